@@ -16,19 +16,33 @@
 #include <asndlib.h>
 
 #include "audio.h"
+#include "resample.h"
 
 extern int ConfigRequested;
 
 /** Locals **/
 static int head = 0;
 static int tail = 0;
-static int gameType = 0;
 
 #define MIXBUFFSIZE 0x10000
 static u8 mixerdata[MIXBUFFSIZE];
 #define MIXERMASK ((MIXBUFFSIZE >> 2) - 1)
 #define SWAP(x) ((x>>16)|(x<<16)) // for reversing stereo channels
 
+#define OUTPUT_RATE 48000
+#define MIXCHUNK 256 // input frames resampled at a time
+static Resampler resampler;
+static u32 resampled[1536]; // stereo frames
+
+// Rate control: system10Frames() paces the emulation by the ring's fill
+// level, what pacing cannot fix is made up by nudging the resample ratio
+#define RATE_RANGE 5000 // ppm, +/- 0.5%
+static bool rateControl = false;
+static int rateLevel = AUDIO_TARGET_FRAMES << 2; // smoothed fill level, x4
+
+u32 audioUnderruns = 0;
+u32 audioOverruns = 0;
+
 static u8 soundbuffer[2][3840] ATTRIBUTE_ALIGN(32);
 static int whichab = 0;
 static int IsPlaying = 0;
@@ -51,9 +65,22 @@ static int MIXER_GetSamples(u8 *dstbuffer, int maxlen)
 		intlen--;
 	}
 
+	if (intlen && IsPlaying)
+		audioUnderruns++;
+
 	return 3200;
 }
 
+/****************************************************************************
+ * AudioBufferedFrames
+ *
+ * Stereo frames in the ring, waiting for the DSP
+ ***************************************************************************/
+int AudioBufferedFrames()
+{
+	return (head - tail) & MIXERMASK;
+}
+
 /****************************************************************************
  * AudioPlayer
  ***************************************************************************/
@@ -83,12 +110,49 @@ void StopAudio()
 }
 
 /****************************************************************************
- * SetAudioRate
+ * ResetAudio
+ *
+ * Starts the resampler over for a new game. The rates come from
+ * SoundWii::init().
+ ***************************************************************************/
+
+void ResetAudio()
+{
+	resampler.reset();
+	SetAudioRateControl(rateControl);
+}
+
+/****************************************************************************
+ * SetAudioRateControl
  ***************************************************************************/
+void SetAudioRateControl(bool enable)
+{
+	rateControl = enable;
+	rateLevel = AUDIO_TARGET_FRAMES << 2;
+	resampler.adjust(0);
+}
 
-void SetAudioRate(int type)
+/****************************************************************************
+ * UpdateAudioRate
+ *
+ * Nudges the resample ratio towards AUDIO_TARGET_FRAMES buffered. Called
+ * right after pacing, when the fill level no longer includes the frames
+ * emulated ahead of time.
+ ***************************************************************************/
+void UpdateAudioRate()
 {
-	gameType = type;
+	if (!rateControl)
+		return;
+
+	rateLevel += AudioBufferedFrames() - (rateLevel >> 2);
+
+	// full range half the target away from it
+	int ppm = ((AUDIO_TARGET_FRAMES - (rateLevel >> 2)) * RATE_RANGE) / (AUDIO_TARGET_FRAMES >> 1);
+	if (ppm > RATE_RANGE)
+		ppm = RATE_RANGE;
+	else if (ppm < -RATE_RANGE)
+		ppm = -RATE_RANGE;
+	resampler.adjust(ppm);
 }
 
 /****************************************************************************
@@ -164,33 +228,38 @@ SoundWii::SoundWii()
 /****************************************************************************
 * SoundWii::write
 *
-* Upsample from 11025 to 48000
-* 11025 == 15052
-* 22050 == 30106
-* 44100 == 60211
-*
-* Audio officianados should look away now !
+* Resamples length bytes of stereo frames to 48000 Hz into the mixer, as
+* many as the ring has room for. Returns the bytes taken.
 ****************************************************************************/
 
-void SoundWii::write(u16 * finalWave, int length)
+int SoundWii::write(u16 * finalWave, int length)
 {
-	u32 *src = (u32 *)finalWave;
+	const s16 *src = (const s16 *)finalWave;
 	u32 *dst = (u32 *)mixerdata;
-	u32 intlen = (3200 >> 2);
-	u32 fixofs = 0;
-	u32 fixinc = 60211; // length = 2940 - GB
-
-	if (gameType == 2) // length = 1468 - GBA
-		fixinc = 30065;
+	int frames = length >> 2;
+	int taken = 0;
 
-	do
+	while (taken < frames)
 	{
-		// Do simple linear interpolate, and swap channels from L-R to R-L
-		dst[head++] = SWAP(src[fixofs >> 16]);
-		head &= MIXERMASK;
-		fixofs += fixinc;
+		int n = frames - taken < MIXCHUNK ? frames - taken : MIXCHUNK;
+
+		if (resampler.maxOutput(n) > MIXERMASK - AudioBufferedFrames())
+		{
+			audioOverruns += frames - taken;
+			break;
+		}
+
+		int out = resampler.process(src, n, (s16 *)resampled);
+
+		for (int i = 0; i < out; ++i)
+		{
+			// swap channels from L-R to R-L
+			dst[head++] = SWAP(resampled[i]);
+			head &= MIXERMASK;
+		}
+		src += n * 2;
+		taken += n;
 	}
-	while( --intlen );
 
 	// Restart Sound Processing if stopped
 	if (IsPlaying == 0)
@@ -198,10 +267,12 @@ void SoundWii::write(u16 * finalWave, int length)
 		ConfigRequested = 0;
 		AudioPlayer();
 	}
+	return taken << 2;
 }
 
 bool SoundWii::init(long sampleRate)
 {
+	resampler.setRates(sampleRate, OUTPUT_RATE);
 	return true;
 }
 
@@ -15,9 +15,17 @@
 
 void InitialiseSound();
 void StopAudio();
-void SetAudioRate(int type);
+void ResetAudio();
 void SwitchAudioMode(int mode);
 void ShutdownAudio();
+void SetAudioRateControl(bool enable);
+void UpdateAudioRate();
+int AudioBufferedFrames();
+
+#define AUDIO_TARGET_FRAMES 3200 // fill level rate control aims for, 4 DMA periods
+
+extern u32 audioUnderruns; // DMA periods the ring could not fill
+extern u32 audioOverruns;  // frames dropped on a full ring
 
 class SoundWii: public SoundDriver
 {
@@ -29,7 +37,7 @@ public:
 	virtual void pause();
 	virtual void reset();
 	virtual void resume();
-	virtual void write(u16 * finalWave, int length);
+	virtual int write(u16 * finalWave, int length);
 };
 
 #endif
@@ -0,0 +1,207 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * fbconvert.cpp
+ *
+ * Frame buffer conversion for the presenter. Each output format has a
+ * portable kernel and, where the CPU has something better, a faster one
+ * that must produce the same bytes.
+ ***************************************************************************/
+
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "fbconvert.h"
+
+/****************************************************************************
+ * TileRGB565
+ *
+ * Each 4x4 tile is 32 bytes, four rows of four pixels
+ ***************************************************************************/
+static void TileRGB565(u8 *dst, const u8 *src, int width, int height, int pitch)
+{
+	u64 *out = (u64 *)dst;
+
+	for(int h = 0; h < height; h += 4)
+	{
+		const u64 *src1 = (const u64 *)(src + pitch * h);
+		const u64 *src2 = (const u64 *)(src + pitch * (h + 1));
+		const u64 *src3 = (const u64 *)(src + pitch * (h + 2));
+		const u64 *src4 = (const u64 *)(src + pitch * (h + 3));
+
+		for(int w = 0; w < (width >> 2); ++w)
+		{
+			*out++ = *src1++;
+			*out++ = *src2++;
+			*out++ = *src3++;
+			*out++ = *src4++;
+		}
+	}
+}
+
+/****************************************************************************
+ * ExpandRGBA8888
+ *
+ * Widens the 5/6/5 bit channels by repeating their top bits
+ ***************************************************************************/
+static void ExpandRGBA8888(u8 *dst, const u8 *src, int width, int height, int pitch)
+{
+	for(int h = 0; h < height; ++h)
+	{
+		const u16 *in = (const u16 *)(src + pitch * h);
+
+		for(int w = 0; w < width; ++w)
+		{
+			u32 c = *in++;
+			u32 r = c >> 11;
+			u32 g = (c >> 5) & 63;
+			u32 b = c & 31;
+
+			*dst++ = (r << 3) | (r >> 2);
+			*dst++ = (g << 2) | (g >> 4);
+			*dst++ = (b << 3) | (b >> 2);
+			*dst++ = 0xFF;
+		}
+	}
+}
+
+#if defined(__SSE2__)
+
+#define FB_KERNEL "sse2"
+
+// A 16 byte load takes 8 pixels of a row, its halves go to neighbouring
+// tiles. Writing the pair is only fast when it fills one 64 byte cache
+// line, any other destination is written a tile at a time.
+static void TileRGB565Vector(u8 *dst, const u8 *src, int width, int height, int pitch)
+{
+	int pairs = ((uintptr_t)dst & 63) ? 0 : (width & ~7);
+
+	for(int h = 0; h < height; h += 4)
+	{
+		const u8 *src1 = src + pitch * h;
+		const u8 *src2 = src1 + pitch;
+		const u8 *src3 = src2 + pitch;
+		const u8 *src4 = src3 + pitch;
+		int w = 0;
+
+		for(; w < pairs; w += 8, dst += 64)
+		{
+			__m128i r1 = _mm_loadu_si128((const __m128i *)(src1 + w * 2));
+			__m128i r2 = _mm_loadu_si128((const __m128i *)(src2 + w * 2));
+			__m128i r3 = _mm_loadu_si128((const __m128i *)(src3 + w * 2));
+			__m128i r4 = _mm_loadu_si128((const __m128i *)(src4 + w * 2));
+
+			_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(r1, r2));
+			_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpacklo_epi64(r3, r4));
+			_mm_storeu_si128((__m128i *)(dst + 32), _mm_unpackhi_epi64(r1, r2));
+			_mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi64(r3, r4));
+		}
+
+		for(; w < width; w += 4, dst += 32)
+		{
+			__m128i r1 = _mm_loadl_epi64((const __m128i *)(src1 + w * 2));
+			__m128i r2 = _mm_loadl_epi64((const __m128i *)(src2 + w * 2));
+			__m128i r3 = _mm_loadl_epi64((const __m128i *)(src3 + w * 2));
+			__m128i r4 = _mm_loadl_epi64((const __m128i *)(src4 + w * 2));
+
+			_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(r1, r2));
+			_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpacklo_epi64(r3, r4));
+		}
+	}
+}
+
+static inline __m128i Widen(__m128i v, int bits)
+{
+	return _mm_or_si128(_mm_slli_epi16(v, 8 - bits), _mm_srli_epi16(v, 2 * bits - 8));
+}
+
+static void ExpandRGBA8888Vector(u8 *dst, const u8 *src, int width, int height, int pitch)
+{
+	const __m128i mask5 = _mm_set1_epi16(31);
+	const __m128i mask6 = _mm_set1_epi16(63);
+	const __m128i alpha = _mm_set1_epi16((short)0xFF00);
+
+	for(int h = 0; h < height; ++h)
+	{
+		const u8 *in = src + pitch * h;
+		int w = 0;
+
+		for(; w + 8 <= width; w += 8, dst += 32)
+		{
+			__m128i c = _mm_loadu_si128((const __m128i *)(in + w * 2));
+			__m128i r = Widen(_mm_srli_epi16(c, 11), 5);
+			__m128i g = Widen(_mm_and_si128(_mm_srli_epi16(c, 5), mask6), 6);
+			__m128i b = Widen(_mm_and_si128(c, mask5), 5);
+			__m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+			__m128i ba = _mm_or_si128(b, alpha);
+
+			_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+
+		if(w < width)
+		{
+			ExpandRGBA8888(dst, in + w * 2, width - w, 1, pitch);
+			dst += (width - w) * 4;
+		}
+	}
+}
+
+#elif defined(HW_RVL) || defined(HW_DOL)
+
+#define FB_KERNEL "dcbz"
+
+// A tile is exactly one 32 byte cache line, dcbz claims the line without
+// reading the old texture from memory first.
+static void TileRGB565Vector(u8 *dst, const u8 *src, int width, int height, int pitch)
+{
+	if((uintptr_t)dst & 31)
+	{
+		TileRGB565(dst, src, width, height, pitch);
+		return;
+	}
+
+	u64 *out = (u64 *)dst;
+
+	for(int h = 0; h < height; h += 4)
+	{
+		const u64 *src1 = (const u64 *)(src + pitch * h);
+		const u64 *src2 = (const u64 *)(src + pitch * (h + 1));
+		const u64 *src3 = (const u64 *)(src + pitch * (h + 2));
+		const u64 *src4 = (const u64 *)(src + pitch * (h + 3));
+
+		for(int w = 0; w < (width >> 2); ++w)
+		{
+			__asm__ volatile ("dcbz 0, %0" : : "r" (out) : "memory");
+			out[0] = *src1++;
+			out[1] = *src2++;
+			out[2] = *src3++;
+			out[3] = *src4++;
+			out += 4;
+		}
+	}
+}
+
+#define ExpandRGBA8888Vector ExpandRGBA8888
+
+#else
+
+#define FB_KERNEL "generic"
+#define TileRGB565Vector TileRGB565
+#define ExpandRGBA8888Vector ExpandRGBA8888
+
+#endif
+
+const FrameFormat frameFormats[FB_FORMATS] =
+{
+	{ "rgb565 tiled", 2, TileRGB565Vector, TileRGB565 },
+	{ "rgba8888", 4, ExpandRGBA8888Vector, ExpandRGBA8888 }
+};
+
+const char *FrameConvertKernel()
+{
+	return FB_KERNEL;
+}
@@ -0,0 +1,43 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * fbconvert.h
+ *
+ * Frame buffer conversion for the presenter
+ ***************************************************************************/
+
+#ifndef _FBCONVERTH_
+#define _FBCONVERTH_
+
+#include "vba/common/Types.h"
+
+// The cores already write RGB565 through systemColorMap16, so a frame only
+// needs to be rearranged into the layout of the output texture. Width and
+// height must be multiples of 4.
+
+enum {
+	FB_RGB565_TILED,	// 4x4 tiles of RGB565, GX_TF_RGB565
+	FB_RGBA8888,		// linear R, G, B, A bytes, for host testing
+	FB_FORMATS
+};
+
+typedef void (*FrameConverter)(u8 *dst, const u8 *src, int width, int height, int pitch);
+
+struct FrameFormat
+{
+	const char *name;
+	int bytesPerPixel;
+	FrameConverter convert;	// fastest kernel this CPU supports
+	FrameConverter scalar;	// portable reference kernel
+};
+
+extern const FrameFormat frameFormats[FB_FORMATS];
+
+const char *FrameConvertKernel();
+
+static inline void ConvertFrame(int format, u8 *dst, const u8 *src, int width, int height, int pitch)
+{
+	frameFormats[format].convert(dst, src, width, height, pitch);
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <ogcsys.h>
 #include <dirent.h>
 #include <sys/stat.h>
@@ -63,6 +64,17 @@ int selectLoadedFile = 0;
 static lwp_t devicethread = LWP_THREAD_NULL;
 static bool deviceHalt = true;
 
+// background save thread, the queued save is guarded by savemutex
+static lwp_t savethread = LWP_THREAD_NULL;
+static mutex_t savemutex = LWP_MUTEX_NULL;
+static cond_t savecond = LWP_COND_NULL;
+static char * saveData = NULL; // queued or being written
+static size_t saveSize = 0;
+static int saveDevice = -1;
+static char savePath[MAXPATHLEN];
+static bool saveResult = true;
+static size_t ReplaceFile(char * buffer, char * filepath, int device, size_t datasize);
+
 /****************************************************************************
  * ResumeDeviceThread
  *
@@ -162,6 +174,26 @@ devicecallback (void *arg)
 }
 #endif
 
+static void *
+savecallback (void *arg)
+{
+	LWP_MutexLock(savemutex);
+	while(1)
+	{
+		while(!saveData)
+			LWP_CondWait(savecond, savemutex);
+		LWP_MutexUnlock(savemutex);
+
+		bool result = ReplaceFile(saveData, savePath, saveDevice, saveSize) == saveSize;
+
+		LWP_MutexLock(savemutex);
+		saveResult = result;
+		saveData = NULL;
+		LWP_CondBroadcast(savecond);
+	}
+	return NULL;
+}
+
 static void *
 parsecallback (void *arg)
 {
@@ -187,6 +219,9 @@ InitDeviceThread()
 	LWP_CreateThread (&devicethread, devicecallback, NULL, NULL, 0, 40);
 #endif
 	LWP_CreateThread (&parsethread, parsecallback, NULL, NULL, 0, 80);
+	LWP_MutexInit (&savemutex, false);
+	LWP_CondInit (&savecond);
+	LWP_CreateThread (&savethread, savecallback, NULL, NULL, 0, 40);
 }
 
 /****************************************************************************
@@ -195,6 +230,8 @@ InitDeviceThread()
  ***************************************************************************/
 void UnmountAllFAT()
 {
+	SaveFileWait(); // the save thread may still be writing
+
 #ifdef HW_RVL
 	fatUnmount("sd:");
 	fatUnmount("usb:");
@@ -251,6 +288,7 @@ static bool MountFAT(int device, int silent)
 
 	if(unmountRequired[device])
 	{
+		SaveFileWait(); // the save thread may still be writing
 		unmountRequired[device] = false;
 		fatUnmount(name2);
 		disc->shutdown();
@@ -851,6 +889,37 @@ size_t LoadFile(char * filepath, bool silent)
 	return LoadFile((char *)savebuffer, filepath, 0, silent);
 }
 
+/****************************************************************************
+ * LoadFilePart
+ * Reads length bytes from offset into a file, without any prompts
+ ***************************************************************************/
+size_t LoadFilePart(char * rbuffer, char *filepath, size_t offset, size_t length)
+{
+	size_t size = 0;
+	int device;
+
+	if(!FindDevice(filepath, &device))
+		return 0;
+
+	HaltDeviceThread();
+	HaltParseThread();
+
+	if(ChangeInterface(device, SILENT))
+	{
+		file = fopen (filepath, "rb");
+
+		if(file)
+		{
+			if(fseeko(file, offset, SEEK_SET) == 0)
+				size = fread (rbuffer, 1, length, file);
+			fclose (file);
+		}
+	}
+
+	ResumeDeviceThread();
+	return size;
+}
+
 /****************************************************************************
  * SaveFile
  * Write buffer to file
@@ -925,3 +994,116 @@ size_t SaveFile(char * filepath, size_t datasize, bool silent)
 {
 	return SaveFile((char *)savebuffer, filepath, datasize, silent);
 }
+
+/****************************************************************************
+ * ReplaceFile
+ * Writes buffer to filepath.tmp, syncs it to the device and renames it over
+ * filepath, so a crash leaves either the old file or the new one. device
+ * must be mounted already. No prompts, no progress.
+ ***************************************************************************/
+static size_t
+ReplaceFile (char * buffer, char * filepath, int device, size_t datasize)
+{
+	char tmppath[MAXPATHLEN];
+	size_t written = 0;
+
+	snprintf(tmppath, MAXPATHLEN, "%s.tmp", filepath);
+
+	FILE * tmpfile = fopen (tmppath, "wb");
+
+	if(!tmpfile)
+		return 0;
+
+	written = fwrite (buffer, 1, datasize, tmpfile);
+
+	if(fflush (tmpfile) != 0 || fsync (fileno (tmpfile)) != 0)
+		written = 0;
+
+	if(fclose (tmpfile) != 0 || written != datasize)
+	{
+		unmountRequired[device] = true;
+		remove(tmppath);
+		return 0;
+	}
+
+	// FAT will not rename over a file
+	remove(filepath);
+
+	if(rename(tmppath, filepath) != 0)
+		return 0;
+	return written;
+}
+
+/****************************************************************************
+ * RecoverFile
+ * Puts back a file that ReplaceFile() removed but could not rename over
+ ***************************************************************************/
+void
+RecoverFile (char * filepath)
+{
+	char tmppath[MAXPATHLEN];
+	struct stat filestat;
+
+	snprintf(tmppath, MAXPATHLEN, "%s.tmp", filepath);
+
+	if(stat(filepath, &filestat) != 0 && stat(tmppath, &filestat) == 0)
+		rename(tmppath, filepath);
+}
+
+/****************************************************************************
+ * SaveFileBackground
+ * Mounts the device of filepath, then hands buffer to the save thread to
+ * write with ReplaceFile(). buffer must be left alone until SaveFileBusy()
+ * returns false. Returns false, without waiting, while the last save is
+ * still being written.
+ ***************************************************************************/
+bool
+SaveFileBackground (char * buffer, char * filepath, size_t datasize)
+{
+	int device;
+
+	if(savethread == LWP_THREAD_NULL || datasize == 0 || SaveFileBusy())
+		return false;
+
+	if(!FindDevice(filepath, &device) || !ChangeInterface(device, SILENT))
+		return false;
+
+	LWP_MutexLock(savemutex);
+	snprintf(savePath, MAXPATHLEN, "%s", filepath);
+	saveSize = datasize;
+	saveDevice = device;
+	saveData = buffer;
+	LWP_CondBroadcast(savecond);
+	LWP_MutexUnlock(savemutex);
+	return true;
+}
+
+bool
+SaveFileBusy ()
+{
+	if(savethread == LWP_THREAD_NULL)
+		return false;
+
+	LWP_MutexLock(savemutex);
+	bool busy = saveData != NULL;
+	LWP_MutexUnlock(savemutex);
+	return busy;
+}
+
+/****************************************************************************
+ * SaveFileWait
+ * Waits for the save thread. Returns whether its last save was written.
+ ***************************************************************************/
+bool
+SaveFileWait ()
+{
+	if(savethread == LWP_THREAD_NULL)
+		return saveResult;
+
+	LWP_MutexLock(savemutex);
+	while(saveData)
+		LWP_CondWait(savecond, savemutex);
+	bool result = saveResult;
+	LWP_MutexUnlock(savemutex);
+	return result;
+}
@@ -37,9 +37,14 @@ void AllocSaveBuffer();
 void FreeSaveBuffer();
 size_t LoadFile(char * rbuffer, char *filepath, size_t length, bool silent);
 size_t LoadFile(char * filepath, bool silent);
+size_t LoadFilePart(char * rbuffer, char *filepath, size_t offset, size_t length);
 size_t LoadSzFile(char * filepath, unsigned char * rbuffer);
 size_t SaveFile(char * buffer, char *filepath, size_t datasize, bool silent);
 size_t SaveFile(char * filepath, size_t datasize, bool silent);
+bool SaveFileBackground(char * buffer, char * filepath, size_t datasize);
+bool SaveFileBusy();
+bool SaveFileWait();
+void RecoverFile(char * filepath);
 
 extern unsigned char *savebuffer;
 extern FILE * file;
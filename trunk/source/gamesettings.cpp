@@ -100,6 +100,21 @@ gamePalette gamePalettes[32] = {
 };
 
 
+// name, game code, saveType, rtcEnabled, flashSize, mirroringEnabled, idleLoop
+// idleLoop may be left out, which lets the core detect idle loops on its own.
+// Set it to -1 for a game that misbehaves when its loops are skipped, or to
+// the address of a loop the detector rejects but that only waits for an
+// interrupt, for example:
+//	{
+//	"Some Game (USA)",
+//	"ABCE",
+//	-1,
+//	-1,
+//	-1,
+//	-1,
+//	0x080002F4 // polls VCOUNT with a read of its own
+//	},
+
 int gameSettingsCount = 106;
 
 gameSetting gameSettings[106] = {
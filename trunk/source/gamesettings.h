@@ -11,7 +11,7 @@
 #ifndef GAMESETTINGS_H
 #define GAMESETTINGS_H
 
-#include <gccore.h>
+#include "vba/common/Types.h"
 
 struct gameSetting {
 	char gameName[100];
@@ -20,6 +20,7 @@ struct gameSetting {
 	int rtcEnabled;
 	int flashSize;
 	int mirroringEnabled;
+	int idleLoop; // 0 = detect, -1 = never skip, or address of the idle loop
 };
 
 extern gameSetting gameSettings[];
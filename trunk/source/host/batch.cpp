@@ -0,0 +1,321 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * batch.cpp
+ *
+ * Batch runner of the headless build. Runs every ROM in a directory for
+ * the same number of frames, each in a process of its own since the cores
+ * keep their state in globals, several processes at a time. Built with an
+ * emulator per thread (CORE_THREADS) the ROMs run on worker threads of
+ * this process instead, where a ROM that crashes ends the whole run.
+ * Prints the speed of each and a crc32 of its last frame and of all its
+ * sound, in a form an earlier run's output can be read back from to
+ * compare against.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <pthread.h>
+
+#include "hostsupport.h"
+
+#include "vba/Util.h"
+#include "vba/common/Bench.h"
+
+extern CORE_LOCAL int cpuIdleLoop;
+
+#define BATCH_MAX 1024 // ROMs a run takes
+#define BATCH_NAME 256
+
+enum { BATCH_OK, BATCH_LOAD_FAILED, BATCH_CRASHED };
+
+struct BatchResult
+{
+	int status;
+	int signal;       // that stopped a crashed run
+	int system;       // cartridgeType
+	u32 screen;       // crc32 of the last frame
+	u32 sound;        // crc32 of every sample
+	u64 time;         // ns spent emulating
+	u64 instructions;
+};
+
+struct BatchRom
+{
+	char name[BATCH_NAME];
+	pid_t pid;
+	int fd;           // the result comes through
+	BatchResult result;
+};
+
+static BatchRom roms[BATCH_MAX];
+
+static int CompareRoms(const void *a, const void *b)
+{
+	return strcmp(((const BatchRom *)a)->name, ((const BatchRom *)b)->name);
+}
+
+// Runs one ROM, in a child process or on a worker thread
+static void RunRom(const char *filepath, int frames, int skip, bool idle, BatchResult *out)
+{
+	BatchResult result;
+	memset(&result, 0, sizeof(result));
+	result.status = BATCH_LOAD_FAILED;
+
+	if(HostLoadROM(filepath))
+	{
+		if(!idle)
+			cpuIdleLoop = -1;
+		systemFrameSkip = skip;
+		hostSoundSum = 0;
+		benchInstructions = 0;
+
+		u64 begin = benchClock();
+		HostRunFrames(frames);
+		HostWaitPresent();
+		result.time = benchClock() - begin;
+
+		result.status = BATCH_OK;
+		result.system = cartridgeType;
+		result.screen = HostScreenSum();
+		result.sound = hostSoundSum;
+		result.instructions = benchInstructions;
+		HostCloseROM();
+	}
+
+	*out = result;
+}
+
+#ifdef CORE_THREADS
+struct BatchWork
+{
+	const char *dirpath;
+	int frames;
+	int skip;
+	bool idle;
+	int count;
+	int next;         // ROM the next free worker takes
+	pthread_mutex_t mutex;
+};
+
+static void *BatchWorker(void *arg)
+{
+	BatchWork *work = (BatchWork *)arg;
+	char filepath[1024];
+
+	while(1)
+	{
+		pthread_mutex_lock(&work->mutex);
+		int i = work->next++;
+		pthread_mutex_unlock(&work->mutex);
+
+		if(i >= work->count)
+			break;
+
+		snprintf(filepath, sizeof(filepath), "%s/%s", work->dirpath, roms[i].name);
+		RunRom(filepath, work->frames, work->skip, work->idle, &roms[i].result);
+	}
+	return NULL;
+}
+#endif
+
+// Looks name up in the output of an earlier run
+static bool FindBaseline(FILE *baseline, const char *name, int *system, u32 *screen, u32 *sound)
+{
+	char line[512];
+	char type[4];
+
+	rewind(baseline);
+	while(fgets(line, sizeof(line), baseline))
+	{
+		char *rom = strstr(line, " MIPS  ");
+		if(!rom || sscanf(line, "%*s %3s screen %x sound %x", type, screen, sound) != 3)
+			continue;
+		rom += 7;
+		rom[strcspn(rom, "\r\n")] = 0;
+		if(strcmp(rom, name))
+			continue;
+		*system = strcmp(type, "GBA") ? 1 : 2;
+		return true;
+	}
+	return false;
+}
+
+/****************************************************************************
+* HostBatch
+*
+* Runs the ROMs in dirpath, jobs at a time, and prints a line for each.
+* With a baseline, the output of an earlier run, marks the ROMs whose
+* frame or sound changed. Returns 1 if any ROM failed or changed.
+****************************************************************************/
+int HostBatch(const char *dirpath, int frames, int skip, bool idle, int jobs, const char *baseline)
+{
+	DIR *dir = opendir(dirpath);
+	if(!dir)
+	{
+		fprintf(stderr, "Cannot open %s\n", dirpath);
+		return 1;
+	}
+
+	int count = 0;
+	struct dirent *entry;
+	char filepath[1024];
+
+	while((entry = readdir(dir)) && count < BATCH_MAX)
+	{
+		snprintf(filepath, sizeof(filepath), "%s/%s", dirpath, entry->d_name);
+		if(entry->d_name[0] == '.' || strlen(entry->d_name) >= BATCH_NAME ||
+			!(utilIsGBAImage(filepath) || utilIsGBImage(filepath)))
+			continue;
+		memset(&roms[count], 0, sizeof(BatchRom));
+		strcpy(roms[count].name, entry->d_name);
+		++count;
+	}
+	closedir(dir);
+	qsort(roms, count, sizeof(BatchRom), CompareRoms);
+
+	if(jobs <= 0)
+		jobs = 1;
+
+	FILE *previous = NULL;
+	if(baseline && !(previous = fopen(baseline, "r")))
+		fprintf(stderr, "Cannot open %s\n", baseline);
+
+	// the children would flush what is buffered again
+	fflush(stdout);
+	fflush(stderr);
+
+	u64 begin = benchClock();
+
+#ifdef CORE_THREADS
+	BatchWork work = { dirpath, frames, skip, idle, count, 0, PTHREAD_MUTEX_INITIALIZER };
+	pthread_t workers[BATCH_MAX];
+	int started = 0;
+
+	if(jobs > count)
+		jobs = count;
+
+	while(started < jobs && pthread_create(&workers[started], NULL, BatchWorker, &work) == 0)
+		++started;
+	if(!started)
+		BatchWorker(&work);
+	for(int i = 0; i < started; ++i)
+		pthread_join(workers[i], NULL);
+#else
+	int next = 0, running = 0;
+
+	while(next < count || running > 0)
+	{
+		while(running < jobs && next < count)
+		{
+			BatchRom *rom = &roms[next++];
+			int fds[2];
+
+			rom->result.status = BATCH_CRASHED;
+			if(pipe(fds) != 0)
+				continue;
+
+			snprintf(filepath, sizeof(filepath), "%s/%s", dirpath, rom->name);
+			rom->pid = fork();
+			if(rom->pid == 0)
+			{
+				BatchResult result;
+				close(fds[0]);
+				RunRom(filepath, frames, skip, idle, &result);
+				if(write(fds[1], &result, sizeof(result)) != sizeof(result))
+					_exit(1);
+				_exit(0);
+			}
+			close(fds[1]);
+			if(rom->pid < 0)
+			{
+				close(fds[0]);
+				continue;
+			}
+			rom->fd = fds[0];
+			++running;
+		}
+
+		int status;
+		pid_t pid = wait(&status);
+		if(pid < 0)
+			break;
+
+		for(int i = 0; i < next; ++i)
+		{
+			BatchRom *rom = &roms[i];
+			if(rom->pid != pid)
+				continue;
+
+			if(read(rom->fd, &rom->result, sizeof(BatchResult)) != sizeof(BatchResult))
+			{
+				rom->result.status = BATCH_CRASHED;
+				rom->result.signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+			}
+			close(rom->fd);
+			rom->pid = 0;
+			--running;
+			break;
+		}
+	}
+#endif
+
+	u64 total = benchClock() - begin;
+	int failed = 0, changed = 0;
+	double emulated = 0;
+
+	for(int i = 0; i < count; ++i)
+	{
+		BatchResult *result = &roms[i].result;
+
+		if(result->status == BATCH_LOAD_FAILED)
+		{
+			printf("FAIL cannot load                                               %s\n", roms[i].name);
+			++failed;
+			continue;
+		}
+		if(result->status == BATCH_CRASHED)
+		{
+			printf("FAIL crashed, signal %-3d                                       %s\n", result->signal, roms[i].name);
+			++failed;
+			continue;
+		}
+
+		const char *mark = "ok";
+		int system;
+		u32 screen, sound;
+
+		if(previous)
+		{
+			if(!FindBaseline(previous, roms[i].name, &system, &screen, &sound))
+				mark = "new";
+			else if(system != result->system || screen != result->screen || sound != result->sound)
+			{
+				mark = "DIFF";
+				++changed;
+			}
+		}
+
+		double seconds = result->time / 1e9;
+		emulated += frames;
+		printf("%-4s %-3s screen %08x sound %08x %8.1f fps %8.2f MIPS  %s\n", mark,
+			result->system == 2 ? "GBA" : "GB", result->screen, result->sound,
+			seconds > 0 ? frames / seconds : 0.0,
+			seconds > 0 ? result->instructions / seconds / 1e6 : 0.0, roms[i].name);
+	}
+
+	printf("batch:        %d ROMs, %d frames each, %d at a time, %.3f s, %.1f frames/s in all\n",
+		count, frames, jobs, total / 1e9, total ? emulated / (total / 1e9) : 0.0);
+	printf("              %d failed%s", failed, previous ? "" : "\n");
+	if(previous)
+	{
+		printf(", %d changed since %s\n", changed, baseline);
+		fclose(previous);
+	}
+
+	return (failed || changed) ? 1 : 0;
+}
@@ -0,0 +1,269 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * bench.cpp
+ *
+ * Headless benchmark runner. Loads a ROM, emulates a fixed number of frames
+ * as fast as possible and reports frames/sec, instructions/sec and the time
+ * spent in each subsystem. Given a directory, runs every ROM in it with
+ * the batch runner instead.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "hostsupport.h"
+#include "fbconvert.h"
+
+#include "vba/common/Bench.h"
+#include "vba/gb/gb.h"
+
+#ifdef THUMB_JIT
+extern int thumbJitMode; // 0 interpreter, 1 recompiler, 2 lockstep compare
+extern u32 thumbJitBlocks;
+extern u32 thumbJitChecked;
+extern u32 thumbJitMismatches;
+#endif
+
+#ifdef GFX_SIMD
+extern int gfxMixMode; // 0 scalar, 1 vector, 2 vector checked against scalar
+extern CORE_LOCAL u32 gfxMixMismatches;
+extern const char *gfxMixName();
+#endif
+
+extern CORE_LOCAL int cpuIdleLoop;
+
+// vba/gba/Scheduler.h
+extern CORE_LOCAL u32 eventsHandled;
+
+// vba/gba/GBA.cpp
+extern CORE_LOCAL u32 dmaTransfers;
+extern CORE_LOCAL u32 dmaBlocks;
+
+// vba/gba/Sound.cpp
+extern CORE_LOCAL u64 soundSamplesDropped;
+
+#define GBA_FPS 59.7275 // 16777216 / 280896
+#define GB_FPS 59.7275  // 4194304 / 70224
+
+static void Usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [options] <rom or directory>\n"
+		"  -f frames    number of frames to emulate (default 600)\n"
+		"  -w frames    warm-up frames, not measured (default 0)\n"
+		"  -s skip      frame skip (default 0, render every frame)\n"
+		"  -o file.ppm  write the last frame to a PPM file\n"
+		"  -v file.wav  write the sound of the measured frames to a WAV file\n"
+		"  -i           run GBA idle loops instead of skipping them\n"
+		"  -p mode      present frames 0 on the emulation thread,\n"
+		"               1 on a render thread (default)\n"
+		"  -t format    texture format 0 tiled RGB565 (default), 1 RGBA8888\n"
+		"  -x count     convert the last frame count times with every\n"
+		"               texture format and report the time per frame\n"
+		"  -r frames    resample frames worth of test tones to 48 kHz and\n"
+		"               report the time per output frame and the images\n"
+		"  -e frames    replay frames GBA frames of timed events with the\n"
+		"               scheduler and with countdowns, report the time per frame\n"
+		"  -z frames    save a compressed and a raw state after each of frames\n"
+		"               frames, report the times and the page deltas, then\n"
+		"               replay the frames from the first raw state\n"
+		"  -k frames    record frames frames into the rewind buffer, then\n"
+		"               rewind through it and check every state\n"
+		"  -b MB        size of the rewind buffer (default 4)\n"
+		"  -a frames    play frames frames without run-ahead and running 1 and\n"
+		"               2 frames ahead, check the runs agree and report the time\n"
+		"               per frame\n"
+		"  -l frames    play frames frames saving the battery in the background,\n"
+		"               report the cost and check the file\n"
+		"  -u passes    time passes passes of GBA loads and stores through the\n"
+		"               page table and through the region decode\n"
+		"  -d passes    unpack a corpus of LZ77, RL and Huffman data passes\n"
+		"               times with the BIOS calls on host pointers and through\n"
+		"               the memory decode, check both give the same memory\n"
+		"  -n jobs      with a directory, ROMs to run at once (default one\n"
+		"               per processor)\n"
+		"  -c file      with a directory, compare the hashes with the output of\n"
+		"               an earlier run kept in file\n"
+#ifdef THUMB_JIT
+		"  -j mode      Thumb core: 0 interpreter, 1 recompiler (default),\n"
+		"               2 recompiler checked against the interpreter\n"
+#endif
+		"  -g mode      GB core: 0 per instruction, 1 batched (default),\n"
+		"               2 batched checked against per instruction\n"
+#ifdef GFX_SIMD
+		"  -m mode      GBA compositing: 0 scalar, 1 vector (default),\n"
+		"               2 vector checked against scalar\n"
+#endif
+		,
+		name);
+}
+
+static double Percent(u64 part, u64 total)
+{
+	return total ? (100.0 * part) / total : 0.0;
+}
+
+/****************************************************************************
+* main
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+	int frames = 600;
+	int warmup = 0;
+	int skip = 0;
+	int converts = 0;
+	int resamples = 0;
+	int events = 0;
+	int states = 0;
+	int rewind = 0;
+	int rewindMB = 4;
+	int runAhead = 0;
+	int sram = 0;
+	int memory = 0;
+	int bios = 0;
+	int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	const char *baseline = NULL;
+	const char *screenshot = NULL;
+	const char *wav = NULL;
+	bool idle = true;
+	int opt;
+
+	while((opt = getopt(argc, argv, "f:w:s:o:v:ip:t:x:r:e:z:k:b:a:l:u:d:n:c:j:g:m:h")) != -1)
+	{
+		switch(opt)
+		{
+			case 'f': frames = atoi(optarg); break;
+			case 'w': warmup = atoi(optarg); break;
+			case 's': skip = atoi(optarg); break;
+			case 'o': screenshot = optarg; break;
+			case 'v': wav = optarg; break;
+			case 'i': idle = false; break;
+			case 'p': hostPresentMode = atoi(optarg); break;
+			case 't': hostPresentFormat = atoi(optarg); break;
+			case 'x': converts = atoi(optarg); break;
+			case 'r': resamples = atoi(optarg); break;
+			case 'e': events = atoi(optarg); break;
+			case 'z': states = atoi(optarg); break;
+			case 'k': rewind = atoi(optarg); break;
+			case 'b': rewindMB = atoi(optarg); break;
+			case 'a': runAhead = atoi(optarg); break;
+			case 'l': sram = atoi(optarg); break;
+			case 'u': memory = atoi(optarg); break;
+			case 'd': bios = atoi(optarg); break;
+			case 'n': jobs = atoi(optarg); break;
+			case 'c': baseline = optarg; break;
+#ifdef THUMB_JIT
+			case 'j': thumbJitMode = atoi(optarg); break;
+#endif
+			case 'g': gbCoreMode = atoi(optarg); break;
+#ifdef GFX_SIMD
+			case 'm': gfxMixMode = atoi(optarg); break;
+#endif
+			default: Usage(argv[0]); return 1;
+		}
+	}
+
+	if(optind >= argc || frames <= 0 || hostPresentFormat < 0 || hostPresentFormat >= FB_FORMATS)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	InitialisePalette();
+
+	struct stat st;
+	if(stat(argv[optind], &st) == 0 && S_ISDIR(st.st_mode))
+		return HostBatch(argv[optind], frames, skip, idle, jobs, baseline);
+
+	if(!HostLoadROM(argv[optind]))
+		return 1;
+
+	if(!idle)
+		cpuIdleLoop = -1;
+
+	HostRunFrames(warmup);
+
+	systemFrameSkip = skip;
+	memset(benchTime, 0, sizeof(benchTime));
+	benchInstructions = 0;
+	eventsHandled = 0;
+	dmaTransfers = dmaBlocks = 0;
+	hostSamplesOut = 0;
+	hostSoundWrites = 0;
+	soundSamplesDropped = 0;
+	hostFramesShown = hostFramesDropped = 0;
+
+	if(wav && !HostSoundWAV(wav))
+		fprintf(stderr, "Cannot write %s\n", wav);
+
+	u64 begin = benchClock();
+	HostRunFrames(frames);
+	HostWaitPresent();
+	u64 total = benchClock() - begin;
+
+	if(wav && !HostSoundWAV(NULL))
+		fprintf(stderr, "Cannot write %s\n", wav);
+
+	double seconds = total / 1e9;
+	double fps = frames / seconds;
+	double native = (cartridgeType == 2) ? GBA_FPS : GB_FPS;
+
+	u64 other = 0;
+	for(int i = 0; i < BENCH_SUBSYSTEMS; i++)
+		other += benchTime[i];
+	u64 cpu = total > other ? total - other : 0;
+
+	printf("rom:          %s (%s)\n", argv[optind], cartridgeType == 2 ? "GBA" : "GB");
+	printf("frames:       %d (skip %d, warm-up %d)\n", frames, skip, warmup);
+	printf("time:         %.3f s\n", seconds);
+	printf("fps:          %.1f (%.0f%% of native speed)\n", fps, 100.0 * fps / native);
+	printf("instructions: %llu (%.2f MIPS)\n", (unsigned long long)benchInstructions,
+		benchInstructions / seconds / 1e6);
+	printf("audio:        %llu samples in %u writes, %llu dropped\n", (unsigned long long)hostSamplesOut,
+		hostSoundWrites, (unsigned long long)soundSamplesDropped);
+	printf("cpu+other:    %8.3f ms/frame %5.1f%%\n", cpu / 1e6 / frames, Percent(cpu, total));
+	printf("render:       %8.3f ms/frame %5.1f%%\n", benchTime[BENCH_RENDER] / 1e6 / frames, Percent(benchTime[BENCH_RENDER], total));
+	printf("sound:        %8.3f ms/frame %5.1f%%\n", benchTime[BENCH_SOUND] / 1e6 / frames, Percent(benchTime[BENCH_SOUND], total));
+	printf("dma:          %8.3f ms/frame %5.1f%%\n", benchTime[BENCH_DMA] / 1e6 / frames, Percent(benchTime[BENCH_DMA], total));
+	printf("present:      %8.3f ms/frame %5.1f%%\n", benchTime[BENCH_PRESENT] / 1e6 / frames, Percent(benchTime[BENCH_PRESENT], total));
+	printf("presenter:    %s, %s, %u frames shown, %u dropped\n",
+		hostPresentMode == HOST_PRESENT_THREAD ? "render thread" : "emulation thread",
+		frameFormats[hostPresentFormat].name, hostFramesShown, hostFramesDropped);
+
+	if(cartridgeType == 2)
+	{
+		printf("events:       %.1f per frame\n", (double)eventsHandled / frames);
+		printf("dma copies:   %u, %u of them as one block\n", dmaTransfers, dmaBlocks);
+	}
+	else
+		printf("gb core:      mode %d, %u batches, %u checked, %u mismatches\n",
+			gbCoreMode, gbCoreBatches, gbCoreChecked, gbCoreMismatches);
+#ifdef THUMB_JIT
+	printf("thumb jit:    mode %d, %u blocks compiled, %u checked, %u mismatches\n",
+		thumbJitMode, thumbJitBlocks, thumbJitChecked, thumbJitMismatches);
+#endif
+#ifdef GFX_SIMD
+	printf("gfx mix:      mode %d (%s), %u mismatches\n",
+		gfxMixMode, gfxMixName(), gfxMixMismatches);
+#endif
+
+	HostBenchConvert(converts);
+	HostBenchResample(resamples);
+	HostBenchEvents(events);
+	HostBenchStates(states);
+	HostBenchRewind(rewind, rewindMB);
+	HostBenchRunAhead(runAhead);
+	HostBenchSram(sram);
+	HostBenchMemory(memory);
+	HostBenchBios(bios);
+
+	if(screenshot && !HostWriteScreenPPM(screenshot))
+		fprintf(stderr, "Cannot write %s\n", screenshot);
+
+	HostCloseROM();
+	return 0;
+}
@@ -0,0 +1,140 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * hostaudio.cpp
+ *
+ * Sound output checks of the headless host build. Runs the resampler of
+ * audio.cpp against the nearest-sample picking it replaced.
+ ***************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hostsupport.h"
+#include "resample.h"
+
+#include "vba/common/Bench.h"
+#include "vba/gba/Sound.h"
+
+#define OUTPUT_RATE 48000
+
+/****************************************************************************
+ * Nearest
+ *
+ * The converter SoundWii::write() used to have, without the fixed output
+ * length: every output frame repeats the input frame before it. fixofs
+ * carries the position over to the next block, with 32 fraction bits like
+ * the resampler instead of 16, so that only the images tell them apart.
+ ***************************************************************************/
+static int Nearest(const s16 *in, int frames, s16 *out, u64 fixinc, u64 &fixofs)
+{
+	const u32 *src = (const u32 *)in;
+	u32 *dst = (u32 *)out;
+	int n = 0;
+
+	for(; (int)(fixofs >> 32) < frames; fixofs += fixinc)
+		dst[n++] = src[fixofs >> 32];
+	fixofs -= (u64)frames << 32;
+	return n;
+}
+
+/****************************************************************************
+ * Distortion
+ *
+ * Fits a sine of the tone's frequency to the left channel by least squares
+ * and returns the power of what is left over, relative to the tone, in dB.
+ * The images of the tone are most of it.
+ ***************************************************************************/
+static double Distortion(const s16 *samples, int frames, double freq)
+{
+	double w = 2 * M_PI * freq / OUTPUT_RATE;
+	double ss = 0, cc = 0, sc = 0, xs = 0, xc = 0, xx = 0;
+
+	for(int i = 0; i < frames; ++i)
+	{
+		double s = sin(w * i), c = cos(w * i), x = samples[i * 2];
+		ss += s * s;
+		cc += c * c;
+		sc += s * c;
+		xs += x * s;
+		xc += x * c;
+		xx += x * x;
+	}
+
+	double det = ss * cc - sc * sc;
+	double a = (xs * cc - xc * sc) / det;
+	double b = (xc * ss - xs * sc) / det;
+	double tone = a * xs + b * xc;
+	return 10 * log10((xx - tone) / tone);
+}
+
+/****************************************************************************
+ * HostBenchResample
+ *
+ * Converts blocks frames worth of test tones from the sample rate of the
+ * loaded ROM to 48000 Hz with both converters. Reports the time per output
+ * frame and the worst distortion, mostly images above the source's Nyquist
+ * frequency.
+ ***************************************************************************/
+void HostBenchResample(int blocks)
+{
+	static const double tones[] = { 0.05, 0.15, 0.3 }; // of the input rate
+	long rate = soundGetSampleRate();
+	int block = rate / 60;
+	int maxout = block * 2 * OUTPUT_RATE / rate + RESAMPLE_TAPS;
+
+	if(blocks <= 0)
+		return;
+
+	s16 *in = (s16 *)malloc(block * blocks * 4);
+	s16 *out = (s16 *)malloc(maxout * blocks * 4);
+	u64 fixinc = ((u64)rate << 32) / OUTPUT_RATE;
+	Resampler resampler;
+
+	resampler.setRates(rate, OUTPUT_RATE);
+
+	for(int m = 0; m < 2; ++m)
+	{
+		double worst = -200;
+		u64 time = 0;
+		int written = 0;
+
+		for(unsigned t = 0; t < sizeof(tones) / sizeof(tones[0]); ++t)
+		{
+			double freq = tones[t] * rate;
+
+			for(int i = 0; i < block * blocks; ++i)
+				in[i * 2] = in[i * 2 + 1] = (s16)(16000 * sin(2 * M_PI * freq * i / rate));
+
+			resampler.reset();
+			written = 0;
+			u64 fixofs = 0;
+
+			u64 begin = benchClock();
+			for(int b = 0; b < blocks; ++b)
+			{
+				const s16 *src = in + b * block * 2;
+				s16 *dst = out + written * 2;
+
+				if(m)
+					written += resampler.process(src, block, dst);
+				else
+					written += Nearest(src, block, dst, fixinc, fixofs);
+			}
+			time += benchClock() - begin;
+
+			// skip the filter's start-up
+			double db = Distortion(out + 64, written - 64, freq);
+			if(db > worst)
+				worst = db;
+		}
+
+		printf("resample:     %-9s %6.2f ns/frame, distortion %6.1f dB (%ld -> %d Hz, %d frames)\n",
+			m ? "polyphase" : "nearest", (double)time / (written * 3.0), worst,
+			rate, OUTPUT_RATE, written);
+	}
+
+	free(in);
+	free(out);
+}
@@ -0,0 +1,1622 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * hostsupport.cpp
+ *
+ * VBA support code for the headless host build. Provides the system*
+ * callbacks that vbasupport.cpp implements on the Wii/GameCube, without
+ * any video/audio pacing, so the cores can be run and measured on a PC.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "hostsupport.h"
+#include "gamesettings.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "sramsave.h"
+
+#include "vba/Util.h"
+#include "vba/common/Port.h"
+#include "vba/common/Bench.h"
+#include "vba/common/SoundDriver.h"
+#include "vba/common/RawState.h"
+#include "vba/common/StateFile.h"
+#include "vba/gba/Flash.h"
+#include "vba/gba/RTC.h"
+#include "vba/gba/Sound.h"
+#include "vba/gba/GBA.h"
+#include "vba/gba/bios.h"
+#include "vba/gba/Scheduler.h"
+#include "vba/gba/agbprint.h"
+#include "vba/gba/Globals.h"
+#include "vba/gba/GBAinline.h"
+#include "vba/gb/gb.h"
+#include "vba/gb/gbGlobals.h"
+#include "vba/gb/gbSound.h"
+
+CORE_LOCAL int cartridgeType = 0;
+CORE_LOCAL u32 RomIdCode;
+
+CORE_LOCAL int hostFrameCount = 0;
+CORE_LOCAL u32 hostJoypad = 0;
+CORE_LOCAL u64 hostSamplesOut = 0;
+CORE_LOCAL u32 hostSoundSum = 0;
+CORE_LOCAL u32 hostSoundWrites = 0;
+
+static CORE_LOCAL int hostFrameTarget = 0;
+static CORE_LOCAL u64 start;
+
+#ifdef BENCHMARK
+CORE_LOCAL u64 benchTime[BENCH_SUBSYSTEMS];
+CORE_LOCAL u64 benchInstructions = 0;
+#endif
+
+/****************************************************************************
+ * VBA Globals
+ ***************************************************************************/
+
+CORE_LOCAL int systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+
+int systemDebug = 0;
+CORE_LOCAL int emulating = 0;
+
+CORE_LOCAL int systemFrameSkip = 0;
+int systemVerbose = 0;
+
+int systemRedShift = 0;
+int systemBlueShift = 0;
+int systemGreenShift = 0;
+int systemColorDepth = 0;
+u16 systemGbPalette[24];
+u16 systemColorMap16[0x10000];
+u32 *systemColorMap32 = NULL;
+
+void StopColorizing();
+extern bool gbUpdateSizes();
+extern bool CPUIsELF(const char *);
+
+CORE_LOCAL struct EmulatedSystem emulator =
+{
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	false,
+	0
+};
+
+/****************************************************************************
+* systemGetClock
+*
+* Returns number of milliseconds since program start
+****************************************************************************/
+static u64 HostTime()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+u32 systemGetClock()
+{
+	return (u32)(HostTime() - start);
+}
+
+void systemFrame()
+{
+	++hostFrameCount;
+	RunAheadFrameEnd();
+}
+
+// stop the core at the end of the frame that reaches the target
+bool systemPauseOnFrame()
+{
+	return hostFrameCount >= hostFrameTarget || RunAheadPause();
+}
+
+void systemScreenCapture(int a) {}
+void systemShowSpeed(int speed) {}
+void systemGbBorderOn() {}
+
+// no pacing and no automatic frame skip on the host
+void system10Frames(int rate) {}
+
+/****************************************************************************
+* System
+****************************************************************************/
+
+void systemGbPrint(u8 *data,int pages,int feed,int palette, int contrast) {}
+void debuggerOutput(const char *s, u32 addr) {}
+void (*dbgOutput)(const char *s, u32 addr) = debuggerOutput;
+
+void systemMessage(int num, const char *msg, ...)
+{
+	va_list args;
+	va_start(args, msg);
+	vfprintf(stderr, msg, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+/****************************************************************************
+* Sound
+*
+* Null driver, samples are counted and thrown away, or written to the WAV
+* file HostSoundWAV() opened
+****************************************************************************/
+
+static CORE_LOCAL FILE *wavFile = NULL;
+static CORE_LOCAL u32 wavBytes = 0;
+
+class SoundHost: public SoundDriver
+{
+public:
+	virtual bool init(long sampleRate) { return true; }
+	virtual void pause() {}
+	virtual void reset() {}
+	virtual void resume() {}
+	virtual int write(u16 * finalWave, int length)
+	{
+		hostSamplesOut += length >> 2;
+		hostSoundSum = crc32(hostSoundSum, (const Bytef *)finalWave, length);
+		hostSoundWrites++;
+
+		if(wavFile && fwrite(finalWave, 1, length, wavFile) == (size_t)length)
+			wavBytes += length;
+		return length;
+	}
+};
+
+// 16 bit stereo PCM at the core's sample rate, bytes of samples after it
+static void WAVHeader(u8 *header, u32 bytes)
+{
+	u32 rate = soundGetSampleRate();
+
+	memcpy(header, "RIFF", 4);
+	WRITE32LE(((u32 *)&header[4]), 36 + bytes);
+	memcpy(&header[8], "WAVEfmt ", 8);
+	WRITE32LE(((u32 *)&header[16]), 16);
+	WRITE16LE(((u16 *)&header[20]), 1); // PCM
+	WRITE16LE(((u16 *)&header[22]), 2); // channels
+	WRITE32LE(((u32 *)&header[24]), rate);
+	WRITE32LE(((u32 *)&header[28]), rate * 4);
+	WRITE16LE(((u16 *)&header[32]), 4); // bytes per sample
+	WRITE16LE(((u16 *)&header[34]), 16);
+	memcpy(&header[36], "data", 4);
+	WRITE32LE(((u32 *)&header[40]), bytes);
+}
+
+/****************************************************************************
+* HostSoundWAV
+*
+* Starts writing the sound to filepath, or with NULL finishes the file
+****************************************************************************/
+bool HostSoundWAV(const char *filepath)
+{
+	u8 header[44];
+
+	if(!filepath)
+	{
+		if(!wavFile)
+			return false;
+
+		WAVHeader(header, wavBytes);
+		bool ok = fseek(wavFile, 0, SEEK_SET) == 0 && fwrite(header, 1, 44, wavFile) == 44;
+		if(fclose(wavFile) != 0)
+			ok = false;
+		wavFile = NULL;
+		return ok;
+	}
+
+	wavFile = fopen(filepath, "wb");
+	if(!wavFile)
+		return false;
+
+	wavBytes = 0;
+	WAVHeader(header, 0);
+	return fwrite(header, 1, 44, wavFile) == 44;
+}
+
+SoundDriver * systemSoundInit()
+{
+	soundShutdown();
+	return new SoundHost();
+}
+
+bool systemCanChangeSoundQuality()
+{
+	return true;
+}
+
+void systemOnWriteDataToSoundBuffer(const u16 * finalWave, int length)
+{
+}
+
+void systemOnSoundShutdown()
+{
+}
+
+/****************************************************************************
+* systemReadJoypads
+****************************************************************************/
+bool systemReadJoypads()
+{
+	return true;
+}
+
+u32 systemReadJoypad(int which)
+{
+	return hostJoypad;
+}
+
+void systemCartridgeRumble(bool RumbleOn) {}
+void systemPossibleCartridgeRumble(bool RumbleOn) {}
+void updateRumbleFrame() {}
+
+/****************************************************************************
+* Motion/Tilt/Solar sensors - always report a level, sunlit cartridge
+****************************************************************************/
+int systemGetSensorX()
+{
+	return 2047;
+}
+
+int systemGetSensorY()
+{
+	return 2047;
+}
+
+int systemGetSensorZ()
+{
+	return 0x6C0;
+}
+
+u8 systemGetSensorDarkness()
+{
+	return 0xE8 - 0x50;
+}
+
+void systemUpdateMotionSensor()
+{
+}
+
+/****************************************************************************
+* systemDrawScreen
+****************************************************************************/
+static CORE_LOCAL int srcWidth = 0;
+static CORE_LOCAL int srcHeight = 0;
+static CORE_LOCAL int srcPitch = 0;
+
+void systemDrawScreen()
+{
+	if(!RunAheadDraws())
+		return;
+
+	BENCH_BEGIN(BENCH_PRESENT);
+	GX_Render(srcWidth, srcHeight, pix, srcPitch);
+	BENCH_END(BENCH_PRESENT);
+}
+
+/****************************************************************************
+ * ApplyPerImagePreferences
+ * Apply game specific settings, same table as the console builds
+ ***************************************************************************/
+
+static void ApplyPerImagePreferences()
+{
+	int snum = -1;
+	RomIdCode = rom[0xac] | (rom[0xad] << 8) | (rom[0xae] << 16) | (rom[0xaf] << 24);
+
+	for(int i=0; i < gameSettingsCount; ++i)
+	{
+		if(gameSettings[i].gameID[0] == rom[0xac] &&
+			gameSettings[i].gameID[1] == rom[0xad] &&
+			gameSettings[i].gameID[2] == rom[0xae] &&
+			gameSettings[i].gameID[3] == rom[0xaf])
+		{
+			snum = i;
+			break;
+		}
+	}
+
+	if(snum >= 0)
+	{
+		if(gameSettings[snum].rtcEnabled >= 0)
+			rtcEnable(gameSettings[snum].rtcEnabled);
+		if(gameSettings[snum].flashSize > 0)
+			flashSetSize(gameSettings[snum].flashSize);
+		if(gameSettings[snum].saveType >= 0)
+			cpuSaveType = gameSettings[snum].saveType;
+		if(gameSettings[snum].mirroringEnabled >= 0)
+			mirroringEnable = gameSettings[snum].mirroringEnabled;
+		if(gameSettings[snum].idleLoop != 0)
+			cpuIdleLoop = gameSettings[snum].idleLoop;
+	}
+
+	switch (rom[0xac])
+	{
+		case 'F': // Classic NES
+			cpuSaveType = 1; // EEPROM
+			mirroringEnable = 1;
+			break;
+		case 'K': // Accelerometers
+			cpuSaveType = 4; // EEPROM + sensor
+			break;
+		case 'R': // WarioWare Twisted style sensors
+		case 'V': // Drill Dozer
+			rtcEnableWarioRumble(true);
+			break;
+		case 'U': // Boktai solar sensor and clock
+			rtcEnable(true);
+			break;
+	}
+}
+
+/****************************************************************************
+* HostLoadFile
+*
+* Reads up to maxsize bytes of a file into buffer, returns the size read
+****************************************************************************/
+static int HostLoadFile(const char *filepath, u8 *buffer, int maxsize)
+{
+	FILE *file = fopen(filepath, "rb");
+
+	if(!file)
+		return 0;
+
+	int size = fread(buffer, 1, maxsize, file);
+	fclose(file);
+	return size;
+}
+
+static bool LoadGBAROM(const char *filepath)
+{
+	emulator = GBASystem;
+
+	if(!CPULoadRom(filepath))
+		return false;
+
+	if(!CPUIsELF(filepath) && HostLoadFile(filepath, rom, 0x2000000) <= 0)
+	{
+		CPUCleanUp();
+		return false;
+	}
+
+	soundSetSampleRate(22050); //44100 / 2
+
+	// Set defaults
+	cpuSaveType = 0; // automatic
+	flashSetSize(0x10000); // 64K saves
+	rtcEnable(false);
+	agbPrintEnable(false);
+	mirroringEnable = false;
+	cpuIdleLoop = 0; // detect idle loops
+
+	ApplyPerImagePreferences();
+	doMirroring(mirroringEnable);
+
+	soundReset();
+	CPUInit(NULL, false);
+	CPUReset();
+	return true;
+}
+
+static bool LoadGBROM(const char *filepath)
+{
+	emulator = GBSystem;
+
+	gbBorderOn = 0;
+	gbBorderLineSkip = 160;
+	gbBorderColumnSkip = 0;
+	gbBorderRowSkip = 0;
+
+	gbRom = (u8 *)malloc(1024*1024*4); // allocate 4 MB to GB ROM
+	bios = (u8 *)calloc(1,0x100);
+
+	if(!gbRom || !bios)
+		return false;
+
+	gbRomSize = HostLoadFile(filepath, gbRom, 1024*1024*4);
+
+	if(gbRomSize <= 0 || !gbUpdateSizes())
+		return false;
+
+	soundSetSampleRate(44100);
+
+	gbGetHardwareType();
+
+	// monochrome games keep the stock palette
+	StopColorizing();
+
+	gbSoundReset();
+	gbSoundSetDeclicking(true);
+	gbReset();
+	return true;
+}
+
+/****************************************************************************
+* HostLoadROM
+*
+* Loads a GBA or GB/GBC image, picked by file extension
+****************************************************************************/
+bool HostLoadROM(const char *filepath)
+{
+	bool loaded = false;
+
+	HostCloseROM();
+
+	if(utilIsGBAImage(filepath))
+		cartridgeType = 2;
+	else if(utilIsGBImage(filepath))
+		cartridgeType = 1;
+	else
+	{
+		systemMessage(0, "Unrecognized file extension: %s", filepath);
+		return false;
+	}
+
+	soundInit();
+
+	if(cartridgeType == 2)
+	{
+		srcWidth = 240;
+		srcHeight = 160;
+		srcPitch = 484;
+		loaded = LoadGBAROM(filepath);
+	}
+	else
+	{
+		srcWidth = 160;
+		srcHeight = 144;
+		srcPitch = 324;
+		loaded = LoadGBROM(filepath);
+	}
+
+	if(!loaded)
+	{
+		systemMessage(0, "Error loading game: %s", filepath);
+		HostCloseROM();
+		return false;
+	}
+
+	GX_Render_Init(srcWidth, srcHeight);
+
+	emulating = 1;
+	systemFrameSkip = 0;
+	hostFrameCount = hostFrameTarget = 0;
+	start = HostTime();
+	return true;
+}
+
+void HostCloseROM()
+{
+	HostWaitPresent();
+
+	if(cartridgeType == 2)
+		CPUCleanUp();
+	else if(cartridgeType == 1)
+		gbCleanUp();
+
+	cartridgeType = 0;
+	emulating = 0;
+}
+
+/****************************************************************************
+* HostRunFrames
+*
+* Emulates exactly the given number of frames
+****************************************************************************/
+void HostRunFrames(int frames)
+{
+	hostFrameTarget = hostFrameCount + frames;
+
+	while(emulating && hostFrameCount < hostFrameTarget)
+		emulator.emuMain(emulator.emuCount);
+}
+
+/****************************************************************************
+* HostWriteScreenPPM
+*
+* Dumps the last rendered frame (RGB565 in pix) as a binary PPM
+****************************************************************************/
+bool HostWriteScreenPPM(const char *filepath)
+{
+	int width = (cartridgeType == 2) ? 240 : 160;
+	int height = (cartridgeType == 2) ? 160 : 144;
+	int pitch = width + 2; // in pixels, see CPULoop() and gbDrawLine()
+
+	if(!pix)
+		return false;
+
+	FILE *file = fopen(filepath, "wb");
+
+	if(!file)
+		return false;
+
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+	for(int y = 0; y < height; y++)
+	{
+		u16 *src = (u16 *)pix + pitch * (y + 1);
+		for(int x = 0; x < width; x++)
+		{
+			u16 c = src[x];
+			u8 rgb[3];
+			rgb[0] = ((c >> systemRedShift) & 0x1f) << 3;
+			rgb[1] = ((c >> systemGreenShift) & 0x1f) << 3;
+			rgb[2] = ((c >> systemBlueShift) & 0x1f) << 3;
+			fwrite(rgb, 1, 3, file);
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+/****************************************************************************
+* HostBenchStates
+*
+* Saves a state after each of frames frames, compressed like the memory
+* states of the menu and raw with a page delta against the state before.
+* Then loads the first raw state, emulates the same frames again and
+* checks that the last state comes out byte for byte the same. The last
+* compressed state also goes into a version 2 state file, with the first
+* raw state standing in for the screen, to time finding a chunk in it.
+****************************************************************************/
+#define STATE_BUFFER (2 * 1024 * 1024)
+
+void HostBenchStates(int frames)
+{
+	if(frames <= 0 || !emulator.emuWriteRawState)
+		return;
+
+	char *gz = (char *)malloc(STATE_BUFFER);
+	char *first = (char *)malloc(STATE_BUFFER);
+	char *prev = (char *)malloc(STATE_BUFFER);
+	char *cur = (char *)malloc(STATE_BUFFER);
+	char *check = (char *)malloc(STATE_BUFFER);
+	u8 *delta = (u8 *)malloc(STATE_BUFFER);
+	u64 gzTime = 0, rawTime = 0, deltaTime = 0, deltaBytes = 0;
+	int mismatches = 0;
+
+	int firstSize = emulator.emuWriteRawState(first, STATE_BUFFER);
+	int prevSize = firstSize;
+	memcpy(prev, first, firstSize);
+
+	for(int f = 0; f < frames; ++f)
+	{
+		HostRunFrames(1);
+
+		u64 begin = benchClock();
+		emulator.emuWriteMemState(gz, STATE_BUFFER);
+		gzTime += benchClock() - begin;
+
+		begin = benchClock();
+		int size = emulator.emuWriteRawState(cur, STATE_BUFFER);
+		rawTime += benchClock() - begin;
+
+		begin = benchClock();
+		int bytes = rawStateDelta((u8 *)prev, prevSize, (u8 *)cur, size, delta, STATE_BUFFER);
+		deltaTime += benchClock() - begin;
+		deltaBytes += bytes;
+
+		memcpy(check, prev, prevSize);
+		if(bytes < 0 || rawStateApply((u8 *)check, STATE_BUFFER, delta) != size ||
+			memcmp(check, cur, size))
+			++mismatches;
+
+		char *t = prev;
+		prev = cur;
+		cur = t;
+		prevSize = size;
+	}
+
+	u8 *file = (u8 *)malloc(STATE_BUFFER);
+	int screenSize = firstSize < 32768 ? firstSize : 32768;
+	StateChunk chunk;
+
+	u64 begin = benchClock();
+	stateFileBegin(file);
+	stateFileAdd(file, STATE_BUFFER, STATEFILE_SCREEN, (u8 *)first, screenSize);
+	int next = stateFileNext(file);
+	emulator.emuWriteMemState((char *)file + next, STATE_BUFFER - next);
+	bool written = stateFileAdd(file, STATE_BUFFER, STATEFILE_STATE, file + next,
+		*((int *)(file + next + 4)) + 8);
+	u64 fileTime = benchClock() - begin;
+	int fileSize = stateFileSize(file);
+
+	begin = benchClock();
+	bool screen = stateFileFind(file, STATEFILE_HEADER, STATEFILE_SCREEN, &chunk) &&
+		stateFileCheck(file + chunk.offset, &chunk) && chunk.size == (u32)screenSize &&
+		!memcmp(file + chunk.offset, first, screenSize);
+	u64 findTime = benchClock() - begin;
+
+	begin = benchClock();
+	bool state = written && stateFileFind(file, fileSize, STATEFILE_STATE, &chunk) &&
+		stateFileCheck(file + chunk.offset, &chunk) &&
+		emulator.emuReadMemState((char *)file + chunk.offset, chunk.size);
+	u64 gzLoad = benchClock() - begin;
+
+	begin = benchClock();
+	bool loaded = emulator.emuReadRawState(first, firstSize);
+	u64 rawLoad = benchClock() - begin;
+
+	// a frame per call as before, CPULoop() stopping at the end of each
+	// frame shifts the later events a little
+	for(int f = 0; f < frames; ++f)
+		HostRunFrames(1);
+	int size = emulator.emuWriteRawState(cur, STATE_BUFFER);
+	bool same = loaded && size == prevSize && !memcmp(cur, prev, size);
+
+	printf("states:       gz save %.3f ms, load %.3f ms; raw save %.3f ms, load %.3f ms\n",
+		gzTime / 1e6 / frames, gzLoad / 1e6, rawTime / 1e6 / frames, rawLoad / 1e6);
+	printf("              raw %d bytes, page delta %.3f ms, %.0f bytes/frame, %d mismatches, replay %s\n",
+		prevSize, deltaTime / 1e6 / frames, (double)deltaBytes / frames, mismatches,
+		same ? "identical" : "DIFFERS");
+	printf("              file %d bytes in %.3f ms, screen from %d bytes %s in %.3f ms, state %s\n",
+		fileSize, fileTime / 1e6, STATEFILE_HEADER + screenSize, screen ? "found" : "MISSING",
+		findTime / 1e6, state ? "loaded" : "FAILED");
+
+	free(file);
+	free(gz);
+	free(first);
+	free(prev);
+	free(cur);
+	free(check);
+	free(delta);
+}
+
+/****************************************************************************
+* HostBenchRewind
+*
+* Records frames frames into a rewind arena of megabytes MB the way the
+* emulation loop does, with a checksum of every snapshot taken. Then
+* rewinds through all that are held and checks each state it loads.
+****************************************************************************/
+void HostBenchRewind(int frames, int megabytes)
+{
+	if(frames <= 0 || !emulator.emuWriteRawState)
+		return;
+
+	int taken = frames / REWIND_INTERVAL;
+	u32 *sums = (u32 *)malloc((taken + 1) * sizeof(u32));
+	char *check = (char *)malloc(REWIND_STATE_MAX);
+	u64 captureTime = 0, captureMax = 0, stepTime = 0;
+	int mismatches = 0, steps = 0;
+
+	RewindInit(megabytes);
+	RewindReset();
+	taken = 0;
+
+	for(int f = 0; f < frames; ++f)
+	{
+		HostRunFrames(1);
+		RewindFrame();
+
+		bool capture = (f + 1) % REWIND_INTERVAL == 0;
+		u64 begin = benchClock();
+		RewindUpdate(false);
+		u64 time = benchClock() - begin;
+
+		if(capture)
+		{
+			captureTime += time;
+			if(time > captureMax)
+				captureMax = time;
+
+			int size = emulator.emuWriteRawState(check, REWIND_STATE_MAX);
+			sums[taken++] = crc32(0, (const Bytef *)check, size);
+		}
+	}
+
+	int held = RewindSnapshots();
+	int bytes = RewindBytes();
+
+	while(steps < held - 1)
+	{
+		u64 begin = benchClock();
+		RewindUpdate(true);
+		stepTime += benchClock() - begin;
+		++steps;
+
+		int size = emulator.emuWriteRawState(check, REWIND_STATE_MAX);
+		if(crc32(0, (const Bytef *)check, size) != sums[taken - 1 - steps])
+			++mismatches;
+	}
+
+	printf("rewind:       %d MB, %d snapshots (%.1f s), %d bytes/snapshot\n",
+		megabytes, held, held * REWIND_INTERVAL / 59.7275, held > 1 ? bytes / (held - 1) : 0);
+	printf("              capture %.3f ms (max %.3f), step back %.3f ms, %d mismatches\n",
+		taken ? captureTime / 1e6 / taken : 0, captureMax / 1e6,
+		steps ? stepTime / 1e6 / steps : 0, mismatches);
+
+	RewindInit(0);
+	free(sums);
+	free(check);
+}
+
+// crc32 of the last frame drawn
+u32 HostScreenSum()
+{
+	int height = (cartridgeType == 2) ? 160 : 144;
+
+	return crc32(0, (const Bytef *)pix + srcPitch, height * srcPitch);
+}
+
+/****************************************************************************
+* HostBenchRunAhead
+*
+* Plays frames frames from the same state without run-ahead, then running
+* 1 and 2 frames ahead. A run ahead has to leave the same state and sound
+* as the plain one and show each frame as many frames earlier. Reports the
+* time per frame, the part of it the snapshots and restores take and how
+* much of the 16.7 ms of a frame at 60 fps is used.
+****************************************************************************/
+void HostBenchRunAhead(int frames)
+{
+	if(frames <= 0 || !emulator.emuWriteRawState)
+		return;
+
+	char *start = (char *)malloc(REWIND_STATE_MAX);
+	char *check = (char *)malloc(REWIND_STATE_MAX);
+	u32 *screens = (u32 *)malloc((frames + RUNAHEAD_MAX) * sizeof(u32));
+	int startSize = emulator.emuWriteRawState(start, REWIND_STATE_MAX);
+	u32 stateSum = 0, soundSum = 0;
+
+	RunAheadInit(RUNAHEAD_MAX);
+
+	for(int ahead = 0; ahead <= RUNAHEAD_MAX; ++ahead)
+	{
+		int mismatches = 0;
+		u64 worst = 0;
+
+		emulator.emuReadRawState(start, startSize);
+		hostSoundSum = 0;
+		benchTime[BENCH_STATE] = 0;
+
+		u64 begin = benchClock();
+		for(int f = 0; f < frames; ++f)
+		{
+			u64 time = benchClock();
+			RunAheadFrame(ahead);
+			time = benchClock() - time;
+			if(time > worst)
+				worst = time;
+
+			if(!ahead)
+				screens[f] = HostScreenSum();
+			else if(HostScreenSum() != screens[f + ahead])
+				++mismatches;
+		}
+		u64 total = benchClock() - begin;
+
+		// A run ahead ends with the sound written out up to the state it
+		// loaded back and the sound frame split there, end the plain run
+		// the same way
+		if(!ahead)
+		{
+			if(cartridgeType == 2)
+				soundHoldOutput();
+			else
+				gbSoundHoldOutput();
+		}
+
+		int size = emulator.emuWriteRawState(check, REWIND_STATE_MAX);
+		u32 sum = crc32(0, (const Bytef *)check, size);
+
+		if(!ahead)
+		{
+			stateSum = sum;
+			soundSum = hostSoundSum;
+
+			emulator.emuReadRawState(check, size);
+			if(cartridgeType == 2)
+				soundReleaseOutput();
+			else
+				gbSoundReleaseOutput();
+
+			// the frames the last ones run ahead to
+			for(int f = frames; f < frames + RUNAHEAD_MAX; ++f)
+			{
+				RunAheadFrame(0);
+				screens[f] = HostScreenSum();
+			}
+		}
+
+		double ms = total / 1e6 / frames;
+		printf("run-ahead %d:  %.3f ms/frame (max %.3f), %.1f%% of 60 fps, snapshot+restore %.3f ms\n",
+			ahead, ms, worst / 1e6, ms * 6, benchTime[BENCH_STATE] / 1e6 / frames);
+		if(ahead)
+			printf("              %d frames shown wrong, state %s, sound %s\n", mismatches,
+				sum == stateSum ? "same" : "DIFFERS", hostSoundSum == soundSum ? "same" : "DIFFERS");
+	}
+
+	RunAheadInit(0);
+	free(start);
+	free(check);
+	free(screens);
+}
+/****************************************************************************
+* Background saves, the save thread of fileop.cpp. It writes filepath.tmp,
+* syncs it to the disk and renames it over filepath.
+****************************************************************************/
+static pthread_t savethread;
+static pthread_mutex_t savemutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t savecond = PTHREAD_COND_INITIALIZER;
+static bool saveStarted = false;
+static char *saveData = NULL;
+static size_t saveSize = 0;
+static char savePath[1024];
+static bool saveResult = true;
+static u64 saveTime = 0; // spent writing on the save thread
+
+static size_t ReplaceFile(char *buffer, char *filepath, size_t datasize)
+{
+	char tmppath[1040];
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", filepath);
+
+	FILE *file = fopen(tmppath, "wb");
+	if(!file)
+		return 0;
+
+	size_t written = fwrite(buffer, 1, datasize, file);
+	if(fflush(file) != 0 || fsync(fileno(file)) != 0)
+		written = 0;
+	if(fclose(file) != 0 || written != datasize)
+	{
+		remove(tmppath);
+		return 0;
+	}
+	if(rename(tmppath, filepath) != 0)
+		return 0;
+	return written;
+}
+
+static void *savecallback(void *arg)
+{
+	pthread_mutex_lock(&savemutex);
+	while(1)
+	{
+		while(!saveData)
+			pthread_cond_wait(&savecond, &savemutex);
+		pthread_mutex_unlock(&savemutex);
+
+		u64 begin = benchClock();
+		bool result = ReplaceFile(saveData, savePath, saveSize) == saveSize;
+		u64 time = benchClock() - begin;
+
+		pthread_mutex_lock(&savemutex);
+		saveResult = result;
+		saveTime += time;
+		saveData = NULL;
+		pthread_cond_broadcast(&savecond);
+	}
+	return NULL;
+}
+
+bool SaveFileBackground(char *buffer, char *filepath, size_t datasize)
+{
+	bool started = false;
+
+	pthread_mutex_lock(&savemutex);
+	if(!saveData && datasize > 0)
+	{
+		if(!saveStarted)
+			saveStarted = pthread_create(&savethread, NULL, savecallback, NULL) == 0;
+		if(saveStarted)
+		{
+			snprintf(savePath, sizeof(savePath), "%s", filepath);
+			saveSize = datasize;
+			saveData = buffer;
+			pthread_cond_broadcast(&savecond);
+			started = true;
+		}
+	}
+	pthread_mutex_unlock(&savemutex);
+	return started;
+}
+
+bool SaveFileBusy()
+{
+	pthread_mutex_lock(&savemutex);
+	bool busy = saveData != NULL;
+	pthread_mutex_unlock(&savemutex);
+	return busy;
+}
+
+bool SaveFileWait()
+{
+	pthread_mutex_lock(&savemutex);
+	while(saveData)
+		pthread_cond_wait(&savecond, &savemutex);
+	bool result = saveResult;
+	pthread_mutex_unlock(&savemutex);
+	return result;
+}
+
+// The GBA flash stands in for the save memory of either core
+static int HostBatteryImage(char *membuffer)
+{
+	memcpy(membuffer, flashSaveMemory, 0x10000);
+	return 0x10000;
+}
+
+/****************************************************************************
+* HostBenchSram
+*
+* Plays frames frames with background battery saves after a second of
+* quiet. The game is made to save every 10 seconds, writing a few hundred
+* bytes a frame for a third of a second. Reports what watching the save
+* memory costs the emulation thread, how many saves went out and how long
+* the save thread took over them, then checks the file after a flush.
+****************************************************************************/
+void HostBenchSram(int frames)
+{
+	if(frames <= 0)
+		return;
+
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/vbagx_bench_%d.sav", (int)getpid());
+
+	u64 watchTime = 0, watchMax = 0;
+	int pokes = 0;
+
+	saveTime = 0;
+	SramSaveStart(path, HostBatteryImage, 60);
+
+	for(int f = 0; f < frames; ++f)
+	{
+		HostRunFrames(1);
+
+		if(f % 600 < 20)
+		{
+			for(int i = 0; i < 256; ++i)
+				flashSaveMemory[(f * 4099 + i) & 0xffff] = (u8)(f + i);
+			pokes += 256;
+		}
+
+		u64 begin = benchClock();
+		SramSaveFrame();
+		u64 time = benchClock() - begin;
+		watchTime += time;
+		if(time > watchMax)
+			watchMax = time;
+	}
+
+	bool flushed = SramSaveFlush();
+	int writes = SramSaveWrites();
+
+	u8 *check = (u8 *)malloc(0x10000);
+	char tmppath[80];
+	snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+	FILE *file = fopen(path, "rb");
+	bool same = file && fread(check, 1, 0x10000, file) == 0x10000 &&
+		!memcmp(check, flashSaveMemory, 0x10000);
+	if(file)
+		fclose(file);
+	bool leftover = access(tmppath, F_OK) == 0;
+
+	printf("sram:         watch %.4f ms/frame, max %.3f ms; %d bytes poked, %d in changed ranges\n",
+		watchTime / 1e6 / frames, watchMax / 1e6, pokes, SramSaveDirtyBytes());
+	printf("              %d saves, %.3f ms each on the save thread, file %s%s\n",
+		writes, writes ? saveTime / 1e6 / writes : 0.0,
+		flushed && same ? "matches" : "DIFFERS", leftover ? ", .tmp LEFT" : "");
+
+	SramSaveStart("", HostBatteryImage, 0);
+	remove(path);
+	free(check);
+}
+
+/****************************************************************************
+* HostBenchEvents
+*
+* Replays the timed events of frames GBA frames with direct sound playing:
+* the LCD, the sound ticks, timer 0 clocking the FIFO and timer 1 counting
+* its buffers. Times the scheduler CPULoop() uses against the countdowns
+* it replaced, which were all decremented and checked on every pass. Both
+* call out between passes the way CPULoop() runs the CPU core, so neither
+* keeps in registers what the real loop has to keep in memory.
+****************************************************************************/
+#define EVENT_FRAME_TICKS 280896
+
+// the old loop kept countdowns for the LCD, sound, timers and profiling
+#define EVENT_COUNTDOWNS (EVENT_PROFILING + 1)
+
+static const int eventPeriod[EVENT_COUNTDOWNS] = { 0, 167772, 512, 16384 };
+
+// globals like lcdTicks and timer0On were, the core could change them
+int eventCountdown[EVENT_COUNTDOWNS];
+bool eventCountdownOn[EVENT_COUNTDOWNS];
+
+static void EventsCore()
+{
+}
+
+// called through a pointer the compiler can't see through
+static void (*volatile eventsCore)() = EventsCore;
+
+static u32 EventsScheduled(int frames)
+{
+	u32 handled = 0;
+	bool hblank = false;
+	int event;
+
+	eventReset();
+	eventScheduleIn(EVENT_LCD, 1008);
+	for(event = EVENT_SOUND; event <= EVENT_TIMER1; ++event)
+		eventScheduleIn(event, eventPeriod[event]);
+
+	for(int f = 0; f < frames; ++f)
+	{
+		eventRebase();
+		for(int ticks = EVENT_FRAME_TICKS; ticks > 0; )
+		{
+			eventsCore();
+			int clockTicks = eventNext();
+			if(clockTicks > ticks)
+				clockTicks = ticks;
+			eventClock += clockTicks;
+			ticks -= clockTicks;
+
+			while((event = eventPop()) >= 0)
+			{
+				if(event == EVENT_LCD)
+				{
+					eventRepeat(EVENT_LCD, hblank ? 1008 : 224);
+					hblank = !hblank;
+				}
+				else
+					eventRepeat(event, eventPeriod[event]);
+				++handled;
+			}
+		}
+	}
+	return handled;
+}
+
+static u32 EventsCounted(int frames)
+{
+	static const int start[EVENT_COUNTDOWNS] = { 1008, 167772, 512, 16384 };
+	u32 handled = 0;
+	bool hblank = false;
+
+	for(int e = 0; e < EVENT_COUNTDOWNS; ++e)
+	{
+		eventCountdown[e] = start[e];
+		eventCountdownOn[e] = start[e] != 0;
+	}
+
+	for(int f = 0; f < frames; ++f)
+	{
+		for(int ticks = EVENT_FRAME_TICKS; ticks > 0; )
+		{
+			eventsCore();
+			int clockTicks = ticks;
+			for(int e = 0; e < EVENT_COUNTDOWNS; ++e)
+				if(eventCountdownOn[e] && eventCountdown[e] < clockTicks)
+					clockTicks = eventCountdown[e];
+			ticks -= clockTicks;
+
+			for(int e = 0; e < EVENT_COUNTDOWNS; ++e)
+			{
+				if(!eventCountdownOn[e])
+					continue;
+				eventCountdown[e] -= clockTicks;
+				if(eventCountdown[e] > 0)
+					continue;
+				if(e == EVENT_LCD)
+				{
+					eventCountdown[e] += hblank ? 1008 : 224;
+					hblank = !hblank;
+				}
+				else
+					eventCountdown[e] += eventPeriod[e];
+				++handled;
+			}
+		}
+	}
+	return handled;
+}
+
+void HostBenchEvents(int frames)
+{
+	if(frames <= 0)
+		return;
+
+	// the loaded ROM's events
+	int clock = eventClock, mask = eventMask;
+	int time[EVENT_COUNT];
+	u32 handled = eventsHandled;
+	memcpy(time, eventTime, sizeof(time));
+
+	u64 begin = benchClock();
+	u32 scheduled = EventsScheduled(frames);
+	u64 scheduleTime = benchClock() - begin;
+
+	begin = benchClock();
+	u32 counted = EventsCounted(frames);
+	u64 countTime = benchClock() - begin;
+
+	printf("scheduler:    events %6.1f ns/frame, countdowns %7.1f ns/frame, %.1f events/frame%s\n",
+		(double)scheduleTime / frames, (double)countTime / frames, (double)scheduled / frames,
+		scheduled == counted ? "" : " MISMATCH");
+
+	eventReset();
+	for(int event = 0; event < EVENT_COUNT; ++event)
+		if(mask & (1 << event))
+			eventSchedule(event, time[event]);
+	eventClock = clock;
+	eventsHandled = handled;
+}
+
+/****************************************************************************
+* HostBenchMemory
+*
+* Times the loads and stores of the GBA core through the page table against
+* the region decode they replaced, which every access went through, over a
+* mix of IWRAM, WRAM, ROM, VRAM and palette addresses. Checks that both
+* read the same values and leave the same memory behind.
+****************************************************************************/
+#define MEMORY_BENCH_ADDRESSES 4096
+
+static u32 memoryBenchAddress[MEMORY_BENCH_ADDRESSES];
+
+// every 8 accesses: 3 word, 1 halfword and 1 byte loads, then a store of each
+template<bool paged> static u32 MemoryBenchRun(int passes)
+{
+	u32 sum = 0;
+
+	for(int p = 0; p < passes; ++p)
+	{
+		for(int i = 0; i < MEMORY_BENCH_ADDRESSES; i += 8)
+		{
+			const u32 *a = &memoryBenchAddress[i];
+			if(paged)
+			{
+				sum += CPUReadMemory(a[0]) + CPUReadMemory(a[1]) + CPUReadMemory(a[2]);
+				sum += CPUReadHalfWord(a[3]) + CPUReadByte(a[4]);
+				CPUWriteMemory(a[5], sum);
+				CPUWriteHalfWord(a[6], (u16)sum);
+				CPUWriteByte(a[7], (u8)sum);
+			}
+			else
+			{
+				sum += CPUReadMemoryDecode(a[0]) + CPUReadMemoryDecode(a[1]) + CPUReadMemoryDecode(a[2]);
+				sum += CPUReadHalfWordDecode(a[3]) + CPUReadByteDecode(a[4]);
+				CPUWriteMemoryDecode(a[5], sum);
+				CPUWriteHalfWordDecode(a[6], (u16)sum);
+				CPUWriteByteDecode(a[7], (u8)sum);
+			}
+		}
+	}
+	return sum;
+}
+
+static u32 MemoryBenchSum()
+{
+	u32 sum = crc32(0, workRAM, 0x40000);
+	sum = crc32(sum, internalRAM, 0x8000);
+	sum = crc32(sum, vram, 0x20000);
+	return crc32(sum, paletteRAM, 0x400);
+}
+
+void HostBenchMemory(int passes)
+{
+	if(passes <= 0 || cartridgeType != 2)
+		return;
+
+	u32 seed = 1;
+	for(int i = 0; i < MEMORY_BENCH_ADDRESSES; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		u32 r = seed >> 8;
+		switch(r % 20)
+		{
+			case 0: case 1: case 2: case 3: case 4: case 5: case 6:
+				memoryBenchAddress[i] = 0x03000000 | (r & 0x7FFC); break;
+			case 7: case 8: case 9: case 10: case 11:
+				memoryBenchAddress[i] = 0x02000000 | (r & 0x3FFFC); break;
+			case 12: case 13: case 14: case 15:
+				memoryBenchAddress[i] = 0x08008000 | (r & 0xFFFC); break;
+			case 16: case 17: case 18:
+				memoryBenchAddress[i] = 0x06000000 | (r & 0xFFFC); break;
+			default:
+				memoryBenchAddress[i] = 0x05000000 | (r & 0x3FC); break;
+		}
+	}
+
+	// the loaded ROM's memory
+	u8 *saved = (u8 *)malloc(0x40000 + 0x8000 + 0x20000 + 0x400);
+	memcpy(saved, workRAM, 0x40000);
+	memcpy(saved + 0x40000, internalRAM, 0x8000);
+	memcpy(saved + 0x48000, vram, 0x20000);
+	memcpy(saved + 0x68000, paletteRAM, 0x400);
+
+	u64 t[2];
+	u32 sum[2], memory[2];
+
+	for(int k = 0; k < 2; ++k)
+	{
+		u64 begin = benchClock();
+		sum[k] = k ? MemoryBenchRun<true>(passes) : MemoryBenchRun<false>(passes);
+		t[k] = benchClock() - begin;
+		memory[k] = MemoryBenchSum();
+
+		memcpy(workRAM, saved, 0x40000);
+		memcpy(internalRAM, saved + 0x40000, 0x8000);
+		memcpy(vram, saved + 0x48000, 0x20000);
+		memcpy(paletteRAM, saved + 0x68000, 0x400);
+	}
+	free(saved);
+
+	double accesses = (double)passes * MEMORY_BENCH_ADDRESSES;
+	printf("memory:       decode %6.1f M accesses/s, pages %6.1f M accesses/s, %s\n",
+		t[0] ? accesses / t[0] * 1e3 : 0.0, t[1] ? accesses / t[1] * 1e3 : 0.0,
+		sum[0] == sum[1] && memory[0] == memory[1] ? "identical" : "MISMATCH");
+}
+
+/****************************************************************************
+* HostBenchBios
+*
+* Times the block and decompression calls of the BIOS with host pointers
+* against the memory decode they used to go through for every byte. The
+* corpus is packed here from made up tile data, with a greedy LZ77 packer,
+* run lengths and a flat 16 leaf Huffman tree, and unpacked to WRAM and to
+* VRAM. Checks that both leave the same memory behind and that what was
+* unpacked to WRAM is the data that was packed.
+****************************************************************************/
+#define BIOS_BENCH_DATA 0x4000
+#define BIOS_BENCH_PACKED 0x02020000 // the packed blobs, in WRAM
+#define BIOS_BENCH_WRAM 0x02000000
+#define BIOS_BENCH_VRAM 0x06000000
+
+enum { BIOS_BENCH_LZ77, BIOS_BENCH_RL, BIOS_BENCH_HUFF8, BIOS_BENCH_HUFF4, BIOS_BENCH_BLOBS };
+
+static u8 biosBenchData[BIOS_BENCH_BLOBS][BIOS_BENCH_DATA];
+static u32 biosBenchBlob[BIOS_BENCH_BLOBS]; // GBA address of each blob
+
+// Tiles of 4 bit pixels: runs of one colour, copies of earlier tiles and
+// some noise. symbols limits the bytes to that many values, for Huffman.
+static void BiosBenchTiles(u8 *data, const u8 *symbols, u32 &seed)
+{
+	for(int i = 0; i < BIOS_BENCH_DATA; i += 32)
+	{
+		seed = seed * 1103515245 + 12345;
+		u32 r = seed >> 8;
+		for(int j = 0; j < 32; ++j)
+		{
+			if((r & 3) == 0)
+			{
+				data[i + j] = symbols ? symbols[(r >> 4) & 15] : (u8)(r >> 4);
+			}
+			else if((r & 3) == 1 && i >= 256)
+			{
+				data[i + j] = data[i + j - 32 * (1 + ((r >> 4) & 7))];
+			}
+			else
+			{
+				seed = seed * 1103515245 + 12345;
+				data[i + j] = symbols ? symbols[(seed >> 12) & 15] : (u8)(seed >> 12);
+			}
+		}
+	}
+}
+
+static int BiosBenchLZ77(u8 *out, const u8 *data)
+{
+	int n = 0;
+	int i = 0;
+	while(i < BIOS_BENCH_DATA)
+	{
+		int flag = n++;
+		out[flag] = 0;
+		for(int b = 0; b < 8 && i < BIOS_BENCH_DATA; ++b)
+		{
+			int best = 0;
+			int bestDisp = 0;
+			// at least 2 back, the VRAM call writes halfwords
+			for(int disp = 2; disp <= 1024 && disp <= i; ++disp)
+			{
+				int len = 0;
+				while(len < 18 && i + len < BIOS_BENCH_DATA && data[i + len] == data[i + len - disp])
+					++len;
+				if(len > best)
+				{
+					best = len;
+					bestDisp = disp;
+				}
+			}
+			if(best >= 3)
+			{
+				out[flag] |= 0x80 >> b;
+				out[n++] = ((best - 3) << 4) | ((bestDisp - 1) >> 8);
+				out[n++] = (bestDisp - 1) & 0xFF;
+				i += best;
+			}
+			else
+			{
+				out[n++] = data[i++];
+			}
+		}
+	}
+	return n;
+}
+
+static int BiosBenchRL(u8 *out, const u8 *data)
+{
+	int n = 0;
+	int i = 0;
+	while(i < BIOS_BENCH_DATA)
+	{
+		int run = 1;
+		while(run < 130 && i + run < BIOS_BENCH_DATA && data[i + run] == data[i])
+			++run;
+		if(run >= 3)
+		{
+			out[n++] = 0x80 | (run - 3);
+			out[n++] = data[i];
+			i += run;
+			continue;
+		}
+
+		// literals up to the next run of 3
+		int flag = n++;
+		int len = 0;
+		while(len < 128 && i < BIOS_BENCH_DATA &&
+			!(i + 2 < BIOS_BENCH_DATA && data[i] == data[i + 1] && data[i] == data[i + 2]))
+		{
+			out[n++] = data[i++];
+			++len;
+		}
+		out[flag] = len - 1;
+	}
+	return n;
+}
+
+// A full tree of depth 4, so every symbol is its own index in 4 bits. Data
+// of 4 bits is two symbols per byte, the low nibble first.
+static int BiosBenchHuff(u8 *out, const u8 *data, const u8 *symbols, int bits)
+{
+	int n = 0;
+	out[n++] = 15; // tree size, (15 + 1) * 2 bytes with this one
+	for(int k = 0; k < 15; ++k)
+	{
+		// the children of node k are 2k+1 and 2k+2, k / 2 pairs on from
+		// the pair after the one k is in
+		u8 node = k >> 1;
+		if(k >= 7)
+			node |= 0xC0;
+		out[n++] = node;
+	}
+	for(int s = 0; s < 16; ++s)
+		out[n++] = symbols[s];
+
+	u32 word = 0;
+	int used = 0;
+	for(int i = 0; i < BIOS_BENCH_DATA; ++i)
+	{
+		u8 code[2];
+		int codes = 0;
+		if(bits == 8)
+		{
+			int s = 0;
+			while(symbols[s] != data[i])
+				++s;
+			code[codes++] = s;
+		}
+		else
+		{
+			code[codes++] = data[i] & 15;
+			code[codes++] = data[i] >> 4;
+		}
+		for(int c = 0; c < codes; ++c)
+		{
+			word |= code[c] << (28 - used);
+			used += 4;
+			if(used == 32)
+			{
+				WRITE32LE(((u32 *)&out[n]), word);
+				n += 4;
+				word = 0;
+				used = 0;
+			}
+		}
+	}
+	if(used)
+	{
+		WRITE32LE(((u32 *)&out[n]), word);
+		n += 4;
+	}
+	// the call reads a word ahead
+	WRITE32LE(((u32 *)&out[n]), 0);
+	return n + 4;
+}
+
+// Packs the corpus behind BIOS_BENCH_PACKED, returns its size
+static int BiosBenchCorpus()
+{
+	static const u8 huff8[16] = {
+		0x00, 0x11, 0x12, 0x21, 0x22, 0x33, 0x34, 0x43,
+		0x44, 0x55, 0x5A, 0xA5, 0xAA, 0xEE, 0xEF, 0xFF
+	};
+	static const u8 huff4[16] = {
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+	};
+	u32 seed = 1;
+	BiosBenchTiles(biosBenchData[BIOS_BENCH_LZ77], NULL, seed);
+	BiosBenchTiles(biosBenchData[BIOS_BENCH_RL], NULL, seed);
+	BiosBenchTiles(biosBenchData[BIOS_BENCH_HUFF8], huff8, seed);
+	BiosBenchTiles(biosBenchData[BIOS_BENCH_HUFF4], NULL, seed);
+
+	u8 *packed = workRAM + (BIOS_BENCH_PACKED & 0x3FFFF);
+	int n = 0;
+	for(int b = 0; b < BIOS_BENCH_BLOBS; ++b)
+	{
+		u8 *out = packed + n + 4;
+		u32 type;
+		int size;
+		switch(b)
+		{
+			case BIOS_BENCH_LZ77:
+				type = 0x10;
+				size = BiosBenchLZ77(out, biosBenchData[b]);
+				break;
+			case BIOS_BENCH_RL:
+				type = 0x30;
+				size = BiosBenchRL(out, biosBenchData[b]);
+				break;
+			case BIOS_BENCH_HUFF8:
+				type = 0x28;
+				size = BiosBenchHuff(out, biosBenchData[b], huff8, 8);
+				break;
+			default:
+				type = 0x24;
+				size = BiosBenchHuff(out, biosBenchData[b], huff4, 4);
+				break;
+		}
+		WRITE32LE(((u32 *)(packed + n)), (BIOS_BENCH_DATA << 8) | type);
+		biosBenchBlob[b] = BIOS_BENCH_PACKED + n;
+		n += (size + 4 + 3) & ~3;
+	}
+	return n;
+}
+
+static void BiosBenchCall(void (*call)(), u32 r0, u32 r1, u32 r2, u32 r3)
+{
+	reg[0].I = r0;
+	reg[1].I = r1;
+	reg[2].I = r2;
+	reg[3].I = r3;
+	call();
+}
+
+// Every call of the corpus once, returns the bytes they wrote
+static u32 BiosBenchRun(bool check, bool &unpacked)
+{
+	static const u32 huff[2] = { BIOS_BENCH_HUFF8, BIOS_BENCH_HUFF4 };
+	u8 *wram = workRAM + (BIOS_BENCH_WRAM & 0x3FFFF);
+
+	BiosBenchCall(BIOS_LZ77UnCompWram, biosBenchBlob[BIOS_BENCH_LZ77], BIOS_BENCH_WRAM, 0, 0);
+	if(check && memcmp(wram, biosBenchData[BIOS_BENCH_LZ77], BIOS_BENCH_DATA))
+		unpacked = false;
+	BiosBenchCall(BIOS_LZ77UnCompVram, biosBenchBlob[BIOS_BENCH_LZ77], BIOS_BENCH_VRAM, 0, 0);
+
+	BiosBenchCall(BIOS_RLUnCompWram, biosBenchBlob[BIOS_BENCH_RL], BIOS_BENCH_WRAM, 0, 0);
+	if(check && memcmp(wram, biosBenchData[BIOS_BENCH_RL], BIOS_BENCH_DATA))
+		unpacked = false;
+	BiosBenchCall(BIOS_RLUnCompVram, biosBenchBlob[BIOS_BENCH_RL], BIOS_BENCH_VRAM, 0, 0);
+
+	for(int h = 0; h < 2; ++h)
+	{
+		BiosBenchCall(BIOS_HuffUnComp, biosBenchBlob[huff[h]], BIOS_BENCH_WRAM, 0, 0);
+		if(check && memcmp(wram, biosBenchData[huff[h]], BIOS_BENCH_DATA))
+			unpacked = false;
+		BiosBenchCall(BIOS_HuffUnComp, biosBenchBlob[huff[h]], BIOS_BENCH_VRAM, 0, 0);
+	}
+
+	// WRAM to VRAM, a fill of IWRAM, and the rotation of 32 sprites to OAM
+	BiosBenchCall(BIOS_CpuFastSet, BIOS_BENCH_WRAM, BIOS_BENCH_VRAM + 0x8000, BIOS_BENCH_DATA >> 2, 0);
+	BiosBenchCall(BIOS_CpuFastSet, BIOS_BENCH_PACKED, 0x03000000, (1 << 24) | (0x1000 >> 2), 0);
+	BiosBenchCall(BIOS_ObjAffineSet, BIOS_BENCH_PACKED, 0x07000006, 32, 8);
+
+	return BIOS_BENCH_DATA * 9 + 0x1000 + 32 * 8;
+}
+
+void HostBenchBios(int passes)
+{
+	if(passes <= 0 || cartridgeType != 2)
+		return;
+
+	// the loaded ROM's memory and the registers the calls take
+	u8 *saved = (u8 *)malloc(0x40000 + 0x8000 + 0x20000 + 0x400 + 0x400);
+	memcpy(saved, workRAM, 0x40000);
+	memcpy(saved + 0x40000, internalRAM, 0x8000);
+	memcpy(saved + 0x48000, vram, 0x20000);
+	memcpy(saved + 0x68000, paletteRAM, 0x400);
+	memcpy(saved + 0x68400, oam, 0x400);
+	reg_pair r[4];
+	memcpy(r, reg, sizeof(r));
+	int mode = biosMemoryMode;
+
+	int size = BiosBenchCorpus();
+
+	u64 t[2];
+	u32 memory[2];
+	u32 bytes = 0;
+	bool unpacked = true;
+
+	for(int k = 0; k < 2; ++k)
+	{
+		biosMemoryMode = k ? BIOS_MEMORY_HOST : BIOS_MEMORY_DECODE;
+
+		u64 begin = benchClock();
+		for(int p = 0; p < passes; ++p)
+			bytes = BiosBenchRun(p == 0, unpacked);
+		t[k] = benchClock() - begin;
+
+		memory[k] = MemoryBenchSum();
+		memory[k] = crc32(memory[k], oam, 0x400);
+
+		// the corpus stays packed in WRAM for the other mode
+		memcpy(workRAM, saved, BIOS_BENCH_PACKED & 0x3FFFF);
+		memcpy(internalRAM, saved + 0x40000, 0x8000);
+		memcpy(vram, saved + 0x48000, 0x20000);
+		memcpy(paletteRAM, saved + 0x68000, 0x400);
+		memcpy(oam, saved + 0x68400, 0x400);
+	}
+
+	memcpy(workRAM, saved, 0x40000);
+	memcpy(reg, r, sizeof(r));
+	biosMemoryMode = mode;
+	free(saved);
+
+	double mb = (double)bytes * passes / 1e6;
+	printf("bios:         %d bytes packed, decode %6.1f MB/s, host %6.1f MB/s, %s\n",
+		size, t[0] ? mb / t[0] * 1e9 : 0.0, t[1] ? mb / t[1] * 1e9 : 0.0,
+		memory[0] == memory[1] && unpacked ? "identical" : "MISMATCH");
+}
+
+/****************************************************************************
+* Palette
+****************************************************************************/
+
+void InitialisePalette()
+{
+	int i;
+	// Build GBPalette
+	for( i = 0; i < 24; )
+	{
+		systemGbPalette[i++] = (0x1f) | (0x1f << 5) | (0x1f << 10);
+		systemGbPalette[i++] = (0x15) | (0x15 << 5) | (0x15 << 10);
+		systemGbPalette[i++] = (0x0c) | (0x0c << 5) | (0x0c << 10);
+		systemGbPalette[i++] = 0;
+	}
+	// Set palette etc - Fixed to RGB565, as on the console
+	systemColorDepth = 16;
+	systemRedShift = 11;
+	systemGreenShift = 6;
+	systemBlueShift = 0;
+	for(i = 0; i < 0x10000; i++)
+	{
+		systemColorMap16[i] =
+			((i & 0x1f) << systemRedShift) |
+			(((i & 0x3e0) >> 5) << systemGreenShift) |
+			(((i & 0x7c00) >> 10) << systemBlueShift);
+	}
+}
@@ -0,0 +1,63 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * hostsupport.h
+ *
+ * VBA support code for the headless host build (no libogc)
+ ***************************************************************************/
+
+#ifndef _HOSTSUPPORT_H_
+#define _HOSTSUPPORT_H_
+
+#include "vba/System.h"
+
+extern CORE_LOCAL int cartridgeType; // 0 - none, 1 - GB, 2 - GBA
+extern CORE_LOCAL int emulating;
+extern CORE_LOCAL struct EmulatedSystem emulator;
+
+extern CORE_LOCAL int hostFrameCount;  // frames emulated since the ROM was loaded
+extern CORE_LOCAL u32 hostJoypad;      // buttons reported by systemReadJoypad()
+extern CORE_LOCAL u64 hostSamplesOut;  // stereo samples handed to the sound driver
+extern CORE_LOCAL u32 hostSoundSum;    // their crc32
+extern CORE_LOCAL u32 hostSoundWrites; // calls to the sound driver's write()
+
+// hostvideo.cpp
+enum { HOST_PRESENT_DIRECT, HOST_PRESENT_THREAD };
+extern int hostPresentMode;   // convert frames on the emulation or a render thread
+extern int hostPresentFormat; // texture format of fbconvert.h
+extern CORE_LOCAL u32 hostFramesShown;   // frames converted to the texture
+extern CORE_LOCAL u32 hostFramesDropped; // frames replaced before the render thread got to them
+
+void InitialisePalette();
+bool HostLoadROM(const char *filepath);
+void HostCloseROM();
+void HostRunFrames(int frames);
+bool HostWriteScreenPPM(const char *filepath);
+bool HostSoundWAV(const char *filepath);
+u32 HostScreenSum();
+void HostBenchEvents(int frames);
+void HostBenchStates(int frames);
+void HostBenchRewind(int frames, int megabytes);
+void HostBenchRunAhead(int frames);
+void HostBenchSram(int frames);
+void HostBenchMemory(int passes);
+void HostBenchBios(int passes);
+
+// the save thread of fileop.cpp
+bool SaveFileBackground(char * buffer, char * filepath, size_t datasize);
+bool SaveFileBusy();
+bool SaveFileWait();
+
+void GX_Render_Init(int width, int height);
+void GX_Render(int width, int height, u8 *buffer, int pitch);
+void HostWaitPresent();
+const u8 *HostTexture();
+void HostBenchConvert(int iterations);
+
+// hostaudio.cpp
+void HostBenchResample(int blocks);
+
+// batch.cpp
+int HostBatch(const char *dirpath, int frames, int skip, bool idle, int jobs, const char *baseline);
+
+#endif
@@ -0,0 +1,227 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * hostvideo.cpp
+ *
+ * Presenter of the headless host build. Mirrors video.cpp: GX_Render()
+ * hands the frame over to a render thread through three buffers, which
+ * converts it to the tiled RGB565 texture the console uploads to GX, or to
+ * another format of fbconvert.h.
+ ***************************************************************************/
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hostsupport.h"
+#include "fbconvert.h"
+
+#include "vba/common/Bench.h"
+
+#define PRESENT_BUFFERS 3
+
+// The render thread serves a single emulator, with an emulator per thread
+// each converts its own frames
+#ifdef CORE_THREADS
+#define PRESENT_THREAD false
+#else
+#define PRESENT_THREAD true
+#endif
+
+int hostPresentMode = HOST_PRESENT_THREAD;
+int hostPresentFormat = FB_RGB565_TILED;
+CORE_LOCAL u32 hostFramesShown = 0;
+CORE_LOCAL u32 hostFramesDropped = 0;
+
+static CORE_LOCAL u8 *texturemem = NULL;
+static CORE_LOCAL int vwidth, vheight;
+static CORE_LOCAL u8 *lastbuffer = NULL;
+static CORE_LOCAL int lastpitch;
+
+static pthread_t prthread;
+static bool prstarted = false;
+static pthread_mutex_t presentmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t presentcond = PTHREAD_COND_INITIALIZER;
+static u8 *presentbuf[PRESENT_BUFFERS] = { NULL, NULL, NULL };
+static int presentwidth[PRESENT_BUFFERS];
+static int presentheight[PRESENT_BUFFERS];
+static int presentwrite = 0; // filled by GX_Render
+static int presentready = 1; // newest complete frame
+static int presentshown = 2; // converted by the render thread
+static bool presentpending = false;
+static bool presentbusy = false;
+
+/****************************************************************************
+ * DrawFrame
+ *
+ * Converts a frame to the texture format
+ ***************************************************************************/
+static void DrawFrame(u8 *buffer, int width, int height, int pitch)
+{
+	ConvertFrame(hostPresentFormat, texturemem, buffer, width, height, pitch);
+	++hostFramesShown;
+}
+
+/****************************************************************************
+ * prrender
+ *
+ * Render thread, converts each frame handed over by GX_Render
+ ***************************************************************************/
+static void *prrender(void *arg)
+{
+	pthread_mutex_lock(&presentmutex);
+	while(1)
+	{
+		while(!presentpending)
+			pthread_cond_wait(&presentcond, &presentmutex);
+
+		int slot = presentready;
+		presentready = presentshown;
+		presentshown = slot;
+		presentpending = false;
+		presentbusy = true;
+		int width = presentwidth[slot];
+		int height = presentheight[slot];
+		pthread_mutex_unlock(&presentmutex);
+
+		DrawFrame(presentbuf[slot], width, height, width * 2);
+
+		pthread_mutex_lock(&presentmutex);
+		presentbusy = false;
+		pthread_cond_broadcast(&presentcond);
+	}
+	return NULL;
+}
+
+/****************************************************************************
+ * HostWaitPresent
+ *
+ * Waits until the render thread has converted every frame
+ ***************************************************************************/
+void HostWaitPresent()
+{
+	pthread_mutex_lock(&presentmutex);
+	while(presentpending || presentbusy)
+		pthread_cond_wait(&presentcond, &presentmutex);
+	pthread_mutex_unlock(&presentmutex);
+}
+
+/****************************************************************************
+ * HostTexture
+ *
+ * Returns the texture of the last frame presented
+ ***************************************************************************/
+const u8 *HostTexture()
+{
+	HostWaitPresent();
+	return texturemem;
+}
+
+/****************************************************************************
+ * HostBenchConvert
+ *
+ * Converts the last frame rendered with every format, timing the scalar
+ * and the fast kernel and checking that they agree
+ ***************************************************************************/
+void HostBenchConvert(int iterations)
+{
+	if(!lastbuffer || iterations <= 0)
+		return;
+
+	HostWaitPresent();
+
+	for(int f = 0; f < FB_FORMATS; ++f)
+	{
+		const FrameFormat &fmt = frameFormats[f];
+		int size = vwidth * vheight * fmt.bytesPerPixel;
+		u8 *expect = (u8 *)memalign(64, size);
+		u8 *out = (u8 *)memalign(64, size);
+		u64 t[2];
+
+		for(int k = 0; k < 2; ++k)
+		{
+			FrameConverter convert = k ? fmt.convert : fmt.scalar;
+			u8 *dst = k ? out : expect;
+			convert(dst, lastbuffer, vwidth, vheight, lastpitch); // warm the caches
+			u64 begin = benchClock();
+			for(int i = 0; i < iterations; ++i)
+				convert(dst, lastbuffer, vwidth, vheight, lastpitch);
+			t[k] = benchClock() - begin;
+		}
+
+		printf("convert:      %-12s scalar %7.1f us, %-7s %7.1f us, %s\n",
+			fmt.name, t[0] / 1e3 / iterations, FrameConvertKernel(),
+			t[1] / 1e3 / iterations,
+			memcmp(expect, out, size) ? "MISMATCH" : "identical");
+
+		free(expect);
+		free(out);
+	}
+}
+
+void GX_Render_Init(int width, int height)
+{
+	HostWaitPresent();
+
+	free(texturemem);
+	int texturesize = width * height * frameFormats[hostPresentFormat].bytesPerPixel;
+	texturemem = (u8 *)memalign(64, texturesize);
+	memset(texturemem, 0, texturesize);
+
+	vwidth = width;
+	vheight = height;
+	hostFramesShown = hostFramesDropped = 0;
+
+	if(!PRESENT_THREAD)
+		return;
+
+	int framesize = width * height * 2;
+
+	for(int i = 0; i < PRESENT_BUFFERS; ++i)
+	{
+		free(presentbuf[i]);
+		presentbuf[i] = (u8 *)calloc(1, framesize);
+	}
+
+	presentpending = false;
+
+	if(!prstarted)
+		prstarted = pthread_create(&prthread, NULL, prrender, NULL) == 0;
+}
+
+/****************************************************************************
+ * GX_Render
+ *
+ * Copies the frame for the render thread, or converts it right away when
+ * presenting on the emulation thread
+ ***************************************************************************/
+void GX_Render(int width, int height, u8 *buffer, int pitch)
+{
+	lastbuffer = buffer;
+	lastpitch = pitch;
+
+	if(hostPresentMode == HOST_PRESENT_DIRECT || !prstarted)
+	{
+		DrawFrame(buffer, width, height, pitch);
+		return;
+	}
+
+	u8 *dst = presentbuf[presentwrite];
+
+	for(int h = 0; h < height; ++h)
+		memcpy(dst + h * width * 2, buffer + h * pitch, width * 2);
+
+	pthread_mutex_lock(&presentmutex);
+	int slot = presentwrite;
+	presentwidth[slot] = width;
+	presentheight[slot] = height;
+	presentwrite = presentready;
+	presentready = slot;
+	if(presentpending)
+		++hostFramesDropped;
+	presentpending = true;
+	pthread_cond_broadcast(&presentcond);
+	pthread_mutex_unlock(&presentmutex);
+}
@@ -908,6 +908,9 @@ u32 GetJoy(int pad)
 		return 0;
 	}
 
+	// rewind while the C-stick or the right stick is held down
+	RewindRequested = (userInput[0].pad.substickY < -70 || userInput[0].WPAD_Stick(1,1) < -70);
+
 	u32 J = DecodeJoy(pad);
 	// don't allow up+down or left+right
 	if ((J & 48) == 48)
@@ -15,11 +15,15 @@
 #include <ogc/system.h>
 #include <ogc/machine/processor.h>
 
+#include "rewind.h"
+
 static heap_cntrl mem2_heap;
 
 u32 InitMem2Manager () 
 {
-	int size = (36*1024*1024);
+	// 32 MB of GBA ROM, the browser and the save buffer, the largest rewind
+	// arena and the run-ahead state
+	int size = (36*1024*1024) + (REWIND_MAX_MB*1024*1024) + 3*REWIND_STATE_MAX;
 	u32 level;
 	_CPU_ISR_Disable(level);
 	size &= ~0x1f; // round down, because otherwise we may exceed the area
@@ -33,6 +33,10 @@
 #include "filelist.h"
 #include "menu.h"
 #include "gamesettings.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "sramsave.h"
+#include "vba/common/StateFile.h"
 #include "gui/gui.h"
 #include "utils/gettext.h"
 
@@ -1589,15 +1593,33 @@ static int MenuGameSaves(int action)
 			saves.files[saves.type[j]][n] = 1;
 			strcpy(saves.filename[j], browserList[i].filename);
 
+			snprintf(filepath, 1024, "%s%s/%s", pathPrefix[GCSettings.SaveMethod], GCSettings.SaveFolder, saves.filename[j]);
+
 			if(saves.type[j] == FILE_SNAPSHOT)
 			{
-				sprintf(scrfile, "%s%s/%s.png", pathPrefix[GCSettings.SaveMethod], GCSettings.SaveFolder, tmp);
+				StateChunk chunk;
+				u8 header[STATEFILE_HEADER];
 
 				memset(savebuffer, 0, SAVEBUFFERSIZE);
-				if(LoadFile(scrfile, SILENT))
-					saves.previewImg[j] = new GuiImageData(savebuffer, 64, 48);
+
+				// version 2 states hold the screen, read only the header
+				// and that chunk; older ones have it in a .png beside them
+				if(LoadFilePart((char *)header, filepath, 0, STATEFILE_HEADER) == STATEFILE_HEADER &&
+					stateFileFind(header, STATEFILE_HEADER, STATEFILE_SCREEN, &chunk))
+				{
+					if(chunk.size <= SAVEBUFFERSIZE &&
+						LoadFilePart((char *)savebuffer, filepath, chunk.offset, chunk.size) == chunk.size &&
+						stateFileCheck(savebuffer, &chunk))
+						saves.previewImg[j] = new GuiImageData(savebuffer, 64, 48);
+				}
+				else
+				{
+					sprintf(scrfile, "%s%s/%s.png", pathPrefix[GCSettings.SaveMethod], GCSettings.SaveFolder, tmp);
+
+					if(LoadFile(scrfile, SILENT))
+						saves.previewImg[j] = new GuiImageData(savebuffer, 64, 48);
+				}
 			}
-			snprintf(filepath, 1024, "%s%s/%s", pathPrefix[GCSettings.SaveMethod], GCSettings.SaveFolder, saves.filename[j]);
 			if (stat(filepath, &filestat) == 0)
 			{
 				timeinfo = localtime(&filestat.st_mtime);
@@ -2701,6 +2723,9 @@ static int MenuSettingsVideo()
 	sprintf(options.name[i++], "Video Mode");
 	sprintf(options.name[i++], "GB Mono Colorization");
 	sprintf(options.name[i++], "GB Palette");
+	sprintf(options.name[i++], "Frame Pacing");
+	sprintf(options.name[i++], "Rewind Buffer");
+	sprintf(options.name[i++], "Run-Ahead");
 	options.length = i;
 
 	for(i=0; i < options.length; i++)
@@ -2795,6 +2820,24 @@ static int MenuSettingsVideo()
 			case 6:
 				menu = MENU_GAMESETTINGS_PALETTE;
 				break;
+
+			case 7:
+				GCSettings.pacing ^= 1;
+				break;
+
+			case 8:
+				GCSettings.rewind *= 2;
+				if (GCSettings.rewind == 0)
+					GCSettings.rewind = 2;
+				else if (GCSettings.rewind > REWIND_MAX_MB)
+					GCSettings.rewind = 0;
+				break;
+
+			case 9:
+				GCSettings.runahead++;
+				if (GCSettings.runahead > RUNAHEAD_MAX)
+					GCSettings.runahead = 0;
+				break;
 		}
 
 		if(ret >= 0 || firstRun)
@@ -2847,6 +2890,23 @@ static int MenuSettingsVideo()
 			else
 				sprintf(options.value[6], "Default");
 
+			if (GCSettings.pacing == 1)
+				sprintf (options.value[7], "Sound Buffer");
+			else
+				sprintf (options.value[7], "Timer");
+
+			if (GCSettings.rewind)
+				sprintf (options.value[8], "%d MB", GCSettings.rewind);
+			else
+				sprintf (options.value[8], "Off");
+
+			if (GCSettings.runahead == 1)
+				sprintf (options.value[9], "1 Frame");
+			else if (GCSettings.runahead)
+				sprintf (options.value[9], "%d Frames", GCSettings.runahead);
+			else
+				sprintf (options.value[9], "Off");
+
 			optionBrowser.TriggerUpdate();
 		}
 
@@ -3043,6 +3103,7 @@ static int MenuSettingsFile()
 	sprintf(options.name[i++], "Cheats Folder");
 	sprintf(options.name[i++], "Auto Load");
 	sprintf(options.name[i++], "Auto Save");
+	sprintf(options.name[i++], "Background SRAM Save");
 	options.length = i;
 	options.name[4][0] = 0; // hide cheats folder (not implemented)
 
@@ -3125,6 +3186,12 @@ static int MenuSettingsFile()
 				if (GCSettings.AutoSave > 3)
 					GCSettings.AutoSave = 0;
 				break;
+
+			case 7:
+				GCSettings.sramdelay++;
+				if (GCSettings.sramdelay > SRAMSAVE_DELAY_MAX)
+					GCSettings.sramdelay = 0;
+				break;
 		}
 
 		if(ret >= 0 || firstRun)
@@ -3196,6 +3263,9 @@ static int MenuSettingsFile()
 			else if (GCSettings.AutoSave == 2) sprintf (options.value[6],"Snapshot");
 			else if (GCSettings.AutoSave == 3) sprintf (options.value[6],"Both");
 
+			if (GCSettings.sramdelay == 0) sprintf (options.value[7],"Off");
+			else sprintf (options.value[7],"After %d sec", GCSettings.sramdelay);
+
 			optionBrowser.TriggerUpdate();
 		}
 
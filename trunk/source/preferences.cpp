@@ -163,6 +163,7 @@ preparePrefsData ()
 
 	createXMLSetting("AutoLoad", "Auto Load", toStr(GCSettings.AutoLoad));
 	createXMLSetting("AutoSave", "Auto Save", toStr(GCSettings.AutoSave));
+	createXMLSetting("sramdelay", "Background SRAM Save Delay", toStr(GCSettings.sramdelay));
 	createXMLSetting("LoadMethod", "Load Method", toStr(GCSettings.LoadMethod));
 	createXMLSetting("SaveMethod", "Save Method", toStr(GCSettings.SaveMethod));
 	createXMLSetting("LoadFolder", "Load Folder", GCSettings.LoadFolder);
@@ -188,6 +189,9 @@ preparePrefsData ()
 	createXMLSetting("xshift", "Horizontal Video Shift", toStr(GCSettings.xshift));
 	createXMLSetting("yshift", "Vertical Video Shift", toStr(GCSettings.yshift));
 	createXMLSetting("colorize", "Colorize Mono Gameboy", toStr(GCSettings.colorize));
+	createXMLSetting("pacing", "Frame Pacing", toStr(GCSettings.pacing));
+	createXMLSetting("rewind", "Rewind Buffer", toStr(GCSettings.rewind));
+	createXMLSetting("runahead", "Run-Ahead Frames", toStr(GCSettings.runahead));
 
 	createXMLSection("Menu", "Menu Settings");
 
@@ -462,6 +466,7 @@ decodePrefsData ()
 
 			loadXMLSetting(&GCSettings.AutoLoad, "AutoLoad");
 			loadXMLSetting(&GCSettings.AutoSave, "AutoSave");
+			loadXMLSetting(&GCSettings.sramdelay, "sramdelay");
 			loadXMLSetting(&GCSettings.LoadMethod, "LoadMethod");
 			loadXMLSetting(&GCSettings.SaveMethod, "SaveMethod");
 			loadXMLSetting(GCSettings.LoadFolder, "LoadFolder", sizeof(GCSettings.LoadFolder));
@@ -487,6 +492,9 @@ decodePrefsData ()
 			loadXMLSetting(&GCSettings.xshift, "xshift");
 			loadXMLSetting(&GCSettings.yshift, "yshift");
 			loadXMLSetting(&GCSettings.colorize, "colorize");
+			loadXMLSetting(&GCSettings.pacing, "pacing");
+			loadXMLSetting(&GCSettings.rewind, "rewind");
+			loadXMLSetting(&GCSettings.runahead, "runahead");
 
 			// Menu Settings
 
@@ -602,6 +610,7 @@ DefaultSettings ()
 	sprintf (GCSettings.CheatFolder, "%s/cheats", APPFOLDER); // Path to cheat files
 	GCSettings.AutoLoad = 1;
 	GCSettings.AutoSave = 1;
+	GCSettings.sramdelay = 2; // seconds without battery writes before a background save
 
 	GCSettings.WiimoteOrientation = 0;
 
@@ -617,6 +626,9 @@ DefaultSettings ()
 	GCSettings.xshift = 0; // horizontal video shift
 	GCSettings.yshift = 0; // vertical video shift
 	GCSettings.colorize = 0; // Colorize mono gameboy games
+	GCSettings.pacing = 0; // timer, 1 follows the sound buffer
+	GCSettings.rewind = 0; // MB of rewind history, off
+	GCSettings.runahead = 0; // frames to run ahead
 
 	GCSettings.WiimoteOrientation = 0;
 	GCSettings.ExitAction = 0;
@@ -0,0 +1,276 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * resample.cpp
+ *
+ * Polyphase resampler for 16 bit stereo sound. Converts the 22050/44100 Hz
+ * stream of the cores to the 48000 Hz of the DSP without the images that
+ * picking the nearest sample leaves above the source's Nyquist frequency.
+ ***************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "resample.h"
+
+#define RESAMPLE_SHIFT 14      // coefficients are Q14, unity gain at DC
+#define RESAMPLE_BETA 6.0      // Kaiser window, about 60 dB stopband
+#define RESAMPLE_CUTOFF 0.43   // of the lower sample rate
+
+static double BesselI0(double x)
+{
+	double sum = 1, term = 1;
+
+	for(int k = 1; k < 32; ++k)
+	{
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+Resampler::Resampler()
+{
+	inRate = outRate = 0;
+	setRates(22050, 48000);
+}
+
+/****************************************************************************
+ * setRates
+ ***************************************************************************/
+void Resampler::setRates(long in, long out)
+{
+	if(in == inRate && out == outRate)
+		return;
+
+	inRate = in;
+	outRate = out;
+	step = nominal = ((u64)in << 32) / out;
+	design();
+	reset();
+}
+
+void Resampler::reset()
+{
+	memset(left, 0, sizeof(left));
+	memset(right, 0, sizeof(right));
+	fill = RESAMPLE_TAPS / 2; // silence before the first frame
+	pos = 0;
+}
+
+/****************************************************************************
+ * design
+ *
+ * Tabulates the filter for each phase, normalized so that every phase
+ * passes DC unchanged
+ ***************************************************************************/
+void Resampler::design()
+{
+	double fc = RESAMPLE_CUTOFF;
+	double half = RESAMPLE_TAPS / 2;
+
+	if(outRate < inRate)
+		fc = fc * outRate / inRate;
+
+	for(int p = 0; p < RESAMPLE_PHASES; ++p)
+	{
+		double h[RESAMPLE_TAPS];
+		double sum = 0;
+
+		for(int k = 0; k < RESAMPLE_TAPS; ++k)
+		{
+			double t = k - (half - 1) - (double)p / RESAMPLE_PHASES;
+			double x = 2 * M_PI * fc * t;
+			double w = 1 - (t / half) * (t / half);
+
+			h[k] = (x == 0 ? 1 : sin(x) / x);
+			h[k] *= w > 0 ? BesselI0(RESAMPLE_BETA * sqrt(w)) / BesselI0(RESAMPLE_BETA) : 0;
+			sum += h[k];
+		}
+
+		int total = 0, peak = 0;
+
+		for(int k = 0; k < RESAMPLE_TAPS; ++k)
+		{
+			coeff[p][k] = (s16)floor(h[k] / sum * (1 << RESAMPLE_SHIFT) + 0.5);
+			total += coeff[p][k];
+			if(coeff[p][k] > coeff[p][peak])
+				peak = k;
+		}
+		coeff[p][peak] += (1 << RESAMPLE_SHIFT) - total;
+	}
+}
+
+void Resampler::adjust(int ppm)
+{
+	step = nominal * 1000000 / (1000000 + ppm);
+}
+
+int Resampler::maxOutput(int frames) const
+{
+	return (int)((((u64)(frames + RESAMPLE_TAPS) << 32) / step)) + 1;
+}
+
+static inline void Filter(const s16 *c, const s16 *l, const s16 *r, int &sl, int &sr)
+{
+	sl = sr = 0;
+	for(int k = 0; k < RESAMPLE_TAPS; ++k)
+	{
+		sl += c[k] * l[k];
+		sr += c[k] * r[k];
+	}
+}
+
+#ifdef __SSE2__
+
+// Partial sums of one channel, pmaddwd adds the products of neighbouring taps
+static inline __m128i Dot(const s16 *c, const s16 *x)
+{
+	__m128i sum = _mm_madd_epi16(_mm_load_si128((const __m128i *)c), _mm_loadu_si128((const __m128i *)x));
+
+	for(int k = 8; k < RESAMPLE_TAPS; k += 8)
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_load_si128((const __m128i *)(c + k)),
+			_mm_loadu_si128((const __m128i *)(x + k))));
+	return sum;
+}
+
+// Adds up the partial sums of two output frames, L0 R0 L1 R1
+static inline __m128i Pair(__m128i l0, __m128i r0, __m128i l1, __m128i r1)
+{
+	__m128i a = _mm_add_epi32(_mm_unpacklo_epi32(l0, r0), _mm_unpackhi_epi32(l0, r0));
+	__m128i b = _mm_add_epi32(_mm_unpacklo_epi32(l1, r1), _mm_unpackhi_epi32(l1, r1));
+	return _mm_add_epi32(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+}
+
+// Four output frames at once, rounded and clamped like Clamp() by packssdw
+static inline void Filter4(const s16 *c[4], const s16 *l[4], const s16 *r[4], s16 *out)
+{
+	const __m128i round = _mm_set1_epi32(1 << (RESAMPLE_SHIFT - 1));
+	__m128i s01 = Pair(Dot(c[0], l[0]), Dot(c[0], r[0]), Dot(c[1], l[1]), Dot(c[1], r[1]));
+	__m128i s23 = Pair(Dot(c[2], l[2]), Dot(c[2], r[2]), Dot(c[3], l[3]), Dot(c[3], r[3]));
+
+	s01 = _mm_srai_epi32(_mm_add_epi32(s01, round), RESAMPLE_SHIFT);
+	s23 = _mm_srai_epi32(_mm_add_epi32(s23, round), RESAMPLE_SHIFT);
+	_mm_storeu_si128((__m128i *)out, _mm_packs_epi32(s01, s23));
+}
+
+#endif
+
+// Deinterleaves L/R frames into the channel arrays
+static inline void Split(const s16 *in, int frames, s16 *l, s16 *r)
+{
+	int i = 0;
+
+#ifdef __SSE2__
+	// the 32 bit frames, the low half sign extended is left, the high right
+	for(; i + 8 <= frames; i += 8)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(in + i * 2));
+		__m128i b = _mm_loadu_si128((const __m128i *)(in + i * 2 + 8));
+
+		_mm_storeu_si128((__m128i *)(l + i), _mm_packs_epi32(
+			_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16)));
+		_mm_storeu_si128((__m128i *)(r + i), _mm_packs_epi32(
+			_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+	}
+#endif
+
+	for(; i < frames; ++i)
+	{
+		l[i] = in[i * 2];
+		r[i] = in[i * 2 + 1];
+	}
+}
+
+static inline s16 Clamp(int v)
+{
+	v = (v + (1 << (RESAMPLE_SHIFT - 1))) >> RESAMPLE_SHIFT;
+	if(v > 32767)
+		return 32767;
+	if(v < -32768)
+		return -32768;
+	return v;
+}
+
+/****************************************************************************
+ * process
+ *
+ * Buffers up to RESAMPLE_BLOCK input frames at a time and emits every
+ * output frame whose taps are all available
+ ***************************************************************************/
+int Resampler::process(const s16 *in, int frames, s16 *out)
+{
+	const u64 round = (u64)1 << (31 - RESAMPLE_PHASE_BITS);
+	s16 *start = out;
+
+	while(frames > 0)
+	{
+		int n = RESAMPLE_BLOCK + RESAMPLE_TAPS - fill;
+		if(n > frames)
+			n = frames;
+
+		Split(in, n, left + fill, right + fill);
+		in += n * 2;
+		fill += n;
+		frames -= n;
+
+#ifdef __SSE2__
+		// four at a time while the taps of the fourth are all there, in
+		// locals, the stores to out could alias the members
+		u64 at = pos + round;
+		const u64 inc = step;
+		const u64 last = fill >= RESAMPLE_TAPS ? (u64)(fill - RESAMPLE_TAPS + 1) << 32 : 0;
+
+		while(at + 3 * inc < last)
+		{
+			const s16 *c[4], *l[4], *r[4];
+
+			for(int k = 0; k < 4; ++k)
+			{
+				int i = (int)(at >> 32);
+
+				c[k] = coeff[(at >> (32 - RESAMPLE_PHASE_BITS)) & (RESAMPLE_PHASES - 1)];
+				l[k] = left + i;
+				r[k] = right + i;
+				at += inc;
+			}
+
+			Filter4(c, l, r, out);
+			out += 8;
+		}
+		pos = at - round;
+#endif
+
+		while(1)
+		{
+			u64 at = pos + round;
+			int i = (int)(at >> 32);
+
+			if(i + RESAMPLE_TAPS > fill)
+				break;
+
+			int sl, sr;
+
+			Filter(coeff[(at >> (32 - RESAMPLE_PHASE_BITS)) & (RESAMPLE_PHASES - 1)],
+				left + i, right + i, sl, sr);
+
+			out[0] = Clamp(sl);
+			out[1] = Clamp(sr);
+			out += 2;
+			pos += step;
+		}
+
+		// drop the frames no later output needs
+		int used = (int)(pos >> 32);
+		fill -= used;
+		pos -= (u64)used << 32;
+		memmove(left, left + used, fill * sizeof(s16));
+		memmove(right, right + used, fill * sizeof(s16));
+	}
+
+	return (out - start) >> 1;
+}
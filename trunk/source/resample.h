@@ -0,0 +1,56 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * resample.h
+ *
+ * Polyphase resampler for 16 bit stereo sound
+ ***************************************************************************/
+
+#ifndef _RESAMPLEH_
+#define _RESAMPLEH_
+
+#include "vba/common/Types.h"
+
+#define RESAMPLE_TAPS 8 // one SSE2 vector per channel
+#define RESAMPLE_PHASE_BITS 8
+#define RESAMPLE_PHASES (1 << RESAMPLE_PHASE_BITS)
+#define RESAMPLE_BLOCK 1024 // input frames filtered per pass
+
+// Windowed sinc filter evaluated at one of RESAMPLE_PHASES fractional
+// positions for every output frame. The channels are kept in separate
+// arrays so the tap loops are plain 16 bit dot products. State carries
+// over between calls, a stream can be fed in blocks of any size.
+class Resampler
+{
+public:
+	Resampler();
+
+	// Ratios above 4:1 downwards are not supported
+	void setRates(long inRate, long outRate);
+	void reset();
+
+	// Speeds the output up by ppm millionths, or slows it down when
+	// negative, without redesigning the filter
+	void adjust(int ppm);
+
+	// Upper bound of the frames process() writes for a block of frames
+	int maxOutput(int frames) const;
+
+	// Resamples interleaved L/R frames, returns the frames written to out
+	int process(const s16 *in, int frames, s16 *out);
+
+private:
+	void design();
+
+	s16 coeff[RESAMPLE_PHASES][RESAMPLE_TAPS] __attribute__((aligned(16)));
+	s16 left[RESAMPLE_BLOCK + RESAMPLE_TAPS];
+	s16 right[RESAMPLE_BLOCK + RESAMPLE_TAPS];
+	int fill;     // frames in left/right
+	u64 pos;      // 32.32 position of the next output frame in left/right
+	u64 step;     // input frames per output frame, 32.32
+	u64 nominal;  // step without adjust()
+	long inRate;
+	long outRate;
+};
+
+#endif
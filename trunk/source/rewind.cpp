@@ -0,0 +1,280 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * rewind.cpp
+ *
+ * Rewind history. Every REWIND_INTERVAL frames a raw state is taken and
+ * XORed with the one before it, the runs of unchanged words are dropped
+ * and what is left goes into an arena used as a ring. The newest state is
+ * kept whole as the keyframe the chain of deltas leads back from, so only
+ * the words that changed in between cost memory. The oldest snapshots
+ * give way when the arena is full.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rewind.h"
+#include "vbasupport.h"
+
+#ifdef HW_RVL
+#include "mem2.h"
+#endif
+
+#define REWIND_ENTRIES 4096 // 4.5 minutes of snapshots at REWIND_INTERVAL 4
+
+struct RewindEntry
+{
+	int offset; // in the arena
+	int size;   // bytes of the delta
+};
+
+static u8 *arena = NULL;
+static int arenaSize = 0;
+static u32 *state = NULL; // the newest snapshot
+static u32 *next = NULL;  // the snapshot being taken
+static int stateSize = 0; // 0 until the first snapshot
+
+static RewindEntry entry[REWIND_ENTRIES];
+static int oldest = 0;
+static int count = 0;
+static int head = 0;      // arena offset of the free space after the newest
+static int used = 0;
+static int frames = 0;    // since the last snapshot
+
+static void *RewindAlloc(int size)
+{
+#ifdef HW_RVL
+	return mem2_malloc(size);
+#else
+	return malloc(size);
+#endif
+}
+
+static void RewindFree(void *ptr)
+{
+	if(!ptr)
+		return;
+#ifdef HW_RVL
+	mem2_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+void RewindInit(int megabytes)
+{
+	int size = megabytes * 1024 * 1024;
+
+	if(size == arenaSize)
+		return;
+
+	RewindFree(arena);
+	RewindFree(state);
+	RewindFree(next);
+	arena = NULL;
+	state = next = NULL;
+	arenaSize = 0;
+	RewindReset();
+
+	if(size <= 0)
+		return;
+
+	arena = (u8 *)RewindAlloc(size);
+	state = (u32 *)RewindAlloc(REWIND_STATE_MAX);
+	next = (u32 *)RewindAlloc(REWIND_STATE_MAX);
+
+	if(!arena || !state || !next)
+	{
+		RewindInit(0);
+		return;
+	}
+	arenaSize = size;
+}
+
+void RewindReset()
+{
+	oldest = count = 0;
+	head = used = 0;
+	stateSize = 0;
+	frames = 0;
+}
+
+void RewindFrame()
+{
+	++frames;
+}
+
+int RewindSnapshots()
+{
+	return stateSize ? count + 1 : 0;
+}
+
+int RewindBytes()
+{
+	return used;
+}
+
+/****************************************************************************
+ * Deltas
+ *
+ * The XOR of two states as runs of words: a header word holding the number
+ * of zero words to skip in its upper half and the number of literal words
+ * that follow it in its lower half. Applying a delta to either state gives
+ * the other one.
+ ***************************************************************************/
+#define RUN_MAX 0xFFFF
+
+static int DeltaMax(int words)
+{
+	return (words + words / RUN_MAX + 2) * 4;
+}
+
+static int DeltaEncode(const u32 *a, const u32 *b, int words, u32 *out)
+{
+	u32 *start = out;
+	int i = 0;
+
+	while(i < words)
+	{
+		int zeros = 0, literals = 0;
+
+		while(i < words && a[i] == b[i] && zeros < RUN_MAX)
+		{
+			++i;
+			++zeros;
+		}
+
+		u32 *header = out++;
+
+		while(i < words && a[i] != b[i] && literals < RUN_MAX)
+		{
+			*out++ = a[i] ^ b[i];
+			++i;
+			++literals;
+		}
+		*header = (zeros << 16) | literals;
+	}
+	return (out - start) * 4;
+}
+
+static void DeltaApply(u32 *s, const u32 *in, int size)
+{
+	const u32 *end = in + size / 4;
+
+	while(in < end)
+	{
+		u32 header = *in++;
+
+		s += header >> 16;
+		for(int n = header & RUN_MAX; n > 0; --n)
+			*s++ ^= *in++;
+	}
+}
+
+static void DropOldest()
+{
+	used -= entry[oldest].size;
+	oldest = (oldest + 1) % REWIND_ENTRIES;
+	if(--count == 0)
+		head = 0;
+}
+
+// Finds room for size bytes after the newest delta or at the start of the
+// arena, dropping the oldest deltas until there is
+static int Reserve(int size)
+{
+	if(size > arenaSize)
+		return -1;
+
+	if(count == REWIND_ENTRIES)
+		DropOldest();
+
+	while(count)
+	{
+		int start = entry[oldest].offset;
+
+		if(start < head) // in use from start to head
+		{
+			if(head + size <= arenaSize)
+				return head;
+			if(size <= start)
+				return 0;
+		}
+		else if(head + size <= start) // in use from start to the end and up to head
+			return head;
+
+		DropOldest();
+	}
+	return 0;
+}
+
+static void Capture()
+{
+	int size = emulator.emuWriteRawState((char *)next, REWIND_STATE_MAX);
+
+	if(!size)
+		return;
+
+	int words = (size + 3) / 4;
+	memset((u8 *)next + size, 0, words * 4 - size);
+
+	if(size == stateSize)
+	{
+		int offset = Reserve(DeltaMax(words));
+
+		if(offset >= 0)
+		{
+			RewindEntry &e = entry[(oldest + count) % REWIND_ENTRIES];
+			e.offset = offset;
+			e.size = DeltaEncode(next, state, words, (u32 *)(arena + offset));
+			head = offset + e.size;
+			used += e.size;
+			++count;
+		}
+	}
+	else // first snapshot of this game
+	{
+		RewindReset();
+		stateSize = size;
+	}
+
+	u32 *t = state;
+	state = next;
+	next = t;
+}
+
+static bool StepBack()
+{
+	if(!stateSize)
+		return false;
+
+	if(count)
+	{
+		RewindEntry &e = entry[(oldest + count - 1) % REWIND_ENTRIES];
+		DeltaApply(state, (u32 *)(arena + e.offset), e.size);
+		head = e.offset;
+		used -= e.size;
+		--count;
+	}
+
+	emulator.emuReadRawState((char *)state, stateSize);
+	frames = 0;
+	return count > 0;
+}
+
+bool RewindUpdate(bool rewinding)
+{
+	if(!arenaSize)
+		return false;
+
+	if(rewinding)
+		return StepBack();
+
+	if(frames >= REWIND_INTERVAL)
+	{
+		frames = 0;
+		Capture();
+	}
+	return true;
+}
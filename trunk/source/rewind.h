@@ -0,0 +1,36 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * rewind.h
+ *
+ * Rewind history of raw state snapshots in a fixed size arena
+ ***************************************************************************/
+
+#ifndef _REWINDH_
+#define _REWINDH_
+
+#include "vba/common/Types.h"
+
+#define REWIND_INTERVAL 4         // frames between snapshots
+#define REWIND_MAX_MB 8           // largest arena the settings offer
+#define REWIND_STATE_MAX (768 * 1024) // largest raw state of either core
+
+// (Re)allocates the arena, keeping the history when the size is unchanged.
+// 0 MB turns rewind off and frees everything.
+void RewindInit(int megabytes);
+
+// Forgets the history, for a new ROM, a loaded state or a reset
+void RewindReset();
+
+// Counts a frame, the core calls this through systemFrame()
+void RewindFrame();
+
+// Called between emuMain() calls. Records a snapshot once REWIND_INTERVAL
+// frames have run, or while rewinding loads the snapshot before the last
+// one. Returns false when there is nothing left to rewind to.
+bool RewindUpdate(bool rewinding);
+
+int RewindSnapshots(); // snapshots held
+int RewindBytes();     // arena bytes they take
+
+#endif
@@ -0,0 +1,134 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * runahead.cpp
+ *
+ * Run-ahead. The frame that is played is emulated with its sound but not
+ * drawn, then a raw state is taken and the emulation runs on with the same
+ * buttons until the frame it shows. Loading the state back leaves the game
+ * where the played frame ended, with the sound carried on from there.
+ ***************************************************************************/
+
+#include <stdlib.h>
+
+#include "runahead.h"
+#include "rewind.h"
+#include "vbasupport.h"
+
+#include "vba/common/Bench.h"
+#include "vba/gba/Sound.h"
+#include "vba/gb/gbSound.h"
+
+#ifdef HW_RVL
+#include "mem2.h"
+#endif
+
+#define RUNAHEAD_HIDE 20 // frame skip that keeps a frame from being drawn,
+                         // the most the pacing sets so it leaves it there
+
+static char *state = NULL;
+static bool running = false;
+static bool hidden = false;
+static bool showing = false;
+static bool frameEnded = false;
+
+void RunAheadInit(int frames)
+{
+	if((frames > 0) == (state != NULL))
+		return;
+
+	if(state)
+	{
+#ifdef HW_RVL
+		mem2_free(state);
+#else
+		free(state);
+#endif
+		state = NULL;
+		return;
+	}
+
+#ifdef HW_RVL
+	state = (char *)mem2_malloc(REWIND_STATE_MAX);
+#else
+	state = (char *)malloc(REWIND_STATE_MAX);
+#endif
+}
+
+void RunAheadFrameEnd()
+{
+	frameEnded = true;
+}
+
+bool RunAheadPause()
+{
+	return running;
+}
+
+bool RunAheadHidden()
+{
+	return hidden;
+}
+
+bool RunAheadDraws()
+{
+	return !running || showing;
+}
+
+static void RunFrame(bool shown)
+{
+	systemFrameSkip = shown ? 0 : RUNAHEAD_HIDE;
+	showing = shown;
+	frameEnded = false;
+
+	while(!frameEnded)
+		emulator.emuMain(emulator.emuCount);
+
+	showing = false;
+}
+
+// The state after the played frame, with the sound up to there written out
+static int Snapshot()
+{
+	BENCH_BEGIN(BENCH_STATE);
+	if(cartridgeType == 2)
+		soundHoldOutput();
+	else
+		gbSoundHoldOutput();
+
+	int size = emulator.emuWriteRawState(state, REWIND_STATE_MAX);
+	BENCH_END(BENCH_STATE);
+	return size;
+}
+
+static void Restore(int size)
+{
+	BENCH_BEGIN(BENCH_STATE);
+	if(size)
+		emulator.emuReadRawState(state, size);
+
+	if(cartridgeType == 2)
+		soundReleaseOutput();
+	else
+		gbSoundReleaseOutput();
+	BENCH_END(BENCH_STATE);
+}
+
+void RunAheadFrame(int frames)
+{
+	running = true;
+	RunFrame(frames <= 0 || !state);
+
+	if(frames > 0 && state)
+	{
+		int size = Snapshot();
+
+		hidden = size > 0;
+		for(int i = 1; hidden && i <= frames; ++i)
+			RunFrame(i == frames);
+
+		Restore(size);
+		hidden = false;
+	}
+	running = false;
+}
@@ -0,0 +1,35 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * runahead.h
+ *
+ * Run-ahead: shows the frame a few frames after the one being played so the
+ * buttons read for it show up that much earlier
+ ***************************************************************************/
+
+#ifndef _RUNAHEADH_
+#define _RUNAHEADH_
+
+#define RUNAHEAD_MAX 2 // most frames the settings run ahead
+
+// (Re)allocates the state buffer, 0 frames frees it
+void RunAheadInit(int frames);
+
+// Emulates one frame in place of emuMain(). Its sound is played and the
+// state after it kept, then frames more run without sound, the last one is
+// shown and the kept state is loaded back.
+void RunAheadFrame(int frames);
+
+// The core calls these through systemFrame() and systemPauseOnFrame()
+void RunAheadFrameEnd();
+bool RunAheadPause();
+
+// True while frames run that are rolled back afterwards. They are not
+// counted for rewind nor paced.
+bool RunAheadHidden();
+
+// False while the frames that aren't shown run, and while the state is
+// loaded back, as the GB core draws the screen when it loads one
+bool RunAheadDraws();
+
+#endif
@@ -0,0 +1,199 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * sramsave.cpp
+ *
+ * Background battery saves. Every SRAMSAVE_CHECK frames the battery file
+ * the core would write is compared with the last one seen, and the range
+ * of bytes that changed is noted. A game saving writes for a while and
+ * then stops; once the file has stayed the same for the delay it is copied
+ * out and handed to the save thread, which writes it next to the old file
+ * and renames it over. A file that never settles, a clock the game keeps
+ * latching, goes out after SRAMSAVE_PATIENCE delays anyway. The emulation
+ * never waits for the card: when the thread is still busy the save just
+ * goes out at a later check.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sramsave.h"
+
+#ifdef HOST_BUILD
+#include "host/hostsupport.h"
+#else
+#include "fileop.h"
+#endif
+
+#define SRAMSAVE_PATIENCE 8
+
+static int (*writeImage)(char *) = NULL;
+static char path[1024];
+static int needed = 0;     // frames the file must stay the same
+static u8 *seen = NULL;    // the file at the last check
+static u8 *current = NULL; // the file now
+static u8 *out = NULL;     // being written by the save thread
+static int seenSize = 0;
+static int counted = 0;    // frames since the last check
+static int quiet = 0;      // frames since the file last changed
+static int waited = 0;     // frames since the first change not written yet
+static int dirtyStart = 0; // changed bytes not written yet
+static int dirtyEnd = 0;
+static int dirtyBytes = 0;
+static int writes = 0;
+
+void SramSaveStart(const char *filepath, int (*image)(char *), int delay)
+{
+	// the last game's file is already out, SramSaveFlush() would look at
+	// the save memory of this one
+	SaveFileWait();
+
+	if(delay <= 0)
+	{
+		free(seen);
+		free(current);
+		free(out);
+		seen = current = out = NULL;
+		needed = 0;
+		return;
+	}
+
+	if(!seen)
+	{
+		seen = (u8 *)malloc(SRAMSAVE_MAX);
+		current = (u8 *)malloc(SRAMSAVE_MAX);
+		out = (u8 *)malloc(SRAMSAVE_MAX);
+	}
+
+	strncpy(path, filepath, sizeof(path) - 1);
+	path[sizeof(path) - 1] = 0;
+	writeImage = image;
+	needed = delay;
+	dirtyBytes = writes = 0;
+	SramSaveReset();
+}
+
+void SramSaveReset()
+{
+	if(!needed)
+		return;
+
+	seenSize = writeImage((char *)seen);
+	counted = quiet = waited = 0;
+	dirtyStart = dirtyEnd = 0;
+}
+
+// Notes the bytes that changed since the last check
+static void Compare(int size)
+{
+	if(size != seenSize)
+	{
+		dirtyStart = 0;
+		dirtyEnd = size;
+		dirtyBytes += size;
+		memcpy(seen, current, size);
+		seenSize = size;
+		quiet = 0;
+		return;
+	}
+
+	// a word at a time from either end, the file is mostly left alone
+	int start = 0;
+	int end = size;
+
+	while(start + 4 <= end && *(u32 *)(current + start) == *(u32 *)(seen + start))
+		start += 4;
+	while(start < end && current[start] == seen[start])
+		++start;
+	while(end - 4 >= start && *(u32 *)(current + end - 4) == *(u32 *)(seen + end - 4))
+		end -= 4;
+	while(end > start && current[end - 1] == seen[end - 1])
+		--end;
+
+	if(start == end)
+	{
+		quiet += SRAMSAVE_CHECK;
+		return;
+	}
+
+	memcpy(seen + start, current + start, end - start);
+	dirtyBytes += end - start;
+
+	if(dirtyStart == dirtyEnd)
+	{
+		dirtyStart = start;
+		dirtyEnd = end;
+	}
+	else
+	{
+		if(start < dirtyStart)
+			dirtyStart = start;
+		if(end > dirtyEnd)
+			dirtyEnd = end;
+	}
+	quiet = 0;
+}
+
+// Hands the file to the save thread, unless it is still busy
+static bool Write()
+{
+	if(SaveFileBusy())
+		return false;
+
+	memcpy(out, seen, seenSize);
+	if(!SaveFileBackground((char *)out, path, seenSize))
+		return false;
+
+	dirtyStart = dirtyEnd = 0;
+	waited = 0;
+	++writes;
+	return true;
+}
+
+// Looks at the save memory, returns false if the core has none
+static bool Check()
+{
+	int size = writeImage((char *)current);
+	if(size <= 0 || size > SRAMSAVE_MAX)
+		return false;
+
+	Compare(size);
+	return true;
+}
+
+void SramSaveFrame()
+{
+	if(!needed || ++counted < SRAMSAVE_CHECK)
+		return;
+	counted = 0;
+
+	if(!Check() || dirtyStart == dirtyEnd)
+		return;
+
+	waited += SRAMSAVE_CHECK;
+	if(quiet >= needed || waited >= needed * SRAMSAVE_PATIENCE)
+		Write();
+}
+
+bool SramSaveFlush()
+{
+	if(!needed)
+		return true;
+
+	if(Check() && dirtyStart != dirtyEnd)
+	{
+		SaveFileWait();
+		Write();
+	}
+	return SaveFileWait();
+}
+
+int SramSaveDirtyBytes()
+{
+	return dirtyBytes;
+}
+
+int SramSaveWrites()
+{
+	return writes;
+}
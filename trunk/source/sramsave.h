@@ -0,0 +1,39 @@
+/****************************************************************************
+ * Visual Boy Advance GX
+ *
+ * sramsave.h
+ *
+ * Background battery saves, written once the game stops saving
+ ***************************************************************************/
+
+#ifndef _SRAMSAVEH_
+#define _SRAMSAVEH_
+
+#include "vba/common/Types.h"
+
+#define SRAMSAVE_MAX (0x20000 + 0x100) // largest battery file of either core
+#define SRAMSAVE_CHECK 16              // frames between looks at the save memory
+#define SRAMSAVE_DELAY_MAX 10          // longest delay the settings offer, seconds
+
+// Watches the save memory of the game just loaded. image writes the battery
+// file of the core to a buffer and returns its size. Once the file has not
+// changed for delay frames, it goes to filepath on the save thread. A delay
+// of 0 turns background saves off and frees the buffers.
+void SramSaveStart(const char *filepath, int (*image)(char *), int delay);
+
+// Takes what the save memory holds now as saved, after loading a battery file
+void SramSaveReset();
+
+// Counts a frame, the core calls this through systemFrame()
+void SramSaveFrame();
+
+// Writes what is still waiting out now and waits for the save thread, before
+// the menu or a battery save of its own. Returns false if a write failed.
+bool SramSaveFlush();
+
+// Bytes of the changed ranges seen, and background saves handed to the save
+// thread, since SramSaveStart()
+int SramSaveDirtyBytes();
+int SramSaveWrites();
+
+#endif
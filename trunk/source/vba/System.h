@@ -26,6 +26,10 @@ struct EmulatedSystem {
   bool (*emuReadMemState)(char *, int);
   // write memory state (rewind)
   bool (*emuWriteMemState)(char *, int);
+  // load raw memory state (rewind, run-ahead)
+  bool (*emuReadRawState)(const char *, int);
+  // write raw memory state, returns its size or 0
+  int (*emuWriteRawState)(char *, int);
   // write PNG file
   bool (*emuWritePNG)(const char *);
   // write BMP file
@@ -88,8 +92,8 @@ extern int systemBlueShift;
 extern int systemColorDepth;
 extern int systemDebug;
 extern int systemVerbose;
-extern int systemFrameSkip;
-extern int systemSaveUpdateCounter;
+extern CORE_LOCAL int systemFrameSkip;
+extern CORE_LOCAL int systemSaveUpdateCounter;
 extern int systemSpeed;
 
 #define SYSTEM_SAVE_UPDATED 30
@@ -34,6 +34,7 @@
 extern "C" {
 #include "common/memgzio.h"
 }
+#include "common/RawState.h"
 
 #ifndef _MSC_VER
 #define _stricmp strcasecmp
@@ -48,12 +49,13 @@ extern u16 systemColorMap16[0x10000];
 //extern u32 systemColorMap32[0x10000];
 extern u32 *systemColorMap32;
 
-static int (*utilGzWriteFunc)(gzFile, const voidp, unsigned int) = NULL;
-static int (*utilGzReadFunc)(gzFile, voidp, unsigned int) = NULL;
-static int (*utilGzCloseFunc)(gzFile) = NULL;
-static z_off_t (*utilGzSeekFunc)(gzFile, z_off_t, int) = NULL;
+static CORE_LOCAL int (*utilGzWriteFunc)(gzFile, const voidp, unsigned int) = NULL;
+static CORE_LOCAL int (*utilGzReadFunc)(gzFile, voidp, unsigned int) = NULL;
+static CORE_LOCAL int (*utilGzCloseFunc)(gzFile) = NULL;
+static CORE_LOCAL z_off_t (*utilGzSeekFunc)(gzFile, z_off_t, int) = NULL;
+static CORE_LOCAL long (*utilGzTellFunc)(gzFile) = NULL;
 
-extern bool cpuIsMultiBoot;
+extern CORE_LOCAL bool cpuIsMultiBoot;
 
 bool utilIsGBAImage(const char * file)
 {
@@ -99,7 +101,7 @@ bool utilIsZipFile(const char *file)
 {
   if(strlen(file) > 4)
     {
-      char * p = strrchr(file,'.');
+      const char * p = strrchr(file,'.');
 
       if(p != NULL)
         {
@@ -163,7 +165,7 @@ void utilWriteData(gzFile gzFile, variable_desc *data)
 
 gzFile utilGzOpen(const char *file, const char *mode)
 {
-  utilGzWriteFunc = (int (ZEXPORT *)(void *,void * const, unsigned int))gzwrite;
+  utilGzWriteFunc = (int (ZEXPORT *)(gzFile, const voidp, unsigned int))gzwrite;
   utilGzReadFunc = gzread;
   utilGzCloseFunc = gzclose;
   utilGzSeekFunc = gzseek;
@@ -176,10 +178,22 @@ gzFile utilMemGzOpen(char *memory, int available, const char *mode)
   utilGzWriteFunc = memgzwrite;
   utilGzReadFunc = memgzread;
   utilGzCloseFunc = memgzclose;
+  utilGzTellFunc = memtell;
 
   return memgzopen(memory, available, mode);
 }
 
+gzFile utilMemRawOpen(char *memory, int available, const char *mode)
+{
+  utilGzWriteFunc = rawwrite;
+  utilGzReadFunc = rawread;
+  utilGzCloseFunc = rawclose;
+  utilGzSeekFunc = rawseek;
+  utilGzTellFunc = rawtell;
+
+  return rawopen(memory, available, mode);
+}
+
 int utilGzWrite(gzFile file, const voidp buffer, unsigned int len)
 {
   return utilGzWriteFunc(file, buffer, len);
@@ -202,5 +216,5 @@ z_off_t utilGzSeek(gzFile file, z_off_t offset, int whence)
 
 long utilGzMemTell(gzFile file)
 {
-  return memtell(file);
+  return utilGzTellFunc(file);
 }
@@ -48,6 +48,7 @@ extern int utilReadInt(gzFile);
 extern void utilWriteInt(gzFile, int);
 extern gzFile utilGzOpen(const char *file, const char *mode);
 extern gzFile utilMemGzOpen(char *memory, int available, const char *mode);
+extern gzFile utilMemRawOpen(char *memory, int available, const char *mode);
 extern int utilGzWrite(gzFile file, const voidp buffer, unsigned int len);
 extern int utilGzRead(gzFile file, voidp buffer, unsigned int len);
 extern int utilGzClose(gzFile file);
@@ -64,6 +64,8 @@ public:
 	void end_frame( blip_time_t );
 	long read_samples( blip_sample_t*, long );
 	long samples_avail() const { return (bufs [0].samples_avail() - mixer.samples_read) * 2; }
+	int buffer_count() const { return bufs_size; }
+	Blip_Buffer* buffer( int i ) { return &bufs [i]; }
 	enum { stereo = 2 };
 	typedef blargg_long fixed_t;
 protected:
@@ -53,6 +53,10 @@ public:
 	virtual long read_samples( blip_sample_t*, long ) BLARGG_PURE( { return 0; } )
 	virtual long samples_avail() const BLARGG_PURE( { return 0; } )
 
+	// Blip_Buffers the output is mixed from, to save and load their state
+	virtual int buffer_count() const { return 0; }
+	virtual Blip_Buffer* buffer( int ) { return 0; }
+
 public:
 	BLARGG_DISABLE_NOTHROW
 	void disable_immediate_removal() { immediate_removal_ = false; }
@@ -93,6 +97,8 @@ public:
 	long read_samples( blip_sample_t* p, long s ) { return buf.read_samples( p, s ); }
 	channel_t channel( int ) { return chan; }
 	void end_frame( blip_time_t t ) { buf.end_frame( t ); }
+	int buffer_count() const { return 1; }
+	Blip_Buffer* buffer( int ) { return &buf; }
 };
 
 	class Tracked_Blip_Buffer : public Blip_Buffer {
@@ -151,6 +157,8 @@ public:
 
 	long samples_avail() const { return (bufs [0].samples_avail() - mixer.samples_read) * 2; }
 	long read_samples( blip_sample_t*, long );
+	int buffer_count() const { return bufs_size; }
+	Blip_Buffer* buffer( int i ) { return &bufs [i]; }
 
 private:
 	enum { bufs_size = 3 };
@@ -0,0 +1,58 @@
+// VisualBoyAdvance - Nintendo Gameboy/GameboyAdvance (TM) emulator.
+// Copyright (C) 2008 VBA-M development team
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or(at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef __VBA_BENCH_H__
+#define __VBA_BENCH_H__
+
+#include "Types.h"
+
+// Timing hooks used by the headless benchmark build (-DBENCHMARK).
+// In the console builds every macro expands to nothing.
+
+enum {
+  BENCH_RENDER,   // line rendering and colour conversion
+  BENCH_SOUND,    // APU synthesis and sound driver output
+  BENCH_DMA,      // DMA transfers
+  BENCH_PRESENT,  // systemDrawScreen()
+  BENCH_STATE,    // run-ahead snapshots and restores
+  BENCH_SUBSYSTEMS
+};
+
+#ifdef BENCHMARK
+#include <time.h>
+
+// nanoseconds spent in each subsystem, and instructions executed
+extern CORE_LOCAL u64 benchTime[BENCH_SUBSYSTEMS];
+extern CORE_LOCAL u64 benchInstructions;
+
+static inline u64 benchClock()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+#define BENCH_BEGIN(s) u64 benchStart_##s = benchClock()
+#define BENCH_END(s) benchTime[s] += benchClock() - benchStart_##s
+#define BENCH_INSN() ++benchInstructions
+#else
+#define BENCH_BEGIN(s)
+#define BENCH_END(s)
+#define BENCH_INSN()
+#endif
+
+#endif // __VBA_BENCH_H__
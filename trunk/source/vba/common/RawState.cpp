@@ -0,0 +1,152 @@
+// VisualBoyAdvance - Nintendo Gameboy/GameboyAdvance (TM) emulator.
+// Copyright (C) 2008 VBA-M development team
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or(at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <string.h>
+
+#include "RawState.h"
+
+// one stream at a time, like the rest of the utilGz functions
+static CORE_LOCAL struct {
+  u8 *memory;
+  int available;
+  int pos;
+  bool error;
+} raw;
+
+static inline int rawAlign(int pos, unsigned len)
+{
+  if(len >= RAWSTATE_PAGE)
+    pos = (pos + RAWSTATE_PAGE - 1) & ~(RAWSTATE_PAGE - 1);
+  return pos;
+}
+
+gzFile rawopen(char *memory, int available, const char *mode)
+{
+  raw.memory = (u8 *)memory;
+  raw.available = available;
+  raw.pos = 0;
+  raw.error = false;
+  return (gzFile)&raw;
+}
+
+int rawread(gzFile file, voidp buf, unsigned len)
+{
+  int pos = rawAlign(raw.pos, len);
+
+  if(pos + (int)len > raw.available) {
+    raw.error = true;
+    return 0;
+  }
+  memcpy(buf, raw.memory + pos, len);
+  raw.pos = pos + len;
+  return len;
+}
+
+int rawwrite(gzFile file, const voidp buf, unsigned len)
+{
+  int pos = rawAlign(raw.pos, len);
+
+  if(pos + (int)len > raw.available) {
+    raw.error = true;
+    return 0;
+  }
+  // zero the padding, identical states must be identical bytes
+  memset(raw.memory + raw.pos, 0, pos - raw.pos);
+  memcpy(raw.memory + pos, buf, len);
+  raw.pos = pos + len;
+  return len;
+}
+
+z_off_t rawseek(gzFile file, z_off_t offset, int whence)
+{
+  if(whence == SEEK_CUR && offset > 0)
+    raw.pos = rawAlign(raw.pos, offset) + offset;
+  else if(whence == SEEK_SET)
+    raw.pos = offset;
+  else
+    return -1;
+  return raw.pos;
+}
+
+int rawclose(gzFile file)
+{
+  raw.memory = NULL;
+  return raw.error ? Z_ERRNO : Z_OK;
+}
+
+long rawtell(gzFile file)
+{
+  return raw.error ? -1 : raw.pos;
+}
+
+/****************************************************************************
+ * Page deltas
+ *
+ * int size, int pages, then the number and the bytes of each page that
+ * changed. The last page of a state may be short.
+ ***************************************************************************/
+
+int rawStateDelta(const u8 *base, int baseSize, const u8 *state, int size,
+                  u8 *delta, int available)
+{
+  u8 *out = delta + 2 * sizeof(int);
+  int pages = 0;
+
+  if(available < (int)(2 * sizeof(int)))
+    return -1;
+
+  for(int pos = 0; pos < size; pos += RAWSTATE_PAGE) {
+    int len = size - pos < RAWSTATE_PAGE ? size - pos : RAWSTATE_PAGE;
+
+    if(pos + len <= baseSize && !memcmp(base + pos, state + pos, len))
+      continue;
+    if(out + sizeof(int) + len > delta + available)
+      return -1;
+
+    int page = pos / RAWSTATE_PAGE;
+    memcpy(out, &page, sizeof(int));
+    memcpy(out + sizeof(int), state + pos, len);
+    out += sizeof(int) + len;
+    pages++;
+  }
+
+  memcpy(delta, &size, sizeof(int));
+  memcpy(delta + sizeof(int), &pages, sizeof(int));
+  return out - delta;
+}
+
+int rawStateApply(u8 *state, int available, const u8 *delta)
+{
+  int size, pages;
+
+  memcpy(&size, delta, sizeof(int));
+  memcpy(&pages, delta + sizeof(int), sizeof(int));
+  if(size > available)
+    return -1;
+
+  delta += 2 * sizeof(int);
+  while(pages--) {
+    int page;
+    memcpy(&page, delta, sizeof(int));
+
+    int pos = page * RAWSTATE_PAGE;
+    int len = size - pos < RAWSTATE_PAGE ? size - pos : RAWSTATE_PAGE;
+    memcpy(state + pos, delta + sizeof(int), len);
+    delta += sizeof(int) + len;
+  }
+  return size;
+}
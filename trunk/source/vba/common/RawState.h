@@ -0,0 +1,49 @@
+// VisualBoyAdvance - Nintendo Gameboy/GameboyAdvance (TM) emulator.
+// Copyright (C) 2008 VBA-M development team
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or(at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef __VBA_RAWSTATE_H__
+#define __VBA_RAWSTATE_H__
+
+#include <zlib.h>
+
+#include "Types.h"
+
+// Raw save states: the save state streams of the cores written to memory
+// as they are, without compression. Blocks of a page or more start on a
+// page boundary, so the same memory of the emulated machine lands in the
+// same pages of every state and two states can be compared page by page.
+// Raw states only make sense to the session that wrote them.
+
+#define RAWSTATE_PAGE 4096
+
+gzFile rawopen(char *memory, int available, const char *mode);
+int rawread(gzFile file, voidp buf, unsigned len);
+int rawwrite(gzFile file, const voidp buf, unsigned len);
+z_off_t rawseek(gzFile file, z_off_t offset, int whence);
+int rawclose(gzFile file);
+long rawtell(gzFile file); // -1 once a write did not fit
+
+// Page delta of state against base: the pages that differ and the size of
+// state. Returns the bytes written to delta, -1 if they do not fit.
+int rawStateDelta(const u8 *base, int baseSize, const u8 *state, int size,
+                  u8 *delta, int available);
+
+// Turns a copy of the base in state into the state the delta was made
+// from. Returns its size, -1 if it is larger than available.
+int rawStateApply(u8 *state, int available, const u8 *delta);
+
+#endif // __VBA_RAWSTATE_H__
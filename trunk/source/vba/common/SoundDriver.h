@@ -56,8 +56,11 @@ public:
 
 	/**
 	 * Write length bytes of data from the finalWave buffer to the driver output buffer.
+	 * length is any whole number of stereo samples, all the core has made since the
+	 * last write.
+	 * @return The number of bytes taken, the core drops the rest
 	 */
-	virtual void write(u16 * finalWave, int length) = 0;
+	virtual int write(u16 * finalWave, int length) = 0;
 
 	virtual void setThrottle(unsigned short throttle) { };
 };
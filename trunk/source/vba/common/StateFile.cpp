@@ -0,0 +1,115 @@
+// VisualBoyAdvance - Nintendo Gameboy/GameboyAdvance (TM) emulator.
+// Copyright (C) 2008 VBA-M development team
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or(at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#include <string.h>
+#include <zlib.h>
+
+#include "StateFile.h"
+#include "Port.h"
+
+// header: magic, version and chunk count, file size, reserved
+#define HEADER_MAGIC   0
+#define HEADER_VERSION 4
+#define HEADER_COUNT   6
+#define HEADER_SIZE    8
+#define HEADER_CHUNK(i) (16 + (i) * 16)
+
+// Port.h takes a plain pointer
+static inline u32 get32(const u8 *p) { return READ32LE(p); }
+static inline u16 get16(const u8 *p) { return READ16LE(p); }
+static inline void put32(u8 *p, u32 v) { WRITE32LE(p, v); }
+static inline void put16(u8 *p, u16 v) { WRITE16LE(p, v); }
+
+static inline int stateFileAlign(int offset)
+{
+  return (offset + 15) & ~15;
+}
+
+int stateFileBegin(u8 *file)
+{
+  memset(file, 0, STATEFILE_HEADER);
+  put32(file + HEADER_MAGIC, STATEFILE_MAGIC);
+  put16(file + HEADER_VERSION, STATEFILE_VERSION);
+  put32(file + HEADER_SIZE, STATEFILE_HEADER);
+  return STATEFILE_HEADER;
+}
+
+int stateFileNext(const u8 *file)
+{
+  return stateFileAlign(get32(file + HEADER_SIZE));
+}
+
+int stateFileSize(const u8 *file)
+{
+  return get32(file + HEADER_SIZE);
+}
+
+bool stateFileAdd(u8 *file, int available, u32 tag, const u8 *data, int size)
+{
+  int count = get16(file + HEADER_COUNT);
+  int end = get32(file + HEADER_SIZE);
+  int offset = stateFileAlign(end);
+
+  if(count >= STATEFILE_CHUNKS || size < 0 || offset + size > available)
+    return false;
+
+  if(data != file + offset)
+    memmove(file + offset, data, size);
+  memset(file + end, 0, offset - end);
+
+  u8 *entry = file + HEADER_CHUNK(count);
+  put32(entry, tag);
+  put32(entry + 4, offset);
+  put32(entry + 8, size);
+  put32(entry + 12, crc32(0, file + offset, size));
+
+  put16(file + HEADER_COUNT, count + 1);
+  put32(file + HEADER_SIZE, offset + size);
+  return true;
+}
+
+bool stateFileFind(const u8 *file, int size, u32 tag, StateChunk *chunk)
+{
+  if(size < STATEFILE_HEADER || get32(file + HEADER_MAGIC) != STATEFILE_MAGIC)
+    return false;
+
+  // a later version may add chunks, but keeps the ones it has
+  if(get16(file + HEADER_VERSION) < STATEFILE_VERSION)
+    return false;
+
+  int count = get16(file + HEADER_COUNT);
+  if(count > STATEFILE_CHUNKS)
+    count = STATEFILE_CHUNKS;
+
+  for(int i = 0; i < count; i++) {
+    const u8 *entry = file + HEADER_CHUNK(i);
+
+    if(get32(entry) == tag) {
+      chunk->tag = tag;
+      chunk->offset = get32(entry + 4);
+      chunk->size = get32(entry + 8);
+      chunk->crc = get32(entry + 12);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool stateFileCheck(const u8 *data, const StateChunk *chunk)
+{
+  return crc32(0, data, chunk->size) == chunk->crc;
+}
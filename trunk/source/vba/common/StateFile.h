@@ -0,0 +1,77 @@
+// VisualBoyAdvance - Nintendo Gameboy/GameboyAdvance (TM) emulator.
+// Copyright (C) 2008 VBA-M development team
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or(at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+#ifndef __VBA_STATEFILE_H__
+#define __VBA_STATEFILE_H__
+
+#include "Types.h"
+
+// Save state files, version 2. A header with a directory of tagged chunks,
+// each with its offset, size and crc32, then the chunks, each starting on
+// a 16 byte boundary. A loader reads the header alone to find a chunk,
+// can read just that one and skips tags it does not know. The state chunk
+// is the gzip stream the cores read and write and the screen chunk a PNG,
+// both compressed already, so chunks are stored as they are.
+// Files without the header are version 1, a bare state stream.
+
+#define STATEFILE_TAG(a, b, c, d) ((a) | ((b) << 8) | ((c) << 16) | ((d) << 24))
+
+#define STATEFILE_MAGIC   STATEFILE_TAG('V', 'B', 'A', 'S')
+#define STATEFILE_VERSION 2
+#define STATEFILE_CHUNKS  8    // directory entries
+#define STATEFILE_HEADER  (16 + STATEFILE_CHUNKS * 16) // bytes before the first chunk
+
+#define STATEFILE_INFO   STATEFILE_TAG('I', 'N', 'F', 'O') // StateFileInfo
+#define STATEFILE_SCREEN STATEFILE_TAG('S', 'C', 'R', 'N') // PNG of the screen
+#define STATEFILE_STATE  STATEFILE_TAG('S', 'T', 'A', 'T') // emuWriteMemState() stream
+
+// Who the state belongs to, all fields little endian
+struct StateFileInfo {
+  u32 system;   // 1 GB, 2 GBA, as cartridgeType
+  u32 gameCode; // RomIdCode, 0 when the ROM has none
+  char title[16];
+};
+
+struct StateChunk {
+  u32 tag;
+  u32 offset; // from the start of the file
+  u32 size;
+  u32 crc;
+};
+
+// Writes an empty header. Returns the offset of the first chunk.
+int stateFileBegin(u8 *file);
+
+// Offset the next chunk goes to, to let a core write a chunk in place
+int stateFileNext(const u8 *file);
+
+// Adds a chunk, copying size bytes of data to stateFileNext() unless they
+// are already there. Returns false when it does not fit in available bytes
+// or the directory is full.
+bool stateFileAdd(u8 *file, int available, u32 tag, const u8 *data, int size);
+
+// Bytes of the file so far
+int stateFileSize(const u8 *file);
+
+// Looks tag up in the first size bytes of a file, STATEFILE_HEADER are
+// enough. False if the file is not version 2 or has no such chunk.
+bool stateFileFind(const u8 *file, int size, u32 tag, StateChunk *chunk);
+
+// Whether data holds the chunk as it was written
+bool stateFileCheck(const u8 *data, const StateChunk *chunk);
+
+#endif // __VBA_STATEFILE_H__
@@ -30,4 +30,16 @@ typedef int16_t s16;
 typedef int32_t s32;
 typedef int64_t s64;
 
+// Storage of the emulator state. Builds running an emulator per thread
+// (CORE_THREADS) give every thread its own copy, the others plain globals.
+// CORE_LOCAL_INIT is for the state a thread has to set up on first use,
+// objects and the tables holding addresses of other state.
+#ifdef CORE_THREADS
+#define CORE_LOCAL __thread
+#define CORE_LOCAL_INIT thread_local
+#else
+#define CORE_LOCAL
+#define CORE_LOCAL_INIT
+#endif
+
 #endif // __VBA_TYPES_H__
@@ -12,6 +12,7 @@
 #include "gbSGB.h"
 #include "gbSound.h"
 #include "../Util.h"
+#include "../common/Bench.h"
 
 #ifdef __GNUC__
 #define _stricmp strcasecmp
@@ -22,187 +23,187 @@ void gbSetObj0Palette(u8 value, bool ColoursChanged=false);
 void gbSetObj1Palette(u8 value, bool ColoursChanged=false);
 void gbPaletteReset();
 
-extern u8 *pix;
-extern bool speedup;
+extern CORE_LOCAL u8 *pix;
+extern CORE_LOCAL bool speedup;
 
 bool gbUpdateSizes();
-bool inBios = false;
+CORE_LOCAL bool inBios = false;
 
 // debugging
-bool memorydebug = false;
-char gbBuffer[2048];
+CORE_LOCAL bool memorydebug = false;
+CORE_LOCAL char gbBuffer[2048];
 
-extern u16 gbLineMix[160];
+extern CORE_LOCAL u16 gbLineMix[160];
 
 // mappers
-void (*mapper)(u16,u8) = NULL;
-void (*mapperRAM)(u16,u8) = NULL;
-u8 (*mapperReadRAM)(u16) = NULL;
-void (*mapperUpdateClock)() = NULL;
+CORE_LOCAL void (*mapper)(u16,u8) = NULL;
+CORE_LOCAL void (*mapperRAM)(u16,u8) = NULL;
+CORE_LOCAL u8 (*mapperReadRAM)(u16) = NULL;
+CORE_LOCAL void (*mapperUpdateClock)() = NULL;
 
 // registers
-gbRegister PC;
-gbRegister SP;
-gbRegister AF;
-gbRegister BC;
-gbRegister DE;
-gbRegister HL;
-u16 IFF = 0;
+CORE_LOCAL gbRegister PC;
+CORE_LOCAL gbRegister SP;
+CORE_LOCAL gbRegister AF;
+CORE_LOCAL gbRegister BC;
+CORE_LOCAL gbRegister DE;
+CORE_LOCAL gbRegister HL;
+CORE_LOCAL u16 IFF = 0;
 // 0xff04
-u8 register_DIV   = 0;
+CORE_LOCAL u8 register_DIV   = 0;
 // 0xff05
-u8 register_TIMA  = 0;
+CORE_LOCAL u8 register_TIMA  = 0;
 // 0xff06
-u8 register_TMA   = 0;
+CORE_LOCAL u8 register_TMA   = 0;
 // 0xff07
-u8 register_TAC   = 0;
+CORE_LOCAL u8 register_TAC   = 0;
 // 0xff0f
-u8 register_IF    = 0;
+CORE_LOCAL u8 register_IF    = 0;
 // 0xff40
-u8 register_LCDC  = 0;
+CORE_LOCAL u8 register_LCDC  = 0;
 // 0xff41
-u8 register_STAT  = 0;
+CORE_LOCAL u8 register_STAT  = 0;
 // 0xff42
-u8 register_SCY   = 0;
+CORE_LOCAL u8 register_SCY   = 0;
 // 0xff43
-u8 register_SCX   = 0;
+CORE_LOCAL u8 register_SCX   = 0;
 // 0xff44
-u8 register_LY    = 0;
+CORE_LOCAL u8 register_LY    = 0;
 // 0xff45
-u8 register_LYC   = 0;
+CORE_LOCAL u8 register_LYC   = 0;
 // 0xff46
-u8 register_DMA   = 0;
+CORE_LOCAL u8 register_DMA   = 0;
 // 0xff4a
-u8 register_WY    = 0;
+CORE_LOCAL u8 register_WY    = 0;
 // 0xff4b
-u8 register_WX    = 0;
+CORE_LOCAL u8 register_WX    = 0;
 // 0xff4f
-u8 register_VBK   = 0;
+CORE_LOCAL u8 register_VBK   = 0;
 // 0xff51
-u8 register_HDMA1 = 0;
+CORE_LOCAL u8 register_HDMA1 = 0;
 // 0xff52
-u8 register_HDMA2 = 0;
+CORE_LOCAL u8 register_HDMA2 = 0;
 // 0xff53
-u8 register_HDMA3 = 0;
+CORE_LOCAL u8 register_HDMA3 = 0;
 // 0xff54
-u8 register_HDMA4 = 0;
+CORE_LOCAL u8 register_HDMA4 = 0;
 // 0xff55
-u8 register_HDMA5 = 0;
+CORE_LOCAL u8 register_HDMA5 = 0;
 // 0xff70
-u8 register_SVBK  = 0;
+CORE_LOCAL u8 register_SVBK  = 0;
 // 0xffff
-u8 register_IE    = 0;
+CORE_LOCAL u8 register_IE    = 0;
 
 // ticks definition
-int GBDIV_CLOCK_TICKS          = 64;
-int GBLCD_MODE_0_CLOCK_TICKS   = 51;
-int GBLCD_MODE_1_CLOCK_TICKS   = 1140;
-int GBLCD_MODE_2_CLOCK_TICKS   = 20;
-int GBLCD_MODE_3_CLOCK_TICKS   = 43;
-int GBLY_INCREMENT_CLOCK_TICKS = 114;
-int GBTIMER_MODE_0_CLOCK_TICKS = 256;
-int GBTIMER_MODE_1_CLOCK_TICKS = 4;
-int GBTIMER_MODE_2_CLOCK_TICKS = 16;
-int GBTIMER_MODE_3_CLOCK_TICKS = 64;
-int GBSERIAL_CLOCK_TICKS       = 128;
-int GBSYNCHRONIZE_CLOCK_TICKS  = 52920;
+CORE_LOCAL int GBDIV_CLOCK_TICKS          = 64;
+CORE_LOCAL int GBLCD_MODE_0_CLOCK_TICKS   = 51;
+CORE_LOCAL int GBLCD_MODE_1_CLOCK_TICKS   = 1140;
+CORE_LOCAL int GBLCD_MODE_2_CLOCK_TICKS   = 20;
+CORE_LOCAL int GBLCD_MODE_3_CLOCK_TICKS   = 43;
+CORE_LOCAL int GBLY_INCREMENT_CLOCK_TICKS = 114;
+CORE_LOCAL int GBTIMER_MODE_0_CLOCK_TICKS = 256;
+CORE_LOCAL int GBTIMER_MODE_1_CLOCK_TICKS = 4;
+CORE_LOCAL int GBTIMER_MODE_2_CLOCK_TICKS = 16;
+CORE_LOCAL int GBTIMER_MODE_3_CLOCK_TICKS = 64;
+CORE_LOCAL int GBSERIAL_CLOCK_TICKS       = 128;
+CORE_LOCAL int GBSYNCHRONIZE_CLOCK_TICKS  = 52920;
 
 // state variables
 
 // general
-int clockTicks = 0;
-bool gbSystemMessage = false;
-int gbGBCColorType = 0;
-int gbHardware = 0;
-int gbRomType = 0;
-int gbRemainingClockTicks = 0;
-int gbOldClockTicks = 0;
-int gbIntBreak = 0;
-int gbInterruptLaunched = 0;
-u8 gbCheatingDevice = 0; // 1 = GS, 2 = GG
+CORE_LOCAL int clockTicks = 0;
+CORE_LOCAL bool gbSystemMessage = false;
+CORE_LOCAL int gbGBCColorType = 0;
+CORE_LOCAL int gbHardware = 0;
+CORE_LOCAL int gbRomType = 0;
+CORE_LOCAL int gbRemainingClockTicks = 0;
+CORE_LOCAL int gbOldClockTicks = 0;
+CORE_LOCAL int gbIntBreak = 0;
+CORE_LOCAL int gbInterruptLaunched = 0;
+CORE_LOCAL u8 gbCheatingDevice = 0; // 1 = GS, 2 = GG
 // breakpoint
-bool breakpoint = false;
+CORE_LOCAL bool breakpoint = false;
 // interrupt
-int gbInt48Signal = 0;
-int gbInterruptWait = 0;
+CORE_LOCAL int gbInt48Signal = 0;
+CORE_LOCAL int gbInterruptWait = 0;
 // serial
-int gbSerialOn = 0;
-int gbSerialTicks = 0;
-int gbSerialBits = 0;
+CORE_LOCAL int gbSerialOn = 0;
+CORE_LOCAL int gbSerialTicks = 0;
+CORE_LOCAL int gbSerialBits = 0;
 // timer
-bool gbTimerOn = false;
-int gbTimerTicks = GBTIMER_MODE_0_CLOCK_TICKS;
-int gbTimerClockTicks = GBTIMER_MODE_0_CLOCK_TICKS;
-int gbTimerMode = 0;
-bool gbIncreased = false;
+CORE_LOCAL bool gbTimerOn = false;
+CORE_LOCAL int gbTimerTicks = 256; // GBTIMER_MODE_0_CLOCK_TICKS
+CORE_LOCAL int gbTimerClockTicks = 256; // GBTIMER_MODE_0_CLOCK_TICKS
+CORE_LOCAL int gbTimerMode = 0;
+CORE_LOCAL bool gbIncreased = false;
 // The internal timer is always active, and it is
 // not reset by writing to register_TIMA/TMA, but by
 // writing to register_DIV...
-int gbInternalTimer = 0x55;
+CORE_LOCAL int gbInternalTimer = 0x55;
 const u8 gbTimerMask [4] = {0xff, 0x3, 0xf, 0x3f};
 const u8 gbTimerBug [8] = {0x80, 0x80, 0x02, 0x02, 0x0, 0xff, 0x0, 0xff};
-bool gbTimerModeChange = false;
-bool gbTimerOnChange = false;
+CORE_LOCAL bool gbTimerModeChange = false;
+CORE_LOCAL bool gbTimerOnChange = false;
 // lcd
-bool gbScreenOn = true;
-int gbLcdMode = 2;
-int gbLcdModeDelayed = 2;
-int gbLcdTicks = GBLCD_MODE_2_CLOCK_TICKS-1;
-int gbLcdTicksDelayed = GBLCD_MODE_2_CLOCK_TICKS;
-int gbLcdLYIncrementTicks = 114;
-int gbLcdLYIncrementTicksDelayed = 115;
-int gbScreenTicks = 0;
-u8 gbSCYLine[300];
-u8 gbSCXLine[300];
-u8 gbBgpLine[300];
-u8 gbObp0Line [300];
-u8 gbObp1Line [300];
-u8 gbSpritesTicks [300];
-u8 oldRegister_WY;
-bool gbLYChangeHappened = false;
-bool gbLCDChangeHappened = false;
-int gbLine99Ticks = 1;
-int gbRegisterLYLCDCOffOn = 0;
-int inUseRegister_WY = 0;
+CORE_LOCAL bool gbScreenOn = true;
+CORE_LOCAL int gbLcdMode = 2;
+CORE_LOCAL int gbLcdModeDelayed = 2;
+CORE_LOCAL int gbLcdTicks = 20-1; // GBLCD_MODE_2_CLOCK_TICKS-1
+CORE_LOCAL int gbLcdTicksDelayed = 20; // GBLCD_MODE_2_CLOCK_TICKS
+CORE_LOCAL int gbLcdLYIncrementTicks = 114;
+CORE_LOCAL int gbLcdLYIncrementTicksDelayed = 115;
+CORE_LOCAL int gbScreenTicks = 0;
+CORE_LOCAL u8 gbSCYLine[300];
+CORE_LOCAL u8 gbSCXLine[300];
+CORE_LOCAL u8 gbBgpLine[300];
+CORE_LOCAL u8 gbObp0Line [300];
+CORE_LOCAL u8 gbObp1Line [300];
+CORE_LOCAL u8 gbSpritesTicks [300];
+CORE_LOCAL u8 oldRegister_WY;
+CORE_LOCAL bool gbLYChangeHappened = false;
+CORE_LOCAL bool gbLCDChangeHappened = false;
+CORE_LOCAL int gbLine99Ticks = 1;
+CORE_LOCAL int gbRegisterLYLCDCOffOn = 0;
+CORE_LOCAL int inUseRegister_WY = 0;
 
 // Used to keep track of the line that ellapse
 // when screen is off
-int gbWhiteScreen = 0;
-bool gbBlackScreen = false;
-int register_LCDCBusy = 0;
+CORE_LOCAL int gbWhiteScreen = 0;
+CORE_LOCAL bool gbBlackScreen = false;
+CORE_LOCAL int register_LCDCBusy = 0;
 
 // div
-int gbDivTicks = GBDIV_CLOCK_TICKS;
+CORE_LOCAL int gbDivTicks = 64; // GBDIV_CLOCK_TICKS
 // cgb
-int gbVramBank = 0;
-int gbWramBank = 1;
+CORE_LOCAL int gbVramBank = 0;
+CORE_LOCAL int gbWramBank = 1;
 //sgb
-bool gbSgbResetFlag = false;
+CORE_LOCAL bool gbSgbResetFlag = false;
 // gbHdmaDestination is 0x99d0 on startup (tested on HW)
 // but I'm not sure what gbHdmaSource is...
-int gbHdmaSource = 0x99d0;
-int gbHdmaDestination = 0x99d0;
-int gbHdmaBytes = 0x0000;
-int gbHdmaOn = 0;
-int gbSpeed = 0;
+CORE_LOCAL int gbHdmaSource = 0x99d0;
+CORE_LOCAL int gbHdmaDestination = 0x99d0;
+CORE_LOCAL int gbHdmaBytes = 0x0000;
+CORE_LOCAL int gbHdmaOn = 0;
+CORE_LOCAL int gbSpeed = 0;
 // frame counting
-int gbFrameCount = 0;
-int gbFrameSkip = 0;
-int gbFrameSkipCount = 0;
+CORE_LOCAL int gbFrameCount = 0;
+CORE_LOCAL int gbFrameSkip = 0;
+CORE_LOCAL int gbFrameSkipCount = 0;
 // timing
-u32 gbLastTime = 0;
-u32 gbElapsedTime = 0;
-u32 gbTimeNow = 0;
-int gbSynchronizeTicks = GBSYNCHRONIZE_CLOCK_TICKS;
+CORE_LOCAL u32 gbLastTime = 0;
+CORE_LOCAL u32 gbElapsedTime = 0;
+CORE_LOCAL u32 gbTimeNow = 0;
+CORE_LOCAL int gbSynchronizeTicks = 52920; // GBSYNCHRONIZE_CLOCK_TICKS
 // emulator features
-int gbBattery = 0;
-bool gbBatteryError = false;
-int gbCaptureNumber = 0;
-bool gbCapture = false;
-bool gbCapturePrevious = false;
-int gbJoymask[4] = { 0, 0, 0, 0 };
+CORE_LOCAL int gbBattery = 0;
+CORE_LOCAL bool gbBatteryError = false;
+CORE_LOCAL int gbCaptureNumber = 0;
+CORE_LOCAL bool gbCapture = false;
+CORE_LOCAL bool gbCapturePrevious = false;
+CORE_LOCAL int gbJoymask[4] = { 0, 0, 0, 0 };
 
-u8 gbRamFill = 0xff;
+CORE_LOCAL u8 gbRamFill = 0xff;
 
 int gbRomSizes[] = { 0x00008000, // 32K
                      0x00010000, // 64K
@@ -281,6 +282,28 @@ int gbCyclesCB[] = {
     2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2   // f
 };
 
+// gbCycles, with 0 for the opcodes a batch stops in front of: STOP, HALT,
+// DI, EI, RETI and the illegal ones all change IFF
+static const u8 gbBatchCycles[] = {
+//  0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+    1, 3, 2, 2, 1, 1, 2, 1, 5, 2, 2, 2, 1, 1, 2, 1,  // 0
+    0, 3, 2, 2, 1, 1, 2, 1, 3, 2, 2, 2, 1, 1, 2, 1,  // 1
+    2, 3, 2, 2, 1, 1, 2, 1, 2, 2, 2, 2, 1, 1, 2, 1,  // 2
+    2, 3, 2, 2, 3, 3, 3, 1, 2, 2, 2, 2, 1, 1, 2, 1,  // 3
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 4
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 5
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 6
+    2, 2, 2, 2, 2, 2, 0, 2, 1, 1, 1, 1, 1, 1, 2, 1,  // 7
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 8
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // 9
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // a
+    1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,  // b
+    2, 3, 3, 4, 3, 4, 2, 4, 2, 4, 3, 2, 3, 6, 2, 4,  // c
+    2, 3, 3, 0, 3, 4, 2, 4, 2, 0, 3, 0, 3, 0, 2, 4,  // d
+    3, 3, 2, 0, 0, 4, 2, 4, 4, 1, 4, 0, 0, 0, 2, 4,  // e
+    3, 3, 2, 0, 0, 4, 2, 4, 3, 2, 4, 0, 0, 0, 2, 4   // f
+};
+
 u16 DAATable[] = {
   0x0080,0x0100,0x0200,0x0300,0x0400,0x0500,0x0600,0x0700,
   0x0800,0x0900,0x1020,0x1120,0x1220,0x1320,0x1420,0x1520,
@@ -704,6 +727,11 @@ void gbCompareLYToLYC()
 
 void  gbWriteMemory(register u16 address, register u8 value)
 {
+  u8 *page = gbWriteMap[address>>12];
+  if(page) {
+    page[address&0x0fff] = value;
+    return;
+  }
 
   if(address < 0x8000) {
 #ifndef FINAL_VERSION
@@ -715,8 +743,11 @@ void  gbWriteMemory(register u16 address, register u8 value)
     }
 
 #endif
-    if(mapper)
+    if(mapper) {
       (*mapper)(address, value);
+      // the bank registers are all in this range
+      gbUpdateMemoryPages();
+    }
     return;
 
   }
@@ -1307,6 +1338,7 @@ void  gbWriteMemory(register u16 address, register u8 value)
         gbMemoryMap[0x00] = &gbRom[0x0000];
         memcpy ((u8 *)(gbRom+0x100), (u8 *)(gbMemory + 0x100), 0xF00);
         inBios = false;
+        gbUpdateMemoryPages();
       }
     }
 
@@ -1534,6 +1566,7 @@ void  gbWriteMemory(register u16 address, register u8 value)
 
         int wramAddress = bank * 0x1000;
         gbMemoryMap[0x0d] = &gbWram[wramAddress];
+        gbUpdateMemoryPages();
 
         gbWramBank = bank;
         gbMemory[0xff70] = register_SVBK = value;
@@ -1561,8 +1594,50 @@ void  gbWriteMemory(register u16 address, register u8 value)
   gbMemory[address] = value;
 }
 
+/****************************************************************************
+ * gbUpdateMemoryPages
+ *
+ * Rebuilds gbReadMap/gbWriteMap from gbMemoryMap. Only ROM, work RAM and
+ * cartridge RAM that no mapper handler sees are accessed directly, pages
+ * with a cheat fall back to the full checks.
+ ***************************************************************************/
+void gbUpdateMemoryPages()
+{
+  int i;
+
+  for(i = 0; i < 16; i++)
+    gbReadMap[i] = gbWriteMap[i] = NULL;
+
+  for(i = 0x00; i < 0x08; i++)
+    gbReadMap[i] = gbMemoryMap[i];
+
+#ifdef FINAL_VERSION
+  // memorydebug logs these in other builds
+  if(!mapperReadRAM) {
+    if(gbRamSizeMask >= 0x0fff)
+      gbReadMap[0x0a] = gbMemoryMap[0x0a];
+    if(gbRamSizeMask >= 0x1fff)
+      gbReadMap[0x0b] = gbMemoryMap[0x0b];
+  }
+#endif
+
+  gbReadMap[0x0c] = gbWriteMap[0x0c] = gbMemoryMap[0x0c];
+  gbReadMap[0x0d] = gbWriteMap[0x0d] = gbMemoryMap[0x0d];
+  // 0xE000 mirrors 0xC000
+  gbReadMap[0x0e] = gbWriteMap[0x0e] = gbMemoryMap[0x0c];
+
+  for(i = 0; i < 16; i++) {
+    if(gbCheatPages & (1 << i))
+      gbReadMap[i] = NULL;
+  }
+}
+
 u8 gbReadOpcode(register u16 address)
 {
+  u8 *page = gbReadMap[address>>12];
+  if(page)
+    return page[address&0x0fff];
+
   if(gbCheatMap[address])
     return gbCheatRead(address);
 
@@ -1712,6 +1787,10 @@ u8 gbReadOpcode(register u16 address)
 
 u8 gbReadMemory(register u16 address)
 {
+  u8 *page = gbReadMap[address>>12];
+  if(page)
+    return page[address&0x0fff];
+
   if(gbCheatMap[address])
     return gbCheatRead(address);
 
@@ -2671,6 +2750,7 @@ void gbReset()
     gbMemoryMap[0x0a] = &gbRam[0x0000];
     gbMemoryMap[0x0b] = &gbRam[0x1000];
   }
+  gbUpdateMemoryPages();
 
   gbSoundReset();
 
@@ -3405,7 +3485,7 @@ bool gbReadGSASnapshot(const char *fileName)
   return true;
 }
 
-variable_desc gbSaveGameStruct[] = {
+CORE_LOCAL_INIT variable_desc gbSaveGameStruct[] = {
   { &PC.W, sizeof(u16) },
   { &SP.W, sizeof(u16) },
   { &AF.W, sizeof(u16) },
@@ -3486,6 +3566,21 @@ variable_desc gbSaveGameStruct[] = {
   { NULL, 0 }
 };
 
+// Raw states only: the live core, which loading a save game otherwise
+// restarts from gbReset()
+CORE_LOCAL_INIT variable_desc gbRawStateStruct[] = {
+  { &soundTicks, sizeof(int) },
+  { &gbInternalTimer, sizeof(int) },
+  { &gbInterruptLaunched, sizeof(int) },
+  { &gbIntBreak, sizeof(int) },
+  { &gbDmaTicks, sizeof(int) },
+  { &gbLine99Ticks, sizeof(int) },
+  { &register_LCDCBusy, sizeof(int) },
+  { &gbLYChangeHappened, sizeof(bool) },
+  { &gbLCDChangeHappened, sizeof(bool) },
+  { NULL, 0 }
+};
+
 
 static bool gbWriteSaveState(gzFile gzFile)
 {
@@ -3570,6 +3665,21 @@ bool gbWriteMemSaveState(char *memory, int available)
   return res;
 }
 
+int gbWriteRawSaveState(char *memory, int available)
+{
+  gzFile gzFile = utilMemRawOpen(memory, available, "w");
+
+  bool res = gbWriteSaveState(gzFile);
+
+  utilWriteData(gzFile, gbRawStateStruct);
+
+  long size = utilGzMemTell(gzFile);
+
+  utilGzClose(gzFile);
+
+  return (res && size > 0) ? size : 0;
+}
+
 bool gbWriteSaveState(const char *name)
 {
   gzFile gzFile = utilGzOpen(name,"wb");
@@ -3583,7 +3693,7 @@ bool gbWriteSaveState(const char *name)
   return res;
 }
 
-static bool gbReadSaveState(gzFile gzFile)
+static bool gbReadSaveState(gzFile gzFile, bool screen = true)
 {
   int version = utilReadInt(gzFile);
 
@@ -3695,7 +3805,8 @@ static bool gbReadSaveState(gzFile gzFile)
   if(version < GBSAVE_GAME_VERSION_5) {
     utilGzRead(gzFile, pix, 256*224*sizeof(u16));
   }
-  memset(pix, 0, 257*226*sizeof(u32));
+  if(screen)
+    memset(pix, 0, 257*226*sizeof(u32));
 
   if(version < GBSAVE_GAME_VERSION_6) {
     utilGzRead(gzFile, gbPalette, 64 * sizeof(u16));
@@ -3841,6 +3952,7 @@ static bool gbReadSaveState(gzFile gzFile)
     gbMemoryMap[0x09] = &gbVram[register_VBK * 0x2000 + 0x1000];
     gbMemoryMap[0x0d] = &gbWram[value * 0x1000];
   }
+  gbUpdateMemoryPages();
 
   gbSoundReadGame(version, gzFile);
 
@@ -3961,6 +4073,22 @@ bool gbReadMemSaveState(char *memory, int available)
   return res;
 }
 
+// Raw states keep the screen, the next frame draws it again
+bool gbReadRawSaveState(const char *memory, int size)
+{
+  gzFile gzFile = utilMemRawOpen((char *)memory, size, "r");
+
+  bool res = gbReadSaveState(gzFile, false);
+
+  if(res)
+    utilReadData(gzFile, gbRawStateStruct);
+
+  if(utilGzClose(gzFile) != Z_OK)
+    res = false;
+
+  return res;
+}
+
 bool gbReadSaveState(const char *name)
 {
   gzFile gzFile = utilGzOpen(name,"rb");
@@ -4452,7 +4580,266 @@ void gbDrawLine()
   }
 }
 
+// Batched CPU core ///////////////////////////////////////////////////////
+//
+// Between two events the per-instruction loop only counts DIV, the LCD,
+// sound and the timer down. While the CPU is quiet (no HALT, no EI/DI in
+// flight, no interrupt about to be taken, no serial transfer) gbEmulate()
+// runs instructions back to back until the nearest event could be reached
+// and then applies their ticks to the counters in one go. Accesses whose
+// result depends on the exact time (VRAM, OAM, I/O) bring the counters up
+// to date first, and a write to an I/O register ends the batch since it
+// can move the next event.
+
+#define GB_BATCH_MAX_TICKS 6  // longest instruction, a taken CALL cc
+#define GB_BATCH_LOG 512
+
+// gbCodes.h and gbCodesCB.h label their handlers with GB_OPCODE(n), they
+// are switch cases unless the batched core makes them goto labels
+#define GB_OPCODE(n) case n
+
+// only read by gbEmulate(), which hands it down to gbEmulateCore()
+int gbCoreMode = GB_CORE_BATCH;
+CORE_LOCAL u32 gbCoreBatches = 0;
+CORE_LOCAL u32 gbCoreChecked = 0;
+CORE_LOCAL u32 gbCoreMismatches = 0;
+
+static CORE_LOCAL int gbBatchPending = 0;   // ticks run but not applied to the counters
+static CORE_LOCAL bool gbBatchLeave = false; // an I/O register was written
+
+// lockstep mode, writes the batch made and the bytes they replaced
+static CORE_LOCAL bool gbBatchPure;
+static CORE_LOCAL int gbBatchLogged;
+static CORE_LOCAL u8 *gbBatchLogPtr[GB_BATCH_LOG];
+static CORE_LOCAL u8 gbBatchLogOld[GB_BATCH_LOG];
+
+struct gbCoreState {
+  u16 AF, BC, DE, HL, SP, PC, IFF;
+  u8 DIV, TIMA, IF, STAT, LY;
+  u8 io[4];
+  int divTicks;
+  int lcdTicks, lcdTicksDelayed;
+  int lyTicks, lyTicksDelayed;
+  int lcdMode, lcdModeDelayed;
+  int soundTicks;
+  int timerTicks, internalTimer;
+  int interruptLaunched, interruptWait, intBreak;
+  int lcdcBusy, clockTicks, dmaTicks;
+  bool lcdChange, lyChange, timerOnChange, timerModeChange, blackScreen;
+};
+
+static void gbCoreSave(gbCoreState *s)
+{
+  memset(s, 0, sizeof(*s));
+  s->AF = AF.W; s->BC = BC.W; s->DE = DE.W; s->HL = HL.W;
+  s->SP = SP.W; s->PC = PC.W; s->IFF = IFF;
+  s->DIV = register_DIV; s->TIMA = register_TIMA; s->IF = register_IF;
+  s->STAT = register_STAT; s->LY = register_LY;
+  s->io[0] = gbMemory[0xff04]; s->io[1] = gbMemory[0xff05];
+  s->io[2] = gbMemory[0xff0f]; s->io[3] = gbMemory[0xff41];
+  s->divTicks = gbDivTicks;
+  s->lcdTicks = gbLcdTicks; s->lcdTicksDelayed = gbLcdTicksDelayed;
+  s->lyTicks = gbLcdLYIncrementTicks; s->lyTicksDelayed = gbLcdLYIncrementTicksDelayed;
+  s->lcdMode = gbLcdMode; s->lcdModeDelayed = gbLcdModeDelayed;
+  s->soundTicks = soundTicks;
+  s->timerTicks = gbTimerTicks; s->internalTimer = gbInternalTimer;
+  s->interruptLaunched = gbInterruptLaunched; s->interruptWait = gbInterruptWait;
+  s->intBreak = gbIntBreak;
+  s->lcdcBusy = register_LCDCBusy; s->clockTicks = clockTicks; s->dmaTicks = gbDmaTicks;
+  s->lcdChange = gbLCDChangeHappened; s->lyChange = gbLYChangeHappened;
+  s->timerOnChange = gbTimerOnChange; s->timerModeChange = gbTimerModeChange;
+  s->blackScreen = gbBlackScreen;
+}
+
+static void gbCoreRestore(const gbCoreState *s)
+{
+  AF.W = s->AF; BC.W = s->BC; DE.W = s->DE; HL.W = s->HL;
+  SP.W = s->SP; PC.W = s->PC; IFF = s->IFF;
+  register_DIV = s->DIV; register_TIMA = s->TIMA; register_IF = s->IF;
+  register_STAT = s->STAT; register_LY = s->LY;
+  gbMemory[0xff04] = s->io[0]; gbMemory[0xff05] = s->io[1];
+  gbMemory[0xff0f] = s->io[2]; gbMemory[0xff41] = s->io[3];
+  gbDivTicks = s->divTicks;
+  gbLcdTicks = s->lcdTicks; gbLcdTicksDelayed = s->lcdTicksDelayed;
+  gbLcdLYIncrementTicks = s->lyTicks; gbLcdLYIncrementTicksDelayed = s->lyTicksDelayed;
+  gbLcdMode = s->lcdMode; gbLcdModeDelayed = s->lcdModeDelayed;
+  soundTicks = s->soundTicks;
+  gbTimerTicks = s->timerTicks; gbInternalTimer = s->internalTimer;
+  gbInterruptLaunched = s->interruptLaunched; gbInterruptWait = s->interruptWait;
+  gbIntBreak = s->intBreak;
+  register_LCDCBusy = s->lcdcBusy; clockTicks = s->clockTicks; gbDmaTicks = s->dmaTicks;
+  gbLCDChangeHappened = s->lcdChange; gbLYChangeHappened = s->lyChange;
+  gbTimerOnChange = s->timerOnChange; gbTimerModeChange = s->timerModeChange;
+  gbBlackScreen = s->blackScreen;
+}
+
+// Nothing but the counters moves until the next event
+static inline bool gbBatchQuiet()
+{
+#ifndef FINAL_VERSION
+  if(systemDebug)
+    return false;
+#endif
+  return !(IFF & 0xfe) && !gbIntBreak && !gbInterruptWait &&
+    !((register_IE & register_IF & 0x1f) && (IFF & 1)) &&
+    (register_LCDC & 0x80) && !register_LCDCBusy && !gbBlackScreen &&
+    !gbSerialOn && !(gbSgbMode && gbSgbPacketTimeout);
+}
+
+// Ticks that can pass before any counter fires. DIV and TIMA only
+// count, they are caught up on the next access, so the timer ends a
+// batch when it overflows rather than on every increment.
+static int gbBatchBudget(int ticks)
+{
+  int lcd = gbLCDChangeHappened ? gbLcdTicksDelayed : gbLcdTicks;
+  int ly = gbLYChangeHappened ? gbLcdLYIncrementTicksDelayed : gbLcdLYIncrementTicks;
+  int sound = (gbSpeed ? soundTicks : soundTicks >> 1) + 1;
+
+  if(lcd < ticks)
+    ticks = lcd;
+  if(ly < ticks)
+    ticks = ly;
+  if(sound < ticks)
+    ticks = sound;
+  if(gbTimerOn) {
+    int overflow = (gbInternalTimer & gbTimerMask[gbTimerMode]) + 1 +
+      (0xff - register_TIMA) * gbTimerClockTicks;
+    if(overflow < ticks)
+      ticks = overflow;
+  }
+  return ticks;
+}
+
+// What the per-instruction loop does to the counters when none of them
+// fires, for all the ticks the batch has run so far
+static void gbBatchSync()
+{
+  int ticks = gbBatchPending;
+
+  if(!ticks)
+    return;
+  gbBatchPending = 0;
+
+  gbInterruptLaunched = 0;
+  gbDivTicks -= ticks;
+  while(gbDivTicks <= 0) {
+    gbMemory[0xff04] = ++register_DIV;
+    gbDivTicks += GBDIV_CLOCK_TICKS;
+  }
+  gbLcdTicks -= ticks;
+  gbLcdTicksDelayed -= ticks;
+  gbLcdLYIncrementTicks -= ticks;
+  gbLcdLYIncrementTicksDelayed -= ticks;
+  gbMemory[0xff0f] = register_IF;
+  gbMemory[0xff41] = register_STAT = (register_STAT & 0xfc) | gbLcdModeDelayed;
+
+  soundTicks -= gbSpeed ? ticks : ticks << 1;
+
+  if(gbTimerOn) {
+    gbTimerTicks = (gbInternalTimer & gbTimerMask[gbTimerMode]) + 1 - ticks;
+    while(gbTimerTicks <= 0) {
+      register_TIMA++;
+      gbTimerTicks += gbTimerClockTicks;
+    }
+    gbTimerOnChange = false;
+    gbTimerModeChange = false;
+    gbMemory[0xff05] = register_TIMA;
+  }
+  gbInternalTimer = (gbInternalTimer - ticks) & 0xff;
+}
+
+// VRAM, OAM and the I/O registers, HRAM is plain memory
+static inline bool gbBatchTimed(u16 address)
+{
+  return (address & 0xe000) == 0x8000 ||
+    (address >= 0xfe00 && (address < 0xff80 || address == 0xffff));
+}
+
+static void gbBatchLog(u16 address)
+{
+  if(address < 0x8000 || (address >= 0xa000 && address < 0xc000) ||
+     (address >= 0xff00 && (address < 0xff80 || address == 0xffff)) ||
+     gbBatchLogged == GB_BATCH_LOG) {
+    // mapper and I/O writes can't be taken back
+    gbBatchPure = false;
+    return;
+  }
+
+  if((address >= 0xe000) && (address < 0xfe00))
+    address &= ~0x2000;
+
+  u8 *p = address < 0xfe00 ? &gbMemoryMap[address >> 12][address & 0x0fff] : &gbMemory[address];
+  gbBatchLogPtr[gbBatchLogged] = p;
+  gbBatchLogOld[gbBatchLogged++] = *p;
+}
+
+static inline u8 gbBatchReadOpcode(u16 address)
+{
+  if(gbBatchTimed(address))
+    gbBatchSync();
+  return gbReadOpcode(address);
+}
+
+static inline u8 gbBatchReadMemory(u16 address)
+{
+  if(gbBatchTimed(address))
+    gbBatchSync();
+  return gbReadMemory(address);
+}
+
+static inline void gbBatchWriteMemory(u16 address, u8 value)
+{
+  if(gbBatchTimed(address)) {
+    gbBatchSync();
+    if(address >= 0xff00)
+      gbBatchLeave = true;
+  }
+  if(gbBatchPure)
+    gbBatchLog(address);
+  gbWriteMemory(address, value);
+}
+
+// Takes the batch that just ran back, replays it one instruction at a time
+// from the same starting state and reports any difference. Execution
+// continues from the per-instruction core's state.
+static void gbEmulateCore(int ticksToStop, int mode);
+
+static void gbBatchCompare(const gbCoreState *before, int ticks, int count)
+{
+  gbCoreState batch, step;
+  u8 written[GB_BATCH_LOG];
+  int i;
+
+  gbCoreSave(&batch);
+  for(i = 0; i < gbBatchLogged; i++)
+    written[i] = *gbBatchLogPtr[i];
+  for(i = gbBatchLogged - 1; i >= 0; i--)
+    *gbBatchLogPtr[i] = gbBatchLogOld[i];
+  gbCoreRestore(before);
+
+  gbEmulateCore(ticks, GB_CORE_STEP);
+  gbCoreSave(&step);
+  gbCoreChecked++;
+
+  for(i = 0; i < gbBatchLogged && written[i] == *gbBatchLogPtr[i]; i++);
+
+  if(i < gbBatchLogged || memcmp(&batch, &step, sizeof(batch)) != 0) {
+    gbCoreMismatches++;
+    if(gbCoreMismatches <= 16)
+      systemMessage(0, N_("GB batch mismatch at %04x (%d insns, %d ticks): "
+                          "PC %04x/%04x AF %04x/%04x LCD %d/%d DIV %d/%d memory %s"),
+                    before->PC, count, ticks, batch.PC, step.PC, batch.AF, step.AF,
+                    batch.lcdTicks, step.lcdTicks, batch.divTicks, step.divTicks,
+                    i < gbBatchLogged ? "differs" : "same");
+  }
+}
+
 void gbEmulate(int ticksToStop)
+{
+  gbEmulateCore(ticksToStop, gbCoreMode);
+}
+
+static void gbEmulateCore(int ticksToStop, int mode)
 {
   gbRegister tempRegister;
   u8 tempValue;
@@ -4484,6 +4871,121 @@ void gbEmulate(int ticksToStop)
 
     u16 oldPCW = PC.W;
 
+    if(mode != GB_CORE_STEP && gbBatchQuiet()) {
+      int budget = gbBatchBudget(ticksToStop);
+
+      if(budget > GB_BATCH_MAX_TICKS) {
+#ifdef __GNUC__
+#define GB_LABELS(p, h) &&p##h##0, &&p##h##1, &&p##h##2, &&p##h##3, \
+  &&p##h##4, &&p##h##5, &&p##h##6, &&p##h##7, &&p##h##8, &&p##h##9, \
+  &&p##h##a, &&p##h##b, &&p##h##c, &&p##h##d, &&p##h##e, &&p##h##f
+        static const void *const gbBatchOpcodes[256] = {
+          GB_LABELS(gbOpcode0x, 0), GB_LABELS(gbOpcode0x, 1), GB_LABELS(gbOpcode0x, 2), GB_LABELS(gbOpcode0x, 3),
+          GB_LABELS(gbOpcode0x, 4), GB_LABELS(gbOpcode0x, 5), GB_LABELS(gbOpcode0x, 6), GB_LABELS(gbOpcode0x, 7),
+          GB_LABELS(gbOpcode0x, 8), GB_LABELS(gbOpcode0x, 9), GB_LABELS(gbOpcode0x, a), GB_LABELS(gbOpcode0x, b),
+          GB_LABELS(gbOpcode0x, c), GB_LABELS(gbOpcode0x, d), GB_LABELS(gbOpcode0x, e), GB_LABELS(gbOpcode0x, f)
+        };
+        static const void *const gbBatchOpcodesCB[256] = {
+          GB_LABELS(gbOpcodeCB0x, 0), GB_LABELS(gbOpcodeCB0x, 1), GB_LABELS(gbOpcodeCB0x, 2), GB_LABELS(gbOpcodeCB0x, 3),
+          GB_LABELS(gbOpcodeCB0x, 4), GB_LABELS(gbOpcodeCB0x, 5), GB_LABELS(gbOpcodeCB0x, 6), GB_LABELS(gbOpcodeCB0x, 7),
+          GB_LABELS(gbOpcodeCB0x, 8), GB_LABELS(gbOpcodeCB0x, 9), GB_LABELS(gbOpcodeCB0x, a), GB_LABELS(gbOpcodeCB0x, b),
+          GB_LABELS(gbOpcodeCB0x, c), GB_LABELS(gbOpcodeCB0x, d), GB_LABELS(gbOpcodeCB0x, e), GB_LABELS(gbOpcodeCB0x, f)
+        };
+#undef GB_LABELS
+#endif
+        gbCoreState before;
+        int ran = 0;
+        int count = 0;
+
+        // the batch logs its writes only while it can still be taken back
+        gbBatchPure = mode == GB_CORE_LOCKSTEP;
+        if(gbBatchPure) {
+          gbCoreSave(&before);
+          gbBatchLogged = 0;
+        }
+        gbBatchLeave = false;
+        gbCoreBatches++;
+
+        while(ran + GB_BATCH_MAX_TICKS < budget && !gbBatchTimed(PC.W)) {
+          opcode1 = opcode = gbReadOpcode(PC.W);
+
+          int ticks = gbBatchCycles[opcode];
+          if(!ticks)
+            break;
+          PC.W++;
+
+          if(opcode1 == 0xCB) {
+            opcode = gbBatchReadOpcode(PC.W++);
+            ticks = gbCyclesCB[opcode];
+          }
+          gbBatchPending += ticks;
+          ran += ticks;
+          clockTicks = 0;
+          BENCH_INSN();
+
+#define gbReadOpcode gbBatchReadOpcode
+#define gbReadMemory gbBatchReadMemory
+#define gbWriteMemory gbBatchWriteMemory
+#undef GB_OPCODE
+#ifdef __GNUC__
+          // each handler is a label of its own, reached through the tables
+          goto *gbBatchOpcodes[opcode1];
+        gbOpcode0xcb:
+          goto *gbBatchOpcodesCB[opcode];
+#define GB_OPCODE(n) gbOpcodeCB##n
+          switch(0) {
+#include "gbCodesCB.h"
+          }
+          goto gbBatchNext;
+#undef GB_OPCODE
+#define GB_OPCODE(n) gbOpcode##n
+          switch(0) {
+#include "gbCodes.h"
+          }
+        gbBatchNext:
+#else
+#define GB_OPCODE(n) case n
+          if(opcode1 == 0xCB) {
+            switch(opcode) {
+#include "gbCodesCB.h"
+            }
+          } else {
+            switch(opcode) {
+#include "gbCodes.h"
+            }
+          }
+#endif
+#undef GB_OPCODE
+#define GB_OPCODE(n) case n
+#undef gbReadOpcode
+#undef gbReadMemory
+#undef gbWriteMemory
+
+          count++;
+          if(gbBatchLeave)
+            break;
+          gbBatchPending += clockTicks;
+          ran += clockTicks;
+          clockTicks = 0;
+        }
+
+        // the last instruction's own extra ticks, if it wrote an I/O
+        // register, are left to the per-instruction loop below
+        gbBatchSync();
+        ticksToStop -= ran;
+
+        if(gbBatchPure && count)
+          gbBatchCompare(&before, ran, count);
+
+        // with nothing run, the next instruction needs the loop below
+        if(count) {
+          gbDmaTicks += clockTicks;
+          clockTicks = 0;
+          goto gbBatchEnd;
+        }
+      }
+    }
+
     if(IFF & 0x80) {
       if(register_LCDC & 0x80) {
           clockTicks = gbLcdTicks;
@@ -4521,6 +5023,7 @@ void gbEmulate(int ticksToStop)
       execute = true;
 
       opcode2 = opcode1 = opcode = gbReadOpcode(PC.W++);
+      BENCH_INSN();
 
       // If HALT state was launched while IME = 0 and (register_IF & register_IE & 0x1F),
       // PC.W is not incremented for the first byte of the next instruction.
@@ -4948,6 +5451,9 @@ void gbEmulate(int ticksToStop)
           } else
              gbFrameSkipCount++;
 
+          if(systemPauseOnFrame())
+            ticksToStop = 0;
+
               } else {
                 // go the the OAM being accessed mode
                 gbLcdTicksDelayed += GBLCD_MODE_2_CLOCK_TICKS;
@@ -4988,6 +5494,7 @@ void gbEmulate(int ticksToStop)
               if((register_LY < 144) && (register_LCDC & 0x80) && gbScreenOn) {
                 if(!gbSgbMask) {
                   if(gbFrameSkipCount >= framesToSkip) {
+                    BENCH_BEGIN(BENCH_RENDER);
                     if (!gbBlackScreen)
                     {
                       gbRenderLine();
@@ -5006,6 +5513,7 @@ void gbEmulate(int ticksToStop)
                       }
                     }
                     gbDrawLine();
+                    BENCH_END(BENCH_RENDER);
                   }
                 }
               }
@@ -5161,6 +5669,9 @@ void gbEmulate(int ticksToStop)
               gbLastTime = currentTime;
               gbFrameCount = 0;
             }
+
+            if(systemPauseOnFrame())
+              ticksToStop = 0;
           }
         }
       }
@@ -5229,7 +5740,9 @@ void gbEmulate(int ticksToStop)
     while(soundTicks < 0) {
       soundTicks += SOUND_CLOCK_TICKS;
 
+      BENCH_BEGIN(BENCH_SOUND);
       gbSoundTick();
+      BENCH_END(BENCH_SOUND);
     }
 
 
@@ -5302,6 +5815,7 @@ void gbEmulate(int ticksToStop)
       }
     }
 
+    gbBatchEnd:
     if (gbDmaTicks)
     {
       clockTicks = gbGetNextEvent(gbDmaTicks);
@@ -5418,6 +5932,10 @@ struct EmulatedSystem GBSystem = {
   gbReadMemSaveState,
   // emuWriteMemState
   gbWriteMemSaveState,
+  // emuReadRawState
+  gbReadRawSaveState,
+  // emuWriteRawState
+  gbWriteRawSaveState,
   // emuWritePNG
   gbWritePNGFile,
   // emuWriteBMP
@@ -17,9 +17,13 @@ typedef union {
   u16 W;
 } gbRegister;
 
+// gbEmulate() cores
+enum { GB_CORE_STEP, GB_CORE_BATCH, GB_CORE_LOCKSTEP };
+
 bool gbLoadRom(const char *);
 void gbEmulate(int);
 void gbWriteMemory(register u16, register u8);
+void gbUpdateMemoryPages();
 void gbDrawLine();
 bool gbIsGameboyRom(const char *);
 void gbGetHardwareType();
@@ -33,6 +37,8 @@ bool gbWriteSaveState(const char *);
 bool gbWriteMemSaveState(char *, int);
 bool gbReadSaveState(const char *);
 bool gbReadMemSaveState(char *, int);
+bool gbReadRawSaveState(const char *, int);
+int gbWriteRawSaveState(char *, int);
 void gbSgbRenderBorder();
 bool gbWritePNGFile(const char *);
 bool gbWriteBMPFile(const char *);
@@ -40,6 +46,11 @@ bool gbReadGSASnapshot(const char *);
 
 extern struct EmulatedSystem GBSystem;
 
+extern int gbCoreMode; // one of the cores above, set before emulation starts
+extern CORE_LOCAL u32 gbCoreBatches;
+extern CORE_LOCAL u32 gbCoreChecked;
+extern CORE_LOCAL u32 gbCoreMismatches;
+
 bool MemgbReadBatteryFile(char * membuffer, int read);
 int MemgbWriteBatteryFile(char * membuffer);
 
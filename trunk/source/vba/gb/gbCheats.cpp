@@ -11,12 +11,13 @@
 #include "gbGlobals.h"
 #include "gb.h"
 
-gbCheat gbCheatList[100];
-int gbCheatNumber = 0;
-int gbNextCheat = 0;
-bool gbCheatMap[0x10000];
+CORE_LOCAL gbCheat gbCheatList[100];
+CORE_LOCAL int gbCheatNumber = 0;
+CORE_LOCAL int gbNextCheat = 0;
+CORE_LOCAL bool gbCheatMap[0x10000];
+CORE_LOCAL u16 gbCheatPages = 0; // one bit per 4KB page with an address in gbCheatMap
 
-extern bool cheatsEnabled;
+extern CORE_LOCAL bool cheatsEnabled;
 
 #define GBCHEAT_IS_HEX(a) ( ((a)>='A' && (a) <='F') || ((a) >='0' && (a) <= '9'))
 #define GBCHEAT_HEX_VALUE(a) ( (a) >= 'A' ? (a) - 'A' + 10 : (a) - '0')
@@ -24,11 +25,15 @@ extern bool cheatsEnabled;
 void gbCheatUpdateMap()
 {
   memset(gbCheatMap, 0, 0x10000);
+  gbCheatPages = 0;
 
   for(int i = 0; i < gbCheatNumber; i++) {
-    if(gbCheatList[i].enabled)
+    if(gbCheatList[i].enabled) {
       gbCheatMap[gbCheatList[i].address] = true;
+      gbCheatPages |= 1 << (gbCheatList[i].address >> 12);
+    }
   }
+  gbUpdateMemoryPages();
 }
 
 void gbCheatsSaveGame(gzFile gzFile)
@@ -366,6 +371,8 @@ bool gbAddGgCheat(const char *code, const char *desc)
   gbCheatList[i].enabled = true;
 
   gbCheatMap[gbCheatList[i].address] = true;
+  gbCheatPages |= 1 << (gbCheatList[i].address >> 12);
+  gbUpdateMemoryPages();
 
   gbCheatNumber++;
 
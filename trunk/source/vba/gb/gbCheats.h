@@ -37,8 +37,9 @@ bool gbVerifyGsCode(const char *code);
 bool gbVerifyGgCode(const char *code);
 
 
-extern int gbCheatNumber;
-extern gbCheat gbCheatList[100];
-extern bool gbCheatMap[0x10000];
+extern CORE_LOCAL int gbCheatNumber;
+extern CORE_LOCAL gbCheat gbCheatList[100];
+extern CORE_LOCAL bool gbCheatMap[0x10000];
+extern CORE_LOCAL u16 gbCheatPages;
 
 #endif // GBCHEATS_H
@@ -7,9 +7,9 @@
 void gbSetBGPalette(u8 value, bool ColoursChanged=false);
 void gbSetObj0Palette(u8 value, bool ColoursChanged=false);
 void gbSetObj1Palette(u8 value, bool ColoursChanged=false);
-extern bool ColorizeGameboy;
+extern CORE_LOCAL bool ColorizeGameboy;
 
-u8 gbInvertTab[256] = {
+CORE_LOCAL u8 gbInvertTab[256] = {
   0x00,0x80,0x40,0xc0,0x20,0xa0,0x60,0xe0,
   0x10,0x90,0x50,0xd0,0x30,0xb0,0x70,0xf0,
   0x08,0x88,0x48,0xc8,0x28,0xa8,0x68,0xe8,
@@ -44,14 +44,14 @@ u8 gbInvertTab[256] = {
   0x1f,0x9f,0x5f,0xdf,0x3f,0xbf,0x7f,0xff
 };
 
-u16 gbLineMix[160];
-u16 gbWindowColor[160];
-extern int inUseRegister_WY;
-extern int layerSettings;
+CORE_LOCAL u16 gbLineMix[160];
+CORE_LOCAL u16 gbWindowColor[160];
+extern CORE_LOCAL int inUseRegister_WY;
+extern CORE_LOCAL int layerSettings;
 
 void gbRenderLine()
 {
-  static u8 oldBgPal=0;
+  static CORE_LOCAL u8 oldBgPal=0;
   memset(gbLineMix, 0, sizeof(gbLineMix));
   u8 * bank0;
   u8 * bank1;
@@ -439,7 +439,7 @@ void gbRenderLine()
 void gbDrawSpriteTile(int tile, int x,int y,int t, int flags,
                       int size,int spriteNumber)
 {
-  static u8 oldObj0Pal=0, oldObj1Pal=0;
+  static CORE_LOCAL u8 oldObj0Pal=0, oldObj1Pal=0;
   u8 * bank0;
   u8 * bank1;
   if(gbCgbMode) {
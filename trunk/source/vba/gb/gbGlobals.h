@@ -1,77 +1,81 @@
 #ifndef GBGLOBALS_H
 #define GBGLOBALS_H
 
-extern int gbRomSizeMask;
-extern int gbRomSize;
-extern int gbRamSize;
-extern int gbRamSizeMask;
-extern int gbTAMA5ramSize;
+extern CORE_LOCAL int gbRomSizeMask;
+extern CORE_LOCAL int gbRomSize;
+extern CORE_LOCAL int gbRamSize;
+extern CORE_LOCAL int gbRamSizeMask;
+extern CORE_LOCAL int gbTAMA5ramSize;
 
-extern bool useBios;
-extern bool skipBios;
-extern u8 *bios;
-extern bool skipSaveGameBattery;
-extern bool skipSaveGameCheats;
+extern CORE_LOCAL bool useBios;
+extern CORE_LOCAL bool skipBios;
+extern CORE_LOCAL u8 *bios;
+extern CORE_LOCAL bool skipSaveGameBattery;
+extern CORE_LOCAL bool skipSaveGameCheats;
 
-extern u8 *gbRom;
-extern u8 *gbRam;
-extern u8 *gbVram;
-extern u8 *gbWram;
-extern u8 *gbMemory;
-extern u16 *gbLineBuffer;
-extern u8 *gbTAMA5ram;
+extern CORE_LOCAL u8 *gbRom;
+extern CORE_LOCAL u8 *gbRam;
+extern CORE_LOCAL u8 *gbVram;
+extern CORE_LOCAL u8 *gbWram;
+extern CORE_LOCAL u8 *gbMemory;
+extern CORE_LOCAL u16 *gbLineBuffer;
+extern CORE_LOCAL u8 *gbTAMA5ram;
 
-extern u8 *gbMemoryMap[16];
+extern CORE_LOCAL u8 *gbMemoryMap[16];
+// gbMemoryMap pages that are plain memory for reads/writes, NULL where
+// gbReadMemory()/gbWriteMemory() have to look closer
+extern CORE_LOCAL u8 *gbReadMap[16];
+extern CORE_LOCAL u8 *gbWriteMap[16];
 
-extern int gbFrameSkip;
-extern u16 gbColorFilter[32768];
-extern int gbColorOption;
-extern int gbPaletteOption;
-extern int gbEmulatorType;
-extern int gbBorderOn;
-extern int gbBorderAutomatic;
-extern int gbCgbMode;
-extern int gbSgbMode;
-extern int gbWindowLine;
-extern int gbSpeed;
-extern u8 gbBgp[4];
-extern u8 gbObp0[4];
-extern u8 gbObp1[4];
-extern u16 gbPalette[128];
-extern bool gbScreenOn;
+extern CORE_LOCAL int gbFrameSkip;
+extern CORE_LOCAL u16 gbColorFilter[32768];
+extern CORE_LOCAL int gbColorOption;
+extern CORE_LOCAL int gbPaletteOption;
+extern CORE_LOCAL int gbEmulatorType;
+extern CORE_LOCAL int gbBorderOn;
+extern CORE_LOCAL int gbBorderAutomatic;
+extern CORE_LOCAL int gbCgbMode;
+extern CORE_LOCAL int gbSgbMode;
+extern CORE_LOCAL int gbWindowLine;
+extern CORE_LOCAL int gbSpeed;
+extern CORE_LOCAL u8 gbBgp[4];
+extern CORE_LOCAL u8 gbObp0[4];
+extern CORE_LOCAL u8 gbObp1[4];
+extern CORE_LOCAL u16 gbPalette[128];
+extern CORE_LOCAL bool gbScreenOn;
 extern bool gbDrawWindow;
-extern u8 gbSCYLine[300];
+extern CORE_LOCAL u8 gbSCYLine[300];
 // gbSCXLine is used for the emulation (bug) of the SX change
 // found in the Artic Zone game.
-extern u8 gbSCXLine[300];
+extern CORE_LOCAL u8 gbSCXLine[300];
 // gbBgpLine is used for the emulation of the
 // Prehistorik Man's title screen scroller.
-extern u8 gbBgpLine[300];
-extern u8 gbObp0Line [300];
-extern u8 gbObp1Line [300];
+extern CORE_LOCAL u8 gbBgpLine[300];
+extern CORE_LOCAL u8 gbObp0Line [300];
+extern CORE_LOCAL u8 gbObp1Line [300];
 // gbSpritesTicks is used for the emulation of Parodius' Laser Beam.
-extern u8 gbSpritesTicks[300];
+extern CORE_LOCAL u8 gbSpritesTicks[300];
 
-extern u8 register_LCDC;
-extern u8 register_LY;
-extern u8 register_SCY;
-extern u8 register_SCX;
-extern u8 register_WY;
-extern u8 register_WX;
-extern u8 register_VBK;
-extern u8 oldRegister_WY;
+extern CORE_LOCAL u8 register_LCDC;
+extern CORE_LOCAL u8 register_LY;
+extern CORE_LOCAL u8 register_SCY;
+extern CORE_LOCAL u8 register_SCX;
+extern CORE_LOCAL u8 register_WY;
+extern CORE_LOCAL u8 register_WX;
+extern CORE_LOCAL u8 register_VBK;
+extern CORE_LOCAL u8 oldRegister_WY;
 
-extern int emulating;
-extern bool genericflashcardEnable;
+extern CORE_LOCAL int emulating;
+extern CORE_LOCAL bool genericflashcardEnable;
 
-extern int gbBorderLineSkip;
-extern int gbBorderRowSkip;
-extern int gbBorderColumnSkip;
-extern int gbDmaTicks;
+extern CORE_LOCAL int gbBorderLineSkip;
+extern CORE_LOCAL int gbBorderRowSkip;
+extern CORE_LOCAL int gbBorderColumnSkip;
+extern CORE_LOCAL int gbDmaTicks;
 
 extern void gbRenderLine();
 extern void gbDrawSprites(bool);
 
-extern u8 (*gbSerialFunction)(u8);
+extern CORE_LOCAL u8 (*gbSerialFunction)(u8);
 
 #endif // GBGLOBALS_H
@@ -5,11 +5,11 @@
 #include "gb.h"
 u8 gbDaysinMonth [12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
 const u8 gbDisabledRam [8] = {0x80, 0xff, 0xf0, 0x00, 0x30, 0xbf, 0xbf, 0xbf};
-extern int gbHardware;
-extern int gbGBCColorType;
-extern gbRegister PC;
+extern CORE_LOCAL int gbHardware;
+extern CORE_LOCAL int gbGBCColorType;
+extern CORE_LOCAL gbRegister PC;
 
-mapperMBC1 gbDataMBC1 = {
+CORE_LOCAL mapperMBC1 gbDataMBC1 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -245,7 +245,7 @@ void memoryUpdateMapMBC1()
   }
 }
 
-mapperMBC2 gbDataMBC2 = {
+CORE_LOCAL mapperMBC2 gbDataMBC2 = {
   0, // RAM enable
   1  // ROM bank
 };
@@ -305,7 +305,7 @@ void memoryUpdateMapMBC2()
   gbMemoryMap[0x07] = &gbRom[tmpAddress + 0x3000];
 }
 
-mapperMBC3 gbDataMBC3 = {
+CORE_LOCAL mapperMBC3 gbDataMBC3 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -531,7 +531,7 @@ void memoryUpdateMapMBC3()
   }
 }
 
-mapperMBC5 gbDataMBC5 = {
+CORE_LOCAL mapperMBC5 gbDataMBC5 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -671,7 +671,7 @@ void memoryUpdateMapMBC5()
   }
 }
 
-mapperMBC7 gbDataMBC7 = {
+CORE_LOCAL mapperMBC7 gbDataMBC7 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -935,7 +935,7 @@ void memoryUpdateMapMBC7()
   gbMemoryMap[0x07] = &gbRom[tmpAddress + 0x3000];
 }
 
-mapperHuC1 gbDataHuC1 = {
+CORE_LOCAL mapperHuC1 gbDataHuC1 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -1029,7 +1029,7 @@ void memoryUpdateMapHuC1()
   }
 }
 
-mapperHuC3 gbDataHuC3 = {
+CORE_LOCAL mapperHuC3 gbDataHuC3 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -1177,7 +1177,7 @@ void memoryUpdateMapHuC3()
 
 // TAMA5 (for Tamagotchi 3 (gb)).
 // Very basic (and ugly :p) support, only rom bank switching is actually working...
-mapperTAMA5 gbDataTAMA5 = {
+CORE_LOCAL mapperTAMA5 gbDataTAMA5 = {
   1, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -1314,6 +1314,7 @@ void mapperTAMA5RAM(u16 address, u8 value)
           gbMemoryMap[0x05] = &gbRom[tmpAddress + 0x1000];
           gbMemoryMap[0x06] = &gbRom[tmpAddress + 0x2000];
           gbMemoryMap[0x07] = &gbRom[tmpAddress + 0x3000];
+          gbUpdateMemoryPages();
 
           gbDataTAMA5.mapperCommands[0x0f] = 0;
         }
@@ -1530,7 +1531,7 @@ void memoryUpdateMapTAMA5()
 }
 
 // MMM01 Used in Momotarou collection (however the rom is corrupted)
-mapperMMM01 gbDataMMM01 ={
+CORE_LOCAL mapperMMM01 gbDataMMM01 ={
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -1670,7 +1671,7 @@ void mapperGGROM(u16 address, u8 value)
 
 
 // GS3 Used to emulate the GS V3.0 rom bank switching
-mapperGS3 gbDataGS3 = { 1 }; // ROM bank
+CORE_LOCAL mapperGS3 gbDataGS3 = { 1 }; // ROM bank
 
 void mapperGS3ROM(u16 address, u8 value)
 {
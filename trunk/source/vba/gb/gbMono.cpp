@@ -8,19 +8,21 @@
 #include "gb.h"
 #include "gbCheats.h"
 #include "gbGlobals.h"
+#ifndef HOST_BUILD
 #include "../../vbagx.h"
 #include "../../menu.h"
+#endif
 
 //#define CARLLOG
 
-bool ColorizeGameboy = true;
+CORE_LOCAL bool ColorizeGameboy = true;
 
 // The 14-colour palette for a monochrome gameboy game
 // bg black, bg dark, bg light, bg white, window black, window dark, window light, window white,
 // obj0 dark, obj0 light, obj0 white, obj1 dark, obj1 light, obj1 white
 // Only the user sets these colours from emulator menu, and it is only read
 // by the palette setting functions.
-u16 systemMonoPalette[14];
+CORE_LOCAL u16 systemMonoPalette[14];
 
 // quickly map the 12 possible indices to 15-bit colours
 // bg index 0..3, obj0 index 0..3, obj1 index 0..3
@@ -28,7 +30,7 @@ u16 systemMonoPalette[14];
 // drawing functions.
 //u16 gbPalette[12];
 
-static bool HadBgPal = false, HadObj0Pal = false, HadObj1Pal = false;
+static CORE_LOCAL bool HadBgPal = false, HadObj0Pal = false, HadObj1Pal = false;
 
 
 const float BL[4] = {0.1f, 0.4f, 0.7f, 1.0f};
@@ -87,13 +89,13 @@ u16 changeColourBrightness(u16 rgb, float factor) {
 	return r | (g << 5) | (b << 10);
 }
 
-u8 oldBgp = 0xFC;
+CORE_LOCAL u8 oldBgp = 0xFC;
 
 // Sets the brightnesses of both the background and window palettes
 void gbSetBGPalette(u8 value, bool ColoursChanged=false) {
-  static u8 DarkestToBrightestIndex[4] = {3, 2, 1, 0};
-  static u8 Darkness[4] = {0, 1, 2, 3};
-  static float BrightnessForBrightest=1, BrightnessForDarkest=0.1; // brightness of palette when indexes are right
+  static CORE_LOCAL u8 DarkestToBrightestIndex[4] = {3, 2, 1, 0};
+  static CORE_LOCAL u8 Darkness[4] = {0, 1, 2, 3};
+  static CORE_LOCAL float BrightnessForBrightest=1, BrightnessForDarkest=0.1; // brightness of palette when indexes are right
   
   // darkness of each index (0 = white, 3 = black)
   gbBgp[0] = value & 0x03;
@@ -217,12 +219,12 @@ void gbSetBGPalette(u8 value, bool ColoursChanged=false) {
   }
 }
 
-u8 oldObp0 = 0xFF;
+CORE_LOCAL u8 oldObp0 = 0xFF;
 
 void gbSetObj0Palette(u8 value, bool ColoursChanged = false) {
-  static u8 DarkestToBrightestIndex[3] = {3, 2, 1};
-  static u8 Darkness[3] = {1, 2, 3};
-  static float BrightnessForBrightest, BrightnessForDarkest; // brightness of palette when indexes are right
+  static CORE_LOCAL u8 DarkestToBrightestIndex[3] = {3, 2, 1};
+  static CORE_LOCAL u8 Darkness[3] = {1, 2, 3};
+  static CORE_LOCAL float BrightnessForBrightest, BrightnessForDarkest; // brightness of palette when indexes are right
   
   // darkness of each index (0 = white, 3 = black)
   gbObp0[0] = value & 0x03;
@@ -330,12 +332,12 @@ void gbSetObj0Palette(u8 value, bool ColoursChanged = false) {
   gbPalette[8] = 0; // always transparent
 }
 
-u8 oldObp1 = 0xFF;
+CORE_LOCAL u8 oldObp1 = 0xFF;
 
 void gbSetObj1Palette(u8 value, bool ColoursChanged = false) {
-  static u8 DarkestToBrightestIndex[3] = {3, 2, 1};
-  static u8 Darkness[3] = {1, 2, 3};
-  static float BrightnessForBrightest, BrightnessForDarkest; // brightness of palette when indexes are right
+  static CORE_LOCAL u8 DarkestToBrightestIndex[3] = {3, 2, 1};
+  static CORE_LOCAL u8 Darkness[3] = {1, 2, 3};
+  static CORE_LOCAL float BrightnessForBrightest, BrightnessForDarkest; // brightness of palette when indexes are right
   
   // darkness of each index (0 = white, 3 = black)
   gbObp1[0] = value & 0x03;
@@ -443,6 +445,10 @@ void gbSetObj1Palette(u8 value, bool ColoursChanged = false) {
 }
 
 bool StartColorizing() {
+#ifdef HOST_BUILD
+  // there are no frontend settings on the host, keep the stock palette
+  return false;
+#else
   if ((!GCSettings.colorize) || gbSgbMode || gbCgbMode) return false;
   if (ColorizeGameboy) return true;
   ColorizeGameboy = true;
@@ -450,6 +456,7 @@ bool StartColorizing() {
   gbSetObj0Palette(oldObp0);
   gbSetObj1Palette(oldObp1);
   return true;
+#endif
 }
 
 void StopColorizing() {
@@ -464,7 +471,7 @@ u16 Make15Bit(u32 rgb) {
 	return ((rgb >> 19) & 0x1F) | (((rgb >> 11) & 0x1F) << 5) | (((rgb >> 3) & 0x1F) << 10);
 }
 
-u32 OldObpBright[2]={0}, OldObpMedium[2]={0}, OldObpDark[2]={0};
+CORE_LOCAL u32 OldObpBright[2]={0}, OldObpMedium[2]={0}, OldObpDark[2]={0};
 
 void gbSetSpritePal(u8 WhichPal, u32 bright, u32 medium, u32 dark) {
   if (!StartColorizing()) return;
@@ -506,7 +513,7 @@ void gbSetSpritePal(u8 WhichPal, u32 bright) {
 	gbSetSpritePal(WhichPal, bright, medium, dark);
 }
 
-u32 OldBgBright=0, OldBgMedium=0, OldBgDark=0, OldBgBlack=0;
+CORE_LOCAL u32 OldBgBright=0, OldBgMedium=0, OldBgDark=0, OldBgBlack=0;
 
 void gbSetBgPal(u8 WhichPal, u32 bright, u32 medium, u32 dark, u32 black=0x000000) {
   if (!StartColorizing()) return;
@@ -7,36 +7,36 @@
 #include "gb.h"
 #include "gbGlobals.h"
 
-extern u8 *pix;
-extern bool speedup;
-extern bool gbSgbResetFlag;
+extern CORE_LOCAL u8 *pix;
+extern CORE_LOCAL bool speedup;
+extern CORE_LOCAL bool gbSgbResetFlag;
 
 #define GBSGB_NONE            0
 #define GBSGB_RESET           1
 #define GBSGB_PACKET_TRANSMIT 2
 
-u8 *gbSgbBorderChar = NULL;
-u8 *gbSgbBorder = NULL;
-
-int gbSgbCGBSupport        = 0;
-int gbSgbMask              = 0;
-int gbSgbMode              = 0;
-int gbSgbPacketState       = GBSGB_NONE;
-int gbSgbBit               = 0;
-int gbSgbPacketTimeout     = 0;
-int GBSGB_PACKET_TIMEOUT   = 66666;
-u8  gbSgbPacket[16*7];
-int gbSgbPacketNBits       = 0;
-int gbSgbPacketByte        = 0;
-int gbSgbPacketNumber      = 0;
-int gbSgbMultiplayer       = 0;
-int gbSgbFourPlayers       = 0;
-u8  gbSgbNextController    = 0x0f;
-u8  gbSgbReadingController = 0;
-u16 gbSgbSCPPalette[4*512];
-u8  gbSgbATF[20 * 18];
-u8  gbSgbATFList[45 * 20 * 18];
-u8  gbSgbScreenBuffer[4160];
+CORE_LOCAL u8 *gbSgbBorderChar = NULL;
+CORE_LOCAL u8 *gbSgbBorder = NULL;
+
+CORE_LOCAL int gbSgbCGBSupport        = 0;
+CORE_LOCAL int gbSgbMask              = 0;
+CORE_LOCAL int gbSgbMode              = 0;
+CORE_LOCAL int gbSgbPacketState       = GBSGB_NONE;
+CORE_LOCAL int gbSgbBit               = 0;
+CORE_LOCAL int gbSgbPacketTimeout     = 0;
+CORE_LOCAL int GBSGB_PACKET_TIMEOUT   = 66666;
+CORE_LOCAL u8  gbSgbPacket[16*7];
+CORE_LOCAL int gbSgbPacketNBits       = 0;
+CORE_LOCAL int gbSgbPacketByte        = 0;
+CORE_LOCAL int gbSgbPacketNumber      = 0;
+CORE_LOCAL int gbSgbMultiplayer       = 0;
+CORE_LOCAL int gbSgbFourPlayers       = 0;
+CORE_LOCAL u8  gbSgbNextController    = 0x0f;
+CORE_LOCAL u8  gbSgbReadingController = 0;
+CORE_LOCAL u16 gbSgbSCPPalette[4*512];
+CORE_LOCAL u8  gbSgbATF[20 * 18];
+CORE_LOCAL u8  gbSgbATFList[45 * 20 * 18];
+CORE_LOCAL u8  gbSgbScreenBuffer[4160];
 
 inline void gbSgbDraw24Bit(u8 *p, u16 v)
 {
@@ -844,7 +844,7 @@ void gbSgbDoBitTransfer(u8 value)
   }
 }
 
-variable_desc gbSgbSaveStruct[] = {
+CORE_LOCAL_INIT variable_desc gbSgbSaveStruct[] = {
   { &gbSgbMask, sizeof(int) },
   { &gbSgbPacketState, sizeof(int) },
   { &gbSgbBit, sizeof(int) },
@@ -857,7 +857,7 @@ variable_desc gbSgbSaveStruct[] = {
   { NULL, 0 }
 };
 
-variable_desc gbSgbSaveStructV3[] = {
+CORE_LOCAL_INIT variable_desc gbSgbSaveStructV3[] = {
   { &gbSgbMask, sizeof(int) },
   { &gbSgbPacketState, sizeof(int) },
   { &gbSgbBit, sizeof(int) },
@@ -8,25 +8,28 @@
 #include "../apu/Gb_Apu.h"
 #include "../apu/Effects_Buffer.h"
 
-extern int gbHardware;
-extern long soundSampleRate; // current sound quality
+extern CORE_LOCAL int gbHardware;
+extern CORE_LOCAL long soundSampleRate; // current sound quality
 
-gb_effects_config_t gb_effects_config = { false, 0.20f, 0.15f, false };
+CORE_LOCAL gb_effects_config_t gb_effects_config = { false, 0.20f, 0.15f, false };
 
-static gb_effects_config_t    gb_effects_config_current;
-static Simple_Effects_Buffer* stereo_buffer;
-static Gb_Apu*                gb_apu;
+static CORE_LOCAL gb_effects_config_t    gb_effects_config_current;
+static CORE_LOCAL Simple_Effects_Buffer* stereo_buffer;
+static CORE_LOCAL Gb_Apu*                gb_apu;
 
-static float soundVolume_  = -1;
-static int prevSoundEnable = -1;
-static bool declicking     = false;
+static CORE_LOCAL float soundVolume_  = -1;
+static CORE_LOCAL int prevSoundEnable = -1;
+static CORE_LOCAL bool declicking     = false;
 
 int const chan_count = 4;
 int const ticks_to_time = 2 * GB_APU_OVERCLOCK;
 
+static CORE_LOCAL blip_time_t frame_start; // time into the tick where the blip frame began
+static CORE_LOCAL blip_time_t held_frame_start;
+
 static inline blip_time_t blip_time()
 {
-	return (SOUND_CLOCK_TICKS - soundTicks) * ticks_to_time;
+	return (SOUND_CLOCK_TICKS - soundTicks) * ticks_to_time - frame_start;
 }
 
 u8 gbSoundRead( u16 address )
@@ -89,7 +92,8 @@ void gbSoundTick()
  	if ( gb_apu && stereo_buffer )
 	{
 		// Run sound hardware to present
-		end_frame( SOUND_CLOCK_TICKS * ticks_to_time );
+		end_frame( SOUND_CLOCK_TICKS * ticks_to_time - frame_start );
+		frame_start = 0;
 
 		flush_samples(stereo_buffer);
 
@@ -116,9 +120,29 @@ static void reset_apu()
 	if ( stereo_buffer )
 		stereo_buffer->clear();
 
+	frame_start = 0;
 	soundTicks = SOUND_CLOCK_TICKS;
 }
 
+void gbSoundHoldOutput()
+{
+	if ( !gb_apu || !stereo_buffer )
+		return;
+
+	blip_time_t time = blip_time();
+	end_frame( time );
+	frame_start += time;
+	held_frame_start = frame_start;
+
+	hold_samples( stereo_buffer );
+}
+
+void gbSoundReleaseOutput()
+{
+	if ( release_samples() )
+		frame_start = held_frame_start;
+}
+
 static void remake_stereo_buffer()
 {
 	// Stereo_Buffer
@@ -235,12 +259,12 @@ void gbSoundSetSampleRate( long sampleRate )
 	}
 }
 
-static struct {
+static CORE_LOCAL struct {
 	int version;
 	gb_apu_state_t apu;
 } state;
 
-static char dummy_state [735 * 2];
+static CORE_LOCAL char dummy_state [735 * 2];
 
 #define SKIP( type, name ) { dummy_state, sizeof (type) }
 
@@ -248,7 +272,7 @@ static char dummy_state [735 * 2];
 
 // Old save state support
 
-static variable_desc gbsound_format [] =
+static CORE_LOCAL_INIT variable_desc gbsound_format [] =
 {
 	SKIP( int, soundPaused ),
 	SKIP( int, soundPlay ),
@@ -308,7 +332,7 @@ static variable_desc gbsound_format [] =
 	{ NULL, 0 }
 };
 
-static variable_desc gbsound_format2 [] =
+static CORE_LOCAL_INIT variable_desc gbsound_format2 [] =
 {
 	SKIP( int, sound1ATLreload ),
 	SKIP( int, freq1low ),
@@ -324,7 +348,7 @@ static variable_desc gbsound_format2 [] =
 	{ NULL, 0 }
 };
 
-static variable_desc gbsound_format3 [] =
+static CORE_LOCAL_INIT variable_desc gbsound_format3 [] =
 {
 	SKIP( u8[2*735], soundBuffer ),
 	SKIP( u8[2*735], soundBuffer ),
@@ -382,7 +406,7 @@ static void gbSoundReadGameOld(int version,gzFile gzFile)
 
 // New state format
 
-static variable_desc gb_state [] =
+static CORE_LOCAL_INIT variable_desc gb_state [] =
 {
 	LOAD( int, state.version ),				// room_for_expansion will be used by later versions
 
@@ -26,7 +26,7 @@ struct gb_effects_config_t
 
 // Changes effects configuration
 void gbSoundConfigEffects( gb_effects_config_t const& );
-extern gb_effects_config_t gb_effects_config; // current configuration
+extern CORE_LOCAL gb_effects_config_t gb_effects_config; // current configuration
 
 
 //// GB sound emulation
@@ -66,11 +66,15 @@ u8 gbSoundRead( u16 address );
 
 // Notifies emulator that SOUND_CLOCK_TICKS clocks have passed
 void gbSoundTick();
-extern int SOUND_CLOCK_TICKS;   // Number of 16.8 MHz clocks between calls to gbSoundTick()
-extern int soundTicks;          // Number of 16.8 MHz clocks until gbSoundTick() will be called
+extern CORE_LOCAL int SOUND_CLOCK_TICKS;   // Number of 16.8 MHz clocks between calls to gbSoundTick()
+extern CORE_LOCAL int soundTicks;          // Number of 16.8 MHz clocks until gbSoundTick() will be called
 
 // Saves/loads emulator state
 void gbSoundSaveGame( gzFile out );
 void gbSoundReadGame( int version, gzFile in );
 
+// soundHoldOutput() and soundReleaseOutput() for GB sound
+void gbSoundHoldOutput();
+void gbSoundReleaseOutput();
+
 #endif // GBSOUND_H
@@ -3,9 +3,9 @@
 
 #include "CheatSearch.h"
 
-CheatSearchBlock cheatSearchBlocks[4];
+CORE_LOCAL CheatSearchBlock cheatSearchBlocks[4];
 
-CheatSearchData cheatSearchData = {
+CORE_LOCAL_INIT CheatSearchData cheatSearchData = {
   0,
   cheatSearchBlocks
 };
@@ -40,7 +40,7 @@ enum {
 #define IS_BIT_SET(bits, off) \
   (bits)[(off) >> 3] & (1 << ((off) & 7))
 
-extern CheatSearchData cheatSearchData;
+extern CORE_LOCAL_INIT CheatSearchData cheatSearchData;
 
 void cheatSearchCleanup(CheatSearchData *cs);
 void cheatSearchStart(const CheatSearchData *cs);
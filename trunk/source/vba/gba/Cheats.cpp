@@ -178,28 +178,28 @@
 #define CHEATS_16_BIT_WRITE           114
 #define CHEATS_32_BIT_WRITE           115
 
-CheatsData cheatsList[100];
-int cheatsNumber = 0;
-u32 rompatch2addr [4];
-u16 rompatch2val [4];
-u16 rompatch2oldval [4];
-
-u8 cheatsCBASeedBuffer[0x30];
-u32 cheatsCBASeed[4];
-u32 cheatsCBATemporaryValue = 0;
-u16 cheatsCBATable[256];
-bool cheatsCBATableGenerated = false;
-u16 super = 0;
-extern u32 mastercode;
-
-u8 cheatsCBACurrentSeed[12] = {
+CORE_LOCAL CheatsData cheatsList[100];
+CORE_LOCAL int cheatsNumber = 0;
+CORE_LOCAL u32 rompatch2addr [4];
+CORE_LOCAL u16 rompatch2val [4];
+CORE_LOCAL u16 rompatch2oldval [4];
+
+CORE_LOCAL u8 cheatsCBASeedBuffer[0x30];
+CORE_LOCAL u32 cheatsCBASeed[4];
+CORE_LOCAL u32 cheatsCBATemporaryValue = 0;
+CORE_LOCAL u16 cheatsCBATable[256];
+CORE_LOCAL bool cheatsCBATableGenerated = false;
+CORE_LOCAL u16 super = 0;
+extern CORE_LOCAL u32 mastercode;
+
+CORE_LOCAL u8 cheatsCBACurrentSeed[12] = {
   0x00, 0x00, 0x00, 0x00,
   0x00, 0x00, 0x00, 0x00,
   0x00, 0x00, 0x00, 0x00
 };
 
-u32 seeds_v1[4];
-u32 seeds_v3[4];
+CORE_LOCAL u32 seeds_v1[4];
+CORE_LOCAL u32 seeds_v3[4];
 
 u32 seed_gen(u8 upper, u8 seed, u8 *deadtable1, u8 *deadtable2);
 
@@ -2818,7 +2818,7 @@ bool cheatsLoadCheatList(const char *file)
   return true;
 }
 
-extern int cpuNextEvent;
+extern CORE_LOCAL int cpuNextEvent;
 
 extern void debuggerBreakOnWrite(u32 , u32, u32, int, int);
 
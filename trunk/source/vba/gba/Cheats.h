@@ -33,7 +33,7 @@ void cheatsWriteHalfWord(u32 address, u16 value);
 void cheatsWriteByte(u32 address, u8 value);
 int cheatsCheckKeys(u32 keys, u32 extended);
 
-extern int cheatsNumber;
-extern CheatsData cheatsList[100];
+extern CORE_LOCAL int cheatsNumber;
+extern CORE_LOCAL CheatsData cheatsList[100];
 
 #endif // CHEATS_H
@@ -3,18 +3,18 @@
 #include "EEprom.h"
 #include "../Util.h"
 
-extern int cpuDmaCount;
+extern CORE_LOCAL int cpuDmaCount;
 
-int eepromMode = EEPROM_IDLE;
-int eepromByte = 0;
-int eepromBits = 0;
-int eepromAddress = 0;
-u8 eepromData[0x2000];
-u8 eepromBuffer[16];
-bool eepromInUse = false;
-int eepromSize = 512;
+CORE_LOCAL int eepromMode = EEPROM_IDLE;
+CORE_LOCAL int eepromByte = 0;
+CORE_LOCAL int eepromBits = 0;
+CORE_LOCAL int eepromAddress = 0;
+CORE_LOCAL u8 eepromData[0x2000];
+CORE_LOCAL u8 eepromBuffer[16];
+CORE_LOCAL bool eepromInUse = false;
+CORE_LOCAL int eepromSize = 512;
 
-variable_desc eepromSaveData[] = {
+CORE_LOCAL_INIT variable_desc eepromSaveData[] = {
   { &eepromMode, sizeof(int) },
   { &eepromByte, sizeof(int) },
   { &eepromBits , sizeof(int) },
@@ -17,22 +17,22 @@
 #define FLASH_PROGRAM            8
 #define FLASH_SETBANK            9
 
-u8 flashSaveMemory[0x20000];
-int flashState = FLASH_READ_ARRAY;
-int flashReadState = FLASH_READ_ARRAY;
-int flashSize = 0x10000;
-int flashDeviceID = 0x1b;
-int flashManufacturerID = 0x32;
-int flashBank = 0;
+CORE_LOCAL u8 flashSaveMemory[0x20000];
+CORE_LOCAL int flashState = FLASH_READ_ARRAY;
+CORE_LOCAL int flashReadState = FLASH_READ_ARRAY;
+CORE_LOCAL int flashSize = 0x10000;
+CORE_LOCAL int flashDeviceID = 0x1b;
+CORE_LOCAL int flashManufacturerID = 0x32;
+CORE_LOCAL int flashBank = 0;
 
-static variable_desc flashSaveData[] = {
+static CORE_LOCAL_INIT variable_desc flashSaveData[] = {
   { &flashState, sizeof(int) },
   { &flashReadState, sizeof(int) },
   { &flashSaveMemory[0], 0x10000 },
   { NULL, 0 }
 };
 
-static variable_desc flashSaveData2[] = {
+static CORE_LOCAL_INIT variable_desc flashSaveData2[] = {
   { &flashState, sizeof(int) },
   { &flashReadState, sizeof(int) },
   { &flashSize, sizeof(int) },
@@ -40,7 +40,7 @@ static variable_desc flashSaveData2[] = {
   { NULL, 0 }
 };
 
-static variable_desc flashSaveData3[] = {
+static CORE_LOCAL_INIT variable_desc flashSaveData3[] = {
   { &flashState, sizeof(int) },
   { &flashReadState, sizeof(int) },
   { &flashSize, sizeof(int) },
@@ -7,12 +7,12 @@ extern void flashReadGameSkip(gzFile _gzFile, int version);
 extern u8 flashRead(u32 address);
 extern void flashWrite(u32 address, u8 byte);
 extern void flashDelayedWrite(u32 address, u8 byte);
-extern u8 flashSaveMemory[0x20000];
+extern CORE_LOCAL u8 flashSaveMemory[0x20000];
 extern void flashSaveDecide(u32 address, u8 byte);
 extern void flashReset();
 extern void flashSetSize(int size);
 extern void flashInit();
 
-extern int flashSize;
+extern CORE_LOCAL int flashSize;
 
 #endif // FLASH_H
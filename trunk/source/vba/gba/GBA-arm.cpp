@@ -16,6 +16,7 @@
 #include "../NLS.h"
 #include "elf.h"
 #include "../Util.h"
+#include "../common/Bench.h"
 #include "../System.h"
 #include "agbprint.h"
 #ifdef PROFILING
@@ -32,7 +33,7 @@
 
 ///////////////////////////////////////////////////////////////////////////
 
-static int clockTicks;
+static CORE_LOCAL int clockTicks;
 
 static INSN_REGPARM void armUnknownInsn(u32 opcode)
 {
@@ -2594,6 +2595,7 @@ static INSN_REGPARM void armA00(u32 opcode)
     clockTicks += 2 + codeTicksAccess32(armNextPC)
                     + codeTicksAccessSeq32(armNextPC);
     busPrefetchCount = 0;
+    CPU_IDLE_LOOP(offset << 2, armNextPC - (offset << 2) - 8);
 }
 
 // BL <offset>
@@ -2845,12 +2847,122 @@ static void tester(void) {
 }
 #endif
 
+// Work RAM fast path ///////////////////////////////////////////////////
+
+static inline insnfunc_t armDecode(u32 opcode)
+{
+    return armInsnTable[((opcode>>16)&0xFF0) | ((opcode>>4)&0x0F)];
+}
+
+static inline bool armCondition(int cond)
+{
+    switch(cond) {
+      case 0x00: // EQ
+        return Z_FLAG;
+      case 0x01: // NE
+        return !Z_FLAG;
+      case 0x02: // CS
+        return C_FLAG;
+      case 0x03: // CC
+        return !C_FLAG;
+      case 0x04: // MI
+        return N_FLAG;
+      case 0x05: // PL
+        return !N_FLAG;
+      case 0x06: // VS
+        return V_FLAG;
+      case 0x07: // VC
+        return !V_FLAG;
+      case 0x08: // HI
+        return C_FLAG && !Z_FLAG;
+      case 0x09: // LS
+        return !C_FLAG || Z_FLAG;
+      case 0x0A: // GE
+        return N_FLAG == V_FLAG;
+      case 0x0B: // LT
+        return N_FLAG != V_FLAG;
+      case 0x0C: // GT
+        return !Z_FLAG &&(N_FLAG == V_FLAG);
+      case 0x0D: // LE
+        return Z_FLAG || (N_FLAG != V_FLAG);
+      case 0x0E: // AL
+        return true;
+      case 0x0F:
+      default:
+        // ???
+        return false;
+    }
+}
+
+// Runs instructions from EWRAM/IWRAM until the PC leaves the region, where
+// games usually copy their hot loops. None of the ROM prefetch bookkeeping
+// applies here, and the sequential fetch time is the same for every
+// instruction.
+// Returns false when the time slice ended, true to continue in armExecute.
+static inline bool armExecuteRAM(int &result)
+{
+    u32 region = armNextPC >> 24;
+
+    do {
+        u32 opcode = cpuPrefetch[0];
+        cpuPrefetch[0] = cpuPrefetch[1];
+
+        busPrefetch = false;
+        if (busPrefetchCount & 0xFFFFFE00)
+            busPrefetchCount = 0x100 | (busPrefetchCount & 0xFF);
+
+        clockTicks = 0;
+
+#ifndef FINAL_VERSION
+        if (armNextPC == stop) {
+            armNextPC++;
+        }
+#endif
+
+        armNextPC = reg[15].I;
+        reg[15].I += 4;
+        ARM_PREFETCH_NEXT;
+
+        int cond = opcode >> 28;
+        bool cond_res = true;
+        if (UNLIKELY(cond != 0x0E))  // most opcodes are AL (always)
+            cond_res = armCondition(cond);
+
+        if (cond_res)
+            (*armDecode(opcode))(opcode);
+        BENCH_INSN();
+#ifdef INSN_COUNTER
+        count(opcode, cond_res);
+#endif
+        if (clockTicks < 0) {
+            result = 0;
+            return false;
+        }
+        if (clockTicks == 0)
+            clockTicks = 1 + memoryWaitSeq32[region];
+        cpuTotalTicks += clockTicks;
+
+        if (!(cpuTotalTicks<cpuNextEvent && armState && !holdState && !eventPending(EVENT_SWI))) {
+            result = 1;
+            return false;
+        }
+    } while ((armNextPC >> 24) == region);
+
+    return true;
+}
+
 int armExecute()
 {
     do {
-		if( cheatsEnabled ) {
+		if( cheatsEnabled && mastercode ) {
 			cpuMasterCodeCheck();
 		}
+        else if ((armNextPC >> 24) == 0x02 || (armNextPC >> 24) == 0x03) {
+            int result;
+            if (!armExecuteRAM(result))
+                return result;
+            continue;
+        }
 
         if ((armNextPC & 0x0803FFFF) == 0x08020000)
           busPrefetchCount = 0x100;
@@ -2877,63 +2989,12 @@ int armExecute()
 
         int cond = opcode >> 28;
         bool cond_res = true;
-        if (UNLIKELY(cond != 0x0E)) {  // most opcodes are AL (always)
-            switch(cond) {
-              case 0x00: // EQ
-                cond_res = Z_FLAG;
-                break;
-              case 0x01: // NE
-                cond_res = !Z_FLAG;
-                break;
-              case 0x02: // CS
-                cond_res = C_FLAG;
-                break;
-              case 0x03: // CC
-                cond_res = !C_FLAG;
-                break;
-              case 0x04: // MI
-                cond_res = N_FLAG;
-                break;
-              case 0x05: // PL
-                cond_res = !N_FLAG;
-                break;
-              case 0x06: // VS
-                cond_res = V_FLAG;
-                break;
-              case 0x07: // VC
-                cond_res = !V_FLAG;
-                break;
-              case 0x08: // HI
-                cond_res = C_FLAG && !Z_FLAG;
-                break;
-              case 0x09: // LS
-                cond_res = !C_FLAG || Z_FLAG;
-                break;
-              case 0x0A: // GE
-                cond_res = N_FLAG == V_FLAG;
-                break;
-              case 0x0B: // LT
-                cond_res = N_FLAG != V_FLAG;
-                break;
-              case 0x0C: // GT
-                cond_res = !Z_FLAG &&(N_FLAG == V_FLAG);
-                break;
-              case 0x0D: // LE
-                cond_res = Z_FLAG || (N_FLAG != V_FLAG);
-                break;
-              case 0x0E: // AL (impossible, checked above)
-                cond_res = true;
-                break;
-              case 0x0F:
-              default:
-                // ???
-                cond_res = false;
-                break;
-            }
-        }
+        if (UNLIKELY(cond != 0x0E))  // most opcodes are AL (always)
+            cond_res = armCondition(cond);
 
         if (cond_res)
-            (*armInsnTable[((opcode>>16)&0xFF0) | ((opcode>>4)&0x0F)])(opcode);
+            (*armDecode(opcode))(opcode);
+        BENCH_INSN();
 #ifdef INSN_COUNTER
         count(opcode, cond_res);
 #endif
@@ -2943,7 +3004,7 @@ int armExecute()
             clockTicks = 1 + codeTicksAccessSeq32(oldArmNextPC);
         cpuTotalTicks += clockTicks;
 
-    } while (cpuTotalTicks<cpuNextEvent && armState && !holdState && !SWITicks);
+    } while (cpuTotalTicks<cpuNextEvent && armState && !holdState && !eventPending(EVENT_SWI));
 
     return 1;
 }
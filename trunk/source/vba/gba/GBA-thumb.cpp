@@ -16,11 +16,15 @@
 #include "../NLS.h"
 #include "elf.h"
 #include "../Util.h"
+#include "../common/Bench.h"
 #include "../System.h"
 #include "agbprint.h"
 #ifdef PROFILING
 #include "prof/prof.h"
 #endif
+#ifdef THUMB_JIT
+#include <sys/mman.h>
+#endif
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
@@ -28,7 +32,7 @@
 
 ///////////////////////////////////////////////////////////////////////////
 
-static int clockTicks;
+static CORE_LOCAL int clockTicks;
 
 static INSN_REGPARM void thumbUnknownInsn(u32 opcode)
 {
@@ -1871,6 +1875,11 @@ static INSN_REGPARM void thumbC8(u32 opcode)
 
 // Conditional branches ///////////////////////////////////////////////////
 
+// armNextPC is the branch target here, the branch itself is 4 bytes before
+// the target minus the offset
+#define THUMB_IDLE_LOOP(offset) \
+  CPU_IDLE_LOOP((offset), armNextPC - (offset) - 4)
+
 // BEQ offset
 static INSN_REGPARM void thumbD0(u32 opcode)
 {
@@ -1883,6 +1892,7 @@ static INSN_REGPARM void thumbD0(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -1898,6 +1908,7 @@ static INSN_REGPARM void thumbD1(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -1913,6 +1924,7 @@ static INSN_REGPARM void thumbD2(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -1928,6 +1940,7 @@ static INSN_REGPARM void thumbD3(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -1943,6 +1956,7 @@ static INSN_REGPARM void thumbD4(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -1958,6 +1972,7 @@ static INSN_REGPARM void thumbD5(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -1973,6 +1988,7 @@ static INSN_REGPARM void thumbD6(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -1988,6 +2004,7 @@ static INSN_REGPARM void thumbD7(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -2003,6 +2020,7 @@ static INSN_REGPARM void thumbD8(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -2018,6 +2036,7 @@ static INSN_REGPARM void thumbD9(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -2033,6 +2052,7 @@ static INSN_REGPARM void thumbDA(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -2048,6 +2068,7 @@ static INSN_REGPARM void thumbDB(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -2063,6 +2084,7 @@ static INSN_REGPARM void thumbDC(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -2078,6 +2100,7 @@ static INSN_REGPARM void thumbDD(u32 opcode)
     clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
         codeTicksAccess16(armNextPC)+3;
     busPrefetchCount=0;
+    THUMB_IDLE_LOOP(((s8)(opcode & 0xFF)) << 1);
   }
 }
 
@@ -2106,6 +2129,7 @@ static INSN_REGPARM void thumbE0(u32 opcode)
   clockTicks = codeTicksAccessSeq16(armNextPC) + codeTicksAccessSeq16(armNextPC) +
       codeTicksAccess16(armNextPC) + 3;
   busPrefetchCount=0;
+  THUMB_IDLE_LOOP(offset);
 }
 
 // BLL #offset (forward)
@@ -2281,13 +2305,9 @@ static insnfunc_t thumbInsnTable[1024] = {
 
 // Wrapper routine (execution loop) ///////////////////////////////////////
 
-int thumbExecute()
+// Executes one instruction, false when the loop has to stop (breakpoint)
+static inline bool thumbStep()
 {
-  do {
-	  if( cheatsEnabled ) {
-		  cpuMasterCodeCheck();
-	  }
-
     //if ((armNextPC & 0x0803FFFF) == 0x08020000)
     //    busPrefetchCount=0x100;
 
@@ -2310,13 +2330,885 @@ int thumbExecute()
     THUMB_PREFETCH_NEXT;
 
     (*thumbInsnTable[opcode>>6])(opcode);
+    BENCH_INSN();
 
     if (clockTicks < 0)
-      return 0;
+      return false;
     if (clockTicks==0)
       clockTicks = codeTicksAccessSeq16(oldArmNextPC) + 1;
     cpuTotalTicks += clockTicks;
+    return true;
+}
+
+static int thumbInterpret()
+{
+  do {
+	  if( cheatsEnabled ) {
+		  cpuMasterCodeCheck();
+	  }
+
+    if (!thumbStep())
+      return 0;
 
-  } while (cpuTotalTicks < cpuNextEvent && !armState && !holdState && !SWITicks);
+  } while (cpuTotalTicks < cpuNextEvent && !armState && !holdState && !eventPending(EVENT_SWI));
   return 1;
 }
+
+#ifdef THUMB_JIT
+
+// Thumb recompiler (x86-64 hosts) ////////////////////////////////////////
+//
+// Straight-line runs of Thumb code from ROM and work RAM are translated to
+// x86-64. Register-only ALU instructions are emitted natively, everything
+// else is a direct call to the interpreter handler, and the pipeline,
+// prefetch and cycle bookkeeping of thumbExecute() is reproduced around
+// each instruction so timing stays identical to the interpreter.
+//
+// A block remembers the halfwords it was translated from and is checked
+// against memory on every entry, so code rewritten in RAM (or ROM patched
+// by cheats) is simply translated again. RAM blocks also compare each
+// opcode with the prefetch pipeline and leave early when they differ.
+//
+// The code buffer is never writable and executable at once: it is made
+// writable while a block is translated and executable again before the
+// block runs.
+
+#ifndef __x86_64__
+#error "THUMB_JIT needs an x86-64 host"
+#endif
+
+#define JIT_CODE_SIZE  (8 << 20)
+#define JIT_OPS_SIZE   (256 << 10)
+#define JIT_HASH_SIZE  0x10000
+#define JIT_BLOCK_MAX  64
+#define JIT_BLOCK_CODE (JIT_BLOCK_MAX * 256 + 64)  // most code a block makes
+#define JIT_PAGE       4096
+#define JIT_LOG_SIZE   (JIT_BLOCK_MAX * 9 * 2)     // PUSH {R0-R7, LR}, twice
+
+struct ThumbJitBlock {
+  u32 pc;
+  int count;         // instructions in the block
+  bool replay;       // no SWI, the lockstep mode can take it back and replay it
+  const u16 *ops;    // halfwords the block was translated from (count + 2)
+  int (*code)();
+};
+
+int thumbJitMode = THUMB_RECOMPILE;
+u32 thumbJitBlocks = 0;
+u32 thumbJitChecked = 0;
+u32 thumbJitMismatches = 0;
+
+static ThumbJitBlock thumbJitCache[JIT_HASH_SIZE];
+static u8 *thumbJitCode;      // JIT_CODE_SIZE bytes
+static u16 thumbJitOps[JIT_OPS_SIZE];
+static u8 *jitPtr;
+static int jitOpsUsed;
+static bool jitOverflow;
+static bool jitReady = false;
+static int jitCompiledMode;
+static u8 *jitSeqTicks[16];   // per region codeTicksAccessSeq16()+1 into eax
+static u32 jitSteps;          // instructions run by the last block (lockstep)
+
+// lockstep mode, the words the stores changed and what they held before
+bool thumbJitLogging = false;
+static bool jitLogReplay;     // every store logged can be taken back
+static int jitLogged;
+static u32 *jitLogPtr[JIT_LOG_SIZE];
+static u32 jitLogOld[JIT_LOG_SIZE];
+
+enum { EAX = 0, ECX = 1, EDX = 2, EBX = 3, EDI = 7 };
+enum { CC_O = 0, CC_C = 2, CC_NC = 3, CC_Z = 4, CC_NZ = 5, CC_BE = 6,
+       CC_S = 8, CC_L = 0xC, CC_GE = 0xD };
+enum { ALU_ADD = 0, ALU_OR = 1, ALU_ADC = 2, ALU_SBB = 3, ALU_AND = 4,
+       ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7 };
+
+static inline void jitByte(u8 b)
+{
+  *jitPtr++ = b;
+}
+
+static inline void jitWord(u32 v)
+{
+  memcpy(jitPtr, &v, 4);
+  jitPtr += 4;
+}
+
+// ModRM + disp32 for a RIP-relative operand; imm is the size of any
+// immediate that follows the displacement.
+static void jitRip(int r, const void *addr, int imm)
+{
+  jitByte(0x05 | (r << 3));
+  s64 disp = (const u8 *)addr - (jitPtr + 4 + imm);
+  if(disp != (s32)disp)
+    jitOverflow = true;
+  jitWord((u32)disp);
+}
+
+static void jitRel32(const void *target)
+{
+  s64 disp = (const u8 *)target - (jitPtr + 4);
+  if(disp != (s32)disp)
+    jitOverflow = true;
+  jitWord((u32)disp);
+}
+
+// mov r32, [mem]
+static void jitLoad(int r, const void *addr)
+{
+  jitByte(0x8B); jitRip(r, addr, 0);
+}
+
+// mov [mem], r32
+static void jitStore(const void *addr, int r)
+{
+  jitByte(0x89); jitRip(r, addr, 0);
+}
+
+// mov dword [mem], imm32
+static void jitStoreImm(const void *addr, u32 imm)
+{
+  jitByte(0xC7); jitRip(0, addr, 4); jitWord(imm);
+}
+
+// mov byte [mem], imm8
+static void jitStoreByte(const void *addr, u8 imm)
+{
+  jitByte(0xC6); jitRip(0, addr, 1); jitByte(imm);
+}
+
+// <op> eax, dword [mem]
+static void jitAluMem(int op, const void *addr)
+{
+  jitByte((op << 3) | 0x03); jitRip(EAX, addr, 0);
+}
+
+// <op> eax, imm32
+static void jitAluImm(int op, u32 imm)
+{
+  jitByte(0x81); jitByte(0xC0 | (op << 3)); jitWord(imm);
+}
+
+// test eax, dword [mem]
+static void jitTestMem(const void *addr)
+{
+  jitByte(0x85); jitRip(EAX, addr, 0);
+}
+
+// test eax, eax
+static void jitTestEax()
+{
+  jitByte(0x85); jitByte(0xC0);
+}
+
+// setcc byte [mem]
+static void jitSetcc(int cc, const void *addr)
+{
+  jitByte(0x0F); jitByte(0x90 | cc); jitRip(0, addr, 0);
+}
+
+// shl/shr/sar eax, imm8
+static void jitShift(int ext, int n)
+{
+  jitByte(0xC1); jitByte(0xC0 | (ext << 3)); jitByte(n);
+}
+
+// jcc rel32, returns the displacement to patch
+static u8 *jitJcc(int cc)
+{
+  jitByte(0x0F); jitByte(0x80 | cc);
+  u8 *patch = jitPtr;
+  jitWord(0);
+  return patch;
+}
+
+static void jitPatch(u8 *patch, const u8 *target)
+{
+  u32 disp = (u32)(target - (patch + 4));
+  memcpy(patch, &disp, 4);
+}
+
+static void jitCall(const void *func)
+{
+  jitByte(0xE8); jitRel32(func);
+}
+
+static void jitSetFlagsNZ()
+{
+  jitSetcc(CC_S, &N_FLAG);
+  jitSetcc(CC_Z, &Z_FLAG);
+}
+
+static void jitSetFlagsAdd()
+{
+  jitSetFlagsNZ();
+  jitSetcc(CC_C, &C_FLAG);
+  jitSetcc(CC_O, &V_FLAG);
+}
+
+static void jitSetFlagsSub()
+{
+  jitSetFlagsNZ();
+  jitSetcc(CC_NC, &C_FLAG);
+  jitSetcc(CC_O, &V_FLAG);
+}
+
+// Emits the sequential fetch timing of a ROM region as a subroutine, the
+// same computation as codeTicksAccessSeq16(address) + 1. Returns in eax.
+static u8 *jitEmitSeqTicks(int region)
+{
+  u8 *start = jitPtr;
+  jitLoad(EAX, &busPrefetchCount);
+  jitByte(0xA8); jitByte(0x01);                        // test al, 1
+  u8 *notOdd = jitJcc(CC_Z);
+  jitByte(0x89); jitByte(0xC1);                        // mov ecx, eax
+  jitByte(0x81); jitByte(0xE1); jitWord(0xFF);         // and ecx, 0xFF
+  jitByte(0xD1); jitByte(0xE9);                        // shr ecx, 1
+  jitAluImm(ALU_AND, 0xFFFFFF00);
+  jitByte(0x09); jitByte(0xC8);                        // or eax, ecx
+  jitStore(&busPrefetchCount, EAX);
+  jitByte(0xB8); jitWord(1);                           // mov eax, 1
+  jitByte(0xC3);
+  jitPatch(notOdd, jitPtr);
+  jitAluImm(ALU_CMP, 0xFF);
+  u8 *seq = jitJcc(CC_BE);
+  jitStoreImm(&busPrefetchCount, 0);
+  jitByte(0x0F); jitByte(0xB6); jitRip(EAX, &memoryWait[region], 0);
+  jitByte(0xFF); jitByte(0xC0);                        // inc eax
+  jitByte(0xC3);
+  jitPatch(seq, jitPtr);
+  jitByte(0x0F); jitByte(0xB6); jitRip(EAX, &memoryWaitSeq[region], 0);
+  jitByte(0xFF); jitByte(0xC0);                        // inc eax
+  jitByte(0xC3);
+  return start;
+}
+
+static bool jitIsRom(u32 address)
+{
+  u32 region = address >> 24;
+  return region >= 0x08 && region <= 0x0D;
+}
+
+static const u8 *jitHostAddress(u32 address)
+{
+  return &map[address >> 24].address[address & map[address >> 24].mask];
+}
+
+// Makes the pages of the code buffer from start to end writable, or
+// executable again
+static bool jitProtect(u8 *start, u8 *end, bool writable)
+{
+  uintptr_t from = (uintptr_t)start & ~(uintptr_t)(JIT_PAGE - 1);
+  uintptr_t to = ((uintptr_t)end + JIT_PAGE - 1) & ~(uintptr_t)(JIT_PAGE - 1);
+
+  if(mprotect((void *)from, to - from,
+              writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) != 0) {
+    systemMessage(0, N_("Thumb recompiler disabled, cannot protect code buffer"));
+    thumbJitMode = THUMB_INTERPRET;
+    return false;
+  }
+  return true;
+}
+
+void thumbJitReset()
+{
+  memset(thumbJitCache, 0, sizeof(thumbJitCache));
+  jitOpsUsed = 0;
+  jitOverflow = false;
+  jitCompiledMode = thumbJitMode;
+  if(!jitReady)
+    return;
+  jitPtr = thumbJitCode;
+  if(!jitProtect(thumbJitCode, thumbJitCode + JIT_BLOCK_CODE, true))
+    return;
+  for(int region = 0x08; region <= 0x0D; region++)
+    jitSeqTicks[region] = jitEmitSeqTicks(region);
+  jitProtect(thumbJitCode, thumbJitCode + JIT_BLOCK_CODE, false);
+}
+
+// The blocks reach the CPU state with 32 bit displacements, so the buffer
+// is mapped below the emulator image rather than wherever mmap likes.
+static bool thumbJitInit()
+{
+  uintptr_t image = (uintptr_t)&reg & ~(uintptr_t)(JIT_PAGE - 1);
+
+  for(uintptr_t below = 64 << 20; below <= (uintptr_t)1 << 30; below += 64 << 20) {
+    if(image < below)
+      break;
+    void *code = mmap((void *)(image - below), JIT_CODE_SIZE, PROT_READ | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(code == MAP_FAILED)
+      break;
+    s64 distance = (u8 *)code - (u8 *)&reg;
+    if(distance > -((s64)1 << 30) && distance < ((s64)1 << 30)) {
+      thumbJitCode = (u8 *)code;
+      jitReady = true;
+      thumbJitReset();
+      return thumbJitMode != THUMB_INTERPRET;
+    }
+    munmap(code, JIT_CODE_SIZE);
+  }
+
+  systemMessage(0, N_("Thumb recompiler disabled, cannot map code buffer"));
+  thumbJitMode = THUMB_INTERPRET;
+  return false;
+}
+
+// Instructions that may leave the straight-line path end the block
+static bool thumbJitEndsBlock(u32 opcode)
+{
+  insnfunc_t func = thumbInsnTable[opcode >> 6];
+  if(func == thumbUI || func == thumbBP)
+    return true;
+  if((opcode & 0xFF00) == 0x4700)                     // BX
+    return true;
+  if((opcode & 0xFC00) == 0x4400 && (opcode & 0x0300) != 0x0100 &&
+     (opcode & 0x87) == 0x87)                         // ADD/MOV PC, Rs
+    return true;
+  if((opcode & 0xFF00) == 0xBD00)                     // POP {..., PC}
+    return true;
+  if((opcode & 0xF000) == 0xD000)                     // Bcc, SWI
+    return true;
+  if((opcode & 0xF000) == 0xE000)                     // B
+    return true;
+  if((opcode & 0xF800) == 0xF800)                     // BL (second half)
+    return true;
+  return false;
+}
+
+// Register-only instructions that never touch clockTicks. Returns false
+// when the opcode has to go through its handler.
+static bool thumbJitNative(u32 opcode)
+{
+  int rd = opcode & 7;
+  int rs = (opcode >> 3) & 7;
+  const void *d = &reg[rd].I;
+  const void *s = &reg[rs].I;
+
+  switch(opcode >> 11) {
+    case 0x00: // LSL Rd, Rs, #Imm5
+    case 0x01: // LSR Rd, Rs, #Imm5
+    case 0x02: // ASR Rd, Rs, #Imm5
+    {
+      int shift = (opcode >> 6) & 0x1F;
+      int type = opcode >> 11;
+      jitLoad(EAX, s);
+      if(shift) {
+        jitShift(type == 0 ? 4 : type == 1 ? 5 : 7, shift);
+        jitSetcc(CC_C, &C_FLAG);
+        jitSetFlagsNZ();
+        jitStore(d, EAX);
+      } else if(type == 0) {
+        jitStore(d, EAX);
+        jitTestEax();
+        jitSetFlagsNZ();
+      } else {
+        // shift by 32: carry is bit 31
+        jitByte(0x0F); jitByte(0xBA); jitByte(0xE0); jitByte(31);  // bt eax, 31
+        jitSetcc(CC_C, &C_FLAG);
+        if(type == 1) {
+          jitStoreImm(d, 0);
+          jitStoreByte(&N_FLAG, 0);
+          jitStoreByte(&Z_FLAG, 1);
+        } else {
+          jitShift(7, 31);
+          jitStore(d, EAX);
+          jitTestEax();
+          jitSetFlagsNZ();
+        }
+      }
+      return true;
+    }
+    case 0x03: // ADD/SUB Rd, Rs, Rn / #Imm3
+    {
+      int rn = (opcode >> 6) & 7;
+      bool sub = (opcode & 0x0200) != 0;
+      jitLoad(EAX, s);
+      if(opcode & 0x0400)
+        jitAluImm(sub ? ALU_SUB : ALU_ADD, rn);
+      else
+        jitAluMem(sub ? ALU_SUB : ALU_ADD, &reg[rn].I);
+      jitStore(d, EAX);
+      if(sub)
+        jitSetFlagsSub();
+      else
+        jitSetFlagsAdd();
+      return true;
+    }
+    case 0x04: // MOV Rd, #Offset8
+    {
+      u32 imm = opcode & 0xFF;
+      jitStoreImm(&reg[(opcode >> 8) & 7].I, imm);
+      jitStoreByte(&N_FLAG, 0);
+      jitStoreByte(&Z_FLAG, imm ? 0 : 1);
+      return true;
+    }
+    case 0x05: // CMP Rd, #Offset8
+      jitLoad(EAX, &reg[(opcode >> 8) & 7].I);
+      jitAluImm(ALU_CMP, opcode & 0xFF);
+      jitSetFlagsSub();
+      return true;
+    case 0x06: // ADD Rd, #Offset8
+    case 0x07: // SUB Rd, #Offset8
+    {
+      const void *r = &reg[(opcode >> 8) & 7].I;
+      bool sub = (opcode >> 11) == 0x07;
+      jitLoad(EAX, r);
+      jitAluImm(sub ? ALU_SUB : ALU_ADD, opcode & 0xFF);
+      jitStore(r, EAX);
+      if(sub)
+        jitSetFlagsSub();
+      else
+        jitSetFlagsAdd();
+      return true;
+    }
+  }
+
+  if((opcode & 0xFC00) == 0x4000) {
+    switch((opcode >> 6) & 0xF) {
+#ifndef BKPT_SUPPORT
+      case 0x0: // AND
+#endif
+      case 0x1: // EOR
+      case 0xC: // ORR
+      {
+        int op = (opcode >> 6) & 0xF;
+        jitLoad(EAX, d);
+        jitAluMem(op == 0 ? ALU_AND : op == 1 ? ALU_XOR : ALU_OR, s);
+        jitStore(d, EAX);
+        jitSetFlagsNZ();
+        return true;
+      }
+      case 0x5: // ADC
+        jitLoad(EAX, d);
+        jitByte(0x8A); jitRip(ECX, &C_FLAG, 0);          // mov cl, [C_FLAG]
+        jitByte(0x80); jitByte(0xC1); jitByte(0xFF);      // add cl, 0xFF
+        jitAluMem(ALU_ADC, s);
+        jitStore(d, EAX);
+        jitSetFlagsAdd();
+        return true;
+      case 0x6: // SBC
+        jitLoad(EAX, d);
+        jitByte(0x80); jitRip(7, &C_FLAG, 1); jitByte(1); // cmp byte [C_FLAG], 1
+        jitAluMem(ALU_SBB, s);
+        jitStore(d, EAX);
+        jitSetFlagsSub();
+        return true;
+      case 0x8: // TST
+        jitLoad(EAX, d);
+        jitTestMem(s);
+        jitSetFlagsNZ();
+        return true;
+      case 0x9: // NEG
+        jitLoad(EAX, s);
+        jitByte(0xF7); jitByte(0xD8);                     // neg eax
+        jitStore(d, EAX);
+        jitSetFlagsSub();
+        return true;
+      case 0xA: // CMP
+        jitLoad(EAX, d);
+        jitAluMem(ALU_CMP, s);
+        jitSetFlagsSub();
+        return true;
+      case 0xB: // CMN
+        jitLoad(EAX, d);
+        jitAluMem(ALU_ADD, s);
+        jitSetFlagsAdd();
+        return true;
+      case 0xE: // BIC
+        jitLoad(EAX, s);
+        jitByte(0xF7); jitByte(0xD0);                     // not eax
+        jitAluMem(ALU_AND, d);
+        jitStore(d, EAX);
+        jitSetFlagsNZ();
+        return true;
+      case 0xF: // MVN
+        jitLoad(EAX, s);
+        jitByte(0xF7); jitByte(0xD0);                     // not eax
+        jitStore(d, EAX);
+        jitTestEax();
+        jitSetFlagsNZ();
+        return true;
+    }
+    return false;
+  }
+
+  if((opcode & 0xFC00) == 0x4400 && (opcode & 0xC0) != 0) {
+    int hd = rd | ((opcode >> 4) & 8);
+    int hs = (opcode >> 3) & 15;
+    if(hd == 15 && (opcode & 0x0300) != 0x0100)
+      return false;
+    switch(opcode & 0x0300) {
+      case 0x0000: // ADD Hd, Hs
+        jitLoad(EAX, &reg[hs].I);
+        jitByte(0x01); jitRip(EAX, &reg[hd].I, 0);        // add [Hd], eax
+        return true;
+      case 0x0100: // CMP Hd, Hs
+        jitLoad(EAX, &reg[hd].I);
+        jitAluMem(ALU_CMP, &reg[hs].I);
+        jitSetFlagsSub();
+        return true;
+      case 0x0200: // MOV Hd, Hs
+        jitLoad(EAX, &reg[hs].I);
+        jitStore(&reg[hd].I, EAX);
+        return true;
+    }
+  }
+  return false;
+}
+
+static bool thumbJitCompile(ThumbJitBlock *b, u32 pc, const u8 *src)
+{
+  bool rom = jitIsRom(pc);
+  u32 region = pc >> 24;
+  u32 mask = map[region].mask;
+
+  if((pc & mask) + 2 * (JIT_BLOCK_MAX + 2) > mask + 1)
+    return false;
+
+  if(jitPtr + JIT_BLOCK_CODE > thumbJitCode + JIT_CODE_SIZE ||
+     jitOpsUsed + JIT_BLOCK_MAX + 2 > JIT_OPS_SIZE)
+    thumbJitReset();
+
+  u16 *ops = &thumbJitOps[jitOpsUsed];
+  u8 *start = jitPtr;
+  u8 *exit0[JIT_BLOCK_MAX], *exit1[JIT_BLOCK_MAX * 2], *exit2[JIT_BLOCK_MAX];
+  int n0 = 0, n1 = 0, n2 = 0;
+  int count = 0;
+  bool replay = true;
+
+  if(!jitProtect(start, start + JIT_BLOCK_CODE, true))
+    return false;
+
+  jitByte(0x48); jitByte(0x83); jitByte(0xEC); jitByte(0x08);  // sub rsp, 8
+
+  for(;;) {
+    u32 address = pc + 2 * count;
+    u32 opcode = READ16LE((src + 2 * count));
+    bool native;
+
+    if(!rom && count) {
+      // code modified while in the pipeline
+      jitLoad(EAX, &cpuPrefetch[0]);
+      jitAluImm(ALU_CMP, opcode);
+      exit2[n2++] = jitJcc(CC_NZ);
+    }
+
+    if(rom) {
+      jitStoreImm(&cpuPrefetch[0], READ16LE((src + 2 * count + 2)));
+    } else {
+      jitLoad(EAX, &cpuPrefetch[1]);
+      jitStore(&cpuPrefetch[0], EAX);
+    }
+    jitStoreByte(&busPrefetch, 0);
+    jitLoad(EAX, &busPrefetchCount);
+    jitByte(0xA9); jitWord(0xFFFFFF00);                  // test eax, 0xFFFFFF00
+    jitByte(0x74);                                       // jz over the reload
+    u8 *reload = jitPtr++;
+    jitAluImm(ALU_AND, 0xFF);
+    jitAluImm(ALU_OR, 0x100);
+    jitStore(&busPrefetchCount, EAX);
+    *reload = (u8)(jitPtr - reload - 1);
+    jitStoreImm(&armNextPC, address + 2);
+    jitStoreImm(&reg[15].I, address + 4);
+    if(rom) {
+      jitStoreImm(&cpuPrefetch[1], READ16LE((src + 2 * count + 4)));
+    } else {
+      const u8 *next = jitHostAddress(address + 4);
+      jitByte(0x48); jitByte(0xB8);                      // mov rax, imm64
+      memcpy(jitPtr, &next, 8);
+      jitPtr += 8;
+      jitByte(0x0F); jitByte(0xB7); jitByte(0x00);       // movzx eax, word [rax]
+      jitStore(&cpuPrefetch[1], EAX);
+    }
+
+    native = thumbJitNative(opcode);
+    if(native) {
+      if(rom) {
+        jitCall(jitSeqTicks[region]);
+      } else {
+        jitStoreImm(&busPrefetchCount, 0);
+        jitByte(0x0F); jitByte(0xB6); jitRip(EAX, &memoryWaitSeq[region], 0);
+        jitByte(0xFF); jitByte(0xC0);                    // inc eax
+      }
+    } else {
+      jitStoreImm(&clockTicks, 0);
+      jitByte(0xBF); jitWord(opcode);                    // mov edi, opcode
+      jitCall((const void *)thumbInsnTable[opcode >> 6]);
+      if(thumbJitMode == THUMB_LOCKSTEP) {
+        jitByte(0x83); jitRip(0, &jitSteps, 1); jitByte(1);  // add [jitSteps], 1
+      }
+      jitLoad(EAX, &clockTicks);
+      jitTestEax();
+      exit0[n0++] = jitJcc(CC_S);
+      jitByte(0x75);                                     // jnz over the fetch time
+      u8 *skip = jitPtr++;
+      if(rom) {
+        jitCall(jitSeqTicks[region]);
+      } else {
+        jitStoreImm(&busPrefetchCount, 0);
+        jitByte(0x0F); jitByte(0xB6); jitRip(EAX, &memoryWaitSeq[region], 0);
+        jitByte(0xFF); jitByte(0xC0);                    // inc eax
+      }
+      *skip = (u8)(jitPtr - skip - 1);
+    }
+    if(native && thumbJitMode == THUMB_LOCKSTEP) {
+      jitByte(0x83); jitRip(0, &jitSteps, 1); jitByte(1);    // add [jitSteps], 1
+    }
+#ifdef BENCHMARK
+    jitByte(0x48); jitByte(0x83); jitRip(0, &benchInstructions, 1); jitByte(1);
+#endif
+
+    jitAluMem(ALU_ADD, &cpuTotalTicks);
+    jitStore(&cpuTotalTicks, EAX);
+    jitAluMem(ALU_CMP, &cpuNextEvent);
+    exit1[n1++] = jitJcc(CC_GE);
+    if(!native) {
+      // the handler may have switched state or halted the CPU
+      jitByte(0x80); jitRip(7, &armState, 1); jitByte(0);
+      exit1[n1++] = jitJcc(CC_NZ);
+      jitByte(0x80); jitRip(7, &holdState, 1); jitByte(0);
+      exit1[n1++] = jitJcc(CC_NZ);
+      jitByte(0xF7); jitRip(0, &eventMask, 4); jitWord(1 << EVENT_SWI);
+      exit1[n1++] = jitJcc(CC_NZ);
+    }
+
+    // the high level BIOS calls write memory behind the log's back
+    if((opcode & 0xFF00) == 0xDF00)
+      replay = false;
+    count++;
+    if(thumbJitEndsBlock(opcode) || count == JIT_BLOCK_MAX)
+      break;
+  }
+
+  // exits: eax = 2 continue, 1 slice over, 0 stop (clockTicks < 0)
+  for(int i = 0; i < n2; i++)
+    jitPatch(exit2[i], jitPtr);
+  jitByte(0xB8); jitWord(2);
+  u8 *epilogue = jitPtr;
+  jitByte(0x48); jitByte(0x83); jitByte(0xC4); jitByte(0x08);  // add rsp, 8
+  jitByte(0xC3);
+  for(int i = 0; i < n1; i++)
+    jitPatch(exit1[i], jitPtr);
+  jitByte(0xB8); jitWord(1);
+  jitByte(0xE9); jitRel32(epilogue);
+  for(int i = 0; i < n0; i++)
+    jitPatch(exit0[i], jitPtr);
+  jitByte(0xB8); jitWord(0);
+  jitByte(0xE9); jitRel32(epilogue);
+
+  if(!jitProtect(start, start + JIT_BLOCK_CODE, false))
+    return false;
+
+  if(jitOverflow) {
+    systemMessage(0, N_("Thumb recompiler disabled, code buffer out of reach"));
+    thumbJitMode = THUMB_INTERPRET;
+    return false;
+  }
+
+  memcpy(ops, src, 2 * (count + 2));
+  jitOpsUsed += count + 2;
+
+  b->pc = pc;
+  b->count = count;
+  b->replay = replay;
+  b->ops = ops;
+  b->code = (int (*)())start;
+  thumbJitBlocks++;
+  return true;
+}
+
+static ThumbJitBlock *thumbJitLookup(u32 pc)
+{
+  u32 region = pc >> 24;
+  if(region != 0x02 && region != 0x03 && !jitIsRom(pc))
+    return NULL;
+
+  ThumbJitBlock *b = &thumbJitCache[(pc >> 1) & (JIT_HASH_SIZE - 1)];
+  const u8 *src = jitHostAddress(pc);
+  if(b->code == NULL || b->pc != pc ||
+     memcmp(b->ops, src, 2 * (b->count + 2)) != 0) {
+    if(!thumbJitCompile(b, pc, src))
+      return NULL;
+  }
+
+  // the pipeline may still hold code that has since been overwritten
+  if(cpuPrefetch[0] != READ16LE(&b->ops[0]) ||
+     cpuPrefetch[1] != READ16LE(&b->ops[1]))
+    return NULL;
+  return b;
+}
+
+struct ThumbJitState {
+  reg_pair reg[45];
+  bool N, Z, C, V;
+  bool armState, armIrqEnable, holdState, busPrefetch;
+  int armMode;
+  u32 armNextPC;
+  u32 cpuPrefetch[2];
+  u32 busPrefetchCount;
+  int cpuTotalTicks;
+  int swiTicks;
+};
+
+static void thumbJitSave(ThumbJitState *s)
+{
+  memset(s, 0, sizeof(*s));
+  memcpy(s->reg, reg, sizeof(reg));
+  s->N = N_FLAG; s->Z = Z_FLAG; s->C = C_FLAG; s->V = V_FLAG;
+  s->armState = armState;
+  s->armIrqEnable = armIrqEnable;
+  s->holdState = holdState;
+  s->busPrefetch = busPrefetch;
+  s->armMode = armMode;
+  s->armNextPC = armNextPC;
+  s->cpuPrefetch[0] = cpuPrefetch[0];
+  s->cpuPrefetch[1] = cpuPrefetch[1];
+  s->busPrefetchCount = busPrefetchCount;
+  s->cpuTotalTicks = cpuTotalTicks;
+  s->swiTicks = eventPending(EVENT_SWI) ? eventTicks(EVENT_SWI) : 0;
+}
+
+static void thumbJitRestore(const ThumbJitState *s)
+{
+  memcpy(reg, s->reg, sizeof(reg));
+  N_FLAG = s->N; Z_FLAG = s->Z; C_FLAG = s->C; V_FLAG = s->V;
+  armState = s->armState;
+  armIrqEnable = s->armIrqEnable;
+  holdState = s->holdState;
+  busPrefetch = s->busPrefetch;
+  armMode = s->armMode;
+  armNextPC = s->armNextPC;
+  cpuPrefetch[0] = s->cpuPrefetch[0];
+  cpuPrefetch[1] = s->cpuPrefetch[1];
+  busPrefetchCount = s->busPrefetchCount;
+  cpuTotalTicks = s->cpuTotalTicks;
+  if(s->swiTicks)
+    eventScheduleIn(EVENT_SWI, s->swiTicks);
+  else
+    eventCancel(EVENT_SWI);
+}
+
+// Called by the write decode while thumbJitLogging is set, before the
+// store. Only plain memory can be put back, writes to the I/O registers and
+// the save chips (and the ones that are dropped) end the replay.
+void thumbJitLog(u32 address)
+{
+  u32 len;
+  u8 *host = CPUHostAddress(address & ~3, true, len);
+
+  if(host == NULL || jitLogged == JIT_LOG_SIZE) {
+    jitLogReplay = false;
+    thumbJitLogging = false;
+    return;
+  }
+  jitLogPtr[jitLogged] = (u32 *)host;
+  jitLogOld[jitLogged++] = *(u32 *)host;
+}
+
+// Runs a block, takes its stores back, then replays the same instructions
+// through the interpreter from the same starting state and reports any
+// difference. Execution continues from the interpreter's state. A block
+// that wrote an I/O register or a save chip can't be taken back and is
+// left as it ran.
+static int thumbJitCompare(ThumbJitBlock *b)
+{
+  ThumbJitState before, jit, interp;
+  u32 written[JIT_LOG_SIZE];
+  int i, j;
+
+  thumbJitSave(&before);
+  jitSteps = 0;
+  jitLogged = 0;
+  jitLogReplay = true;
+  thumbJitLogging = true;
+  int result = b->code();
+  thumbJitLogging = false;
+  if(!jitLogReplay)
+    return result;
+  u32 steps = jitSteps;
+  int stores = jitLogged;
+  thumbJitSave(&jit);
+
+  for(i = 0; i < stores; i++)
+    written[i] = *jitLogPtr[i];
+  for(i = stores - 1; i >= 0; i--)
+    *jitLogPtr[i] = jitLogOld[i];
+  thumbJitRestore(&before);
+
+  int expected = 2;
+  thumbJitLogging = true;
+  for(u32 n = 0; n < steps; n++) {
+    if(!thumbStep()) {
+      expected = 0;
+      break;
+    }
+  }
+  thumbJitLogging = false;
+  if(expected && !(cpuTotalTicks < cpuNextEvent && !armState && !holdState && !eventPending(EVENT_SWI)))
+    expected = 1;
+  thumbJitSave(&interp);
+  thumbJitChecked++;
+
+  // the words the block wrote, then the ones only the interpreter wrote,
+  // which the block left as they were
+  bool memory = jitLogReplay;
+  for(i = 0; memory && i < stores; i++)
+    memory = *jitLogPtr[i] == written[i];
+  for(i = stores; memory && i < jitLogged; i++) {
+    for(j = 0; j < i && jitLogPtr[j] != jitLogPtr[i]; j++);
+    if(j == i || j >= stores)
+      memory = *jitLogPtr[i] == jitLogOld[j];
+  }
+
+  if(result != expected || !memory || memcmp(&jit, &interp, sizeof(jit)) != 0) {
+    thumbJitMismatches++;
+    if(thumbJitMismatches <= 16) {
+      for(i = 0; i < 45 && jit.reg[i].I == interp.reg[i].I; i++);
+      systemMessage(0, N_("Thumb recompiler mismatch in block %08x (%d insns): "
+                          "reg %d %08x/%08x flags %d%d%d%d/%d%d%d%d ticks %d/%d memory %s"),
+                    b->pc, steps, i, i < 45 ? jit.reg[i].I : 0,
+                    i < 45 ? interp.reg[i].I : 0,
+                    jit.N, jit.Z, jit.C, jit.V,
+                    interp.N, interp.Z, interp.C, interp.V,
+                    jit.cpuTotalTicks, interp.cpuTotalTicks,
+                    memory ? "same" : "differs");
+    }
+  }
+  return expected;
+}
+
+static int thumbJitExecute()
+{
+  if(!jitReady && !thumbJitInit())
+    return thumbInterpret();
+  if(jitCompiledMode != thumbJitMode) {
+    thumbJitReset();
+    CPUUpdateMemoryPages(); // the lockstep mode decodes every store
+  }
+
+  for(;;) {
+    ThumbJitBlock *b = thumbJitLookup(armNextPC);
+    int result;
+    if(b == NULL) {
+      if(!thumbStep())
+        return 0;
+      result = (cpuTotalTicks < cpuNextEvent && !armState && !holdState && !eventPending(EVENT_SWI)) ? 2 : 1;
+    } else if(thumbJitMode == THUMB_LOCKSTEP && b->replay)
+      result = thumbJitCompare(b);
+    else
+      result = b->code();
+    if(result != 2)
+      return result;
+  }
+}
+
+#endif // THUMB_JIT
+
+int thumbExecute()
+{
+#ifdef THUMB_JIT
+  if(thumbJitMode != THUMB_INTERPRET && !(cheatsEnabled && mastercode))
+    return thumbJitExecute();
+#endif
+  return thumbInterpret();
+}
@@ -11,12 +11,14 @@
 #include "Flash.h"
 #include "Sound.h"
 #include "Sram.h"
+#include "Scheduler.h"
 #include "bios.h"
 #include "Cheats.h"
 #include "../NLS.h"
 #include "elf.h"
 #include "../Util.h"
 #include "../common/Port.h"
+#include "../common/Bench.h"
 #include "../System.h"
 #include "agbprint.h"
 #ifdef PROFILING
@@ -28,7 +30,7 @@
 #endif
 
 
-extern int emulating;
+extern CORE_LOCAL int emulating;
 #ifdef LINK_EMULATION
 extern int linktime;
 extern void StartLink(u16);
@@ -38,36 +40,40 @@ extern void LinkSSend(u16);
 extern void LinkUpdate(int);
 extern int linktime2;
 #endif
-int SWITicks = 0;
-int IRQTicks = 0;
-
-u32 mastercode = 0;
-int layerEnableDelay = 0;
-bool busPrefetch = false;
-bool busPrefetchEnable = false;
-u32 busPrefetchCount = 0;
-int cpuDmaTicksToUpdate = 0;
-int cpuDmaCount = 0;
-bool cpuDmaHack = false;
-u32 cpuDmaLast = 0;
-int dummyAddress = 0;
-
-bool cpuBreakLoop = false;
-int cpuNextEvent = 0;
-
-int gbaSaveType = 0; // used to remember the save type on reset
-bool intState = false;
-bool stopState = false;
-bool holdState = false;
-int holdType = 0;
-bool cpuSramEnabled = true;
-bool cpuFlashEnabled = true;
-bool cpuEEPROMEnabled = true;
-bool cpuEEPROMSensorEnabled = false;
-
-u32 cpuPrefetch[2];
-
-int cpuTotalTicks = 0;
+
+CORE_LOCAL u32 mastercode = 0;
+CORE_LOCAL int layerEnableDelay = 0;
+CORE_LOCAL bool busPrefetch = false;
+CORE_LOCAL bool busPrefetchEnable = false;
+CORE_LOCAL u32 busPrefetchCount = 0;
+CORE_LOCAL int cpuDmaTicksToUpdate = 0;
+CORE_LOCAL int cpuDmaCount = 0;
+CORE_LOCAL bool cpuDmaHack = false;
+CORE_LOCAL u32 cpuDmaLast = 0;
+CORE_LOCAL u32 dmaTransfers = 0; // DMAs run
+CORE_LOCAL u32 dmaBlocks = 0;    // of them copied as one block
+CORE_LOCAL u8 *memoryReadPages[MEMORY_PAGES];
+CORE_LOCAL u8 *memoryWritePages[MEMORY_PAGES];
+CORE_LOCAL int dummyAddress = 0;
+
+CORE_LOCAL bool cpuBreakLoop = false;
+CORE_LOCAL int cpuNextEvent = 0;
+CORE_LOCAL bool cpuVolatileRead = false;
+CORE_LOCAL int cpuIdleLoop = 0; // 0 detect, -1 never skip, else address of a loop to always skip
+
+CORE_LOCAL int gbaSaveType = 0; // used to remember the save type on reset
+CORE_LOCAL bool intState = false;
+CORE_LOCAL bool stopState = false;
+CORE_LOCAL bool holdState = false;
+CORE_LOCAL int holdType = 0;
+CORE_LOCAL bool cpuSramEnabled = true;
+CORE_LOCAL bool cpuFlashEnabled = true;
+CORE_LOCAL bool cpuEEPROMEnabled = true;
+CORE_LOCAL bool cpuEEPROMSensorEnabled = false;
+
+CORE_LOCAL u32 cpuPrefetch[2];
+
+CORE_LOCAL int cpuTotalTicks = 0;
 #ifdef PROFILING
 int profilingTicks = 0;
 int profilingTicksReload = 0;
@@ -83,48 +89,53 @@ u8 freezeOAM[0x400];
 bool debugger_last;
 #endif
 
-int lcdTicks = (useBios && !skipBios) ? 1008 : 208;
-u8 timerOnOffDelay = 0;
-u16 timer0Value = 0;
-bool timer0On = false;
-int timer0Ticks = 0;
-int timer0Reload = 0;
-int timer0ClockReload  = 0;
-u16 timer1Value = 0;
-bool timer1On = false;
-int timer1Ticks = 0;
-int timer1Reload = 0;
-int timer1ClockReload  = 0;
-u16 timer2Value = 0;
-bool timer2On = false;
-int timer2Ticks = 0;
-int timer2Reload = 0;
-int timer2ClockReload  = 0;
-u16 timer3Value = 0;
-bool timer3On = false;
-int timer3Ticks = 0;
-int timer3Reload = 0;
-int timer3ClockReload  = 0;
-u32 dma0Source = 0;
-u32 dma0Dest = 0;
-u32 dma1Source = 0;
-u32 dma1Dest = 0;
-u32 dma2Source = 0;
-u32 dma2Dest = 0;
-u32 dma3Source = 0;
-u32 dma3Dest = 0;
-void (*cpuSaveGameFunc)(u32,u8) = flashSaveDecide;
-void (*renderLine)() = mode0RenderLine;
-bool fxOn = false;
-bool windowOn = false;
-int frameCount = 0;
-char buffer[1024];
-u32 lastTime = 0;
-int count = 0;
-
-int capture = 0;
-int capturePrevious = 0;
-int captureNumber = 0;
+// lcdTicks and timerNTicks are the countdowns of the save states. The
+// scheduler keeps the live ones, a timer's timerNTicks only counts while
+// it is not clocked by the CPU (off, counting up or in stop state).
+CORE_LOCAL int lcdTicks = 208; // CPUReset() sets it for the BIOS
+static CORE_LOCAL bool timerStopped = false;
+static CORE_LOCAL bool timerRegistersValid = true; // TMxD in ioMem as of the last events
+CORE_LOCAL u8 timerOnOffDelay = 0;
+CORE_LOCAL u16 timer0Value = 0;
+CORE_LOCAL bool timer0On = false;
+CORE_LOCAL int timer0Ticks = 0;
+CORE_LOCAL int timer0Reload = 0;
+CORE_LOCAL int timer0ClockReload  = 0;
+CORE_LOCAL u16 timer1Value = 0;
+CORE_LOCAL bool timer1On = false;
+CORE_LOCAL int timer1Ticks = 0;
+CORE_LOCAL int timer1Reload = 0;
+CORE_LOCAL int timer1ClockReload  = 0;
+CORE_LOCAL u16 timer2Value = 0;
+CORE_LOCAL bool timer2On = false;
+CORE_LOCAL int timer2Ticks = 0;
+CORE_LOCAL int timer2Reload = 0;
+CORE_LOCAL int timer2ClockReload  = 0;
+CORE_LOCAL u16 timer3Value = 0;
+CORE_LOCAL bool timer3On = false;
+CORE_LOCAL int timer3Ticks = 0;
+CORE_LOCAL int timer3Reload = 0;
+CORE_LOCAL int timer3ClockReload  = 0;
+CORE_LOCAL u32 dma0Source = 0;
+CORE_LOCAL u32 dma0Dest = 0;
+CORE_LOCAL u32 dma1Source = 0;
+CORE_LOCAL u32 dma1Dest = 0;
+CORE_LOCAL u32 dma2Source = 0;
+CORE_LOCAL u32 dma2Dest = 0;
+CORE_LOCAL u32 dma3Source = 0;
+CORE_LOCAL u32 dma3Dest = 0;
+CORE_LOCAL void (*cpuSaveGameFunc)(u32,u8) = flashSaveDecide;
+CORE_LOCAL void (*renderLine)() = mode0RenderLine;
+CORE_LOCAL bool fxOn = false;
+CORE_LOCAL bool windowOn = false;
+CORE_LOCAL int frameCount = 0;
+CORE_LOCAL char buffer[1024];
+CORE_LOCAL u32 lastTime = 0;
+CORE_LOCAL int count = 0;
+
+CORE_LOCAL int capture = 0;
+CORE_LOCAL int capturePrevious = 0;
+CORE_LOCAL int captureNumber = 0;
 
 const int TIMER_TICKS[4] = {
   0,
@@ -143,13 +154,13 @@ const bool isInRom [16]=
   { false, false, false, false, false, false, false, false,
     true, true, true, true, true, true, false, false };
 
-u8 memoryWait[16] =
+CORE_LOCAL u8 memoryWait[16] =
   { 0, 0, 2, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, 4, 4, 0 };
-u8 memoryWait32[16] =
+CORE_LOCAL u8 memoryWait32[16] =
   { 0, 0, 5, 0, 0, 1, 1, 0, 7, 7, 9, 9, 13, 13, 4, 0 };
-u8 memoryWaitSeq[16] =
+CORE_LOCAL u8 memoryWaitSeq[16] =
   { 0, 0, 2, 0, 0, 0, 0, 0, 2, 2, 4, 4, 8, 8, 4, 0 };
-u8 memoryWaitSeq32[16] =
+CORE_LOCAL u8 memoryWaitSeq32[16] =
   { 0, 0, 5, 0, 0, 1, 1, 0, 5, 5, 9, 9, 17, 17, 4, 0 };
 
 // The videoMemoryWait constants are used to add some waitstates
@@ -160,7 +171,7 @@ u8 memoryWaitSeq32[16] =
 //  {0, 0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 
-u8 biosProtected[4];
+CORE_LOCAL u8 biosProtected[4];
 
 #ifdef WORDS_BIGENDIAN
 bool cpuBiosSwapped = false;
@@ -342,7 +353,7 @@ u32 myROM[] = {
 0x03007FE0
 };
 
-variable_desc saveGameStruct[] = {
+CORE_LOCAL_INIT variable_desc saveGameStruct[] = {
   { &DISPCNT  , sizeof(u16) },
   { &DISPSTAT , sizeof(u16) },
   { &VCOUNT   , sizeof(u16) },
@@ -461,7 +472,7 @@ variable_desc saveGameStruct[] = {
   { NULL, 0 }
 };
 
-static int romSize = 0x2000000;
+static CORE_LOCAL int romSize = 0x2000000;
 
 #ifdef PROFILING
 void cpuProfil(profile_segment *seg)
@@ -474,49 +485,58 @@ void cpuEnableProfiling(int hz)
   if(hz == 0)
     hz = 100;
   profilingTicks = profilingTicksReload = 16777216 / hz;
+  eventScheduleIn(EVENT_PROFILING, profilingTicks);
   profSetHertz(hz);
 }
 #endif
 
 
-inline int CPUUpdateTicks()
+// Brings TMxD of the clocked timers up to the last events, the event loop
+// only works them out when something reads them
+void CPUUpdateTimerRegisters()
 {
-  int cpuLoopTicks = lcdTicks;
-
-  if(soundTicks < cpuLoopTicks)
-    cpuLoopTicks = soundTicks;
-
-  if(timer0On && (timer0Ticks < cpuLoopTicks)) {
-    cpuLoopTicks = timer0Ticks;
-  }
-  if(timer1On && !(TM1CNT & 4) && (timer1Ticks < cpuLoopTicks)) {
-    cpuLoopTicks = timer1Ticks;
+  if(timerRegistersValid)
+    return;
+  timerRegistersValid = true;
+  if(eventPending(EVENT_TIMER0)) {
+    TM0D = 0xFFFF - (eventTicks(EVENT_TIMER0) >> timer0ClockReload);
+    UPDATE_REG(0x100, TM0D);
   }
-  if(timer2On && !(TM2CNT & 4) && (timer2Ticks < cpuLoopTicks)) {
-    cpuLoopTicks = timer2Ticks;
+  if(eventPending(EVENT_TIMER1)) {
+    TM1D = 0xFFFF - (eventTicks(EVENT_TIMER1) >> timer1ClockReload);
+    UPDATE_REG(0x104, TM1D);
   }
-  if(timer3On && !(TM3CNT & 4) && (timer3Ticks < cpuLoopTicks)) {
-    cpuLoopTicks = timer3Ticks;
+  if(eventPending(EVENT_TIMER2)) {
+    TM2D = 0xFFFF - (eventTicks(EVENT_TIMER2) >> timer2ClockReload);
+    UPDATE_REG(0x108, TM2D);
   }
-#ifdef PROFILING
-  if(profilingTicksReload != 0) {
-    if(profilingTicks < cpuLoopTicks) {
-      cpuLoopTicks = profilingTicks;
-    }
-  }
-#endif
-
-  if (SWITicks) {
-    if (SWITicks < cpuLoopTicks)
-        cpuLoopTicks = SWITicks;
+  if(eventPending(EVENT_TIMER3)) {
+    TM3D = 0xFFFF - (eventTicks(EVENT_TIMER3) >> timer3ClockReload);
+    UPDATE_REG(0x10C, TM3D);
   }
+}
 
-  if (IRQTicks) {
-    if (IRQTicks < cpuLoopTicks)
-        cpuLoopTicks = IRQTicks;
+static void CPUUpdateTimerEvent(int event, bool clocked, int &timerTicks)
+{
+  if(clocked == eventPending(event))
+    return;
+  if(clocked)
+    eventScheduleIn(event, timerTicks);
+  else {
+    timerTicks = eventTicks(event);
+    eventCancel(event);
   }
+}
 
-  return cpuLoopTicks;
+// Schedules the timers that count CPU ticks and parks the others in
+// timerNTicks. Call CPUUpdateTimerRegisters() first when a timer may stop.
+static void CPUUpdateTimerEvents()
+{
+  CPUUpdateTimerEvent(EVENT_TIMER0, timer0On && !stopState, timer0Ticks);
+  CPUUpdateTimerEvent(EVENT_TIMER1, timer1On && !(TM1CNT & 4) && !stopState, timer1Ticks);
+  CPUUpdateTimerEvent(EVENT_TIMER2, timer2On && !(TM2CNT & 4) && !stopState, timer2Ticks);
+  CPUUpdateTimerEvent(EVENT_TIMER3, timer3On && !(TM3CNT & 4) && !stopState, timer3Ticks);
+  timerStopped = stopState;
 }
 
 void CPUUpdateWindow0()
@@ -551,10 +571,10 @@ void CPUUpdateWindow1()
   }
 }
 
-extern u32 line0[240];
-extern u32 line1[240];
-extern u32 line2[240];
-extern u32 line3[240];
+extern CORE_LOCAL u32 line0[240];
+extern CORE_LOCAL u32 line1[240];
+extern CORE_LOCAL u32 line2[240];
+extern CORE_LOCAL u32 line3[240];
 
 #define CLEAR_ARRAY(a) \
   {\
@@ -580,7 +600,7 @@ void CPUUpdateRenderBuffers(bool force)
   }
 }
 
-static bool CPUWriteState(gzFile gzFile)
+static bool CPUWriteState(gzFile gzFile, bool screen = true)
 {
   utilWriteInt(gzFile, SAVE_GAME_VERSION);
 
@@ -590,19 +610,34 @@ static bool CPUWriteState(gzFile gzFile)
 
   utilGzWrite(gzFile, &reg[0], sizeof(reg));
 
+  // the countdowns as the old event loop kept them
+  lcdTicks = eventTicks(EVENT_LCD);
+  if(eventPending(EVENT_TIMER0))
+    timer0Ticks = eventTicks(EVENT_TIMER0);
+  if(eventPending(EVENT_TIMER1))
+    timer1Ticks = eventTicks(EVENT_TIMER1);
+  if(eventPending(EVENT_TIMER2))
+    timer2Ticks = eventTicks(EVENT_TIMER2);
+  if(eventPending(EVENT_TIMER3))
+    timer3Ticks = eventTicks(EVENT_TIMER3);
+  CPUUpdateTimerRegisters();
+
   utilWriteData(gzFile, saveGameStruct);
 
   // new to version 0.7.1
   utilWriteInt(gzFile, stopState);
   // new to version 0.8
-  utilWriteInt(gzFile, IRQTicks);
+  utilWriteInt(gzFile, eventPending(EVENT_IRQ) ? eventTicks(EVENT_IRQ) : 0);
+  // version 11, the ticks a high level BIOS call still has to take
+  utilWriteInt(gzFile, eventPending(EVENT_SWI) ? eventTicks(EVENT_SWI) : 0);
 
   utilGzWrite(gzFile, internalRAM, 0x8000);
   utilGzWrite(gzFile, paletteRAM, 0x400);
   utilGzWrite(gzFile, workRAM, 0x40000);
   utilGzWrite(gzFile, vram, 0x20000);
   utilGzWrite(gzFile, oam, 0x400);
-  utilGzWrite(gzFile, pix, 4*241*162);
+  if(screen)
+    utilGzWrite(gzFile, pix, 4*241*162);
   utilGzWrite(gzFile, ioMem, 0x400);
 
   eepromSaveGame(gzFile);
@@ -633,6 +668,22 @@ bool CPUWriteState(const char *file)
   return res;
 }
 
+int CPUWriteRawState(char *memory, int available)
+{
+  gzFile gzFile = utilMemRawOpen(memory, available, "w");
+
+  bool res = CPUWriteState(gzFile, false);
+
+  // loading restarts the sound frame, a raw state picks it up where it was
+  utilWriteInt(gzFile, eventTicks(EVENT_SOUND));
+
+  long size = utilGzMemTell(gzFile);
+
+  utilGzClose(gzFile);
+
+  return (res && size > 0) ? size : 0;
+}
+
 bool CPUWriteMemState(char *memory, int available)
 {
   gzFile gzFile = utilMemGzOpen(memory, available, "w");
@@ -653,7 +704,7 @@ bool CPUWriteMemState(char *memory, int available)
   return res;
 }
 
-static bool CPUReadState(gzFile gzFile)
+static bool CPUReadState(gzFile gzFile, bool screen = true)
 {
   int version = utilReadInt(gzFile);
 
@@ -698,29 +749,38 @@ static bool CPUReadState(gzFile gzFile)
   else
     stopState = utilReadInt(gzFile) ? true : false;
 
+  eventCancel(EVENT_IRQ);
   if(version < SAVE_GAME_VERSION_4)
-  {
-    IRQTicks = 0;
     intState = false;
-  }
   else
   {
-    IRQTicks = utilReadInt(gzFile);
-    if (IRQTicks>0)
+    int irqTicks = utilReadInt(gzFile);
+    if (irqTicks>0)
+    {
       intState = true;
+      eventScheduleIn(EVENT_IRQ, irqTicks);
+    }
     else
-    {
       intState = false;
-      IRQTicks = 0;
-    }
+  }
+
+  eventCancel(EVENT_SWI);
+  if(version >= SAVE_GAME_VERSION_11)
+  {
+    int swiTicks = utilReadInt(gzFile);
+    if(swiTicks > 0)
+      eventScheduleIn(EVENT_SWI, swiTicks);
   }
 
   utilGzRead(gzFile, internalRAM, 0x8000);
   utilGzRead(gzFile, paletteRAM, 0x400);
   utilGzRead(gzFile, workRAM, 0x40000);
   utilGzRead(gzFile, vram, 0x20000);
+  gfxTileCacheReset();
   utilGzRead(gzFile, oam, 0x400);
-  if(version < SAVE_GAME_VERSION_6)
+  if(!screen)
+    ;
+  else if(version < SAVE_GAME_VERSION_6)
     utilGzRead(gzFile, pix, 4*240*160);
   else
     utilGzRead(gzFile, pix, 4*241*162);
@@ -780,6 +840,14 @@ static bool CPUReadState(gzFile gzFile)
     interp_rate();
   }
 
+  eventScheduleIn(EVENT_LCD, lcdTicks);
+  timerRegistersValid = true;
+  eventCancel(EVENT_TIMER0);
+  eventCancel(EVENT_TIMER1);
+  eventCancel(EVENT_TIMER2);
+  eventCancel(EVENT_TIMER3);
+  CPUUpdateTimerEvents();
+
   // set pointers!
   layerEnable = layerSettings & DISPCNT;
 
@@ -836,6 +904,22 @@ bool CPUReadMemState(char *memory, int available)
   return res;
 }
 
+// Raw states leave out the screen, the next frame draws it again
+bool CPUReadRawState(const char *memory, int size)
+{
+  gzFile gzFile = utilMemRawOpen((char *)memory, size, "r");
+
+  bool res = CPUReadState(gzFile, false);
+
+  if(res)
+    eventScheduleIn(EVENT_SOUND, utilReadInt(gzFile));
+
+  if(utilGzClose(gzFile) != Z_OK)
+    res = false;
+
+  return res;
+}
+
 bool CPUReadState(const char * file)
 {
   gzFile gzFile = utilGzOpen(file, "rb");
@@ -1680,7 +1764,7 @@ void CPUSoftwareInterrupt()
 
 void CPUSoftwareInterrupt(int comment)
 {
-  static bool disableMessage = false;
+  static CORE_LOCAL bool disableMessage = false;
   if(armState) comment >>= 16;
 #ifdef BKPT_SUPPORT
   if(comment == 0xff) {
@@ -1737,6 +1821,7 @@ void CPUSoftwareInterrupt(int comment)
   //    biosProtected = 0xe3a02004;
   //  }
 
+  int swiTicks = 0;
   switch(comment) {
   case 0x00:
     BIOS_SoftReset();
@@ -1812,17 +1897,17 @@ void CPUSoftwareInterrupt(int comment)
         if ((reg[2].I >> 24) & 1)
         {
           if ((reg[2].I >> 26) & 1)
-          SWITicks = (7 + memoryWait32[(reg[1].I>>24) & 0xF]) * (len>>1);
+          swiTicks = (7 + memoryWait32[(reg[1].I>>24) & 0xF]) * (len>>1);
           else
-          SWITicks = (8 + memoryWait[(reg[1].I>>24) & 0xF]) * (len);
+          swiTicks = (8 + memoryWait[(reg[1].I>>24) & 0xF]) * (len);
         }
         else
         {
           if ((reg[2].I >> 26) & 1)
-          SWITicks = (10 + memoryWait32[(reg[0].I>>24) & 0xF] +
+          swiTicks = (10 + memoryWait32[(reg[0].I>>24) & 0xF] +
               memoryWait32[(reg[1].I>>24) & 0xF]) * (len>>1);
           else
-          SWITicks = (11 + memoryWait[(reg[0].I>>24) & 0xF] +
+          swiTicks = (11 + memoryWait[(reg[0].I>>24) & 0xF] +
               memoryWait[(reg[1].I>>24) & 0xF]) * len;
         }
       }
@@ -1836,10 +1921,10 @@ void CPUSoftwareInterrupt(int comment)
          ((reg[0].I + len) & 0xe000000) == 0))
       {
         if ((reg[2].I >> 24) & 1)
-          SWITicks = (6 + memoryWait32[(reg[1].I>>24) & 0xF] +
+          swiTicks = (6 + memoryWait32[(reg[1].I>>24) & 0xF] +
               7 * (memoryWaitSeq32[(reg[1].I>>24) & 0xF] + 1)) * len;
         else
-          SWITicks = (9 + memoryWait32[(reg[0].I>>24) & 0xF] +
+          swiTicks = (9 + memoryWait32[(reg[0].I>>24) & 0xF] +
               memoryWait32[(reg[1].I>>24) & 0xF] +
               7 * (memoryWaitSeq32[(reg[0].I>>24) & 0xF] +
               memoryWaitSeq32[(reg[1].I>>24) & 0xF] + 2)) * len;
@@ -1861,7 +1946,7 @@ void CPUSoftwareInterrupt(int comment)
       int len = CPUReadHalfWord(reg[2].I);
       if (!(((reg[0].I & 0xe000000) == 0) ||
          ((reg[0].I + len) & 0xe000000) == 0))
-        SWITicks = (32 + memoryWait[(reg[0].I>>24) & 0xF]) * len;
+        swiTicks = (32 + memoryWait[(reg[0].I>>24) & 0xF]) * len;
     }
     BIOS_BitUnPack();
     break;
@@ -1870,7 +1955,7 @@ void CPUSoftwareInterrupt(int comment)
       u32 len = CPUReadMemory(reg[0].I) >> 8;
       if(!(((reg[0].I & 0xe000000) == 0) ||
           ((reg[0].I + (len & 0x1fffff)) & 0xe000000) == 0))
-        SWITicks = (9 + memoryWait[(reg[1].I>>24) & 0xF]) * len;
+        swiTicks = (9 + memoryWait[(reg[1].I>>24) & 0xF]) * len;
     }
     BIOS_LZ77UnCompWram();
     break;
@@ -1879,7 +1964,7 @@ void CPUSoftwareInterrupt(int comment)
       u32 len = CPUReadMemory(reg[0].I) >> 8;
       if(!(((reg[0].I & 0xe000000) == 0) ||
           ((reg[0].I + (len & 0x1fffff)) & 0xe000000) == 0))
-        SWITicks = (19 + memoryWait[(reg[1].I>>24) & 0xF]) * len;
+        swiTicks = (19 + memoryWait[(reg[1].I>>24) & 0xF]) * len;
     }
     BIOS_LZ77UnCompVram();
     break;
@@ -1888,7 +1973,7 @@ void CPUSoftwareInterrupt(int comment)
       u32 len = CPUReadMemory(reg[0].I) >> 8;
       if(!(((reg[0].I & 0xe000000) == 0) ||
           ((reg[0].I + (len & 0x1fffff)) & 0xe000000) == 0))
-        SWITicks = (29 + (memoryWait[(reg[0].I>>24) & 0xF]<<1)) * len;
+        swiTicks = (29 + (memoryWait[(reg[0].I>>24) & 0xF]<<1)) * len;
     }
     BIOS_HuffUnComp();
     break;
@@ -1897,7 +1982,7 @@ void CPUSoftwareInterrupt(int comment)
       u32 len = CPUReadMemory(reg[0].I) >> 8;
       if(!(((reg[0].I & 0xe000000) == 0) ||
           ((reg[0].I + (len & 0x1fffff)) & 0xe000000) == 0))
-        SWITicks = (11 + memoryWait[(reg[0].I>>24) & 0xF] +
+        swiTicks = (11 + memoryWait[(reg[0].I>>24) & 0xF] +
           memoryWait[(reg[1].I>>24) & 0xF]) * len;
     }
     BIOS_RLUnCompWram();
@@ -1907,7 +1992,7 @@ void CPUSoftwareInterrupt(int comment)
       u32 len = CPUReadMemory(reg[0].I) >> 9;
       if(!(((reg[0].I & 0xe000000) == 0) ||
           ((reg[0].I + (len & 0x1fffff)) & 0xe000000) == 0))
-        SWITicks = (34 + (memoryWait[(reg[0].I>>24) & 0xF] << 1) +
+        swiTicks = (34 + (memoryWait[(reg[0].I>>24) & 0xF] << 1) +
           memoryWait[(reg[1].I>>24) & 0xF]) * len;
     }
     BIOS_RLUnCompVram();
@@ -1917,7 +2002,7 @@ void CPUSoftwareInterrupt(int comment)
       u32 len = CPUReadMemory(reg[0].I) >> 8;
       if(!(((reg[0].I & 0xe000000) == 0) ||
           ((reg[0].I + (len & 0x1fffff)) & 0xe000000) == 0))
-        SWITicks = (13 + memoryWait[(reg[0].I>>24) & 0xF] +
+        swiTicks = (13 + memoryWait[(reg[0].I>>24) & 0xF] +
           memoryWait[(reg[1].I>>24) & 0xF]) * len;
     }
     BIOS_Diff8bitUnFilterWram();
@@ -1927,7 +2012,7 @@ void CPUSoftwareInterrupt(int comment)
       u32 len = CPUReadMemory(reg[0].I) >> 9;
       if(!(((reg[0].I & 0xe000000) == 0) ||
           ((reg[0].I + (len & 0x1fffff)) & 0xe000000) == 0))
-        SWITicks = (39 + (memoryWait[(reg[0].I>>24) & 0xF]<<1) +
+        swiTicks = (39 + (memoryWait[(reg[0].I>>24) & 0xF]<<1) +
           memoryWait[(reg[1].I>>24) & 0xF]) * len;
     }
     BIOS_Diff8bitUnFilterVram();
@@ -1937,7 +2022,7 @@ void CPUSoftwareInterrupt(int comment)
       u32 len = CPUReadMemory(reg[0].I) >> 9;
       if(!(((reg[0].I & 0xe000000) == 0) ||
           ((reg[0].I + (len & 0x1fffff)) & 0xe000000) == 0))
-        SWITicks = (13 + memoryWait[(reg[0].I>>24) & 0xF] +
+        swiTicks = (13 + memoryWait[(reg[0].I>>24) & 0xF] +
           memoryWait[(reg[1].I>>24) & 0xF]) * len;
     }
     BIOS_Diff16bitUnFilter();
@@ -1982,6 +2067,10 @@ void CPUSoftwareInterrupt(int comment)
     }
     break;
   }
+
+  // the CPU stands still for the time the real call would take
+  if(swiTicks > 0)
+    eventScheduleIn(EVENT_SWI, swiTicks);
 }
 
 void CPUCompareVCOUNT()
@@ -2007,6 +2096,150 @@ void CPUCompareVCOUNT()
 
 }
 
+// Host memory behind an address for the regions block copies and the BIOS
+// calls can use directly, with the bytes up to the next mirror in len. NULL
+// for I/O, the save chips, the BIOS, the clock in the ROM header and the
+// writes that are dropped.
+u8 *CPUHostAddress(u32 address, bool write, u32 &len)
+{
+  u8 *base;
+  u32 offset;
+  u32 size;
+
+  switch(address >> 24) {
+  case 0x02:
+    base = workRAM;
+    offset = address & 0x3FFFF;
+    size = 0x40000;
+    break;
+  case 0x03:
+    base = internalRAM;
+    offset = address & 0x7FFF;
+    size = 0x8000;
+    break;
+  case 0x05:
+    if(write && address >= 0x5000400 && (RomIdCode & 0xFFFFFF) == CORVETTE)
+      return NULL;
+    base = paletteRAM;
+    offset = address & 0x3FF;
+    size = 0x400;
+    break;
+  case 0x06:
+    offset = address & 0x1FFFF;
+    if (((DISPCNT & 7) >2) && ((offset & 0x1C000) == 0x18000))
+      return NULL;
+    if ((offset & 0x18000) == 0x18000)
+      offset &= 0x17FFF;
+    base = vram;
+    size = 0x18000;
+    break;
+  case 0x07:
+    base = oam;
+    offset = address & 0x3FF;
+    size = 0x400;
+    break;
+#ifndef USE_VM
+  case 0x08:
+    // the GPIO port of the clock and sensors
+    if(address < 0x80000CA)
+      return NULL;
+  case 0x09:
+  case 0x0A:
+  case 0x0B:
+  case 0x0C:
+    if(write)
+      return NULL;
+    base = rom;
+    offset = address & 0x1FFFFFF;
+    size = 0x2000000;
+    break;
+#endif
+  default:
+    return NULL;
+  }
+
+  len = size - offset;
+  if(len > 0x1000000 - (address & 0xFFFFFF))
+    len = 0x1000000 - (address & 0xFFFFFF);
+  return base + offset;
+}
+
+// What halfword or word writes to bytes bytes at host would have
+// invalidated, for a block written through CPUHostAddress()
+void CPUHostWritten(u8 *host, u32 bytes)
+{
+  if(host >= paletteRAM && host < paletteRAM + 0x400) {
+    for(u32 a = (host - paletteRAM) & ~31; a < (u32)(host - paletteRAM) + bytes; a += 32)
+      gfxPaletteWritten(a);
+  } else if(host >= vram && host < vram + 0x20000) {
+    for(u32 a = (host - vram) & ~31; a < (u32)(host - vram) + bytes; a += 32)
+      gfxVramWritten(a);
+  }
+}
+
+// Runs a DMA between plain memory as a single copy, or as a fill when the
+// source is fixed or is the BIOS, which then reads as 0. Returns false to
+// leave it to the per unit path: I/O and save chips, decrementing or
+// fixed destinations, blocks that reach a mirror and copies that overlap.
+static bool dmaBlock(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
+{
+#ifdef BKPT_SUPPORT
+  return false;
+#else
+  u32 unit = transfer32 ? 4 : 2;
+  u32 bytes = c * unit;
+  u32 src = s & ~(unit - 1);
+  u32 len;
+
+  if(di != 4 || (si != 4 && si != 0))
+    return false;
+
+  u8 *to = CPUHostAddress(d & ~(unit - 1), true, len);
+  if(!to || len < bytes)
+    return false;
+
+  if(src < 0x02000000 && (reg[15].I >> 24)) {
+    memset(to, 0, bytes);
+    s = src;
+  } else {
+    u8 *from = CPUHostAddress(src, false, len);
+    if(!from || len < (si ? bytes : unit))
+      return false;
+
+    if(si == 0) {
+      if(transfer32) {
+        u32 value = *(u32 *)from;
+        for(u32 i = 0; i < c; i++)
+          ((u32 *)to)[i] = value;
+      } else {
+        u16 value = *(u16 *)from;
+        for(u32 i = 0; i < c; i++)
+          ((u16 *)to)[i] = value;
+      }
+    } else {
+      if(from < to + bytes && to < from + bytes)
+        return false;
+      memcpy(to, from, bytes);
+      from += bytes - unit;
+    }
+
+    if(transfer32) {
+      cpuDmaLast = READ32LE(((u32 *)from));
+    } else {
+      cpuDmaLast = READ16LE(((u16 *)from));
+      cpuDmaLast |= (cpuDmaLast<<16);
+    }
+    s = src + (si ? bytes : 0);
+  }
+
+  CPUHostWritten(to, bytes);
+
+  d += bytes;
+  dmaBlocks++;
+  return true;
+#endif
+}
+
 void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
 {
   int sm = s >> 24;
@@ -2015,6 +2248,8 @@ void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
   int dw = 0;
   int sc = c;
 
+  BENCH_BEGIN(BENCH_DMA);
+
   cpuDmaCount = c;
   // This is done to get the correct waitstates.
   if (sm>15)
@@ -2025,7 +2260,11 @@ void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
   //if ((sm>=0x05) && (sm<=0x07) || (dm>=0x05) && (dm <=0x07))
   //    blank = (((DISPSTAT | ((DISPSTAT>>1)&1))==1) ?  true : false);
 
-  if(transfer32) {
+  dmaTransfers++;
+
+  if(dmaBlock(s, d, si, di, c, transfer32)) {
+    // plain memory on both sides
+  } else if(transfer32) {
     s &= 0xFFFFFFFC;
     if(s < 0x02000000 && (reg[15].I >> 24)) {
       while(c != 0) {
@@ -2084,6 +2323,7 @@ void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
 
   cpuDmaTicksToUpdate += totalTicks;
 
+  BENCH_END(BENCH_DMA);
 }
 
 void CPUCheckDMA(int reason, int dmamask)
@@ -2368,7 +2608,7 @@ void CPUUpdateRegister(u32 address, u16 value)
       windowOn = (layerEnable & 0x6000) ? true : false;
       if(change && !((value & 0x80))) {
         if(!(DISPSTAT & 1)) {
-          lcdTicks = 1008;
+          eventScheduleIn(EVENT_LCD, 1008);
           //      VCOUNT = 0;
           //      UPDATE_REG(0x06, VCOUNT);
           DISPSTAT &= 0xFFFC;
@@ -2892,6 +3132,7 @@ void CPUUpdateRegister(u32 address, u16 value)
 
 void applyTimer ()
 {
+  CPUUpdateTimerRegisters();
   if (timerOnOffDelay & 1)
   {
     timer0ClockReload = TIMER_TICKS[timer0Value & 3];
@@ -2947,12 +3188,14 @@ void applyTimer ()
     TM3CNT = timer3Value & 0xC7;
     UPDATE_REG(0x10E, TM3CNT);
   }
-  cpuNextEvent = CPUUpdateTicks();
+  CPUUpdateTimerEvents();
+  timerRegistersValid = true;
+  cpuNextEvent = eventNext();
   timerOnOffDelay = 0;
 }
 
-u8 cpuBitsSet[256];
-u8 cpuLowestBitSet[256];
+CORE_LOCAL u8 cpuBitsSet[256];
+CORE_LOCAL u8 cpuLowestBitSet[256];
 
 void CPUInit(const char *biosFileName, bool useBiosFile)
 {
@@ -3007,6 +3250,10 @@ void CPUInit(const char *biosFileName, bool useBiosFile)
     cpuLowestBitSet[i] = j;
   }
 
+#ifdef THUMB_JIT
+  thumbJitReset();
+#endif
+
   for(i = 0; i < 0x400; i++)
     ioReadable[i] = true;
   for(i = 0x10; i < 0x48; i++)
@@ -3050,6 +3297,51 @@ void CPUInit(const char *biosFileName, bool useBiosFile)
   }
 }
 
+// Points the pages of the bus that are plain memory at the host memory
+// behind them, see GBAinline.h
+void CPUUpdateMemoryPages()
+{
+  memset(memoryReadPages, 0, sizeof(memoryReadPages));
+  memset(memoryWritePages, 0, sizeof(memoryWritePages));
+
+  for(u32 page = 0; page < MEMORY_PAGES; page++) {
+    u32 address = page << MEMORY_PAGE_SHIFT;
+
+    switch(address >> 24) {
+    case 0x02:
+      memoryReadPages[page] = &workRAM[address & 0x3FFFF];
+      memoryWritePages[page] = memoryReadPages[page];
+      break;
+    case 0x03:
+      memoryReadPages[page] = &internalRAM[address & 0x7FFF];
+      memoryWritePages[page] = memoryReadPages[page];
+      break;
+    case 0x06:
+      if((address & 0x1FFFF) < 0x18000)
+        memoryReadPages[page] = &vram[address & 0x1FFFF];
+      break;
+#ifndef USE_VM
+    case 0x08:
+      // the GPIO port of the clock and sensors
+      if(address == 0x08000000)
+        break;
+    case 0x09:
+    case 0x0A:
+    case 0x0B:
+    case 0x0C:
+      memoryReadPages[page] = &rom[address & 0x1FFFFFF];
+      break;
+#endif
+    }
+  }
+
+#ifdef THUMB_JIT
+  // the lockstep mode logs the stores, which only the decode does
+  if(thumbJitMode == THUMB_LOCKSTEP)
+    memset(memoryWritePages, 0, sizeof(memoryWritePages));
+#endif
+}
+
 void CPUReset()
 {
   systemCartridgeRumble(false);
@@ -3077,6 +3369,7 @@ void CPUReset()
   memset(pix, 0, 4*160*240);
   // clean vram
   memset(vram, 0, 0x20000);
+  gfxTileCacheReset();
   // clean io memory
   memset(ioMem, 0, 0x400);
 
@@ -3226,6 +3519,14 @@ void CPUReset()
   timer3Ticks = 0;
   timer3Reload = 0;
   timer3ClockReload  = 0;
+  eventReset();
+  eventScheduleIn(EVENT_LCD, lcdTicks);
+  CPUUpdateTimerEvents();
+  timerRegistersValid = true;
+#ifdef PROFILING
+  if(profilingTicksReload)
+    eventScheduleIn(EVENT_PROFILING, profilingTicksReload);
+#endif
   dma0Source = 0;
   dma0Dest = 0;
   dma1Source = 0;
@@ -3274,6 +3575,8 @@ void CPUReset()
   map[14].address = flashSaveMemory;
   map[14].mask = 0xFFFF;
 
+  CPUUpdateMemoryPages();
+
   eepromReset();
   flashReset();
 
@@ -3350,8 +3653,6 @@ void CPUReset()
   cpuDmaHack = false;
 
   //lastTime = systemGetClock();
-
-  SWITicks = 0;
 }
 
 void CPUInterrupt()
@@ -3377,18 +3678,185 @@ void CPUInterrupt()
   biosProtected[3] = 0xe5;
 }
 
+// Idle loop detection ////////////////////////////////////////////////////
+//
+// A short loop that only reads memory and comes back to its start with the
+// same registers and flags will go on doing so until something outside the
+// CPU changes memory, which only happens at the next event. Such iterations
+// are skipped as a whole, so the loop is still left at the same instruction
+// and on the same tick as when running it.
+
+static CORE_LOCAL bool idleValid = false;
+static CORE_LOCAL bool idleSafe = false;
+static CORE_LOCAL u32 idleTarget = 0;
+static CORE_LOCAL u32 idleRegs[16];
+static CORE_LOCAL bool idleFlags[4];
+static CORE_LOCAL int idleStart = 0;
+
+// Loads, ALU operations and branches that stay inside the loop only
+static bool CPUIdleLoopSafe(u32 target, u32 branch)
+{
+  if(armState) {
+    for(u32 pc = target; pc < branch; pc += 4) {
+      u32 opcode = CPUReadMemoryQuick(pc);
+      if((opcode >> 28) == 0xF || ((opcode >> 12) & 15) == 15)
+        return false;
+      switch((opcode >> 25) & 7) {
+      case 0:
+        if((opcode & 0x0FFFFFF0) == 0x012FFF10) // BX
+          return false;
+        if((opcode & 0x90) == 0x90) {
+          if(opcode & 0x60) {
+            if(!(opcode & 0x00100000)) // STRH
+              return false;
+          } else if(opcode & 0x01000000) // SWP
+            return false;
+          break;
+        }
+        // fall through
+      case 1:
+        if((opcode & 0x01B00000) == 0x01200000) // MSR
+          return false;
+        break;
+      case 3:
+        if(opcode & 0x10) // undefined
+          return false;
+        // fall through
+      case 2:
+        if(!(opcode & 0x00100000)) // STR
+          return false;
+        break;
+      case 4:
+        if(!(opcode & 0x00100000) || (opcode & 0x8000)) // STM, LDM with PC
+          return false;
+        break;
+      case 5:
+      {
+        if(opcode & 0x01000000) // BL
+          return false;
+        int offset = opcode & 0x00FFFFFF;
+        if(offset & 0x00800000)
+          offset |= 0xFF000000;
+        u32 dest = pc + 8 + (offset << 2);
+        if(dest < target || dest > branch)
+          return false;
+        break;
+      }
+      default:
+        return false;
+      }
+    }
+  } else {
+    for(u32 pc = target; pc < branch; pc += 2) {
+      u32 opcode = CPUReadHalfWordQuick(pc);
+      u32 dest;
+      switch(opcode >> 12) {
+      case 0x0: case 0x1: case 0x2: case 0x3: case 0xA:
+        break;
+      case 0x4:
+        if((opcode & 0xFC00) == 0x4400) {
+          if((opcode & 0x0300) == 0x0300) // BX
+            return false;
+          if((opcode & 0x0300) != 0x0100 && (opcode & 0x87) == 0x87) // writes PC
+            return false;
+        }
+        break;
+      case 0x5:
+        if(opcode & 0x0200) {
+          if(!(opcode & 0x0C00)) // STRH
+            return false;
+        } else if(!(opcode & 0x0800)) // STR, STRB
+          return false;
+        break;
+      case 0x6: case 0x7: case 0x8: case 0x9: case 0xC:
+        if(!(opcode & 0x0800)) // stores
+          return false;
+        break;
+      case 0xB:
+        if((opcode & 0xFF00) != 0xB000) // PUSH, POP
+          return false;
+        break;
+      case 0xD:
+        if((opcode & 0x0F00) >= 0x0E00) // undefined, SWI
+          return false;
+        dest = pc + 4 + (((s8)(opcode & 0xFF)) << 1);
+        if(dest < target || dest > branch)
+          return false;
+        break;
+      case 0xE:
+        if(opcode & 0x0800)
+          return false;
+        dest = pc + 4 + ((opcode & 0x400) ? ((opcode & 0x3FF) << 1) | 0xFFFFF800 : (opcode & 0x3FF) << 1);
+        if(dest < target || dest > branch)
+          return false;
+        break;
+      default:
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Called by backward branches to target, returns the ticks to skip
+int CPUIdleLoop(u32 target, u32 branch, int ticks)
+{
+  bool forced = cpuIdleLoop > 0 && (u32)cpuIdleLoop == target;
+  int now = cpuTotalTicks + ticks;
+
+  if(!idleValid || idleTarget != target) {
+    idleValid = true;
+    idleTarget = target;
+    idleSafe = forced || CPUIdleLoopSafe(target, branch);
+  } else if(!idleSafe) {
+    return 0;
+  } else {
+    bool same = forced;
+    if(!same && !cpuVolatileRead && N_FLAG == idleFlags[0] &&
+       Z_FLAG == idleFlags[1] && C_FLAG == idleFlags[2] && V_FLAG == idleFlags[3]) {
+      int i;
+      for(i = 0; i < 16 && reg[i].I == idleRegs[i]; i++);
+      // the code may have been rewritten since it was checked
+      same = i == 16 && (idleSafe = CPUIdleLoopSafe(target, branch));
+    }
+    if(same) {
+      int period = now - idleStart;
+      int skip = 0;
+      if(period > 0 && cpuNextEvent - 1 - now >= period)
+        skip = (cpuNextEvent - 1 - now) / period * period;
+      idleStart = now + skip;
+      cpuVolatileRead = false;
+      return skip;
+    }
+  }
+
+  for(int i = 0; i < 16; i++)
+    idleRegs[i] = reg[i].I;
+  idleFlags[0] = N_FLAG;
+  idleFlags[1] = Z_FLAG;
+  idleFlags[2] = C_FLAG;
+  idleFlags[3] = V_FLAG;
+  idleStart = now;
+  cpuVolatileRead = false;
+  return 0;
+}
+
 void CPULoop(int ticks)
 {
   int clockTicks;
   int timerOverflow = 0;
+  int event;
+  u32 due;
   // variable used by the CPU core
   cpuTotalTicks = 0;
+  eventRebase();
+  idleValid = false;
 #ifdef LINK_EMULATION
   if(linkenable)
     cpuNextEvent = 1;
 #endif
   cpuBreakLoop = false;
-  cpuNextEvent = CPUUpdateTicks();
+  cpuNextEvent = eventNext();
   if(cpuNextEvent > ticks)
     cpuNextEvent = ticks;
 
@@ -3429,7 +3897,7 @@ void CPULoop(int ticks)
     }
 #endif /* FINAL_VERSION */
 
-    if(!holdState && !SWITicks) {
+    if(!holdState && !eventPending(EVENT_SWI)) {
       if(armState) {
         if (!armExecute())
           return;
@@ -3439,7 +3907,7 @@ void CPULoop(int ticks)
       }
       clockTicks = 0;
     } else
-      clockTicks = CPUUpdateTicks();
+      clockTicks = eventNext();
 
     cpuTotalTicks += clockTicks;
 
@@ -3447,41 +3915,43 @@ void CPULoop(int ticks)
     if(cpuTotalTicks >= cpuNextEvent) {
       int remainingTicks = cpuTotalTicks - cpuNextEvent;
 
-      if (SWITicks)
-      {
-        SWITicks-=clockTicks;
-        if (SWITicks<0)
-          SWITicks = 0;
-      }
+      // a BIOS call only counts the ticks the CPU stood still, not the
+      // ones it ran before the call
+      if(eventPending(EVENT_SWI) && cpuTotalTicks > clockTicks)
+        eventRepeat(EVENT_SWI, cpuTotalTicks - clockTicks);
 
       clockTicks = cpuNextEvent;
       cpuTotalTicks = 0;
       cpuDmaHack = false;
+      // memory may change from here on
+      idleValid = false;
 
     updateLoop:
 
-      if (IRQTicks)
-      {
-          IRQTicks -= clockTicks;
-        if (IRQTicks<0)
-          IRQTicks = 0;
+      // timers stand still in stop state
+      if(stopState != timerStopped) {
+        CPUUpdateTimerRegisters();
+        CPUUpdateTimerEvents();
       }
 
-      lcdTicks -= clockTicks;
-
+      eventClock += clockTicks;
+      timerRegistersValid = false;
+      due = 0;
+      while((event = eventPop()) >= 0)
+        due |= 1 << event;
 
-      if(lcdTicks <= 0) {
+      if(due & (1 << EVENT_LCD)) {
         if(DISPSTAT & 1) { // V-BLANK
           // if in V-Blank mode, keep computing...
           if(DISPSTAT & 2) {
-            lcdTicks += 1008;
+            eventRepeat(EVENT_LCD, 1008);
             ++VCOUNT;
             UPDATE_REG(0x06, VCOUNT);
             DISPSTAT &= 0xFFFD;
             UPDATE_REG(0x04, DISPSTAT);
             CPUCompareVCOUNT();
           } else {
-            lcdTicks += 224;
+            eventRepeat(EVENT_LCD, 224);
             DISPSTAT |= 2;
             UPDATE_REG(0x04, DISPSTAT);
             if(DISPSTAT & 16) {
@@ -3507,7 +3977,7 @@ void CPULoop(int ticks)
             ++VCOUNT;
             UPDATE_REG(0x06, VCOUNT);
 
-            lcdTicks += 1008;
+            eventRepeat(EVENT_LCD, 1008);
             DISPSTAT &= 0xFFFD;
             if(VCOUNT == 160) {
               ++count;
@@ -3590,6 +4060,7 @@ void CPULoop(int ticks)
           } else {
             if(frameCount >= framesToSkip)
             {
+              BENCH_BEGIN(BENCH_RENDER);
               (*renderLine)();
               switch(systemColorDepth) {
                 case 16:
@@ -3689,11 +4160,12 @@ void CPULoop(int ticks)
                 }
                 break;
               }
+              BENCH_END(BENCH_RENDER);
             }
             // entering H-Blank
             DISPSTAT |= 2;
             UPDATE_REG(0x04, DISPSTAT);
-            lcdTicks += 224;
+            eventRepeat(EVENT_LCD, 224);
             CPUCheckDMA(2, 0x0f);
             if(DISPSTAT & 16) {
               IF |= 2;
@@ -3706,26 +4178,25 @@ void CPULoop(int ticks)
 	    // we shouldn't be doing sound in stop state, but we loose synchronization
       // if sound is disabled, so in stop state, soundTick will just produce
       // mute sound
-      soundTicks -= clockTicks;
-      if(soundTicks <= 0) {
+      if(due & (1 << EVENT_SOUND)) {
+        BENCH_BEGIN(BENCH_SOUND);
         psoundTickfn();
-        soundTicks += SOUND_CLOCK_TICKS;
-      }
-
-      if(!stopState) {
-        if(timer0On) {
-          timer0Ticks -= clockTicks;
-          if(timer0Ticks <= 0) {
-            timer0Ticks += (0x10000 - timer0Reload) << timer0ClockReload;
-            timerOverflow |= 1;
-            soundTimerOverflow(0);
-            if(TM0CNT & 0x40) {
-              IF |= 0x08;
-              UPDATE_REG(0x202, IF);
-            }
+        BENCH_END(BENCH_SOUND);
+        eventRepeat(EVENT_SOUND, SOUND_CLOCK_TICKS);
+      }
+
+      // only clocked timers have events, the ones counting up follow the
+      // overflows of the timer before them
+      if(due & ((1 << EVENT_TIMER0) | (1 << EVENT_TIMER1) |
+                (1 << EVENT_TIMER2) | (1 << EVENT_TIMER3))) {
+        if(due & (1 << EVENT_TIMER0)) {
+          eventRepeat(EVENT_TIMER0, (0x10000 - timer0Reload) << timer0ClockReload);
+          timerOverflow |= 1;
+          soundTimerOverflow(0);
+          if(TM0CNT & 0x40) {
+            IF |= 0x08;
+            UPDATE_REG(0x202, IF);
           }
-          TM0D = 0xFFFF - (timer0Ticks >> timer0ClockReload);
-          UPDATE_REG(0x100, TM0D);
         }
 
         if(timer1On) {
@@ -3743,19 +4214,14 @@ void CPULoop(int ticks)
               }
               UPDATE_REG(0x104, TM1D);
             }
-          } else {
-            timer1Ticks -= clockTicks;
-            if(timer1Ticks <= 0) {
-              timer1Ticks += (0x10000 - timer1Reload) << timer1ClockReload;
-              timerOverflow |= 2;
-              soundTimerOverflow(1);
-              if(TM1CNT & 0x40) {
-                IF |= 0x10;
-                UPDATE_REG(0x202, IF);
-              }
+          } else if(due & (1 << EVENT_TIMER1)) {
+            eventRepeat(EVENT_TIMER1, (0x10000 - timer1Reload) << timer1ClockReload);
+            timerOverflow |= 2;
+            soundTimerOverflow(1);
+            if(TM1CNT & 0x40) {
+              IF |= 0x10;
+              UPDATE_REG(0x202, IF);
             }
-            TM1D = 0xFFFF - (timer1Ticks >> timer1ClockReload);
-            UPDATE_REG(0x104, TM1D);
           }
         }
 
@@ -3773,18 +4239,13 @@ void CPULoop(int ticks)
               }
               UPDATE_REG(0x108, TM2D);
             }
-          } else {
-            timer2Ticks -= clockTicks;
-            if(timer2Ticks <= 0) {
-              timer2Ticks += (0x10000 - timer2Reload) << timer2ClockReload;
-              timerOverflow |= 4;
-              if(TM2CNT & 0x40) {
-                IF |= 0x20;
-                UPDATE_REG(0x202, IF);
-              }
+          } else if(due & (1 << EVENT_TIMER2)) {
+            eventRepeat(EVENT_TIMER2, (0x10000 - timer2Reload) << timer2ClockReload);
+            timerOverflow |= 4;
+            if(TM2CNT & 0x40) {
+              IF |= 0x20;
+              UPDATE_REG(0x202, IF);
             }
-            TM2D = 0xFFFF - (timer2Ticks >> timer2ClockReload);
-            UPDATE_REG(0x108, TM2D);
           }
         }
 
@@ -3801,17 +4262,12 @@ void CPULoop(int ticks)
               }
               UPDATE_REG(0x10C, TM3D);
             }
-          } else {
-              timer3Ticks -= clockTicks;
-            if(timer3Ticks <= 0) {
-              timer3Ticks += (0x10000 - timer3Reload) << timer3ClockReload;
-              if(TM3CNT & 0x40) {
-                IF |= 0x40;
-                UPDATE_REG(0x202, IF);
-              }
+          } else if(due & (1 << EVENT_TIMER3)) {
+            eventRepeat(EVENT_TIMER3, (0x10000 - timer3Reload) << timer3ClockReload);
+            if(TM3CNT & 0x40) {
+              IF |= 0x40;
+              UPDATE_REG(0x202, IF);
             }
-            TM3D = 0xFFFF - (timer3Ticks >> timer3ClockReload);
-            UPDATE_REG(0x10C, TM3D);
           }
         }
       }
@@ -3821,9 +4277,8 @@ void CPULoop(int ticks)
 
 
 #ifdef PROFILING
-      profilingTicks -= clockTicks;
-      if(profilingTicks <= 0) {
-        profilingTicks += profilingTicksReload;
+      if(due & (1 << EVENT_PROFILING)) {
+        eventRepeat(EVENT_PROFILING, profilingTicksReload);
         if(profilSegment) {
 	  profile_segment *seg = profilSegment;
 	  do {
@@ -3845,16 +4300,20 @@ void CPULoop(int ticks)
 	  if (linkenable)
 		  LinkUpdate(clockTicks);
 #endif
-      cpuNextEvent = CPUUpdateTicks();
-
+      // the DMA holds the bus until its event, the ones due before it are
+      // handled on the way
       if(cpuDmaTicksToUpdate > 0) {
-        if(cpuDmaTicksToUpdate > cpuNextEvent)
-          clockTicks = cpuNextEvent;
-        else
-          clockTicks = cpuDmaTicksToUpdate;
-        cpuDmaTicksToUpdate -= clockTicks;
-        if(cpuDmaTicksToUpdate < 0)
-          cpuDmaTicksToUpdate = 0;
+        eventSchedule(EVENT_DMA, (eventPending(EVENT_DMA) ? eventTime[EVENT_DMA] :
+                                  eventClock) + cpuDmaTicksToUpdate);
+        cpuDmaTicksToUpdate = 0;
+      }
+      cpuNextEvent = eventNext();
+
+      if(eventPending(EVENT_DMA)) {
+        clockTicks = cpuNextEvent;
+        // a BIOS call does not count the ticks the DMA takes either
+        if(eventPending(EVENT_SWI))
+          eventRepeat(EVENT_SWI, clockTicks);
         cpuDmaHack = true;
         goto updateLoop;
       }
@@ -3869,7 +4328,7 @@ void CPULoop(int ticks)
         if(res) {
           if (intState)
           {
-            if (!IRQTicks)
+            if (!eventPending(EVENT_IRQ))
             {
               CPUInterrupt();
               intState = false;
@@ -3883,9 +4342,9 @@ void CPULoop(int ticks)
             if (!holdState)
             {
               intState = true;
-              IRQTicks=7;
-              if (cpuNextEvent> IRQTicks)
-                cpuNextEvent = IRQTicks;
+              eventScheduleIn(EVENT_IRQ, 7);
+              if (cpuNextEvent> 7)
+                cpuNextEvent = 7;
             }
             else
             {
@@ -3898,11 +4357,18 @@ void CPULoop(int ticks)
 
           // Stops the SWI Ticks emulation if an IRQ is executed
           //(to avoid problems with nested IRQ/SWI)
-          if (SWITicks)
-            SWITicks = 0;
+          eventCancel(EVENT_SWI);
         }
       }
 
+      // the interrupt that ends stop state starts the timers again
+      if(stopState != timerStopped) {
+        CPUUpdateTimerEvents();
+        int next = eventNext();
+        if(cpuNextEvent > next)
+          cpuNextEvent = next;
+      }
+
       if(remainingTicks > 0) {
         if(remainingTicks > cpuNextEvent)
           clockTicks = cpuNextEvent;
@@ -3948,6 +4414,10 @@ struct EmulatedSystem GBASystem = {
   CPUReadMemState,
   // emuWriteMemState
   CPUWriteMemState,
+  // emuReadRawState
+  CPUReadRawState,
+  // emuWriteRawState
+  CPUWriteRawState,
   // emuWritePNG
   CPUWritePNGFile,
   // emuWriteBMP
@@ -13,7 +13,8 @@
 #define SAVE_GAME_VERSION_8 8
 #define SAVE_GAME_VERSION_9 9
 #define SAVE_GAME_VERSION_10 10
-#define SAVE_GAME_VERSION  SAVE_GAME_VERSION_10
+#define SAVE_GAME_VERSION_11 11
+#define SAVE_GAME_VERSION  SAVE_GAME_VERSION_11
 
 typedef struct {
   u8 *address;
@@ -51,20 +52,21 @@ typedef union {
 } reg_pair;
 
 #ifndef NO_GBA_MAP
-extern memoryMap map[256];
+extern CORE_LOCAL memoryMap map[256];
 #endif
 
-extern reg_pair reg[45];
-extern u8 biosProtected[4];
+extern CORE_LOCAL reg_pair reg[45];
+extern CORE_LOCAL u8 biosProtected[4];
 
-extern bool N_FLAG;
-extern bool Z_FLAG;
-extern bool C_FLAG;
-extern bool V_FLAG;
-extern bool armIrqEnable;
-extern bool armState;
-extern int armMode;
-extern void (*cpuSaveGameFunc)(u32,u8);
+extern CORE_LOCAL bool N_FLAG;
+extern CORE_LOCAL bool Z_FLAG;
+extern CORE_LOCAL bool C_FLAG;
+extern CORE_LOCAL bool V_FLAG;
+extern CORE_LOCAL bool armIrqEnable;
+extern CORE_LOCAL bool armState;
+extern CORE_LOCAL int armMode;
+extern CORE_LOCAL int cpuIdleLoop;
+extern CORE_LOCAL void (*cpuSaveGameFunc)(u32,u8);
 
 #ifdef BKPT_SUPPORT
 extern u8 freezeWorkRAM[0x40000];
@@ -91,6 +93,8 @@ extern void CPUUpdateRenderBuffers(bool);
 extern bool CPUReadMemState(char *, int);
 extern bool CPUReadState(const char *);
 extern bool CPUWriteMemState(char *, int);
+extern bool CPUReadRawState(const char *, int);
+extern int CPUWriteRawState(char *, int);
 extern bool CPUWriteState(const char *);
 extern int CPULoadRom(const char *);
 extern void doMirroring(bool);
@@ -102,6 +106,9 @@ extern void CPULoop(int);
 extern void CPUCheckDMA(int,int);
 extern bool CPUIsGBAImage(const char *);
 extern bool CPUIsZipFile(const char *);
+extern u8 *CPUHostAddress(u32 address, bool write, u32 &len);
+extern void CPUHostWritten(u8 *host, u32 bytes);
+extern void CPUUpdateMemoryPages();
 #ifdef PROFILING
 #include "prof/prof.h"
 extern void cpuProfil(profile_segment *seg);
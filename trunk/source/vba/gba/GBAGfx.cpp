@@ -1,25 +1,265 @@
+#include <string.h>
+
 #include "../System.h"
+#include "GBAGfx.h"
 
 int coeff[32] = {
   0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
   16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16};
 
-u32 line0[240];
-u32 line1[240];
-u32 line2[240];
-u32 line3[240];
-u32 lineOBJ[240];
-u32 lineOBJWin[240];
-u32 lineMix[240];
-bool gfxInWin0[240];
-bool gfxInWin1[240];
-int lineOBJpixleft[128];
-
-int gfxBG2Changed = 0;
-int gfxBG3Changed = 0;
-
-int gfxBG2X = 0;
-int gfxBG2Y = 0;
-int gfxBG3X = 0;
-int gfxBG3Y = 0;
-int gfxLastVCOUNT = 0;
+CORE_LOCAL u32 line0[240];
+CORE_LOCAL u32 line1[240];
+CORE_LOCAL u32 line2[240];
+CORE_LOCAL u32 line3[240];
+CORE_LOCAL u32 lineOBJ[240];
+CORE_LOCAL u32 lineOBJWin[240];
+CORE_LOCAL u32 lineMix[240];
+CORE_LOCAL bool gfxInWin0[240];
+CORE_LOCAL bool gfxInWin1[240];
+CORE_LOCAL int lineOBJpixleft[128];
+
+CORE_LOCAL int gfxBG2Changed = 0;
+CORE_LOCAL int gfxBG3Changed = 0;
+
+CORE_LOCAL int gfxBG2X = 0;
+CORE_LOCAL int gfxBG2Y = 0;
+CORE_LOCAL int gfxBG3X = 0;
+CORE_LOCAL int gfxBG3Y = 0;
+CORE_LOCAL int gfxLastVCOUNT = 0;
+
+CORE_LOCAL gfxTileRow gfxTileCache[GFX_TILE_CACHE_SIZE];
+CORE_LOCAL u32 gfxTileVersion[0x20000 >> 5];
+CORE_LOCAL u32 gfxPaletteVersion[17];
+
+// Forgets every decoded tile row, for when VRAM or the palette is changed
+// without going through the CPU write functions
+void gfxTileCacheReset()
+{
+  for(int i = 0; i < GFX_TILE_CACHE_SIZE; i++)
+    gfxTileCache[i].key = 0xFFFFFFFF;
+}
+
+#ifdef GFX_SIMD
+int gfxMixMode = GFX_MIX_VECTOR;
+CORE_LOCAL u32 gfxMixMismatches = 0;
+
+// Four pixels for SSE2, eight for AVX2
+typedef u32 gfxVec4 __attribute__((vector_size(16)));
+typedef s32 gfxVec4S __attribute__((vector_size(16)));
+typedef u32 gfxVec8 __attribute__((vector_size(32)));
+typedef s32 gfxVec8S __attribute__((vector_size(32)));
+
+// The helpers are always inlined, so returning vectors does not depend on
+// the AVX calling convention
+#pragma GCC diagnostic ignored "-Wpsabi"
+#define GFX_INLINE static inline __attribute__((always_inline))
+
+template<typename V> GFX_INLINE V gfxVecSplat(u32 value)
+{
+  V v;
+  for(unsigned i = 0; i < sizeof(V) / 4; i++)
+    v[i] = value;
+  return v;
+}
+
+template<typename V> GFX_INLINE V gfxVecSelect(const V &mask, const V &a, const V &b)
+{
+  return (a & mask) | (b & ~mask);
+}
+
+// Lanes where the priority byte of a is lower than the one of b
+template<typename V, typename S> GFX_INLINE V gfxVecAbove(const V &a, const V &b)
+{
+  return (V)((S)(a >> 24) < (S)(b >> 24));
+}
+
+template<typename V> GFX_INLINE bool gfxVecAny(const V &mask)
+{
+  union { V v; u64 q[sizeof(V) / 8]; } u;
+  u64 any = 0;
+  u.v = mask;
+  for(unsigned i = 0; i < sizeof(V) / 8; i++)
+    any |= u.q[i];
+  return any != 0;
+}
+
+// Vector versions of gfxAlphaBlend(), gfxIncreaseBrightness() and
+// gfxDecreaseBrightness(), the packed arithmetic is the same so the
+// results match bit for bit
+template<typename V> GFX_INLINE V gfxVecUnpack(const V &value)
+{
+  V color = value & 0xffff;
+  return ((color << 16) | color) & 0x3E07C1F;
+}
+
+template<typename V> GFX_INLINE V gfxVecAlphaBlend(const V &color1, const V &color2, u32 ca, u32 cb)
+{
+  V color = ((gfxVecUnpack(color1) * ca) + (gfxVecUnpack(color2) * cb)) >> 4;
+
+  if((ca + cb) > 16) {
+    color |= (0 - ((color >> 5) & 1)) & 0x1f;
+    color |= (0 - ((color >> 15) & 1)) & 0x7C00;
+    color |= (0 - ((color >> 26) & 1)) & 0x03E00000;
+  }
+
+  color &= 0x03E07C1F;
+  return (color >> 16) | color;
+}
+
+template<typename V> GFX_INLINE V gfxVecIncreaseBrightness(const V &value, u32 coeff)
+{
+  V color = gfxVecUnpack(value);
+  color = color + (((0x3E07C1F - color) * coeff) >> 4);
+  color &= 0x3E07C1F;
+  return (color >> 16) | color;
+}
+
+template<typename V> GFX_INLINE V gfxVecDecreaseBrightness(const V &value, u32 coeff)
+{
+  V color = gfxVecUnpack(value);
+  color = color - (((color * coeff) >> 4) & 0x3E07C1F);
+  return (color >> 16) | color;
+}
+
+template<typename V, typename S>
+GFX_INLINE void gfxMixKernel(u32 backdrop, int layers, int semiLayers, bool fx)
+{
+  u32 *lines[4] = { line0, line1, line2, line3 };
+  int effect = (BLDMOD >> 6) & 3;
+  u32 ca = coeff[COLEV & 0x1F];
+  u32 cb = coeff[(COLEV >> 8) & 0x1F];
+  u32 cy = coeff[COLY & 0x1F];
+  V first = gfxVecSplat<V>(BLDMOD & 0x3F);
+  V second = gfxVecSplat<V>((BLDMOD >> 8) & 0x3F);
+  V none = gfxVecSplat<V>(0);
+
+  for(int x = 0; x < 240; x += sizeof(V) / 4) {
+    V bg[4];
+    V obj;
+    V color = gfxVecSplat<V>(backdrop);
+    V top = gfxVecSplat<V>(0x20);
+
+    // the first layer with the lowest priority byte wins
+    for(int i = 0; i < 4; i++) {
+      if(layers & (1 << i)) {
+        __builtin_memcpy(&bg[i], &lines[i][x], sizeof(V));
+        V m = gfxVecAbove<V, S>(bg[i], color);
+        color = gfxVecSelect(m, bg[i], color);
+        top = gfxVecSelect(m, gfxVecSplat<V>(1 << i), top);
+      }
+    }
+    __builtin_memcpy(&obj, &lineOBJ[x], sizeof(V));
+    V m = gfxVecAbove<V, S>(obj, color);
+    color = gfxVecSelect(m, obj, color);
+    top = gfxVecSelect(m, gfxVecSplat<V>(0x10), top);
+
+    V semi = (V)((color & 0x00010000) != 0);
+    V blend = none;
+    V bright = none;
+
+    if((fx && effect == 1) || gfxVecAny(semi)) {
+      // the layer below, semi-transparent sprites only look at semiLayers
+      V back = gfxVecSplat<V>(backdrop);
+      V top2 = gfxVecSplat<V>(0x20);
+      for(int i = 0; i < 4; i++) {
+        if(layers & (1 << i)) {
+          m = (V)(top != (1 << i)) & gfxVecAbove<V, S>(bg[i], back);
+          if(!(semiLayers & (1 << i)))
+            m &= ~semi;
+          back = gfxVecSelect(m, bg[i], back);
+          top2 = gfxVecSelect(m, gfxVecSplat<V>(1 << i), top2);
+        }
+      }
+      m = (V)(top != 0x10) & gfxVecAbove<V, S>(obj, back);
+      back = gfxVecSelect(m, obj, back);
+      top2 = gfxVecSelect(m, gfxVecSplat<V>(0x10), top2);
+
+      V isSecond = (V)((top2 & second) != 0);
+      blend = semi & isSecond;
+      if(fx && effect == 1)
+        blend |= ~semi & (V)((top & first) != 0) & isSecond;
+      bright = semi & ~isSecond;
+
+      if(gfxVecAny(blend))
+        color = gfxVecSelect(blend, gfxVecAlphaBlend(color, back, ca, cb), color);
+    }
+
+    if(effect >= 2) {
+      if(fx)
+        bright |= ~semi;
+      bright &= (V)((top & first) != 0);
+      if(gfxVecAny(bright)) {
+        if(effect == 2)
+          color = gfxVecSelect(bright, gfxVecIncreaseBrightness(color, cy), color);
+        else
+          color = gfxVecSelect(bright, gfxVecDecreaseBrightness(color, cy), color);
+      }
+    }
+
+    __builtin_memcpy(&lineMix[x], &color, sizeof(V));
+  }
+}
+
+static void gfxMixLine4(u32 backdrop, int layers, int semiLayers, bool fx)
+{
+  gfxMixKernel<gfxVec4, gfxVec4S>(backdrop, layers, semiLayers, fx);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static void gfxMixLine8(u32 backdrop, int layers, int semiLayers, bool fx)
+{
+  gfxMixKernel<gfxVec8, gfxVec8S>(backdrop, layers, semiLayers, fx);
+}
+#endif
+
+static void (*gfxMixVector)(u32, int, int, bool) = NULL;
+
+static void gfxMixSelect()
+{
+  gfxMixVector = gfxMixLine4;
+#if defined(__x86_64__) || defined(__i386__)
+  if(__builtin_cpu_supports("avx2"))
+    gfxMixVector = gfxMixLine8;
+#endif
+}
+
+const char *gfxMixName()
+{
+  if(!gfxMixVector)
+    gfxMixSelect();
+#if defined(__x86_64__) || defined(__i386__)
+  if(gfxMixVector == gfxMixLine8)
+    return "avx2";
+  return "sse2";
+#else
+  return "generic";
+#endif
+}
+
+void gfxMixLine(void (*scalar)(u32), u32 backdrop, int layers,
+                int semiLayers, bool fx)
+{
+  if(!gfxMixVector)
+    gfxMixSelect();
+
+  switch(gfxMixMode) {
+  case GFX_MIX_SCALAR:
+    scalar(backdrop);
+    break;
+  case GFX_MIX_VECTOR:
+    gfxMixVector(backdrop, layers, semiLayers, fx);
+    break;
+  default:
+    {
+      u32 vector[240];
+      gfxMixVector(backdrop, layers, semiLayers, fx);
+      memcpy(vector, lineMix, sizeof(vector));
+      scalar(backdrop);
+      if(memcmp(vector, lineMix, sizeof(vector)))
+        gfxMixMismatches++;
+    }
+    break;
+  }
+}
+#endif
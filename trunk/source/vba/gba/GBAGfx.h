@@ -71,25 +71,64 @@ void mode5RenderLineNoWindow();
 void mode5RenderLineAll();
 
 extern int coeff[32];
-extern u32 line0[240];
-extern u32 line1[240];
-extern u32 line2[240];
-extern u32 line3[240];
-extern u32 lineOBJ[240];
-extern u32 lineOBJWin[240];
-extern u32 lineMix[240];
-extern bool gfxInWin0[240];
-extern bool gfxInWin1[240];
-extern int lineOBJpixleft[128];
-
-extern int gfxBG2Changed;
-extern int gfxBG3Changed;
-
-extern int gfxBG2X;
-extern int gfxBG2Y;
-extern int gfxBG3X;
-extern int gfxBG3Y;
-extern int gfxLastVCOUNT;
+extern CORE_LOCAL u32 line0[240];
+extern CORE_LOCAL u32 line1[240];
+extern CORE_LOCAL u32 line2[240];
+extern CORE_LOCAL u32 line3[240];
+extern CORE_LOCAL u32 lineOBJ[240];
+extern CORE_LOCAL u32 lineOBJWin[240];
+extern CORE_LOCAL u32 lineMix[240];
+extern CORE_LOCAL bool gfxInWin0[240];
+extern CORE_LOCAL bool gfxInWin1[240];
+extern CORE_LOCAL int lineOBJpixleft[128];
+
+extern CORE_LOCAL int gfxBG2Changed;
+extern CORE_LOCAL int gfxBG3Changed;
+
+extern CORE_LOCAL int gfxBG2X;
+extern CORE_LOCAL int gfxBG2Y;
+extern CORE_LOCAL int gfxBG3X;
+extern CORE_LOCAL int gfxBG3Y;
+extern CORE_LOCAL int gfxLastVCOUNT;
+
+// Decoded tile rows for the text backgrounds, the colour of each of the 8
+// pixels or 0x80000000 when transparent. An entry is valid while the
+// versions of its VRAM block and palette bank are unchanged, see
+// gfxVramWritten() and gfxPaletteWritten() in GBAinline.h.
+#define GFX_TILE_CACHE_SIZE 4096
+
+struct gfxTileRow {
+  u32 key;
+  u32 tileVersion;
+  u32 paletteVersion;
+  u32 pixels[8];
+};
+
+extern CORE_LOCAL gfxTileRow gfxTileCache[GFX_TILE_CACHE_SIZE];
+extern CORE_LOCAL u32 gfxTileVersion[0x20000 >> 5];
+extern CORE_LOCAL u32 gfxPaletteVersion[17];
+extern void gfxTileCacheReset();
+
+// Compositing of the layer lines into lineMix. Each mode passes its scalar
+// loop together with the masks of the BG lines (1 = line0 ... 8 = line3) in
+// the priority search and under semi-transparent sprites, fx is set when
+// the BLDMOD colour effect applies to every pixel. With GFX_SIMD the line
+// is composited four (SSE2) or eight (AVX2) pixels at a time instead,
+// GFX_MIX_CHECK runs both and counts the lines on which they differ.
+#ifdef GFX_SIMD
+enum { GFX_MIX_SCALAR, GFX_MIX_VECTOR, GFX_MIX_CHECK };
+extern int gfxMixMode;
+extern CORE_LOCAL u32 gfxMixMismatches;
+extern const char *gfxMixName();
+extern void gfxMixLine(void (*scalar)(u32), u32 backdrop, int layers,
+                       int semiLayers, bool fx);
+
+#define GFX_MIX_LINE(scalar, backdrop, layers, semiLayers, fx) \
+  gfxMixLine(scalar, backdrop, layers, semiLayers, fx)
+#else
+#define GFX_MIX_LINE(scalar, backdrop, layers, semiLayers, fx) \
+  scalar(backdrop)
+#endif
 
 static inline void gfxClearArray(u32 *array)
 {
@@ -98,11 +137,42 @@ static inline void gfxClearArray(u32 *array)
   }
 }
 
+// Returns the decoded pixels of the tile row at VRAM offset, bank is the
+// 16 colour palette bank or -1 for 256 colour tiles
+static inline const u32 *gfxTileRowPixels(u32 offset, int bank)
+{
+  u32 key = offset | ((bank & 0x1F) << 17);
+  gfxTileRow *row = &gfxTileCache[(key * 2654435761U) >> 20];
+  u32 tileVersion = gfxTileVersion[offset >> 5];
+  u32 paletteVersion = gfxPaletteVersion[bank < 0 ? 16 : bank];
+
+  if(row->key != key || row->tileVersion != tileVersion ||
+     row->paletteVersion != paletteVersion) {
+    u16 *palette = (u16 *)paletteRAM;
+    if(bank < 0) {
+      for(int i = 0; i < 8; i++) {
+        u8 color = vram[offset + i];
+        row->pixels[i] = color ? READ16LE(&palette[color]) : 0x80000000;
+      }
+    } else {
+      palette += bank << 4;
+      for(int i = 0; i < 8; i++) {
+        u8 color = vram[offset + (i >> 1)];
+        color = (i & 1) ? (color >> 4) : (color & 0x0F);
+        row->pixels[i] = color ? READ16LE(&palette[color]) : 0x80000000;
+      }
+    }
+    row->key = key;
+    row->tileVersion = tileVersion;
+    row->paletteVersion = paletteVersion;
+  }
+  return row->pixels;
+}
+
 static inline void gfxDrawTextScreen(u16 control, u16 hofs, u16 vofs,
 				     u32 *line)
 {
-  u16 *palette = (u16 *)paletteRAM;
-  u8 *charBase = &vram[((control >> 2) & 0x03) * 0x4000];
+  u32 charBase = ((control >> 2) & 0x03) * 0x4000;
   u16 *screenBase = (u16 *)&vram[((control >> 8) & 0x1f) * 0x800];
   u32 prio = ((control & 3)<<25) + 0x1000000;
   int sizeX = 256;
@@ -147,83 +217,57 @@ static inline void gfxDrawTextScreen(u16 control, u16 hofs, u16 vofs,
   }
 
   int yshift = ((yyy>>3)<<5);
-  if((control) & 0x80) {
-    u16 *screenSource = screenBase + 0x400 * (xxx>>8) + ((xxx & 255)>>3) + yshift;
-    for(int x = 0; x < 240; x++) {
-      u16 data = READ16LE(screenSource);
-
-      int tile = data & 0x3FF;
-      int tileX = (xxx & 7);
-      int tileY = yyy & 7;
-
-      if(tileX == 7)
-        screenSource++;
-
-      if(data & 0x0400)
-        tileX = 7 - tileX;
-      if(data & 0x0800)
-        tileY = 7 - tileY;
-
-      u8 color = charBase[tile * 64 + tileY * 8 + tileX];
-
-      line[x] = color ? (READ16LE(&palette[color]) | prio): 0x80000000;
-
-      xxx++;
-      if(xxx == 256) {
-        if(sizeX > 256)
-          screenSource = screenBase + 0x400 + yshift;
-        else {
-          screenSource = screenBase + yshift;
-          xxx = 0;
-        }
-      } else if(xxx >= sizeX) {
-        xxx = 0;
-        screenSource = screenBase + yshift;
+  u16 *screenSource = screenBase + 0x400 * (xxx>>8) + ((xxx & 255)>>3) + yshift;
+  int x = 0;
+
+  // one tile (or what is left of it on either edge) per iteration
+  while(x < 240) {
+    u16 data = READ16LE(screenSource);
+
+    int tile = data & 0x3FF;
+    int tileX = (xxx & 7);
+    int tileY = yyy & 7;
+
+    if(data & 0x0800)
+      tileY = 7 - tileY;
+
+    const u32 *pixels;
+    if((control) & 0x80)
+      pixels = gfxTileRowPixels(charBase + tile * 64 + tileY * 8, -1);
+    else
+      pixels = gfxTileRowPixels(charBase + (tile<<5) + (tileY<<2), data >> 12);
+
+    int count = 8 - tileX;
+    if(count > 240 - x)
+      count = 240 - x;
+
+    if(data & 0x0400) {
+      for(int i = 7 - tileX; i > 7 - tileX - count; i--) {
+        u32 color = pixels[i];
+        line[x++] = color | (prio & ~((s32)color >> 31));
       }
-    }
-  } else {
-    u16 *screenSource = screenBase + 0x400*(xxx>>8)+((xxx&255)>>3) +
-      yshift;
-    for(int x = 0; x < 240; x++) {
-      u16 data = READ16LE(screenSource);
-
-      int tile = data & 0x3FF;
-      int tileX = (xxx & 7);
-      int tileY = yyy & 7;
-
-      if(tileX == 7)
-        screenSource++;
-
-      if(data & 0x0400)
-        tileX = 7 - tileX;
-      if(data & 0x0800)
-        tileY = 7 - tileY;
-
-      u8 color = charBase[(tile<<5) + (tileY<<2) + (tileX>>1)];
-
-      if(tileX & 1) {
-        color = (color >> 4);
-      } else {
-        color &= 0x0F;
+    } else {
+      for(int i = tileX; i < tileX + count; i++) {
+        u32 color = pixels[i];
+        line[x++] = color | (prio & ~((s32)color >> 31));
       }
+    }
 
-      int pal = (data>>8) & 0xF0;
-      line[x] = color ? (READ16LE(&palette[pal + color])|prio): 0x80000000;
-
-      xxx++;
-      if(xxx == 256) {
-        if(sizeX > 256)
-          screenSource = screenBase + 0x400 + yshift;
-        else {
-          screenSource = screenBase + yshift;
-          xxx = 0;
-        }
-      } else if(xxx >= sizeX) {
-        xxx = 0;
+    screenSource++;
+    xxx += count;
+    if(xxx == 256) {
+      if(sizeX > 256)
+        screenSource = screenBase + 0x400 + yshift;
+      else {
         screenSource = screenBase + yshift;
+        xxx = 0;
       }
+    } else if(xxx >= sizeX) {
+      xxx = 0;
+      screenSource = screenBase + yshift;
     }
   }
+
   if(mosaicOn) {
     if(mosaicX > 1) {
       int m = 1;
@@ -4,6 +4,15 @@
 extern int armExecute();
 extern int thumbExecute();
 
+#ifdef THUMB_JIT
+enum { THUMB_INTERPRET, THUMB_RECOMPILE, THUMB_LOCKSTEP };
+extern int thumbJitMode;
+extern u32 thumbJitBlocks;
+extern u32 thumbJitChecked;
+extern u32 thumbJitMismatches;
+extern void thumbJitReset();
+#endif
+
 #ifdef __GNUC__
 # define INSN_REGPARM /*nothing*/
   //# define INSN_REGPARM __attribute__((regparm(1)))
@@ -39,21 +48,20 @@ extern int thumbExecute();
   cpuPrefetch[1] = CPUReadHalfWordQuick(armNextPC+2);
 
 
-extern int SWITicks;
-extern u32 mastercode;
-extern bool busPrefetch;
-extern bool busPrefetchEnable;
-extern u32 busPrefetchCount;
-extern int cpuNextEvent;
-extern bool holdState;
-extern u32 cpuPrefetch[2];
-extern int cpuTotalTicks;
-extern u8 memoryWait[16];
-extern u8 memoryWait32[16];
-extern u8 memoryWaitSeq[16];
-extern u8 memoryWaitSeq32[16];
-extern u8 cpuBitsSet[256];
-extern u8 cpuLowestBitSet[256];
+extern CORE_LOCAL u32 mastercode;
+extern CORE_LOCAL bool busPrefetch;
+extern CORE_LOCAL bool busPrefetchEnable;
+extern CORE_LOCAL u32 busPrefetchCount;
+extern CORE_LOCAL int cpuNextEvent;
+extern CORE_LOCAL bool holdState;
+extern CORE_LOCAL u32 cpuPrefetch[2];
+extern CORE_LOCAL int cpuTotalTicks;
+extern CORE_LOCAL u8 memoryWait[16];
+extern CORE_LOCAL u8 memoryWait32[16];
+extern CORE_LOCAL u8 memoryWaitSeq[16];
+extern CORE_LOCAL u8 memoryWaitSeq32[16];
+extern CORE_LOCAL u8 cpuBitsSet[256];
+extern CORE_LOCAL u8 cpuLowestBitSet[256];
 extern void CPUSwitchMode(int mode, bool saveState, bool breakLoop);
 extern void CPUSwitchMode(int mode, bool saveState);
 extern void CPUUpdateCPSR();
@@ -62,6 +70,17 @@ extern void CPUUpdateFlags();
 extern void CPUUndefinedException();
 extern void CPUSoftwareInterrupt();
 extern void CPUSoftwareInterrupt(int comment);
+extern int CPUIdleLoop(u32 target, u32 branch, int ticks);
+
+// A taken branch at most IDLE_LOOP_BYTES backwards may close a busy-wait
+// loop, CPUIdleLoop() returns the ticks of the iterations it can skip.
+#define IDLE_LOOP_BYTES 40
+
+#define CPU_IDLE_LOOP(offset, branch) \
+  {\
+    if (UNLIKELY((offset) < 0) && (offset) >= -IDLE_LOOP_BYTES && cpuIdleLoop != -1)\
+      clockTicks += CPUIdleLoop(armNextPC, (branch), clockTicks);\
+  }
 
 
 // Waitstates when accessing data
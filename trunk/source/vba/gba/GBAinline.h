@@ -6,34 +6,73 @@
 #include "RTC.h"
 #include "Sound.h"
 #include "agbprint.h"
+#include "Scheduler.h"
 #include "vmmem.h" // Nintendo GC Virtual Memory
 
 extern const u32 objTilesAddress[3];
 
-extern bool stopState;
-extern bool holdState;
-extern int holdType;
-extern int cpuNextEvent;
-extern bool cpuSramEnabled;
-extern bool cpuFlashEnabled;
-extern bool cpuEEPROMEnabled;
-extern bool cpuEEPROMSensorEnabled;
-extern bool cpuDmaHack;
-extern u32 cpuDmaLast;
-extern bool timer0On;
-extern int timer0Ticks;
-extern int timer0ClockReload;
-extern bool timer1On;
-extern int timer1Ticks;
-extern int timer1ClockReload;
-extern bool timer2On;
-extern int timer2Ticks;
-extern int timer2ClockReload;
-extern bool timer3On;
-extern int timer3Ticks;
-extern int timer3ClockReload;
-extern int cpuTotalTicks;
-extern u32 RomIdCode;
+extern CORE_LOCAL bool stopState;
+extern CORE_LOCAL bool holdState;
+extern CORE_LOCAL int holdType;
+extern CORE_LOCAL int cpuNextEvent;
+extern CORE_LOCAL bool cpuSramEnabled;
+extern CORE_LOCAL bool cpuFlashEnabled;
+extern CORE_LOCAL bool cpuEEPROMEnabled;
+extern CORE_LOCAL bool cpuEEPROMSensorEnabled;
+extern CORE_LOCAL bool cpuDmaHack;
+extern CORE_LOCAL bool cpuVolatileRead;
+extern CORE_LOCAL u32 cpuDmaLast;
+extern CORE_LOCAL bool timer0On;
+extern CORE_LOCAL int timer0Ticks;
+extern CORE_LOCAL int timer0ClockReload;
+extern CORE_LOCAL bool timer1On;
+extern CORE_LOCAL int timer1Ticks;
+extern CORE_LOCAL int timer1ClockReload;
+extern CORE_LOCAL bool timer2On;
+extern CORE_LOCAL int timer2Ticks;
+extern CORE_LOCAL int timer2ClockReload;
+extern CORE_LOCAL bool timer3On;
+extern CORE_LOCAL int timer3Ticks;
+extern CORE_LOCAL int timer3ClockReload;
+extern CORE_LOCAL int cpuTotalTicks;
+extern void CPUUpdateTimerRegisters();
+extern CORE_LOCAL u32 RomIdCode;
+extern CORE_LOCAL u32 gfxTileVersion[0x20000 >> 5];
+extern CORE_LOCAL u32 gfxPaletteVersion[17];
+extern void gfxTileCacheReset();
+
+// Host memory behind each page of the bus that is plain memory, NULL where
+// the decode below has to run: BIOS, I/O, palette, OAM, the VRAM page with
+// the bitmap mode hole, the clock port, the save chips and open bus. Only
+// WRAM and IWRAM are written through it, writes elsewhere have side effects.
+#define MEMORY_PAGE_SHIFT 15
+#define MEMORY_PAGE_MASK ((1 << MEMORY_PAGE_SHIFT) - 1)
+#define MEMORY_PAGES (0x10000000 >> MEMORY_PAGE_SHIFT)
+extern CORE_LOCAL u8 *memoryReadPages[MEMORY_PAGES];
+extern CORE_LOCAL u8 *memoryWritePages[MEMORY_PAGES];
+
+#define CPUMemoryPage(pages, address) \
+  (pages)[((address) >> MEMORY_PAGE_SHIFT) & (MEMORY_PAGES - 1)]
+
+#ifdef THUMB_JIT
+// The lockstep mode of the Thumb recompiler takes the stores of a block back
+// before it replays the block. It leaves memoryWritePages empty, so that
+// every store reaches the decode below and is logged there.
+extern bool thumbJitLogging;
+extern void thumbJitLog(u32 address);
+#define CPU_WRITE_LOG(address) \
+  if(thumbJitLogging) \
+    thumbJitLog(address)
+#else
+#define CPU_WRITE_LOG(address)
+#endif
+
+// Ticks to a timer's next overflow as of the last events, timerTicks keeps
+// them while the CPU does not clock the timer
+inline int CPUTimerTicks(int event, int timerTicks)
+{
+  return eventPending(event) ? eventTicks(event) : timerTicks;
+}
 
 #define gid(a,b,c) (a|(b<<8)|(c<<16))
 #define CORVETTE		gid('A','V','C')
@@ -110,7 +149,7 @@ u32 inline CPUReadMemoryQuick( u32 addr )
  * End of VM override
  ****************************************************************************/
 
-static inline u32 CPUReadMemory(u32 address)
+static inline u32 CPUReadMemoryDecode(u32 address)
 {
 #ifdef GBA_LOGGING
   if(address & 3) {
@@ -147,6 +186,8 @@ static inline u32 CPUReadMemory(u32 address)
     break;
   case 0x04:
     if((address < 0x4000400) && ioReadable[address & 0x3fc]) {
+      if((address & 0x3f0) == 0x100)
+        CPUUpdateTimerRegisters();
       if(ioReadable[(address & 0x3fc) + 2])
         value = READ32LE(((u32 *)&ioMem[address & 0x3fC]));
       else
@@ -183,11 +224,13 @@ static inline u32 CPUReadMemory(u32 address)
 #endif
     break;
   case 0x0D:
+    cpuVolatileRead = true;
     if(cpuEEPROMEnabled)
       // no need to swap this
       return eepromRead(address);
     goto unreadable;
   case 0x0E:
+    cpuVolatileRead = true;
 	// Yoshi's Universal Gravitation (Topsy Turvy)
 	// Koro Koro
     if(cpuEEPROMSensorEnabled) {
@@ -260,9 +303,17 @@ static inline u32 CPUReadMemory(u32 address)
   return value;
 }
 
+static inline u32 CPUReadMemory(u32 address)
+{
+  u8 *page = CPUMemoryPage(memoryReadPages, address);
+  if(page && !(address & 0xF0000003))
+    return READ32LE(((u32 *)&page[address & MEMORY_PAGE_MASK]));
+  return CPUReadMemoryDecode(address);
+}
+
 extern u32 myROM[];
 
-static inline u32 CPUReadHalfWord(u32 address)
+static inline u32 CPUReadHalfWordDecode(u32 address)
 {
 #ifdef GBA_LOGGING
   if(address & 1) {
@@ -302,17 +353,18 @@ static inline u32 CPUReadHalfWord(u32 address)
       value =  READ16LE(((u16 *)&ioMem[address & 0x3fe]));
       if (((address & 0x3fe)>0xFF) && ((address & 0x3fe)<0x10E))
       {
+        cpuVolatileRead = true;
         if (((address & 0x3fe) == 0x100) && timer0On)
-          value = 0xFFFF - ((timer0Ticks-cpuTotalTicks) >> timer0ClockReload);
+          value = 0xFFFF - ((CPUTimerTicks(EVENT_TIMER0, timer0Ticks)-cpuTotalTicks) >> timer0ClockReload);
         else
         if (((address & 0x3fe) == 0x104) && timer1On && !(TM1CNT & 4))
-          value = 0xFFFF - ((timer1Ticks-cpuTotalTicks) >> timer1ClockReload);
+          value = 0xFFFF - ((CPUTimerTicks(EVENT_TIMER1, timer1Ticks)-cpuTotalTicks) >> timer1ClockReload);
         else
         if (((address & 0x3fe) == 0x108) && timer2On && !(TM2CNT & 4))
-          value = 0xFFFF - ((timer2Ticks-cpuTotalTicks) >> timer2ClockReload);
+          value = 0xFFFF - ((CPUTimerTicks(EVENT_TIMER2, timer2Ticks)-cpuTotalTicks) >> timer2ClockReload);
         else
         if (((address & 0x3fe) == 0x10C) && timer3On && !(TM3CNT & 4))
-          value = 0xFFFF - ((timer3Ticks-cpuTotalTicks) >> timer3ClockReload);
+          value = 0xFFFF - ((CPUTimerTicks(EVENT_TIMER3, timer3Ticks)-cpuTotalTicks) >> timer3ClockReload);
       }
     }
     else goto unreadable;
@@ -341,6 +393,7 @@ static inline u32 CPUReadHalfWord(u32 address)
     if(address >= 0x80000c4 && address <= 0x80000c8) {
 	  // this function still works if there is no real time clock
 	  // and does a normal memory read in that case.
+      cpuVolatileRead = true;
       value = rtcRead(address & 0xFFFFFFE);
 	  break;
 	}
@@ -355,11 +408,13 @@ static inline u32 CPUReadHalfWord(u32 address)
 #endif
     break;
   case 0x0D:
+    cpuVolatileRead = true;
     if(cpuEEPROMEnabled)
       // no need to swap this
       return  eepromRead(address);
     goto unreadable;
   case 0x0E:
+    cpuVolatileRead = true;
 	// Yoshi's Universal Gravitation (Topsy Turvy)
 	// Koro Koro
     if(cpuEEPROMSensorEnabled) {
@@ -413,6 +468,14 @@ static inline u32 CPUReadHalfWord(u32 address)
   return value;
 }
 
+static inline u32 CPUReadHalfWord(u32 address)
+{
+  u8 *page = CPUMemoryPage(memoryReadPages, address);
+  if(page && !(address & 0xF0000001))
+    return READ16LE(((u16 *)&page[address & MEMORY_PAGE_MASK]));
+  return CPUReadHalfWordDecode(address);
+}
+
 static inline u16 CPUReadHalfWordSigned(u32 address)
 {
   u16 value = CPUReadHalfWord(address);
@@ -421,7 +484,7 @@ static inline u16 CPUReadHalfWordSigned(u32 address)
   return value;
 }
 
-static inline u8 CPUReadByte(u32 address)
+static inline u8 CPUReadByteDecode(u32 address)
 {
   switch(address >> 24) {
   case 0x00:
@@ -442,8 +505,11 @@ static inline u8 CPUReadByte(u32 address)
   case 0x03:
     return internalRAM[address & 0x7fff];
   case 0x04:
-    if((address < 0x4000400) && ioReadable[address & 0x3ff])
+    if((address < 0x4000400) && ioReadable[address & 0x3ff]) {
+      if((address & 0x3f0) == 0x100)
+        CPUUpdateTimerRegisters();
       return ioMem[address & 0x3ff];
+    }
     else goto unreadable;
   case 0x05:
     return paletteRAM[address & 0x3ff];
@@ -468,10 +534,12 @@ static inline u8 CPUReadByte(u32 address)
     return rom[address & 0x1FFFFFF];
 #endif
   case 0x0D:
+    cpuVolatileRead = true;
     if(cpuEEPROMEnabled)
       return eepromRead(address);
     goto unreadable;
   case 0x0E:
+    cpuVolatileRead = true;
 	// Yoshi's Universal Gravitation (Topsy Turvy)
 	// Koro Koro
     if(cpuEEPROMSensorEnabled) {
@@ -518,8 +586,31 @@ static inline u8 CPUReadByte(u32 address)
   }
 }
 
-static inline void CPUWriteMemory(u32 address, u32 value)
+static inline u8 CPUReadByte(u32 address)
+{
+  u8 *page = CPUMemoryPage(memoryReadPages, address);
+  if(page && !(address & 0xF0000000))
+    return page[address & MEMORY_PAGE_MASK];
+  return CPUReadByteDecode(address);
+}
+
+// Invalidate the decoded tile rows of the text background renderer
+static inline void gfxVramWritten(u32 address)
+{
+  gfxTileVersion[address >> 5]++;
+}
+
+static inline void gfxPaletteWritten(u32 address)
 {
+  if((address & 0x3FF) < 0x200) {
+    gfxPaletteVersion[(address >> 5) & 15]++;
+    gfxPaletteVersion[16]++;
+  }
+}
+
+static inline void CPUWriteMemoryDecode(u32 address, u32 value)
+{
+  CPU_WRITE_LOG(address);
 
 #ifdef GBA_LOGGING
   if(address & 3) {
@@ -558,6 +649,7 @@ static inline void CPUWriteMemory(u32 address, u32 value)
     } else goto unwritable;
     break;
   case 0x05:
+    gfxPaletteWritten(address);
 #ifdef BKPT_SUPPORT
     if(*((u32 *)&freezePRAM[address & 0x3fc]))
       cheatsWriteMemory(address & 0x70003FC,
@@ -574,6 +666,8 @@ static inline void CPUWriteMemory(u32 address, u32 value)
     if ((address & 0x18000) == 0x18000)
       address &= 0x17fff;
 
+    gfxVramWritten(address);
+
 #ifdef BKPT_SUPPORT
     if(*((u32 *)&freezeVRAM[address]))
       cheatsWriteMemory(address + 0x06000000, value);
@@ -617,8 +711,22 @@ static inline void CPUWriteMemory(u32 address, u32 value)
   }
 }
 
-static inline void CPUWriteHalfWord(u32 address, u16 value)
+// The cheat freezes of BKPT_SUPPORT builds are checked in the decode
+static inline void CPUWriteMemory(u32 address, u32 value)
 {
+#ifndef BKPT_SUPPORT
+  u8 *page = CPUMemoryPage(memoryWritePages, address);
+  if(page && !(address & 0xF0000003)) {
+    WRITE32LE(((u32 *)&page[address & MEMORY_PAGE_MASK]), value);
+    return;
+  }
+#endif
+  CPUWriteMemoryDecode(address, value);
+}
+
+static inline void CPUWriteHalfWordDecode(u32 address, u16 value)
+{
+  CPU_WRITE_LOG(address);
 #ifdef GBA_LOGGING
   if(address & 1) {
     if(systemVerbose & VERBOSE_UNALIGNED_MEMORY) {
@@ -655,6 +763,7 @@ static inline void CPUWriteHalfWord(u32 address, u16 value)
     else goto unwritable;
     break;
   case 5:
+    gfxPaletteWritten(address);
 #ifdef BKPT_SUPPORT
     if(*((u16 *)&freezePRAM[address & 0x03fe]))
       cheatsWriteHalfWord(address & 0x70003fe,
@@ -670,6 +779,7 @@ static inline void CPUWriteHalfWord(u32 address, u16 value)
         return;
     if ((address & 0x18000) == 0x18000)
       address &= 0x17fff;
+    gfxVramWritten(address);
 #ifdef BKPT_SUPPORT
     if(*((u16 *)&freezeVRAM[address]))
       cheatsWriteHalfWord(address + 0x06000000,
@@ -720,8 +830,21 @@ static inline void CPUWriteHalfWord(u32 address, u16 value)
   }
 }
 
-static inline void CPUWriteByte(u32 address, u8 b)
+static inline void CPUWriteHalfWord(u32 address, u16 value)
+{
+#ifndef BKPT_SUPPORT
+  u8 *page = CPUMemoryPage(memoryWritePages, address);
+  if(page && !(address & 0xF0000001)) {
+    WRITE16LE(((u16 *)&page[address & MEMORY_PAGE_MASK]), value);
+    return;
+  }
+#endif
+  CPUWriteHalfWordDecode(address, value);
+}
+
+static inline void CPUWriteByteDecode(u32 address, u8 b)
 {
+  CPU_WRITE_LOG(address);
   switch(address >> 24) {
   case 2:
 #ifdef BKPT_SUPPORT
@@ -793,6 +916,8 @@ static inline void CPUWriteByte(u32 address, u8 b)
         break;
       default: // every other register
         u32 lowerBits = address & 0x3fe;
+        if((lowerBits & 0x3f0) == 0x100)
+          CPUUpdateTimerRegisters();
         if(address & 1) {
           CPUUpdateRegister(lowerBits, (READ16LE(&ioMem[lowerBits]) & 0x00FF) | (b << 8));
         } else {
@@ -803,6 +928,7 @@ static inline void CPUWriteByte(u32 address, u8 b)
     } else goto unwritable;
     break;
   case 5:
+    gfxPaletteWritten(address);
     // no need to switch
     *((u16 *)&paletteRAM[address & 0x3FE]) = (b << 8) | b;
     break;
@@ -817,6 +943,7 @@ static inline void CPUWriteByte(u32 address, u8 b)
     // byte writes to OBJ VRAM are ignored
     if ((address) < objTilesAddress[((DISPCNT&7)+1)>>2])
     {
+      gfxVramWritten(address);
 #ifdef BKPT_SUPPORT
       if(freezeVRAM[address])
         cheatsWriteByte(address + 0x06000000, b);
@@ -859,4 +986,16 @@ unwritable:
   }
 }
 
+static inline void CPUWriteByte(u32 address, u8 b)
+{
+#ifndef BKPT_SUPPORT
+  u8 *page = CPUMemoryPage(memoryWritePages, address);
+  if(page && !(address & 0xF0000000)) {
+    page[address & MEMORY_PAGE_MASK] = b;
+    return;
+  }
+#endif
+  CPUWriteByteDecode(address, b);
+}
+
 #endif // GBAINLINE_H
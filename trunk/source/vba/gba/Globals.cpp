@@ -5,125 +5,125 @@ int  oldreg[18];
 char oldbuffer[10];
 #endif
 
-reg_pair reg[45];
-memoryMap map[256];
-bool ioReadable[0x400];
-bool N_FLAG = 0;
-bool C_FLAG = 0;
-bool Z_FLAG = 0;
-bool V_FLAG = 0;
-bool armState = true;
-bool armIrqEnable = true;
-u32 armNextPC = 0x00000000;
-int armMode = 0x1f;
-u32 stop = 0x08000568;
-int saveType = 0;
-bool useBios = false;
-bool skipBios = false;
-int frameSkip = 1;
-bool speedup = false;
-bool synchronize = true;
-bool cpuDisableSfx = false;
-bool cpuIsMultiBoot = false;
-bool parseDebug = true;
-int layerSettings = 0xff00;
-int layerEnable = 0xff00;
-bool speedHack = false;
-int cpuSaveType = 0;
-bool cheatsEnabled = true;
-bool mirroringEnable = false;
-bool skipSaveGameBattery = false;
-bool skipSaveGameCheats = false;
+CORE_LOCAL reg_pair reg[45];
+CORE_LOCAL memoryMap map[256];
+CORE_LOCAL bool ioReadable[0x400];
+CORE_LOCAL bool N_FLAG = 0;
+CORE_LOCAL bool C_FLAG = 0;
+CORE_LOCAL bool Z_FLAG = 0;
+CORE_LOCAL bool V_FLAG = 0;
+CORE_LOCAL bool armState = true;
+CORE_LOCAL bool armIrqEnable = true;
+CORE_LOCAL u32 armNextPC = 0x00000000;
+CORE_LOCAL int armMode = 0x1f;
+CORE_LOCAL u32 stop = 0x08000568;
+CORE_LOCAL int saveType = 0;
+CORE_LOCAL bool useBios = false;
+CORE_LOCAL bool skipBios = false;
+CORE_LOCAL int frameSkip = 1;
+CORE_LOCAL bool speedup = false;
+CORE_LOCAL bool synchronize = true;
+CORE_LOCAL bool cpuDisableSfx = false;
+CORE_LOCAL bool cpuIsMultiBoot = false;
+CORE_LOCAL bool parseDebug = true;
+CORE_LOCAL int layerSettings = 0xff00;
+CORE_LOCAL int layerEnable = 0xff00;
+CORE_LOCAL bool speedHack = false;
+CORE_LOCAL int cpuSaveType = 0;
+CORE_LOCAL bool cheatsEnabled = true;
+CORE_LOCAL bool mirroringEnable = false;
+CORE_LOCAL bool skipSaveGameBattery = false;
+CORE_LOCAL bool skipSaveGameCheats = false;
 
 // this is an optional hack to change the backdrop/background color:
 // -1: disabled
 // 0x0000 to 0x7FFF: set custom 15 bit color
-int customBackdropColor = -1;
+CORE_LOCAL int customBackdropColor = -1;
 
-u8 *bios = 0;
-u8 *rom = 0;
-u8 *internalRAM = 0;
-u8 *workRAM = 0;
-u8 *paletteRAM = 0;
-u8 *vram = 0;
-u8 *pix = 0;
-u8 *oam = 0;
-u8 *ioMem = 0;
+CORE_LOCAL u8 *bios = 0;
+CORE_LOCAL u8 *rom = 0;
+CORE_LOCAL u8 *internalRAM = 0;
+CORE_LOCAL u8 *workRAM = 0;
+CORE_LOCAL u8 *paletteRAM = 0;
+CORE_LOCAL u8 *vram = 0;
+CORE_LOCAL u8 *pix = 0;
+CORE_LOCAL u8 *oam = 0;
+CORE_LOCAL u8 *ioMem = 0;
 
-u16 DISPCNT  = 0x0080;
-u16 DISPSTAT = 0x0000;
-u16 VCOUNT   = 0x0000;
-u16 BG0CNT   = 0x0000;
-u16 BG1CNT   = 0x0000;
-u16 BG2CNT   = 0x0000;
-u16 BG3CNT   = 0x0000;
-u16 BG0HOFS  = 0x0000;
-u16 BG0VOFS  = 0x0000;
-u16 BG1HOFS  = 0x0000;
-u16 BG1VOFS  = 0x0000;
-u16 BG2HOFS  = 0x0000;
-u16 BG2VOFS  = 0x0000;
-u16 BG3HOFS  = 0x0000;
-u16 BG3VOFS  = 0x0000;
-u16 BG2PA    = 0x0100;
-u16 BG2PB    = 0x0000;
-u16 BG2PC    = 0x0000;
-u16 BG2PD    = 0x0100;
-u16 BG2X_L   = 0x0000;
-u16 BG2X_H   = 0x0000;
-u16 BG2Y_L   = 0x0000;
-u16 BG2Y_H   = 0x0000;
-u16 BG3PA    = 0x0100;
-u16 BG3PB    = 0x0000;
-u16 BG3PC    = 0x0000;
-u16 BG3PD    = 0x0100;
-u16 BG3X_L   = 0x0000;
-u16 BG3X_H   = 0x0000;
-u16 BG3Y_L   = 0x0000;
-u16 BG3Y_H   = 0x0000;
-u16 WIN0H    = 0x0000;
-u16 WIN1H    = 0x0000;
-u16 WIN0V    = 0x0000;
-u16 WIN1V    = 0x0000;
-u16 WININ    = 0x0000;
-u16 WINOUT   = 0x0000;
-u16 MOSAIC   = 0x0000;
-u16 BLDMOD   = 0x0000;
-u16 COLEV    = 0x0000;
-u16 COLY     = 0x0000;
-u16 DM0SAD_L = 0x0000;
-u16 DM0SAD_H = 0x0000;
-u16 DM0DAD_L = 0x0000;
-u16 DM0DAD_H = 0x0000;
-u16 DM0CNT_L = 0x0000;
-u16 DM0CNT_H = 0x0000;
-u16 DM1SAD_L = 0x0000;
-u16 DM1SAD_H = 0x0000;
-u16 DM1DAD_L = 0x0000;
-u16 DM1DAD_H = 0x0000;
-u16 DM1CNT_L = 0x0000;
-u16 DM1CNT_H = 0x0000;
-u16 DM2SAD_L = 0x0000;
-u16 DM2SAD_H = 0x0000;
-u16 DM2DAD_L = 0x0000;
-u16 DM2DAD_H = 0x0000;
-u16 DM2CNT_L = 0x0000;
-u16 DM2CNT_H = 0x0000;
-u16 DM3SAD_L = 0x0000;
-u16 DM3SAD_H = 0x0000;
-u16 DM3DAD_L = 0x0000;
-u16 DM3DAD_H = 0x0000;
-u16 DM3CNT_L = 0x0000;
-u16 DM3CNT_H = 0x0000;
-u16 TM0D     = 0x0000;
-u16 TM0CNT   = 0x0000;
-u16 TM1D     = 0x0000;
-u16 TM1CNT   = 0x0000;
-u16 TM2D     = 0x0000;
-u16 TM2CNT   = 0x0000;
-u16 TM3D     = 0x0000;
-u16 TM3CNT   = 0x0000;
-u16 P1       = 0xFFFF;
-u16 IE       = 0x0000;
-u16 IF       = 0x0000;
-u16 IME      = 0x0000;
+CORE_LOCAL u16 DISPCNT  = 0x0080;
+CORE_LOCAL u16 DISPSTAT = 0x0000;
+CORE_LOCAL u16 VCOUNT   = 0x0000;
+CORE_LOCAL u16 BG0CNT   = 0x0000;
+CORE_LOCAL u16 BG1CNT   = 0x0000;
+CORE_LOCAL u16 BG2CNT   = 0x0000;
+CORE_LOCAL u16 BG3CNT   = 0x0000;
+CORE_LOCAL u16 BG0HOFS  = 0x0000;
+CORE_LOCAL u16 BG0VOFS  = 0x0000;
+CORE_LOCAL u16 BG1HOFS  = 0x0000;
+CORE_LOCAL u16 BG1VOFS  = 0x0000;
+CORE_LOCAL u16 BG2HOFS  = 0x0000;
+CORE_LOCAL u16 BG2VOFS  = 0x0000;
+CORE_LOCAL u16 BG3HOFS  = 0x0000;
+CORE_LOCAL u16 BG3VOFS  = 0x0000;
+CORE_LOCAL u16 BG2PA    = 0x0100;
+CORE_LOCAL u16 BG2PB    = 0x0000;
+CORE_LOCAL u16 BG2PC    = 0x0000;
+CORE_LOCAL u16 BG2PD    = 0x0100;
+CORE_LOCAL u16 BG2X_L   = 0x0000;
+CORE_LOCAL u16 BG2X_H   = 0x0000;
+CORE_LOCAL u16 BG2Y_L   = 0x0000;
+CORE_LOCAL u16 BG2Y_H   = 0x0000;
+CORE_LOCAL u16 BG3PA    = 0x0100;
+CORE_LOCAL u16 BG3PB    = 0x0000;
+CORE_LOCAL u16 BG3PC    = 0x0000;
+CORE_LOCAL u16 BG3PD    = 0x0100;
+CORE_LOCAL u16 BG3X_L   = 0x0000;
+CORE_LOCAL u16 BG3X_H   = 0x0000;
+CORE_LOCAL u16 BG3Y_L   = 0x0000;
+CORE_LOCAL u16 BG3Y_H   = 0x0000;
+CORE_LOCAL u16 WIN0H    = 0x0000;
+CORE_LOCAL u16 WIN1H    = 0x0000;
+CORE_LOCAL u16 WIN0V    = 0x0000;
+CORE_LOCAL u16 WIN1V    = 0x0000;
+CORE_LOCAL u16 WININ    = 0x0000;
+CORE_LOCAL u16 WINOUT   = 0x0000;
+CORE_LOCAL u16 MOSAIC   = 0x0000;
+CORE_LOCAL u16 BLDMOD   = 0x0000;
+CORE_LOCAL u16 COLEV    = 0x0000;
+CORE_LOCAL u16 COLY     = 0x0000;
+CORE_LOCAL u16 DM0SAD_L = 0x0000;
+CORE_LOCAL u16 DM0SAD_H = 0x0000;
+CORE_LOCAL u16 DM0DAD_L = 0x0000;
+CORE_LOCAL u16 DM0DAD_H = 0x0000;
+CORE_LOCAL u16 DM0CNT_L = 0x0000;
+CORE_LOCAL u16 DM0CNT_H = 0x0000;
+CORE_LOCAL u16 DM1SAD_L = 0x0000;
+CORE_LOCAL u16 DM1SAD_H = 0x0000;
+CORE_LOCAL u16 DM1DAD_L = 0x0000;
+CORE_LOCAL u16 DM1DAD_H = 0x0000;
+CORE_LOCAL u16 DM1CNT_L = 0x0000;
+CORE_LOCAL u16 DM1CNT_H = 0x0000;
+CORE_LOCAL u16 DM2SAD_L = 0x0000;
+CORE_LOCAL u16 DM2SAD_H = 0x0000;
+CORE_LOCAL u16 DM2DAD_L = 0x0000;
+CORE_LOCAL u16 DM2DAD_H = 0x0000;
+CORE_LOCAL u16 DM2CNT_L = 0x0000;
+CORE_LOCAL u16 DM2CNT_H = 0x0000;
+CORE_LOCAL u16 DM3SAD_L = 0x0000;
+CORE_LOCAL u16 DM3SAD_H = 0x0000;
+CORE_LOCAL u16 DM3DAD_L = 0x0000;
+CORE_LOCAL u16 DM3DAD_H = 0x0000;
+CORE_LOCAL u16 DM3CNT_L = 0x0000;
+CORE_LOCAL u16 DM3CNT_H = 0x0000;
+CORE_LOCAL u16 TM0D     = 0x0000;
+CORE_LOCAL u16 TM0CNT   = 0x0000;
+CORE_LOCAL u16 TM1D     = 0x0000;
+CORE_LOCAL u16 TM1CNT   = 0x0000;
+CORE_LOCAL u16 TM2D     = 0x0000;
+CORE_LOCAL u16 TM2CNT   = 0x0000;
+CORE_LOCAL u16 TM3D     = 0x0000;
+CORE_LOCAL u16 TM3CNT   = 0x0000;
+CORE_LOCAL u16 P1       = 0xFFFF;
+CORE_LOCAL u16 IE       = 0x0000;
+CORE_LOCAL u16 IF       = 0x0000;
+CORE_LOCAL u16 IME      = 0x0000;
@@ -16,122 +16,122 @@
 #define VERBOSE_AGBPRINT           512
 #define VERBOSE_SOUNDOUTPUT       1024
 
-extern reg_pair reg[45];
-extern bool ioReadable[0x400];
-extern bool N_FLAG;
-extern bool C_FLAG;
-extern bool Z_FLAG;
-extern bool V_FLAG;
-extern bool armState;
-extern bool armIrqEnable;
-extern u32 armNextPC;
-extern int armMode;
-extern u32 stop;
-extern int saveType;
-extern bool useBios;
-extern bool skipBios;
-extern int frameSkip;
-extern bool speedup;
-extern bool synchronize;
-extern bool cpuDisableSfx;
-extern bool cpuIsMultiBoot;
-extern bool parseDebug;
-extern int layerSettings;
-extern int layerEnable;
-extern bool speedHack;
-extern int cpuSaveType;
-extern bool cheatsEnabled;
-extern bool mirroringEnable;
-extern bool skipSaveGameBattery; // skip battery data when reading save states
-extern bool skipSaveGameCheats;  // skip cheat list data when reading save states
-extern int customBackdropColor;
+extern CORE_LOCAL reg_pair reg[45];
+extern CORE_LOCAL bool ioReadable[0x400];
+extern CORE_LOCAL bool N_FLAG;
+extern CORE_LOCAL bool C_FLAG;
+extern CORE_LOCAL bool Z_FLAG;
+extern CORE_LOCAL bool V_FLAG;
+extern CORE_LOCAL bool armState;
+extern CORE_LOCAL bool armIrqEnable;
+extern CORE_LOCAL u32 armNextPC;
+extern CORE_LOCAL int armMode;
+extern CORE_LOCAL u32 stop;
+extern CORE_LOCAL int saveType;
+extern CORE_LOCAL bool useBios;
+extern CORE_LOCAL bool skipBios;
+extern CORE_LOCAL int frameSkip;
+extern CORE_LOCAL bool speedup;
+extern CORE_LOCAL bool synchronize;
+extern CORE_LOCAL bool cpuDisableSfx;
+extern CORE_LOCAL bool cpuIsMultiBoot;
+extern CORE_LOCAL bool parseDebug;
+extern CORE_LOCAL int layerSettings;
+extern CORE_LOCAL int layerEnable;
+extern CORE_LOCAL bool speedHack;
+extern CORE_LOCAL int cpuSaveType;
+extern CORE_LOCAL bool cheatsEnabled;
+extern CORE_LOCAL bool mirroringEnable;
+extern CORE_LOCAL bool skipSaveGameBattery; // skip battery data when reading save states
+extern CORE_LOCAL bool skipSaveGameCheats;  // skip cheat list data when reading save states
+extern CORE_LOCAL int customBackdropColor;
 
-extern u8 *bios;
-extern u8 *rom;
-extern u8 *internalRAM;
-extern u8 *workRAM;
-extern u8 *paletteRAM;
-extern u8 *vram;
-extern u8 *pix;
-extern u8 *oam;
-extern u8 *ioMem;
+extern CORE_LOCAL u8 *bios;
+extern CORE_LOCAL u8 *rom;
+extern CORE_LOCAL u8 *internalRAM;
+extern CORE_LOCAL u8 *workRAM;
+extern CORE_LOCAL u8 *paletteRAM;
+extern CORE_LOCAL u8 *vram;
+extern CORE_LOCAL u8 *pix;
+extern CORE_LOCAL u8 *oam;
+extern CORE_LOCAL u8 *ioMem;
 
-extern u16 DISPCNT;
-extern u16 DISPSTAT;
-extern u16 VCOUNT;
-extern u16 BG0CNT;
-extern u16 BG1CNT;
-extern u16 BG2CNT;
-extern u16 BG3CNT;
-extern u16 BG0HOFS;
-extern u16 BG0VOFS;
-extern u16 BG1HOFS;
-extern u16 BG1VOFS;
-extern u16 BG2HOFS;
-extern u16 BG2VOFS;
-extern u16 BG3HOFS;
-extern u16 BG3VOFS;
-extern u16 BG2PA;
-extern u16 BG2PB;
-extern u16 BG2PC;
-extern u16 BG2PD;
-extern u16 BG2X_L;
-extern u16 BG2X_H;
-extern u16 BG2Y_L;
-extern u16 BG2Y_H;
-extern u16 BG3PA;
-extern u16 BG3PB;
-extern u16 BG3PC;
-extern u16 BG3PD;
-extern u16 BG3X_L;
-extern u16 BG3X_H;
-extern u16 BG3Y_L;
-extern u16 BG3Y_H;
-extern u16 WIN0H;
-extern u16 WIN1H;
-extern u16 WIN0V;
-extern u16 WIN1V;
-extern u16 WININ;
-extern u16 WINOUT;
-extern u16 MOSAIC;
-extern u16 BLDMOD;
-extern u16 COLEV;
-extern u16 COLY;
-extern u16 DM0SAD_L;
-extern u16 DM0SAD_H;
-extern u16 DM0DAD_L;
-extern u16 DM0DAD_H;
-extern u16 DM0CNT_L;
-extern u16 DM0CNT_H;
-extern u16 DM1SAD_L;
-extern u16 DM1SAD_H;
-extern u16 DM1DAD_L;
-extern u16 DM1DAD_H;
-extern u16 DM1CNT_L;
-extern u16 DM1CNT_H;
-extern u16 DM2SAD_L;
-extern u16 DM2SAD_H;
-extern u16 DM2DAD_L;
-extern u16 DM2DAD_H;
-extern u16 DM2CNT_L;
-extern u16 DM2CNT_H;
-extern u16 DM3SAD_L;
-extern u16 DM3SAD_H;
-extern u16 DM3DAD_L;
-extern u16 DM3DAD_H;
-extern u16 DM3CNT_L;
-extern u16 DM3CNT_H;
-extern u16 TM0D;
-extern u16 TM0CNT;
-extern u16 TM1D;
-extern u16 TM1CNT;
-extern u16 TM2D;
-extern u16 TM2CNT;
-extern u16 TM3D;
-extern u16 TM3CNT;
-extern u16 P1;
-extern u16 IE;
-extern u16 IF;
-extern u16 IME;
+extern CORE_LOCAL u16 DISPCNT;
+extern CORE_LOCAL u16 DISPSTAT;
+extern CORE_LOCAL u16 VCOUNT;
+extern CORE_LOCAL u16 BG0CNT;
+extern CORE_LOCAL u16 BG1CNT;
+extern CORE_LOCAL u16 BG2CNT;
+extern CORE_LOCAL u16 BG3CNT;
+extern CORE_LOCAL u16 BG0HOFS;
+extern CORE_LOCAL u16 BG0VOFS;
+extern CORE_LOCAL u16 BG1HOFS;
+extern CORE_LOCAL u16 BG1VOFS;
+extern CORE_LOCAL u16 BG2HOFS;
+extern CORE_LOCAL u16 BG2VOFS;
+extern CORE_LOCAL u16 BG3HOFS;
+extern CORE_LOCAL u16 BG3VOFS;
+extern CORE_LOCAL u16 BG2PA;
+extern CORE_LOCAL u16 BG2PB;
+extern CORE_LOCAL u16 BG2PC;
+extern CORE_LOCAL u16 BG2PD;
+extern CORE_LOCAL u16 BG2X_L;
+extern CORE_LOCAL u16 BG2X_H;
+extern CORE_LOCAL u16 BG2Y_L;
+extern CORE_LOCAL u16 BG2Y_H;
+extern CORE_LOCAL u16 BG3PA;
+extern CORE_LOCAL u16 BG3PB;
+extern CORE_LOCAL u16 BG3PC;
+extern CORE_LOCAL u16 BG3PD;
+extern CORE_LOCAL u16 BG3X_L;
+extern CORE_LOCAL u16 BG3X_H;
+extern CORE_LOCAL u16 BG3Y_L;
+extern CORE_LOCAL u16 BG3Y_H;
+extern CORE_LOCAL u16 WIN0H;
+extern CORE_LOCAL u16 WIN1H;
+extern CORE_LOCAL u16 WIN0V;
+extern CORE_LOCAL u16 WIN1V;
+extern CORE_LOCAL u16 WININ;
+extern CORE_LOCAL u16 WINOUT;
+extern CORE_LOCAL u16 MOSAIC;
+extern CORE_LOCAL u16 BLDMOD;
+extern CORE_LOCAL u16 COLEV;
+extern CORE_LOCAL u16 COLY;
+extern CORE_LOCAL u16 DM0SAD_L;
+extern CORE_LOCAL u16 DM0SAD_H;
+extern CORE_LOCAL u16 DM0DAD_L;
+extern CORE_LOCAL u16 DM0DAD_H;
+extern CORE_LOCAL u16 DM0CNT_L;
+extern CORE_LOCAL u16 DM0CNT_H;
+extern CORE_LOCAL u16 DM1SAD_L;
+extern CORE_LOCAL u16 DM1SAD_H;
+extern CORE_LOCAL u16 DM1DAD_L;
+extern CORE_LOCAL u16 DM1DAD_H;
+extern CORE_LOCAL u16 DM1CNT_L;
+extern CORE_LOCAL u16 DM1CNT_H;
+extern CORE_LOCAL u16 DM2SAD_L;
+extern CORE_LOCAL u16 DM2SAD_H;
+extern CORE_LOCAL u16 DM2DAD_L;
+extern CORE_LOCAL u16 DM2DAD_H;
+extern CORE_LOCAL u16 DM2CNT_L;
+extern CORE_LOCAL u16 DM2CNT_H;
+extern CORE_LOCAL u16 DM3SAD_L;
+extern CORE_LOCAL u16 DM3SAD_H;
+extern CORE_LOCAL u16 DM3DAD_L;
+extern CORE_LOCAL u16 DM3DAD_H;
+extern CORE_LOCAL u16 DM3CNT_L;
+extern CORE_LOCAL u16 DM3CNT_H;
+extern CORE_LOCAL u16 TM0D;
+extern CORE_LOCAL u16 TM0CNT;
+extern CORE_LOCAL u16 TM1D;
+extern CORE_LOCAL u16 TM1CNT;
+extern CORE_LOCAL u16 TM2D;
+extern CORE_LOCAL u16 TM2CNT;
+extern CORE_LOCAL u16 TM3D;
+extern CORE_LOCAL u16 TM3CNT;
+extern CORE_LOCAL u16 P1;
+extern CORE_LOCAL u16 IE;
+extern CORE_LOCAL u16 IF;
+extern CORE_LOCAL u16 IME;
 
 #endif // GLOBALS_H
@@ -10,51 +10,8 @@ These routines only render a single line at a time, because of the way the GBA d
 #include "Globals.h"
 #include "GBAGfx.h"
 
-void mode0RenderLine()
+static void mode0MixLine(u32 backdrop)
 {
-  u16 *palette = (u16 *)paletteRAM;
-
-  if(DISPCNT & 0x80) {
-	int x = 232;	//240 - 8  
-	do{
-		lineMix[x  ] =
-		lineMix[x+1] =
-		lineMix[x+2] =
-		lineMix[x+3] =
-		lineMix[x+4] =
-		lineMix[x+5] =
-		lineMix[x+6] =
-		lineMix[x+7] = 0x7fff;
-		x-=8;
-	}while(x>=0);
-    return;
-  }
-
-  if(layerEnable & 0x0100) {
-    gfxDrawTextScreen(BG0CNT, BG0HOFS, BG0VOFS, line0);
-  }
-
-  if(layerEnable & 0x0200) {
-    gfxDrawTextScreen(BG1CNT, BG1HOFS, BG1VOFS, line1);
-  }
-
-  if(layerEnable & 0x0400) {
-    gfxDrawTextScreen(BG2CNT, BG2HOFS, BG2VOFS, line2);
-  }
-
-  if(layerEnable & 0x0800) {
-    gfxDrawTextScreen(BG3CNT, BG3HOFS, BG3VOFS, line3);
-  }
-
-  gfxDrawSprites(lineOBJ);
-
-  u32 backdrop;
-  if(customBackdropColor == -1) {
-    backdrop = (READ16LE(&palette[0]) | 0x30000000);
-  } else {
-    backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
-  }
-
   for(u32 x = 0; x < 240u; ++x) {
     u32 color = backdrop;
     u8 top = 0x20;
@@ -183,13 +140,12 @@ void mode0RenderLine()
   }
 }
 
-void mode0RenderLineNoWindow()
+void mode0RenderLine()
 {
   u16 *palette = (u16 *)paletteRAM;
 
   if(DISPCNT & 0x80) {
-
-	int x = 232;	//240 -  8  
+	int x = 232;	//240 - 8  
 	do{
 		lineMix[x  ] =
 		lineMix[x+1] =
@@ -201,7 +157,6 @@ void mode0RenderLineNoWindow()
 		lineMix[x+7] = 0x7fff;
 		x-=8;
 	}while(x>=0);
-
     return;
   }
 
@@ -230,6 +185,12 @@ void mode0RenderLineNoWindow()
     backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
   }
 
+  // semi-transparent sprites only ever blend with the backdrop in mode 0
+  GFX_MIX_LINE(mode0MixLine, backdrop, 0x0F, 0x00, false);
+}
+
+static void mode0MixLineNoWindow(u32 backdrop)
+{
   int effect = (BLDMOD >> 6) & 3;
 
   for(int x = 0; x < 240; x++) {
@@ -386,6 +347,57 @@ void mode0RenderLineNoWindow()
   }
 }
 
+void mode0RenderLineNoWindow()
+{
+  u16 *palette = (u16 *)paletteRAM;
+
+  if(DISPCNT & 0x80) {
+
+	int x = 232;	//240 -  8  
+	do{
+		lineMix[x  ] =
+		lineMix[x+1] =
+		lineMix[x+2] =
+		lineMix[x+3] =
+		lineMix[x+4] =
+		lineMix[x+5] =
+		lineMix[x+6] =
+		lineMix[x+7] = 0x7fff;
+		x-=8;
+	}while(x>=0);
+
+    return;
+  }
+
+  if(layerEnable & 0x0100) {
+    gfxDrawTextScreen(BG0CNT, BG0HOFS, BG0VOFS, line0);
+  }
+
+  if(layerEnable & 0x0200) {
+    gfxDrawTextScreen(BG1CNT, BG1HOFS, BG1VOFS, line1);
+  }
+
+  if(layerEnable & 0x0400) {
+    gfxDrawTextScreen(BG2CNT, BG2HOFS, BG2VOFS, line2);
+  }
+
+  if(layerEnable & 0x0800) {
+    gfxDrawTextScreen(BG3CNT, BG3HOFS, BG3VOFS, line3);
+  }
+
+  gfxDrawSprites(lineOBJ);
+
+  u32 backdrop;
+  if(customBackdropColor == -1) {
+    backdrop = (READ16LE(&palette[0]) | 0x30000000);
+  } else {
+    backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
+  }
+
+  // semi-transparent sprites only ever blend with the backdrop in mode 0
+  GFX_MIX_LINE(mode0MixLineNoWindow, backdrop, 0x0F, 0x00, true);
+}
+
 void mode0RenderLineAll()
 {
   u16 *palette = (u16 *)paletteRAM;
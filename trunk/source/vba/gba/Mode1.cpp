@@ -11,55 +11,8 @@ These routines only render a single line at a time, because of the way the GBA d
 #include "Globals.h"
 #include "GBAGfx.h"
 
-void mode1RenderLine()
+static void mode1MixLine(u32 backdrop)
 {
-  u16 *palette = (u16 *)paletteRAM;
-
-  if(DISPCNT & 0x80) {
-
-	int x = 232;	//240 - 8  
-	do{
-		lineMix[x  ] =
-		lineMix[x+1] =
-		lineMix[x+2] =
-		lineMix[x+3] =
-		lineMix[x+4] =
-		lineMix[x+5] =
-		lineMix[x+6] =
-		lineMix[x+7] = 0x7fff;
-		x-=8;
-	}while(x>=0);
-
-    gfxLastVCOUNT = VCOUNT;
-    return;
-  }
-
-  if(layerEnable & 0x0100) {
-    gfxDrawTextScreen(BG0CNT, BG0HOFS, BG0VOFS, line0);
-  }
-
-  if(layerEnable & 0x0200) {
-    gfxDrawTextScreen(BG1CNT, BG1HOFS, BG1VOFS, line1);
-  }
-
-  if(layerEnable & 0x0400) {
-    int changed = gfxBG2Changed;
-    if(gfxLastVCOUNT > VCOUNT)
-      changed = 3;
-    gfxDrawRotScreen(BG2CNT, BG2X_L, BG2X_H, BG2Y_L, BG2Y_H,
-                     BG2PA, BG2PB, BG2PC, BG2PD,
-                     gfxBG2X, gfxBG2Y, changed, line2);
-  }
-
-  gfxDrawSprites(lineOBJ);
-
-  u32 backdrop;
-  if(customBackdropColor == -1) {
-    backdrop = (READ16LE(&palette[0]) | 0x30000000);
-  } else {
-    backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
-  }
-
   for(u32 x = 0; x < 240u; ++x) {
     u32 color = backdrop;
     u8 top = 0x20;
@@ -139,17 +92,15 @@ void mode1RenderLine()
 
     lineMix[x] = color;
   }
-  gfxBG2Changed = 0;
-  gfxLastVCOUNT = VCOUNT;
 }
 
-void mode1RenderLineNoWindow()
+void mode1RenderLine()
 {
   u16 *palette = (u16 *)paletteRAM;
 
   if(DISPCNT & 0x80) {
 
-	int x = 232;	//240 -  8  
+	int x = 232;	//240 - 8  
 	do{
 		lineMix[x  ] =
 		lineMix[x+1] =
@@ -170,7 +121,6 @@ void mode1RenderLineNoWindow()
     gfxDrawTextScreen(BG0CNT, BG0HOFS, BG0VOFS, line0);
   }
 
-
   if(layerEnable & 0x0200) {
     gfxDrawTextScreen(BG1CNT, BG1HOFS, BG1VOFS, line1);
   }
@@ -193,6 +143,13 @@ void mode1RenderLineNoWindow()
     backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
   }
 
+  GFX_MIX_LINE(mode1MixLine, backdrop, 0x07, 0x07, false);
+  gfxBG2Changed = 0;
+  gfxLastVCOUNT = VCOUNT;
+}
+
+static void mode1MixLineNoWindow(u32 backdrop)
+{
   for(int x = 0; x < 240; ++x) {
     u32 color = backdrop;
     u8 top = 0x20;
@@ -319,6 +276,59 @@ void mode1RenderLineNoWindow()
 
     lineMix[x] = color;
   }
+}
+
+void mode1RenderLineNoWindow()
+{
+  u16 *palette = (u16 *)paletteRAM;
+
+  if(DISPCNT & 0x80) {
+
+	int x = 232;	//240 -  8  
+	do{
+		lineMix[x  ] =
+		lineMix[x+1] =
+		lineMix[x+2] =
+		lineMix[x+3] =
+		lineMix[x+4] =
+		lineMix[x+5] =
+		lineMix[x+6] =
+		lineMix[x+7] = 0x7fff;
+		x-=8;
+	}while(x>=0);
+
+    gfxLastVCOUNT = VCOUNT;
+    return;
+  }
+
+  if(layerEnable & 0x0100) {
+    gfxDrawTextScreen(BG0CNT, BG0HOFS, BG0VOFS, line0);
+  }
+
+
+  if(layerEnable & 0x0200) {
+    gfxDrawTextScreen(BG1CNT, BG1HOFS, BG1VOFS, line1);
+  }
+
+  if(layerEnable & 0x0400) {
+    int changed = gfxBG2Changed;
+    if(gfxLastVCOUNT > VCOUNT)
+      changed = 3;
+    gfxDrawRotScreen(BG2CNT, BG2X_L, BG2X_H, BG2Y_L, BG2Y_H,
+                     BG2PA, BG2PB, BG2PC, BG2PD,
+                     gfxBG2X, gfxBG2Y, changed, line2);
+  }
+
+  gfxDrawSprites(lineOBJ);
+
+  u32 backdrop;
+  if(customBackdropColor == -1) {
+    backdrop = (READ16LE(&palette[0]) | 0x30000000);
+  } else {
+    backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
+  }
+
+  GFX_MIX_LINE(mode1MixLineNoWindow, backdrop, 0x07, 0x07, true);
   gfxBG2Changed = 0;
   gfxLastVCOUNT = VCOUNT;
 }
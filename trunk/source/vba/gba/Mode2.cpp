@@ -10,58 +10,8 @@ These routines only render a single line at a time, because of the way the GBA d
 #include "Globals.h"
 #include "GBAGfx.h"
 
-void mode2RenderLine()
+static void mode2MixLine(u32 backdrop)
 {
-  u16 *palette = (u16 *)paletteRAM;
-
-  if(DISPCNT & 0x80) {
-
-	int x = 232;	//240 - 8  
-	do{
-		lineMix[x  ] =
-		lineMix[x+1] =
-		lineMix[x+2] =
-		lineMix[x+3] =
-		lineMix[x+4] =
-		lineMix[x+5] =
-		lineMix[x+6] =
-		lineMix[x+7] = 0x7fff;
-		x-=8;
-	}while(x>=0);
-
-    gfxLastVCOUNT = VCOUNT;
-    return;
-  }
-
-  if(layerEnable & 0x0400) {
-    int changed = gfxBG2Changed;
-    if(gfxLastVCOUNT > VCOUNT)
-      changed = 3;
-
-    gfxDrawRotScreen(BG2CNT, BG2X_L, BG2X_H, BG2Y_L, BG2Y_H,
-                     BG2PA, BG2PB, BG2PC, BG2PD, gfxBG2X, gfxBG2Y,
-                     changed, line2);
-  }
-
-  if(layerEnable & 0x0800) {
-    int changed = gfxBG3Changed;
-    if(gfxLastVCOUNT > VCOUNT)
-      changed = 3;
-
-    gfxDrawRotScreen(BG3CNT, BG3X_L, BG3X_H, BG3Y_L, BG3Y_H,
-                     BG3PA, BG3PB, BG3PC, BG3PD, gfxBG3X, gfxBG3Y,
-                     changed, line3);
-  }
-
-  gfxDrawSprites(lineOBJ);
-
-  u32 backdrop;
-  if(customBackdropColor == -1) {
-    backdrop = (READ16LE(&palette[0]) | 0x30000000);
-  } else {
-    backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
-  }
-
   for(int x = 0; x < 240; ++x) {
     u32 color = backdrop;
     u8 top = 0x20;
@@ -128,12 +78,9 @@ void mode2RenderLine()
 
     lineMix[x] = color;
   }
-  gfxBG2Changed = 0;
-  gfxBG3Changed = 0;
-  gfxLastVCOUNT = VCOUNT;
 }
 
-void mode2RenderLineNoWindow()
+void mode2RenderLine()
 {
   u16 *palette = (u16 *)paletteRAM;
 
@@ -185,6 +132,14 @@ void mode2RenderLineNoWindow()
     backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
   }
 
+  GFX_MIX_LINE(mode2MixLine, backdrop, 0x0C, 0x0C, false);
+  gfxBG2Changed = 0;
+  gfxBG3Changed = 0;
+  gfxLastVCOUNT = VCOUNT;
+}
+
+static void mode2MixLineNoWindow(u32 backdrop)
+{
   for(int x = 0; x < 240; ++x) {
     u32 color = backdrop;
     u8 top = 0x20;
@@ -292,6 +247,61 @@ void mode2RenderLineNoWindow()
 
     lineMix[x] = color;
   }
+}
+
+void mode2RenderLineNoWindow()
+{
+  u16 *palette = (u16 *)paletteRAM;
+
+  if(DISPCNT & 0x80) {
+
+	int x = 232;	//240 - 8  
+	do{
+		lineMix[x  ] =
+		lineMix[x+1] =
+		lineMix[x+2] =
+		lineMix[x+3] =
+		lineMix[x+4] =
+		lineMix[x+5] =
+		lineMix[x+6] =
+		lineMix[x+7] = 0x7fff;
+		x-=8;
+	}while(x>=0);
+
+    gfxLastVCOUNT = VCOUNT;
+    return;
+  }
+
+  if(layerEnable & 0x0400) {
+    int changed = gfxBG2Changed;
+    if(gfxLastVCOUNT > VCOUNT)
+      changed = 3;
+
+    gfxDrawRotScreen(BG2CNT, BG2X_L, BG2X_H, BG2Y_L, BG2Y_H,
+                     BG2PA, BG2PB, BG2PC, BG2PD, gfxBG2X, gfxBG2Y,
+                     changed, line2);
+  }
+
+  if(layerEnable & 0x0800) {
+    int changed = gfxBG3Changed;
+    if(gfxLastVCOUNT > VCOUNT)
+      changed = 3;
+
+    gfxDrawRotScreen(BG3CNT, BG3X_L, BG3X_H, BG3Y_L, BG3Y_H,
+                     BG3PA, BG3PB, BG3PC, BG3PD, gfxBG3X, gfxBG3Y,
+                     changed, line3);
+  }
+
+  gfxDrawSprites(lineOBJ);
+
+  u32 backdrop;
+  if(customBackdropColor == -1) {
+    backdrop = (READ16LE(&palette[0]) | 0x30000000);
+  } else {
+    backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
+  }
+
+  GFX_MIX_LINE(mode2MixLineNoWindow, backdrop, 0x0C, 0x0C, true);
   gfxBG2Changed = 0;
   gfxBG3Changed = 0;
   gfxLastVCOUNT = VCOUNT;
@@ -9,50 +9,8 @@ These routines only render a single line at a time, because of the way the GBA d
 #include "GBAGfx.h"
 #include "Globals.h"
 
-void mode4RenderLine()
+static void mode4MixLine(u32 backdrop)
 {
-  u16 *palette = (u16 *)paletteRAM;
-
-  if(DISPCNT & 0x0080) {
-
-	int x = 232;	//240 - 8  
-	do{
-		lineMix[x  ] =
-		lineMix[x+1] =
-		lineMix[x+2] =
-		lineMix[x+3] =
-		lineMix[x+4] =
-		lineMix[x+5] =
-		lineMix[x+6] =
-		lineMix[x+7] = 0x7fff;
-		x-=8;
-	}while(x>=0);
-
-    gfxLastVCOUNT = VCOUNT;
-    return;
-  }
-
-  if(layerEnable & 0x400) {
-    int changed = gfxBG2Changed;
-
-    if(gfxLastVCOUNT > VCOUNT)
-      changed = 3;
-
-    gfxDrawRotScreen256(BG2CNT, BG2X_L, BG2X_H, BG2Y_L, BG2Y_H,
-                        BG2PA, BG2PB, BG2PC, BG2PD,
-                        gfxBG2X, gfxBG2Y, changed,
-                        line2);
-  }
-
-  gfxDrawSprites(lineOBJ);
-
-  u32 backdrop;
-  if(customBackdropColor == -1) {
-    backdrop = (READ16LE(&palette[0]) | 0x30000000);
-  } else {
-    backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
-  }
-
   for(int x = 0; x < 240; ++x) {
     u32 color = backdrop;
     u8 top = 0x20;
@@ -97,11 +55,9 @@ void mode4RenderLine()
 
     lineMix[x] = color;
   }
-  gfxBG2Changed = 0;
-  gfxLastVCOUNT = VCOUNT;
 }
 
-void mode4RenderLineNoWindow()
+void mode4RenderLine()
 {
   u16 *palette = (u16 *)paletteRAM;
 
@@ -145,6 +101,13 @@ void mode4RenderLineNoWindow()
     backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
   }
 
+  GFX_MIX_LINE(mode4MixLine, backdrop, 0x04, 0x04, false);
+  gfxBG2Changed = 0;
+  gfxLastVCOUNT = VCOUNT;
+}
+
+static void mode4MixLineNoWindow(u32 backdrop)
+{
   for(int x = 0; x < 240; ++x) {
     u32 color = backdrop;
     u8 top = 0x20;
@@ -226,6 +189,53 @@ void mode4RenderLineNoWindow()
 
     lineMix[x] = color;
   }
+}
+
+void mode4RenderLineNoWindow()
+{
+  u16 *palette = (u16 *)paletteRAM;
+
+  if(DISPCNT & 0x0080) {
+
+	int x = 232;	//240 - 8  
+	do{
+		lineMix[x  ] =
+		lineMix[x+1] =
+		lineMix[x+2] =
+		lineMix[x+3] =
+		lineMix[x+4] =
+		lineMix[x+5] =
+		lineMix[x+6] =
+		lineMix[x+7] = 0x7fff;
+		x-=8;
+	}while(x>=0);
+
+    gfxLastVCOUNT = VCOUNT;
+    return;
+  }
+
+  if(layerEnable & 0x400) {
+    int changed = gfxBG2Changed;
+
+    if(gfxLastVCOUNT > VCOUNT)
+      changed = 3;
+
+    gfxDrawRotScreen256(BG2CNT, BG2X_L, BG2X_H, BG2Y_L, BG2Y_H,
+                        BG2PA, BG2PB, BG2PC, BG2PD,
+                        gfxBG2X, gfxBG2Y, changed,
+                        line2);
+  }
+
+  gfxDrawSprites(lineOBJ);
+
+  u32 backdrop;
+  if(customBackdropColor == -1) {
+    backdrop = (READ16LE(&palette[0]) | 0x30000000);
+  } else {
+    backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
+  }
+
+  GFX_MIX_LINE(mode4MixLineNoWindow, backdrop, 0x04, 0x04, true);
   gfxBG2Changed = 0;
   gfxLastVCOUNT = VCOUNT;
 }
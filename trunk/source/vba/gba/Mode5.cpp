@@ -10,51 +10,8 @@ These routines only render a single line at a time, because of the way the GBA d
 #include "Globals.h"
 #include "GBAGfx.h"
 
-void mode5RenderLine()
+static void mode5MixLine(u32 background)
 {
-  if(DISPCNT & 0x0080) {
-
-	int x = 232;	//240 - 8  
-	do{
-		lineMix[x  ] =
-		lineMix[x+1] =
-		lineMix[x+2] =
-		lineMix[x+3] =
-		lineMix[x+4] =
-		lineMix[x+5] =
-		lineMix[x+6] =
-		lineMix[x+7] = 0x7fff;
-		x-=8;
-	}while(x>=0);
-
-    gfxLastVCOUNT = VCOUNT;
-    return;
-  }
-
-  u16 *palette = (u16 *)paletteRAM;
-
-  if(layerEnable & 0x0400) {
-    int changed = gfxBG2Changed;
-
-    if(gfxLastVCOUNT > VCOUNT)
-      changed = 3;
-
-    gfxDrawRotScreen16Bit160(BG2CNT, BG2X_L, BG2X_H,
-                             BG2Y_L, BG2Y_H, BG2PA, BG2PB,
-                             BG2PC, BG2PD,
-                             gfxBG2X, gfxBG2Y, changed,
-                             line2);
-  }
-
-  gfxDrawSprites(lineOBJ);
-
-  u32 background;
-  if(customBackdropColor == -1) {
-    background = (READ16LE(&palette[0]) | 0x30000000);
-  } else {
-    background = ((customBackdropColor & 0x7FFF) | 0x30000000);
-  }
-
   for(int x = 0; x < 240; ++x) {
     u32 color = background;
     u8 top = 0x20;
@@ -99,11 +56,9 @@ void mode5RenderLine()
 
     lineMix[x] = color;
   }
-  gfxBG2Changed = 0;
-  gfxLastVCOUNT = VCOUNT;
 }
 
-void mode5RenderLineNoWindow()
+void mode5RenderLine()
 {
   if(DISPCNT & 0x0080) {
 
@@ -148,6 +103,13 @@ void mode5RenderLineNoWindow()
     background = ((customBackdropColor & 0x7FFF) | 0x30000000);
   }
 
+  GFX_MIX_LINE(mode5MixLine, background, 0x04, 0x04, false);
+  gfxBG2Changed = 0;
+  gfxLastVCOUNT = VCOUNT;
+}
+
+static void mode5MixLineNoWindow(u32 background)
+{
   for(int x = 0; x < 240; ++x) {
     u32 color = background;
     u8 top = 0x20;
@@ -229,6 +191,54 @@ void mode5RenderLineNoWindow()
 
     lineMix[x] = color;
   }
+}
+
+void mode5RenderLineNoWindow()
+{
+  if(DISPCNT & 0x0080) {
+
+	int x = 232;	//240 - 8  
+	do{
+		lineMix[x  ] =
+		lineMix[x+1] =
+		lineMix[x+2] =
+		lineMix[x+3] =
+		lineMix[x+4] =
+		lineMix[x+5] =
+		lineMix[x+6] =
+		lineMix[x+7] = 0x7fff;
+		x-=8;
+	}while(x>=0);
+
+    gfxLastVCOUNT = VCOUNT;
+    return;
+  }
+
+  u16 *palette = (u16 *)paletteRAM;
+
+  if(layerEnable & 0x0400) {
+    int changed = gfxBG2Changed;
+
+    if(gfxLastVCOUNT > VCOUNT)
+      changed = 3;
+
+    gfxDrawRotScreen16Bit160(BG2CNT, BG2X_L, BG2X_H,
+                             BG2Y_L, BG2Y_H, BG2PA, BG2PB,
+                             BG2PC, BG2PD,
+                             gfxBG2X, gfxBG2Y, changed,
+                             line2);
+  }
+
+  gfxDrawSprites(lineOBJ);
+
+  u32 background;
+  if(customBackdropColor == -1) {
+    background = (READ16LE(&palette[0]) | 0x30000000);
+  } else {
+    background = ((customBackdropColor & 0x7FFF) | 0x30000000);
+  }
+
+  GFX_MIX_LINE(mode5MixLineNoWindow, background, 0x04, 0x04, true);
   gfxBG2Changed = 0;
   gfxLastVCOUNT = VCOUNT;
 }
@@ -30,9 +30,9 @@ typedef struct {
   u32 reserved3;
 } RTCCLOCKDATA;
 
-static RTCCLOCKDATA rtcClockData;
-static bool rtcEnabled = false;
-static bool rtcWarioRumbleEnabled = false;
+static CORE_LOCAL RTCCLOCKDATA rtcClockData;
+static CORE_LOCAL bool rtcEnabled = false;
+static CORE_LOCAL bool rtcWarioRumbleEnabled = false;
 
 void rtcEnable(bool e)
 {
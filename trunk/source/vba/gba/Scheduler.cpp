@@ -0,0 +1,52 @@
+#include <string.h>
+
+#include "../System.h"
+#include "Scheduler.h"
+
+// The scheduled events are chained in the order they come due, ties going
+// to the lower event number. The earliest one is taken off the front, so
+// the only walk left is the one that links an event back in, and that
+// stops at the first later deadline, which for the LCD and the timers that
+// come back most often is one or two links down.
+
+CORE_LOCAL int eventClock = 0;
+CORE_LOCAL int eventTime[EVENT_COUNT];
+CORE_LOCAL int eventMask = 0; // sound schedules before CPUReset
+CORE_LOCAL int eventFirst = -1;
+CORE_LOCAL int eventNextTime = 0x7fffffff;
+CORE_LOCAL int eventAfter[EVENT_COUNT];
+CORE_LOCAL u32 eventsHandled = 0;
+
+void eventReset()
+{
+  eventClock = 0;
+  eventMask = 0;
+  eventFirst = -1;
+  eventNextTime = 0x7fffffff;
+  memset(eventTime, 0, sizeof(eventTime));
+}
+
+// Takes a scheduled event out of the chain, eventMask is up to the caller
+void eventUnlink(int event)
+{
+  if(event == eventFirst) {
+    eventFirst = eventAfter[event];
+    eventNextTime = eventFirst >= 0 ? eventTime[eventFirst] : 0x7fffffff;
+    return;
+  }
+
+  int before = eventFirst;
+  while(eventAfter[before] != event)
+    before = eventAfter[before];
+  eventAfter[before] = eventAfter[event];
+}
+
+// Keeps the clock away from overflowing, called between frames
+void eventRebase()
+{
+  for(int i = 0; i < EVENT_COUNT; i++)
+    eventTime[i] -= eventClock;
+  if(eventFirst >= 0)
+    eventNextTime -= eventClock;
+  eventClock = 0;
+}
@@ -0,0 +1,117 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// Timed events of the GBA core. Every event has a deadline on a clock of
+// CPU ticks that CPULoop() moves forward to the earliest deadline, events
+// due on the same tick are handled in the order they are listed here.
+enum {
+  EVENT_LCD,
+  EVENT_SOUND,
+  EVENT_TIMER0,
+  EVENT_TIMER1,
+  EVENT_TIMER2,
+  EVENT_TIMER3,
+  EVENT_PROFILING,
+  EVENT_SWI,       // end of the ticks a high level BIOS call takes
+  EVENT_IRQ,       // end of the delay before an interrupt is taken
+  EVENT_DMA,       // end of the ticks the DMA holds the bus
+  EVENT_COUNT
+};
+
+extern CORE_LOCAL int eventClock;              // ticks up to the events handled last
+extern CORE_LOCAL int eventTime[EVENT_COUNT];  // deadline of each event
+extern CORE_LOCAL int eventMask;               // bit per scheduled event
+extern CORE_LOCAL int eventFirst;              // earliest scheduled event, -1 if none
+extern CORE_LOCAL int eventNextTime;           // its deadline, INT_MAX if none
+extern CORE_LOCAL int eventAfter[EVENT_COUNT]; // event due next after each one, -1 if none
+extern CORE_LOCAL u32 eventsHandled;
+
+void eventReset();
+void eventUnlink(int event);
+void eventRebase();
+
+inline bool eventPending(int event)
+{
+  return (eventMask >> event) & 1;
+}
+
+// Links the event in behind the ones due no later than time
+inline void eventInsert(int event, int time)
+{
+  int after = eventFirst;
+
+  if(after < 0 || time < eventNextTime ||
+     (time == eventNextTime && event < after)) {
+    eventAfter[event] = after;
+    eventFirst = event;
+    eventNextTime = time;
+    return;
+  }
+
+  int before;
+  do {
+    before = after;
+    after = eventAfter[after];
+  } while(after >= 0 && (eventTime[after] < time ||
+                         (eventTime[after] == time && after < event)));
+  eventAfter[event] = after;
+  eventAfter[before] = event;
+}
+
+// Schedules the event for time, or moves it there if it is already
+inline void eventSchedule(int event, int time)
+{
+  if(eventPending(event))
+    eventUnlink(event);
+  eventTime[event] = time;
+  eventMask |= 1 << event;
+  eventInsert(event, time);
+}
+
+inline void eventCancel(int event)
+{
+  if(!eventPending(event))
+    return;
+  eventMask &= ~(1 << event);
+  eventUnlink(event);
+}
+
+// Ticks to the deadline, the countdown the event used to keep by itself
+inline int eventTicks(int event)
+{
+  return eventTime[event] - eventClock;
+}
+
+inline void eventScheduleIn(int event, int ticks)
+{
+  eventSchedule(event, eventClock + ticks);
+}
+
+// Next deadline of a periodic event, counted from its last one
+inline void eventRepeat(int event, int ticks)
+{
+  eventSchedule(event, eventTime[event] + ticks);
+}
+
+// Ticks to the earliest deadline
+inline int eventNext()
+{
+  return eventNextTime - eventClock;
+}
+
+// Takes the earliest event off the schedule if it is due, -1 otherwise.
+// The deadline stays in eventTime for eventRepeat().
+inline int eventPop()
+{
+  if(eventNextTime > eventClock)
+    return -1;
+
+  int event = eventFirst;
+  eventMask &= ~(1 << event);
+  eventFirst = eventAfter[event];
+  eventNextTime = eventFirst >= 0 ? eventTime[eventFirst] : 0x7fffffff;
+  eventsHandled++;
+  return event;
+}
+
+#endif // SCHEDULER_H
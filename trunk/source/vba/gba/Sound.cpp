@@ -4,6 +4,7 @@
 
 #include "GBA.h"
 #include "Globals.h"
+#include "Scheduler.h"
 #include "../Util.h"
 #include "../common/Port.h"
 
@@ -34,24 +35,25 @@
 #define NR51 0x81
 #define NR52 0x84
 
-SoundDriver * soundDriver = 0;
+CORE_LOCAL SoundDriver * soundDriver = 0;
 
-extern bool stopState;      // TODO: silence sound when true
+extern CORE_LOCAL bool stopState;      // TODO: silence sound when true
 
 int const SOUND_CLOCK_TICKS_ = 167772; // 1/100 second
 
-static u16   soundFinalWave [1600];
-long  soundSampleRate    = 44100;
-bool  soundInterpolation = true;
-bool  soundPaused        = true;
-float soundFiltering     = 0.5f;
-int   SOUND_CLOCK_TICKS  = SOUND_CLOCK_TICKS_;
-int   soundTicks         = SOUND_CLOCK_TICKS_;
+static CORE_LOCAL u16   soundFinalWave [1600]; // more than a tick at 44100 Hz
+CORE_LOCAL u64   soundSamplesDropped = 0;
+CORE_LOCAL long  soundSampleRate    = 44100;
+CORE_LOCAL bool  soundInterpolation = true;
+CORE_LOCAL bool  soundPaused        = true;
+CORE_LOCAL float soundFiltering     = 0.5f;
+CORE_LOCAL int   SOUND_CLOCK_TICKS  = SOUND_CLOCK_TICKS_;
+CORE_LOCAL int   soundTicks         = SOUND_CLOCK_TICKS_;
 
-static float soundVolume     = 1.0f;
-static int soundEnableFlag   = 0x3ff; // emulator channels enabled
-static float soundFiltering_ = -1.0f;
-static float soundVolume_    = -1.0f;
+static CORE_LOCAL float soundVolume     = 1.0f;
+static CORE_LOCAL int soundEnableFlag   = 0x3ff; // emulator channels enabled
+static CORE_LOCAL float soundFiltering_ = -1.0f;
+static CORE_LOCAL float soundVolume_    = -1.0f;
 
 void interp_rate() { /* empty for now */ }
 
@@ -90,15 +92,21 @@ private:
 	bool enabled;
 };
 
-static Gba_Pcm_Fifo     pcm [2];
-static Gb_Apu*          gb_apu;
-static Stereo_Buffer*   stereo_buffer;
+static CORE_LOCAL Gba_Pcm_Fifo     pcm [2];
+static CORE_LOCAL Gb_Apu*          gb_apu;
+static CORE_LOCAL Stereo_Buffer*   stereo_buffer;
 
-static Blip_Synth<blip_best_quality,1> pcm_synth [3]; // 32 kHz, 16 kHz, 8 kHz
+static CORE_LOCAL_INIT Blip_Synth<blip_best_quality,1> pcm_synth [3]; // 32 kHz, 16 kHz, 8 kHz
+
+static CORE_LOCAL blip_time_t frame_start; // clocks into the tick where the blip frame began
+
+// Direct Sound kept while frames that get rolled back run, see soundHoldOutput()
+static CORE_LOCAL Gba_Pcm_Fifo held_fifo [2];
+static CORE_LOCAL blip_time_t  held_frame_start;
 
 static inline blip_time_t blip_time()
 {
-	return SOUND_CLOCK_TICKS - soundTicks;
+	return SOUND_CLOCK_TICKS - eventTicks( EVENT_SOUND ) - frame_start;
 }
 
 void Gba_Pcm::init()
@@ -356,30 +364,66 @@ static void end_frame( blip_time_t time )
 	stereo_buffer->end_frame( time );
 }
 
+static CORE_LOCAL bool                soundHeld;      // output is dropped, see hold_samples()
+static CORE_LOCAL Multi_Buffer*       held_buffer;
+static CORE_LOCAL blip_buffer_state_t held_states [32]; // Effects_Buffer has up to 32
+
+static void write_samples( Multi_Buffer * buffer, int count )
+{
+	buffer->read_samples( (blip_sample_t*) soundFinalWave, count );
+	if ( soundHeld )
+		return; // these frames get rolled back, nobody hears them
+
+	if(soundPaused)
+		soundResume();
+
+	int length = count * sizeof *soundFinalWave;
+	int taken = soundDriver->write(soundFinalWave, length);
+	if ( taken < length )
+		soundSamplesDropped += (length - taken) >> 2;
+	systemOnWriteDataToSoundBuffer(soundFinalWave, length);
+}
+
 void flush_samples(Multi_Buffer * buffer)
 {
-	// We want to write the data frame by frame to support legacy audio drivers
-	// that don't use the length parameter of the write method.
-	// TODO: Update the Win32 audio drivers (DS, OAL, XA2), and flush all the
-	// samples at once to help reducing the audio delay on all platforms.
-	int soundBufferLen = ( soundSampleRate / 60 ) << 2;
+	// Everything made since the last flush goes to the driver in one write,
+	// a tick's worth, and soundFinalWave holds more than that
+	int const count = sizeof soundFinalWave / sizeof *soundFinalWave;
+	long avail;
+	while ( (avail = buffer->samples_avail()) > 0 )
+		write_samples( buffer, avail < count ? avail : count );
+}
 
-	// soundBufferLen should have a whole number of sample pairs
-	assert( soundBufferLen % ((sizeof *soundFinalWave)<<1) == 0 );
+void hold_samples( Multi_Buffer * buffer )
+{
+	// Write out everything, so that all a buffer still holds are the tails
+	// of the last deltas, which save_state() keeps
+	flush_samples( buffer );
 
-	// number of samples in output buffer
-	int const out_buf_size = soundBufferLen / sizeof *soundFinalWave;
+	assert( buffer->buffer_count() <= (int) (sizeof held_states / sizeof *held_states) );
+	for ( int i = 0; i < buffer->buffer_count(); i++ )
+		buffer->buffer( i )->save_state( &held_states [i] );
 
-	// Keep filling and writing soundFinalWave until it can't be fully filled
-	while ( buffer->samples_avail() >= out_buf_size )
-	{
-		buffer->read_samples( (blip_sample_t*) soundFinalWave, out_buf_size );
-		if(soundPaused)
-			soundResume();
+	held_buffer = buffer;
+	soundHeld = true;
+}
 
-		soundDriver->write(soundFinalWave, soundBufferLen);
-		systemOnWriteDataToSoundBuffer(soundFinalWave, soundBufferLen);
+bool release_samples()
+{
+	if ( !soundHeld )
+		return false;
+
+	// Clears what the rolled back frames left in the buffers and in the
+	// mixer, then puts the tails back
+	held_buffer->clear();
+	for ( int i = 0; i < held_buffer->buffer_count(); i++ )
+	{
+		Blip_Buffer* buf = held_buffer->buffer( i );
+		buf->load_state( held_states [i] );
+		buf->set_modified();
 	}
+	soundHeld = false;
+	return true;
 }
 
 static void apply_filtering()
@@ -405,7 +449,8 @@ void psoundTickfn()
  	if ( gb_apu && stereo_buffer )
 	{
 		// Run sound hardware to present
-		end_frame( SOUND_CLOCK_TICKS );
+		end_frame( SOUND_CLOCK_TICKS - frame_start );
+		frame_start = 0;
 
 		flush_samples(stereo_buffer);
 
@@ -446,7 +491,13 @@ static void reset_apu()
 	if ( stereo_buffer )
 		stereo_buffer->clear();
 
+	// The buffers start from silence, so does the DAC output
+	pcm [0].pcm.init();
+	pcm [1].pcm.init();
+
+	frame_start = 0;
 	soundTicks = SOUND_CLOCK_TICKS;
+	eventScheduleIn( EVENT_SOUND, SOUND_CLOCK_TICKS );
 }
 
 static void remake_stereo_buffer()
@@ -538,10 +589,39 @@ void soundReset()
 	soundPaused = true;
 	SOUND_CLOCK_TICKS = SOUND_CLOCK_TICKS_;
 	soundTicks        = SOUND_CLOCK_TICKS_;
+	eventScheduleIn( EVENT_SOUND, SOUND_CLOCK_TICKS_ );
 
 	soundEvent( NR52, (u8) 0x80 );
 }
 
+void soundHoldOutput()
+{
+	if ( !gb_apu || !stereo_buffer )
+		return;
+
+	// End the blip frame now instead of at the next tick, the sound event
+	// stays where it is
+	blip_time_t time = blip_time();
+	end_frame( time );
+	frame_start += time;
+
+	held_fifo [0]    = pcm [0];
+	held_fifo [1]    = pcm [1];
+	held_frame_start = frame_start;
+
+	hold_samples( stereo_buffer );
+}
+
+void soundReleaseOutput()
+{
+	if ( !release_samples() )
+		return;
+
+	pcm [0]     = held_fifo [0];
+	pcm [1]     = held_fifo [1];
+	frame_start = held_frame_start;
+}
+
 bool soundInit()
 {
 	soundDriver = systemSoundInit();
@@ -586,13 +666,13 @@ void soundSetSampleRate(long sampleRate)
 	}
 }
 
-static int dummy_state [16];
+static CORE_LOCAL int dummy_state [16];
 
 #define SKIP( type, name ) { dummy_state, sizeof (type) }
 
 #define LOAD( type, name ) { &name, sizeof (type) }
 
-static struct {
+static CORE_LOCAL struct {
 	gb_apu_state_t apu;
 
 	// old state
@@ -601,7 +681,7 @@ static struct {
 } state;
 
 // Old GBA sound state format
-static variable_desc old_gba_state [] =
+static CORE_LOCAL_INIT variable_desc old_gba_state [] =
 {
 	SKIP( int, soundPaused ),
 	SKIP( int, soundPlay ),
@@ -679,7 +759,7 @@ static variable_desc old_gba_state [] =
 	{ NULL, 0 }
 };
 
-variable_desc old_gba_state2 [] =
+CORE_LOCAL_INIT variable_desc old_gba_state2 [] =
 {
 	LOAD( u8 [0x20], state.apu.regs [0x20] ),
 	SKIP( int, sound3Bank ),
@@ -689,7 +769,7 @@ variable_desc old_gba_state2 [] =
 };
 
 // New state format
-static variable_desc gba_state [] =
+static CORE_LOCAL_INIT variable_desc gba_state [] =
 {
 	// PCM
 	LOAD( int, pcm [0].readIndex ),
@@ -31,7 +31,10 @@ int  soundGetEnable();
 // Pauses/resumes system sound output
 void soundPause();
 void soundResume();
-extern bool soundPaused; // current paused state
+extern CORE_LOCAL bool soundPaused; // current paused state
+
+// Stereo samples the sound driver did not take
+extern CORE_LOCAL u64 soundSamplesDropped;
 
 // Cleans up sound. Afterwards, soundInit() can be called again.
 void soundShutdown();
@@ -42,8 +45,8 @@ long soundGetSampleRate();
 void soundSetSampleRate(long sampleRate);
 
 // Sound settings
-extern bool soundInterpolation; // 1 if PCM should have low-pass filtering
-extern float soundFiltering;    // 0.0 = none, 1.0 = max
+extern CORE_LOCAL bool soundInterpolation; // 1 if PCM should have low-pass filtering
+extern CORE_LOCAL float soundFiltering;    // 0.0 = none, 1.0 = max
 
 
 //// GBA sound emulation
@@ -70,15 +73,26 @@ void interp_rate();
 
 // Notifies emulator that SOUND_CLOCK_TICKS clocks have passed
 void psoundTickfn();
-extern int SOUND_CLOCK_TICKS;   // Number of 16.8 MHz clocks between calls to soundTick()
-extern int soundTicks;          // Number of 16.8 MHz clocks until soundTick() will be called
+extern CORE_LOCAL int SOUND_CLOCK_TICKS;   // Number of 16.8 MHz clocks between calls to soundTick()
+extern CORE_LOCAL int soundTicks;          // Number of 16.8 MHz clocks until soundTick() will be called
 
 // Saves/loads emulator state
 void soundSaveGame( gzFile );
 void soundReadGame( gzFile, int version );
 
+// Run-ahead. Writes out all the sound made so far and drops what comes
+// after it, until the state saved right after this call has been loaded
+// back and soundReleaseOutput() called, which carries on from the samples
+// held here as if the frames in between never ran.
+void soundHoldOutput();
+void soundReleaseOutput();
+
 class Multi_Buffer;
 
 void flush_samples(Multi_Buffer * buffer);
 
+// The part of soundHoldOutput() shared with GB sound
+void hold_samples(Multi_Buffer * buffer);
+bool release_samples();
+
 #endif // SOUND_H
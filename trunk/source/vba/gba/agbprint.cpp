@@ -12,8 +12,8 @@
 #define debuggerReadHalfWord(addr) \
   READ16LE(((u16*)&map[(addr)>>24].address[(addr) & map[(addr)>>24].mask]))
 
-static bool agbPrintEnabled = false;
-static bool agbPrintProtect = false;
+static CORE_LOCAL bool agbPrintEnabled = false;
+static CORE_LOCAL bool agbPrintProtect = false;
 
 bool agbPrintWrite(u32 address, u16 value)
 {
@@ -180,6 +180,141 @@ void BIOS_BitUnPack()
   }
 }
 
+int biosMemoryMode = BIOS_MEMORY_HOST;
+
+// Plain memory a BIOS call works on through a host pointer, len bytes from
+// address on. CPUHostAddress() ends it on a word boundary, so an aligned
+// halfword or word that starts inside it ends inside it too. Whatever falls
+// outside goes through the memory decode, which is also where everything
+// goes with BIOS_MEMORY_DECODE or BKPT_SUPPORT.
+struct BiosArea {
+  u32 address;
+  u8 *host;
+  u32 len;
+};
+
+// bytes is set for the calls that write single bytes, which only WRAM and
+// IWRAM store as they are
+static void biosArea(BiosArea &area, u32 address, bool write, bool bytes = false)
+{
+  area.address = address;
+  area.host = NULL;
+  area.len = 0;
+#ifndef BKPT_SUPPORT
+  if(biosMemoryMode != BIOS_MEMORY_HOST)
+    return;
+  if(bytes && (address >> 24) != 2 && (address >> 24) != 3)
+    return;
+  u8 *host = CPUHostAddress(address, write, area.len);
+  if(host)
+    area.host = host;
+  else
+    area.len = 0;
+#endif
+}
+
+// true when bytes bytes at address are all in the area
+static inline bool biosCovers(const BiosArea &area, u32 address, u32 bytes)
+{
+  u32 offset = address - area.address;
+  return offset < area.len && area.len - offset >= bytes;
+}
+
+static inline u8 biosReadByte(const BiosArea &area, u32 address)
+{
+  u32 offset = address - area.address;
+  if(offset < area.len)
+    return area.host[offset];
+  return CPUReadByte(address);
+}
+
+static inline u16 biosReadHalfWord(const BiosArea &area, u32 address)
+{
+  u32 offset = address - area.address;
+  if(offset < area.len && !(address & 1))
+    return READ16LE(((u16 *)&area.host[offset]));
+  return CPUReadHalfWord(address);
+}
+
+static inline u32 biosReadMemory(const BiosArea &area, u32 address)
+{
+  u32 offset = address - area.address;
+  if(offset < area.len && !(address & 3))
+    return READ32LE(((u32 *)&area.host[offset]));
+  return CPUReadMemory(address);
+}
+
+static inline void biosWriteByte(const BiosArea &area, u32 address, u8 value)
+{
+  u32 offset = address - area.address;
+  if(offset < area.len)
+    area.host[offset] = value;
+  else
+    CPUWriteByte(address, value);
+}
+
+static inline void biosWriteHalfWord(const BiosArea &area, u32 address, u16 value)
+{
+  u32 offset = address - area.address;
+  if(offset < area.len && !(address & 1))
+    WRITE16LE(((u16 *)&area.host[offset]), value);
+  else
+    CPUWriteHalfWord(address, value);
+}
+
+static inline void biosWriteMemory(const BiosArea &area, u32 address, u32 value)
+{
+  u32 offset = address - area.address;
+  if(offset < area.len && !(address & 3))
+    WRITE32LE(((u32 *)&area.host[offset]), value);
+  else
+    CPUWriteMemory(address, value);
+}
+
+// Invalidates what the writes through the area, up to end, would have
+static void biosWritten(const BiosArea &area, u32 end)
+{
+  u32 bytes = end - area.address;
+  if(bytes > area.len)
+    bytes = area.len;
+  if(bytes)
+    CPUHostWritten(area.host, bytes);
+}
+
+// Copies bytes bytes in one go when both sides are in their areas and do
+// not overlap, returns false to leave it to the unit by unit loop
+static bool biosCopy(const BiosArea &from, u32 source, const BiosArea &to, u32 dest, u32 bytes)
+{
+  if(!biosCovers(from, source, bytes) || !biosCovers(to, dest, bytes))
+    return false;
+
+  u8 *s = from.host + (source - from.address);
+  u8 *d = to.host + (dest - to.address);
+  if(s < d + bytes && d < s + bytes)
+    return false;
+
+  memcpy(d, s, bytes);
+  return true;
+}
+
+// Fills count aligned words or halfwords with value when they are all in
+// the area, returns false to leave it to the unit by unit loop
+static bool biosFill(const BiosArea &to, u32 dest, u32 value, u32 count, bool words)
+{
+  if(!biosCovers(to, dest, count << (words ? 2 : 1)))
+    return false;
+
+  u8 *d = to.host + (dest - to.address);
+  if(words) {
+    for(u32 i = 0; i < count; i++)
+      WRITE32LE((((u32 *)d) + i), value);
+  } else {
+    for(u32 i = 0; i < count; i++)
+      WRITE16LE((((u16 *)d) + i), (u16)value);
+  }
+  return true;
+}
+
 void BIOS_GetBiosChecksum()
 {
   reg[0].I=0xBAAE187F;
@@ -201,20 +336,24 @@ void BIOS_BgAffineSet()
   u32 dest = reg[1].I;
   int num = reg[2].I;
 
+  BiosArea from, to;
+  biosArea(from, src, false);
+  biosArea(to, dest, true);
+
   for(int i = 0; i < num; i++) {
-    s32 cx = CPUReadMemory(src);
+    s32 cx = biosReadMemory(from, src);
     src+=4;
-    s32 cy = CPUReadMemory(src);
+    s32 cy = biosReadMemory(from, src);
     src+=4;
-    s16 dispx = CPUReadHalfWord(src);
+    s16 dispx = biosReadHalfWord(from, src);
     src+=2;
-    s16 dispy = CPUReadHalfWord(src);
+    s16 dispy = biosReadHalfWord(from, src);
     src+=2;
-    s16 rx = CPUReadHalfWord(src);
+    s16 rx = biosReadHalfWord(from, src);
     src+=2;
-    s16 ry = CPUReadHalfWord(src);
+    s16 ry = biosReadHalfWord(from, src);
     src+=2;
-    u16 theta = CPUReadHalfWord(src)>>8;
+    u16 theta = biosReadHalfWord(from, src)>>8;
     src+=4; // keep structure alignment
     s32 a = sineTable[(theta+0x40)&255];
     s32 b = sineTable[theta];
@@ -224,23 +363,24 @@ void BIOS_BgAffineSet()
     s16 dy =  (ry * b)>>14;
     s16 dmy = (ry * a)>>14;
 
-    CPUWriteHalfWord(dest, dx);
+    biosWriteHalfWord(to, dest, dx);
     dest += 2;
-    CPUWriteHalfWord(dest, -dmx);
+    biosWriteHalfWord(to, dest, -dmx);
     dest += 2;
-    CPUWriteHalfWord(dest, dy);
+    biosWriteHalfWord(to, dest, dy);
     dest += 2;
-    CPUWriteHalfWord(dest, dmy);
+    biosWriteHalfWord(to, dest, dmy);
     dest += 2;
 
     s32 startx = cx - dx * dispx + dmx * dispy;
     s32 starty = cy - dy * dispx - dmy * dispy;
 
-    CPUWriteMemory(dest, startx);
+    biosWriteMemory(to, dest, startx);
     dest += 4;
-    CPUWriteMemory(dest, starty);
+    biosWriteMemory(to, dest, starty);
     dest += 4;
   }
+  biosWritten(to, dest);
 }
 
 void BIOS_CpuSet()
@@ -267,18 +407,34 @@ void BIOS_CpuSet()
     // needed for 32-bit mode!
     source &= 0xFFFFFFFC;
     dest &= 0xFFFFFFFC;
+  }
+
+  BiosArea from, to;
+  biosArea(from, source, false);
+  biosArea(to, dest, true);
+
+  // 32-bit ?
+  if((cnt >> 26) & 1) {
     // fill ?
     if((cnt >> 24) & 1) {
-        u32 value = (source>0x0EFFFFFF ? 0x1CAD1CAD : CPUReadMemory(source));
+        u32 value = (source>0x0EFFFFFF ? 0x1CAD1CAD : biosReadMemory(from, source));
+      if(biosFill(to, dest, value, count, true)) {
+        dest += count << 2;
+        count = 0;
+      }
       while(count) {
-        CPUWriteMemory(dest, value);
+        biosWriteMemory(to, dest, value);
         dest += 4;
         count--;
       }
     } else {
       // copy
+      if(biosCopy(from, source, to, dest, count << 2)) {
+        dest += count << 2;
+        count = 0;
+      }
       while(count) {
-        CPUWriteMemory(dest, (source>0x0EFFFFFF ? 0x1CAD1CAD : CPUReadMemory(source)));
+        biosWriteMemory(to, dest, (source>0x0EFFFFFF ? 0x1CAD1CAD : biosReadMemory(from, source)));
         source += 4;
         dest += 4;
         count--;
@@ -287,22 +443,31 @@ void BIOS_CpuSet()
   } else {
     // 16-bit fill?
     if((cnt >> 24) & 1) {
-      u16 value = (source>0x0EFFFFFF ? 0x1CAD : CPUReadHalfWord(source));
+      u16 value = (source>0x0EFFFFFF ? 0x1CAD : biosReadHalfWord(from, source));
+      if(!(dest & 1) && biosFill(to, dest, value, count, false)) {
+        dest += count << 1;
+        count = 0;
+      }
       while(count) {
-        CPUWriteHalfWord(dest, value);
+        biosWriteHalfWord(to, dest, value);
         dest += 2;
         count--;
       }
     } else {
       // copy
+      if(!((source | dest) & 1) && biosCopy(from, source, to, dest, count << 1)) {
+        dest += count << 1;
+        count = 0;
+      }
       while(count) {
-        CPUWriteHalfWord(dest, (source>0x0EFFFFFF ? 0x1CAD : CPUReadHalfWord(source)));
+        biosWriteHalfWord(to, dest, (source>0x0EFFFFFF ? 0x1CAD : biosReadHalfWord(from, source)));
         source += 2;
         dest += 2;
         count--;
       }
     }
   }
+  biosWritten(to, dest);
 }
 
 void BIOS_CpuFastSet()
@@ -328,29 +493,46 @@ void BIOS_CpuFastSet()
 
   int count = cnt & 0x1FFFFF;
 
+  BiosArea from, to;
+  biosArea(from, source, false);
+  biosArea(to, dest, true);
+
+  // BIOS always transfers 32 bytes at a time
+  u32 blocks = (count + 7) >> 3;
+
   // fill?
   if((cnt >> 24) & 1) {
+    // the source is read again for every 32 bytes, which only gives
+    // another value when it is not plain memory
+    if(biosCovers(from, source, 4) &&
+       biosFill(to, dest, biosReadMemory(from, source), blocks << 3, true)) {
+      dest += blocks << 5;
+      count = 0;
+    }
     while(count > 0) {
-      // BIOS always transfers 32 bytes at a time
-      u32 value = (source>0x0EFFFFFF ? 0xBAFFFFFB : CPUReadMemory(source));
+      u32 value = (source>0x0EFFFFFF ? 0xBAFFFFFB : biosReadMemory(from, source));
       for(int i = 0; i < 8; i++) {
-        CPUWriteMemory(dest, value);
+        biosWriteMemory(to, dest, value);
         dest += 4;
       }
       count -= 8;
     }
   } else {
     // copy
+    if(biosCopy(from, source, to, dest, blocks << 5)) {
+      dest += blocks << 5;
+      count = 0;
+    }
     while(count > 0) {
-      // BIOS always transfers 32 bytes at a time
       for(int i = 0; i < 8; i++) {
-        CPUWriteMemory(dest, (source>0x0EFFFFFF ? 0xBAFFFFFB :CPUReadMemory(source)));
+        biosWriteMemory(to, dest, (source>0x0EFFFFFF ? 0xBAFFFFFB : biosReadMemory(from, source)));
         source += 4;
         dest += 4;
       }
       count -= 8;
     }
   }
+  biosWritten(to, dest);
 }
 
 void BIOS_Diff8bitUnFilterWram()
@@ -533,7 +715,11 @@ void BIOS_HuffUnComp()
      ((source + ((header >> 8) & 0x1fffff)) & 0xe000000) == 0)
     return;
 
-  u8 treeSize = CPUReadByte(source++);
+  BiosArea from, to;
+  biosArea(from, source, false);
+  biosArea(to, dest, true);
+
+  u8 treeSize = biosReadByte(from, source++);
 
   u32 treeStart = source;
 
@@ -542,11 +728,11 @@ void BIOS_HuffUnComp()
   int len = header >> 8;
 
   u32 mask = 0x80000000;
-  u32 data = CPUReadMemory(source);
+  u32 data = biosReadMemory(from, source);
   source += 4;
 
   int pos = 0;
-  u8 rootNode = CPUReadByte(treeStart);
+  u8 rootNode = biosReadByte(from, treeStart);
   u8 currentNode = rootNode;
   bool writeData = false;
   int byteShift = 0;
@@ -565,12 +751,12 @@ void BIOS_HuffUnComp()
         // right
         if(currentNode & 0x40)
           writeData = true;
-        currentNode = CPUReadByte(treeStart+pos+1);
+        currentNode = biosReadByte(from, treeStart+pos+1);
       } else {
         // left
         if(currentNode & 0x80)
           writeData = true;
-        currentNode = CPUReadByte(treeStart+pos);
+        currentNode = biosReadByte(from, treeStart+pos);
       }
 
       if(writeData) {
@@ -585,7 +771,7 @@ void BIOS_HuffUnComp()
         if(byteCount == 4) {
           byteCount = 0;
           byteShift = 0;
-          CPUWriteMemory(dest, writeValue);
+          biosWriteMemory(to, dest, writeValue);
           writeValue = 0;
           dest += 4;
           len -= 4;
@@ -594,7 +780,7 @@ void BIOS_HuffUnComp()
       mask >>= 1;
       if(mask == 0) {
         mask = 0x80000000;
-        data = CPUReadMemory(source);
+        data = biosReadMemory(from, source);
         source += 4;
       }
     }
@@ -612,12 +798,12 @@ void BIOS_HuffUnComp()
         // right
         if(currentNode & 0x40)
           writeData = true;
-        currentNode = CPUReadByte(treeStart+pos+1);
+        currentNode = biosReadByte(from, treeStart+pos+1);
       } else {
         // left
         if(currentNode & 0x80)
           writeData = true;
-        currentNode = CPUReadByte(treeStart+pos);
+        currentNode = biosReadByte(from, treeStart+pos);
       }
 
       if(writeData) {
@@ -638,7 +824,7 @@ void BIOS_HuffUnComp()
           if(byteCount == 4) {
             byteCount = 0;
             byteShift = 0;
-            CPUWriteMemory(dest, writeValue);
+            biosWriteMemory(to, dest, writeValue);
             dest += 4;
             writeValue = 0;
             len -= 4;
@@ -651,11 +837,13 @@ void BIOS_HuffUnComp()
       mask >>= 1;
       if(mask == 0) {
         mask = 0x80000000;
-        data = CPUReadMemory(source);
+        data = biosReadMemory(from, source);
         source += 4;
       }
     }
   }
+
+  biosWritten(to, dest);
 }
 
 void BIOS_LZ77UnCompVram()
@@ -679,6 +867,10 @@ void BIOS_LZ77UnCompVram()
      ((source + ((header >> 8) & 0x1fffff)) & 0xe000000) == 0)
     return;
 
+  BiosArea from, to;
+  biosArea(from, source, false);
+  biosArea(to, dest, true);
+
   int byteCount = 0;
   int byteShift = 0;
   u32 writeValue = 0;
@@ -686,67 +878,75 @@ void BIOS_LZ77UnCompVram()
   int len = header >> 8;
 
   while(len > 0) {
-    u8 d = CPUReadByte(source++);
+    u8 d = biosReadByte(from, source++);
 
     if(d) {
       for(int i = 0; i < 8; i++) {
         if(d & 0x80) {
-          u16 data = CPUReadByte(source++) << 8;
-          data |= CPUReadByte(source++);
+          u16 data = biosReadByte(from, source++) << 8;
+          data |= biosReadByte(from, source++);
           int length = (data >> 12) + 3;
           int offset = (data & 0x0FFF);
           u32 windowOffset = dest + byteCount - offset - 1;
           for(int i2 = 0; i2 < length; i2++) {
-            writeValue |= (CPUReadByte(windowOffset++) << byteShift);
+            writeValue |= (biosReadByte(to, windowOffset++) << byteShift);
             byteShift += 8;
             byteCount++;
 
             if(byteCount == 2) {
-              CPUWriteHalfWord(dest, writeValue);
+              biosWriteHalfWord(to, dest, writeValue);
               dest += 2;
               byteCount = 0;
               byteShift = 0;
               writeValue = 0;
             }
             len--;
-            if(len == 0)
+            if(len == 0) {
+              biosWritten(to, dest);
               return;
+            }
           }
         } else {
-          writeValue |= (CPUReadByte(source++) << byteShift);
+          writeValue |= (biosReadByte(from, source++) << byteShift);
           byteShift += 8;
           byteCount++;
           if(byteCount == 2) {
-            CPUWriteHalfWord(dest, writeValue);
+            biosWriteHalfWord(to, dest, writeValue);
             dest += 2;
             byteCount = 0;
             byteShift = 0;
             writeValue = 0;
           }
           len--;
-          if(len == 0)
+          if(len == 0) {
+            biosWritten(to, dest);
             return;
+          }
         }
         d <<= 1;
       }
     } else {
       for(int i = 0; i < 8; i++) {
-        writeValue |= (CPUReadByte(source++) << byteShift);
+        writeValue |= (biosReadByte(from, source++) << byteShift);
         byteShift += 8;
         byteCount++;
         if(byteCount == 2) {
-          CPUWriteHalfWord(dest, writeValue);
+          biosWriteHalfWord(to, dest, writeValue);
           dest += 2;
           byteShift = 0;
           byteCount = 0;
           writeValue = 0;
         }
         len--;
-        if(len == 0)
+        if(len == 0) {
+          biosWritten(to, dest);
           return;
+        }
       }
     }
   }
+
+  biosWritten(to, dest);
 }
 
 void BIOS_LZ77UnCompWram()
@@ -768,27 +968,31 @@ void BIOS_LZ77UnCompWram()
      ((source + ((header >> 8) & 0x1fffff)) & 0xe000000) == 0)
     return;
 
+  BiosArea from, to;
+  biosArea(from, source, false);
+  biosArea(to, dest, true, true);
+
   int len = header >> 8;
 
   while(len > 0) {
-    u8 d = CPUReadByte(source++);
+    u8 d = biosReadByte(from, source++);
 
     if(d) {
       for(int i = 0; i < 8; i++) {
         if(d & 0x80) {
-          u16 data = CPUReadByte(source++) << 8;
-          data |= CPUReadByte(source++);
+          u16 data = biosReadByte(from, source++) << 8;
+          data |= biosReadByte(from, source++);
           int length = (data >> 12) + 3;
           int offset = (data & 0x0FFF);
           u32 windowOffset = dest - offset - 1;
           for(int i2 = 0; i2 < length; i2++) {
-            CPUWriteByte(dest++, CPUReadByte(windowOffset++));
+            biosWriteByte(to, dest++, biosReadByte(to, windowOffset++));
             len--;
             if(len == 0)
               return;
           }
         } else {
-          CPUWriteByte(dest++, CPUReadByte(source++));
+          biosWriteByte(to, dest++, biosReadByte(from, source++));
           len--;
           if(len == 0)
             return;
@@ -797,7 +1001,7 @@ void BIOS_LZ77UnCompWram()
       }
     } else {
       for(int i = 0; i < 8; i++) {
-        CPUWriteByte(dest++, CPUReadByte(source++));
+        biosWriteByte(to, dest++, biosReadByte(from, source++));
         len--;
         if(len == 0)
           return;
@@ -824,12 +1028,16 @@ void BIOS_ObjAffineSet()
   int num = reg[2].I;
   int offset = reg[3].I;
 
+  BiosArea from, to;
+  biosArea(from, src, false);
+  biosArea(to, dest, true);
+
   for(int i = 0; i < num; i++) {
-    s16 rx = CPUReadHalfWord(src);
+    s16 rx = biosReadHalfWord(from, src);
     src+=2;
-    s16 ry = CPUReadHalfWord(src);
+    s16 ry = biosReadHalfWord(from, src);
     src+=2;
-    u16 theta = CPUReadHalfWord(src)>>8;
+    u16 theta = biosReadHalfWord(from, src)>>8;
     src+=4; // keep structure alignment
 
     s32 a = (s32)sineTable[(theta+0x40)&255];
@@ -840,15 +1048,17 @@ void BIOS_ObjAffineSet()
     s16 dy =  ((s32)ry * b)>>14;
     s16 dmy = ((s32)ry * a)>>14;
 
-    CPUWriteHalfWord(dest, dx);
+    biosWriteHalfWord(to, dest, dx);
     dest += offset;
-    CPUWriteHalfWord(dest, -dmx);
+    biosWriteHalfWord(to, dest, -dmx);
     dest += offset;
-    CPUWriteHalfWord(dest, dy);
+    biosWriteHalfWord(to, dest, dy);
     dest += offset;
-    CPUWriteHalfWord(dest, dmy);
+    biosWriteHalfWord(to, dest, dmy);
     dest += offset;
   }
+
+  biosWritten(to, dest);
 }
 
 void BIOS_RegisterRamReset(u32 flags)
@@ -870,10 +1080,12 @@ void BIOS_RegisterRamReset(u32 flags)
     if(flags & 0x04) {
       // clear palette RAM
       memset(paletteRAM, 0, 0x400);
+      gfxTileCacheReset();
     }
     if(flags & 0x08) {
       // clear VRAM
       memset(vram, 0, 0x18000);
+      gfxTileCacheReset();
     }
     if(flags & 0x10) {
       // clean OAM
@@ -961,16 +1173,20 @@ void BIOS_RLUnCompVram()
      ((source + ((header >> 8) & 0x1fffff)) & 0xe000000) == 0)
     return;
 
+  BiosArea from, to;
+  biosArea(from, source, false);
+  biosArea(to, dest, true);
+
   int len = header >> 8;
   int byteCount = 0;
   int byteShift = 0;
   u32 writeValue = 0;
 
   while(len > 0) {
-    u8 d = CPUReadByte(source++);
+    u8 d = biosReadByte(from, source++);
     int l = d & 0x7F;
     if(d & 0x80) {
-      u8 data = CPUReadByte(source++);
+      u8 data = biosReadByte(from, source++);
       l += 3;
       for(int i = 0;i < l; i++) {
         writeValue |= (data << byteShift);
@@ -978,35 +1194,41 @@ void BIOS_RLUnCompVram()
         byteCount++;
 
         if(byteCount == 2) {
-          CPUWriteHalfWord(dest, writeValue);
+          biosWriteHalfWord(to, dest, writeValue);
           dest += 2;
           byteCount = 0;
           byteShift = 0;
           writeValue = 0;
         }
         len--;
-        if(len == 0)
+        if(len == 0) {
+          biosWritten(to, dest);
           return;
+        }
       }
     } else {
       l++;
       for(int i = 0; i < l; i++) {
-        writeValue |= (CPUReadByte(source++) << byteShift);
+        writeValue |= (biosReadByte(from, source++) << byteShift);
         byteShift += 8;
         byteCount++;
         if(byteCount == 2) {
-          CPUWriteHalfWord(dest, writeValue);
+          biosWriteHalfWord(to, dest, writeValue);
           dest += 2;
           byteCount = 0;
           byteShift = 0;
           writeValue = 0;
         }
         len--;
-        if(len == 0)
+        if(len == 0) {
+          biosWritten(to, dest);
           return;
+        }
       }
     }
   }
+
+  biosWritten(to, dest);
 }
 
 void BIOS_RLUnCompWram()
@@ -1030,16 +1252,20 @@ void BIOS_RLUnCompWram()
      ((source + ((header >> 8) & 0x1fffff)) & 0xe000000) == 0)
     return;
 
+  BiosArea from, to;
+  biosArea(from, source, false);
+  biosArea(to, dest, true, true);
+
   int len = header >> 8;
 
   while(len > 0) {
-    u8 d = CPUReadByte(source++);
+    u8 d = biosReadByte(from, source++);
     int l = d & 0x7F;
     if(d & 0x80) {
-      u8 data = CPUReadByte(source++);
+      u8 data = biosReadByte(from, source++);
       l += 3;
       for(int i = 0;i < l; i++) {
-        CPUWriteByte(dest++, data);
+        biosWriteByte(to, dest++, data);
         len--;
         if(len == 0)
           return;
@@ -1047,7 +1273,7 @@ void BIOS_RLUnCompWram()
     } else {
       l++;
       for(int i = 0; i < l; i++) {
-        CPUWriteByte(dest++,  CPUReadByte(source++));
+        biosWriteByte(to, dest++, biosReadByte(from, source++));
         len--;
         if(len == 0)
           return;
@@ -26,4 +26,11 @@ extern void BIOS_Sqrt();
 extern void BIOS_MidiKey2Freq();
 extern void BIOS_SndDriverJmpTableCopy();
 
+// How the block and decompression calls get at memory. BIOS_MEMORY_HOST
+// works on host pointers to plain memory and only goes through the memory
+// decode for I/O, save chips and the ends of regions, BIOS_MEMORY_DECODE
+// does every access through it, as the host bench compares against.
+enum { BIOS_MEMORY_DECODE, BIOS_MEMORY_HOST };
+extern int biosMemoryMode;
+
 #endif // BIOS_H
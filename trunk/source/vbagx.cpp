@@ -33,6 +33,9 @@
 #include "video.h"
 #include "gamesettings.h"
 #include "mem2.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "sramsave.h"
 #include "utils/FreeTypeGX.h"
 
 #include "vba/gba/Globals.h"
@@ -42,13 +45,14 @@ extern "C" {
 extern void __exception_setreload(int t);
 }
 
-extern int emulating;
+extern CORE_LOCAL int emulating;
 void StopColorizing();
 void gbSetPalette(u32 RRGGBB[]);
 int ScreenshotRequested = 0;
 int ConfigRequested = 0;
 int ShutdownRequested = 0;
 int ResetRequested = 0;
+int RewindRequested = 0;
 int ExitRequested = 0;
 char appPath[1024] = { 0 };
 char loadedFile[1024] = { 0 };
@@ -83,6 +87,9 @@ void ExitApp()
 
 	SavePrefs(SILENT);
 
+	if (ROMLoaded && !ConfigRequested)
+		SramSaveFlush();
+
 	if (ROMLoaded && !ConfigRequested && GCSettings.AutoSave == 1)
 		SaveBatteryOrStateAuto(FILE_SRAM, SILENT);
 
@@ -392,6 +399,7 @@ int main(int argc, char *argv[])
 		ConfigRequested = 0;
 		ScreenshotRequested = 0;
 		SwitchAudioMode(0);
+		SetAudioRateControl(GCSettings.pacing == 1);
 
 		// stop checking if devices were removed/inserted
 		// since we're starting emulation again
@@ -408,18 +416,28 @@ int main(int argc, char *argv[])
 				StopColorizing();
 		}
 
+		RewindInit(GCSettings.rewind);
+		RunAheadInit(GCSettings.runahead);
+		StartSramSave();
+
 		while (emulating) // emulation loop
 		{
-			emulator.emuMain(emulator.emuCount);
+			if(GCSettings.runahead)
+				RunAheadFrame(GCSettings.runahead);
+			else
+				emulator.emuMain(emulator.emuCount);
+			RewindUpdate(RewindRequested);
 
 			if(ResetRequested)
 			{
 				emulator.emuReset(); // reset game
 				ResetRequested = 0;
+				RewindReset();
 			}
 			if(ConfigRequested)
 			{
 				ResetVideo_Menu();
+				SramSaveFlush();
 				break; // leave emulation loop
 			}
 			#ifdef HW_RVL
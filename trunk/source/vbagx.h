@@ -76,6 +76,10 @@ struct SGCSettings{
 	int		xshift;		   // video output shift
 	int		yshift;
 	int     colorize;      // colorize Mono Gameboy games
+	int		pacing;        // 0 - timer, 1 - sound buffer
+	int		rewind;        // MB of rewind history, 0 - off
+	int		runahead;      // frames to run ahead, 0 - off
+	int		sramdelay;     // seconds without battery writes before a background save, 0 - off
 	int		WiiControls;   // Match Wii Game
 	int		WiimoteOrientation;
 	int		ExitAction;
@@ -99,6 +103,7 @@ bool SaneIOS(u32 ios);
 extern struct SGCSettings GCSettings;
 extern int ScreenshotRequested;
 extern int ConfigRequested;
+extern int RewindRequested;
 extern int ShutdownRequested;
 extern int ExitRequested;
 extern char appPath[];
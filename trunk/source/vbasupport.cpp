@@ -29,12 +29,16 @@
 #include "gamesettings.h"
 #include "preferences.h"
 #include "fastmath.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "sramsave.h"
 #include "utils/pngu.h"
 #include "utils/unzip/unzip.h"
 
 #include "vba/Util.h"
 #include "vba/common/Port.h"
 #include "vba/common/Patch.h"
+#include "vba/common/StateFile.h"
 #include "vba/gba/Flash.h"
 #include "vba/gba/RTC.h"
 #include "vba/gba/Sound.h"
@@ -47,8 +51,8 @@
 #include "vba/gb/gbSound.h"
 
 static u32 start;
-int cartridgeType = 0;
-u32 RomIdCode;
+CORE_LOCAL int cartridgeType = 0;
+CORE_LOCAL u32 RomIdCode;
 char RomTitle[17];
 
 int SunBars = 3;
@@ -58,12 +62,12 @@ bool TiltSideways = false;
  * VBA Globals
  ***************************************************************************/
 
-int systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+CORE_LOCAL int systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
 
 int systemDebug = 0;
-int emulating = 0;
+CORE_LOCAL int emulating = 0;
 
-int systemFrameSkip = 0;
+CORE_LOCAL int systemFrameSkip = 0;
 int systemVerbose = 0;
 
 int systemRedShift = 0;
@@ -77,12 +81,12 @@ u32 *systemColorMap32 = NULL;
 void gbSetPalette(u32 RRGGBB[]);
 bool StartColorizing();
 void StopColorizing();
-extern bool ColorizeGameboy;
-extern u16 systemMonoPalette[14];
+extern CORE_LOCAL bool ColorizeGameboy;
+extern CORE_LOCAL u16 systemMonoPalette[14];
 void gbSetBgPal(u8 WhichPal, u32 bright, u32 medium, u32 dark, u32 black=0x000000);
 void gbSetSpritePal(u8 WhichPal, u32 bright, u32 medium, u32 dark);
 
-struct EmulatedSystem emulator =
+CORE_LOCAL struct EmulatedSystem emulator =
 {
 	NULL,
 	NULL,
@@ -96,6 +100,8 @@ struct EmulatedSystem emulator =
 	NULL,
 	NULL,
 	NULL,
+	NULL,
+	NULL,
 	false,
 	0
 };
@@ -111,21 +117,75 @@ u32 systemGetClock( void )
 	return diff_usec(start, now) / 1000;
 }
 
-void systemFrame() {}
+void systemFrame()
+{
+	if(!RunAheadHidden())
+	{
+		RewindFrame();
+		SramSaveFrame();
+	}
+	RunAheadFrameEnd();
+}
+
 void systemScreenCapture(int a) {}
 void systemShowSpeed(int speed) {}
 void systemGbBorderOn() {}
 
 bool systemPauseOnFrame()
 {
-	return false;
+	return RunAheadPause();
 }
 
 static u32 lastTime = 0;
+static u32 lastUnderruns = 0;
 #define RATE60HZ 166666.67 // 1/6 second or 166666.67 usec
 
+/****************************************************************************
+* PaceBySound
+*
+* Frame pacing of rate control: sleeps while the sound ring holds more than
+* its target, skips more frames once the DSP drains it faster than the
+* emulation refills it
+****************************************************************************/
+static void PaceBySound()
+{
+	int buffered = AudioBufferedFrames();
+	int underruns = audioUnderruns - lastUnderruns;
+	lastUnderruns = audioUnderruns;
+
+	if(buffered > AUDIO_TARGET_FRAMES) // we're running ahead!
+		usleep((buffered - AUDIO_TARGET_FRAMES) * 125 / 6); // 48 frames per msec
+
+	UpdateAudioRate();
+
+	if (cartridgeType == 2) // GBA games require frameskipping
+	{
+		if(underruns)
+			systemFrameSkip += 2;
+		else if(buffered < AUDIO_TARGET_FRAMES / 2)
+			++systemFrameSkip;
+		else if(buffered > AUDIO_TARGET_FRAMES)
+			--systemFrameSkip;
+
+		if(systemFrameSkip > 20)
+			systemFrameSkip = 20;
+		else if(systemFrameSkip < 0)
+			systemFrameSkip = 0;
+	}
+	lastTime = gettime();
+}
+
 void system10Frames(int rate)
 {
+	if(RunAheadHidden())
+		return;
+
+	if(GCSettings.pacing == 1)
+	{
+		PaceBySound();
+		return;
+	}
+
 	u32 time = gettime();
 	u32 diff = diff_usec(lastTime, time);
 
@@ -201,7 +261,7 @@ bool MemCPUReadBatteryFile(char * membuffer, int size)
 	return true;
 }
 
-extern int gbaSaveType;
+extern CORE_LOCAL int gbaSaveType;
 
 int MemCPUWriteBatteryFile(char * membuffer)
 {
@@ -247,6 +307,31 @@ int MemCPUWriteBatteryFile(char * membuffer)
 	return result;
 }
 
+/****************************************************************************
+* StateFileMatches
+* Whether a version 2 state file was saved from the loaded game. Files
+* without an info chunk are taken as they are.
+****************************************************************************/
+
+static bool StateFileMatches(const u8 * file, int size)
+{
+	StateChunk chunk;
+
+	if(!stateFileFind(file, size, STATEFILE_INFO, &chunk))
+		return true;
+	if(chunk.size < sizeof(StateFileInfo) || chunk.offset + chunk.size > (u32)size ||
+		!stateFileCheck(file + chunk.offset, &chunk))
+		return false;
+
+	const StateFileInfo * info = (const StateFileInfo *)(file + chunk.offset);
+	u32 system = READ32LE(&info->system);
+	u32 gameCode = READ32LE(&info->gameCode);
+
+	if(system != (u32)cartridgeType)
+		return false;
+	return gameCode == 0 || RomIdCode == 0 || gameCode == RomIdCode;
+}
+
 /****************************************************************************
 * LoadBatteryOrState
 * Load Battery/State file into memory
@@ -263,6 +348,10 @@ bool LoadBatteryOrState(char * filepath, int action, bool silent)
 	if(!FindDevice(filepath, &device))
 		return 0;
 
+	// a background save may have stopped between its remove and rename
+	if(action == FILE_SRAM)
+		RecoverFile(filepath);
+
 	AllocSaveBuffer();
 
 	// load the file into savebuffer
@@ -277,10 +366,29 @@ bool LoadBatteryOrState(char * filepath, int action, bool silent)
 				result = MemgbReadBatteryFile((char *)savebuffer, offset);
 			else
 				result = MemCPUReadBatteryFile((char *)savebuffer, offset);
+			if(result)
+				SramSaveReset();
 		}
 		else
 		{
-			result = emulator.emuReadMemState((char *)savebuffer, offset);
+			StateChunk chunk;
+			char * state = (char *)savebuffer;
+			int size = offset;
+
+			// version 2 files carry the state as one chunk, older ones are
+			// the bare stream
+			if(stateFileFind(savebuffer, offset, STATEFILE_STATE, &chunk))
+			{
+				state += chunk.offset;
+				size = chunk.size;
+				if(chunk.offset + chunk.size > (u32)offset ||
+					!stateFileCheck(savebuffer + chunk.offset, &chunk) ||
+					!StateFileMatches(savebuffer, offset))
+					size = 0;
+			}
+			result = size > 0 && emulator.emuReadMemState(state, size);
+			if(result)
+				RewindReset();
 		}
 	}
 
@@ -354,15 +462,6 @@ bool SaveBatteryOrState(char * filepath, int action, bool silent)
 	if(!FindDevice(filepath, &device))
 		return 0;
 
-	if(action == FILE_SNAPSHOT && gameScreenPngSize > 0)
-	{
-		char screenpath[1024];
-		strncpy(screenpath, filepath, 1024);
-		screenpath[strlen(screenpath)-4] = 0;
-		sprintf(screenpath, "%s.png", screenpath);
-		SaveFile((char *)gameScreenPng, screenpath, gameScreenPngSize, silent);
-	}
-
 	AllocSaveBuffer();
 
 	// put VBA memory into savebuffer, sets datasize to size of memory written
@@ -375,8 +474,25 @@ bool SaveBatteryOrState(char * filepath, int action, bool silent)
 	}
 	else
 	{
-		if(emulator.emuWriteMemState((char *)savebuffer, SAVEBUFFERSIZE))
-			datasize = *((int *)(savebuffer+4)) + 8;
+		// the screen goes in the file ahead of the state, so the save
+		// browser can show it without reading the rest
+		StateFileInfo info;
+		memset(&info, 0, sizeof(info));
+		WRITE32LE(&info.system, cartridgeType);
+		WRITE32LE(&info.gameCode, RomIdCode);
+		strncpy(info.title, RomTitle, sizeof(info.title));
+
+		stateFileBegin(savebuffer);
+		stateFileAdd(savebuffer, SAVEBUFFERSIZE, STATEFILE_INFO, (u8 *)&info, sizeof(info));
+		if(gameScreenPngSize > 0)
+			stateFileAdd(savebuffer, SAVEBUFFERSIZE, STATEFILE_SCREEN, gameScreenPng, gameScreenPngSize);
+
+		// the cores write the state chunk in place
+		int next = stateFileNext(savebuffer);
+		u8 * state = savebuffer + next;
+		if(emulator.emuWriteMemState((char *)state, SAVEBUFFERSIZE - next) &&
+			stateFileAdd(savebuffer, SAVEBUFFERSIZE, STATEFILE_STATE, state, *((int *)(state+4)) + 8))
+			datasize = stateFileSize(savebuffer);
 	}
 
 	// write savebuffer into file
@@ -412,6 +528,31 @@ bool SaveBatteryOrStateAuto(int action, bool silent)
 	return SaveBatteryOrState(filepath, action, silent);
 }
 
+static int WriteBatteryImage(char * membuffer)
+{
+	if(cartridgeType == 1)
+		return MemgbWriteBatteryFile(membuffer);
+	return MemCPUWriteBatteryFile(membuffer);
+}
+
+/****************************************************************************
+* StartSramSave
+* Saves the battery in the background while the game runs, to the file
+* SaveBatteryOrStateAuto() writes, when battery saves are automatic
+****************************************************************************/
+void StartSramSave()
+{
+	char filepath[1024];
+	int delay = 0;
+
+	filepath[0] = 0;
+	if((GCSettings.AutoSave == 1 || GCSettings.AutoSave == 3) &&
+		MakeFilePath(filepath, FILE_SRAM, ROMFilename, 0))
+		delay = GCSettings.sramdelay * 60;
+
+	SramSaveStart(filepath, WriteBatteryImage, delay);
+}
+
 /****************************************************************************
 * Sound
 ****************************************************************************/
@@ -618,7 +759,8 @@ static int srcPitch = 0;
 
 void systemDrawScreen()
 {
-	GX_Render( srcWidth, srcHeight, pix, srcPitch );
+	if(RunAheadDraws())
+		GX_Render( srcWidth, srcHeight, pix, srcPitch );
 }
 
 static bool ValidGameId(u32 id)
@@ -757,6 +899,8 @@ static void ApplyPerImagePreferences()
 			cpuSaveType = gameSettings[snum].saveType;
 		if(gameSettings[snum].mirroringEnabled >= 0)
 			mirroringEnable = gameSettings[snum].mirroringEnabled;
+		if(gameSettings[snum].idleLoop != 0)
+			cpuIdleLoop = gameSettings[snum].idleLoop;
 	}
 	// In most cases this is already handled in GameSettings, but just to make sure:
 	switch (rom[0xac])
@@ -987,6 +1131,7 @@ bool LoadVBAROM()
 			rtcEnable(false);
 			agbPrintEnable(false);
 			mirroringEnable = false;
+			cpuIdleLoop = 0; // detect idle loops
 
 			// Apply preferences specific to this game
 			ApplyPerImagePreferences();
@@ -998,7 +1143,7 @@ bool LoadVBAROM()
 			CPUReset();
 		}
 
-		SetAudioRate(cartridgeType);
+		ResetAudio();
 		soundInit();
 
 		emulating = 1;
@@ -1006,6 +1151,8 @@ bool LoadVBAROM()
 		// reset frameskip variables
 		lastTime = systemFrameSkip = 0;
 
+		RewindReset();
+
 		// Start system clock
 		start = gettime();
 
@@ -13,10 +13,10 @@
 
 #include "vba/System.h"
 
-extern struct EmulatedSystem emulator;
-extern int cartridgeType;
+extern CORE_LOCAL struct EmulatedSystem emulator;
+extern CORE_LOCAL int cartridgeType;
 extern int SunBars;
-extern u32 RomIdCode;
+extern CORE_LOCAL u32 RomIdCode;
 extern bool TiltSideways;
 extern char RomTitle[];
 
@@ -28,5 +28,6 @@ bool LoadBatteryOrState(char * filepath, int action, bool silent);
 bool LoadBatteryOrStateAuto(int action, bool silent);
 bool SaveBatteryOrState(char * filepath, int action, bool silent);
 bool SaveBatteryOrStateAuto(int action, bool silent);
+void StartSramSave();
 
 #endif
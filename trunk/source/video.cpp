@@ -19,6 +19,7 @@
 #include "vbagx.h"
 #include "menu.h"
 #include "input.h"
+#include "fbconvert.h"
 
 s32 CursorX, CursorY;
 bool CursorVisible;
@@ -91,6 +92,31 @@ static camera cam = { {0.0F, 0.0F, 0.0F},
 static lwp_t vbthread;
 static unsigned char vbstack[TSTACK];
 
+/****************************************************************************
+ * Presenter
+ *
+ * GX_Render() only copies the frame into one of three buffers. The render
+ * thread converts the newest complete frame to the texture and draws it,
+ * so the emulator never waits for the vertical blank. When the render
+ * thread falls behind, a frame that was not drawn yet is replaced by the
+ * next one. Each buffer carries its frame size, and a frame taken for the
+ * screenshot is left in the EFB instead of being shown.
+ ***************************************************************************/
+#define PRESENT_BUFFERS 3
+static lwp_t prthread;
+static unsigned char prstack[TSTACK];
+static mutex_t presentmutex;
+static cond_t presentcond;
+static u8 *presentbuf[PRESENT_BUFFERS] = { NULL, NULL, NULL };
+static int presentwidth[PRESENT_BUFFERS];
+static int presentheight[PRESENT_BUFFERS];
+static bool presentkeep[PRESENT_BUFFERS];
+static int presentwrite = 0; // filled by GX_Render
+static int presentready = 1; // newest complete frame
+static int presentshown = 2; // drawn by the render thread
+static bool presentpending = false;
+static bool presentbusy = false;
+
 /****************************************************************************
  * vbgetback
  *
@@ -110,6 +136,57 @@ vbgetback (void *arg)
 	return NULL;
 }
 
+static void DrawFrame(u8 * buffer, int width, int height, bool keep);
+
+/****************************************************************************
+ * prrender
+ *
+ * Render thread, draws each frame handed over by GX_Render
+ ***************************************************************************/
+static void *
+prrender (void *arg)
+{
+	while (1)
+	{
+		LWP_MutexLock (presentmutex);
+		while (!presentpending)
+			LWP_CondWait (presentcond, presentmutex);
+
+		int slot = presentready;
+		presentready = presentshown;
+		presentshown = slot;
+		presentpending = false;
+		presentbusy = true;
+		int width = presentwidth[slot];
+		int height = presentheight[slot];
+		bool keep = presentkeep[slot];
+		LWP_MutexUnlock (presentmutex);
+
+		DrawFrame (presentbuf[slot], width, height, keep);
+
+		LWP_MutexLock (presentmutex);
+		presentbusy = false;
+		LWP_CondBroadcast (presentcond);
+		LWP_MutexUnlock (presentmutex);
+	}
+	return NULL;
+}
+
+/****************************************************************************
+ * WaitPresent
+ *
+ * Waits until the render thread has drawn every frame and is idle, GX
+ * must not be used by another thread before that
+ ***************************************************************************/
+static void
+WaitPresent ()
+{
+	LWP_MutexLock (presentmutex);
+	while (presentpending || presentbusy)
+		LWP_CondWait (presentcond, presentmutex);
+	LWP_MutexUnlock (presentmutex);
+}
+
 /****************************************************************************
  * copy_to_xfb
  *
@@ -258,6 +335,7 @@ static inline void draw_cursor(Mtx v)
  ***************************************************************************/
 void StopGX()
 {
+	WaitPresent();
 	GX_AbortFrame();
 	GX_Flush();
 
@@ -413,6 +491,10 @@ InitializeVideo ()
 
 	LWP_CreateThread (&vbthread, vbgetback, NULL, vbstack, TSTACK, 68);
 
+	LWP_MutexInit (&presentmutex, false);
+	LWP_CondInit (&presentcond);
+	LWP_CreateThread (&prthread, prrender, NULL, prstack, TSTACK, 68);
+
 	// Initialise GX
 	GXColor background = { 0, 0, 0, 0xff };
 	memset (gp_fifo, 0, DEFAULT_FIFO_SIZE);
@@ -554,6 +636,8 @@ ResetVideo_Emu ()
 
 void GX_Render_Init(int width, int height)
 {
+	WaitPresent();
+
 	if (texturemem)
 		free(texturemem);
 
@@ -564,6 +648,15 @@ void GX_Render_Init(int width, int height)
 
 	memset(texturemem, 0, texturesize);
 
+	for (int i = 0; i < PRESENT_BUFFERS; ++i)
+	{
+		if (presentbuf[i])
+			free(presentbuf[i]);
+		presentbuf[i] = (u8 *) memalign(32, texturesize);
+		memset(presentbuf[i], 0, texturesize);
+	}
+	presentpending = false;
+
 	/*** Setup for first call to scaler ***/
 	vwidth = width;
 	vheight = height;
@@ -572,31 +665,50 @@ void GX_Render_Init(int width, int height)
 /****************************************************************************
 * GX_Render
 *
-* Pass in a buffer, width and height to update as a tiled RGB565 texture
+* Pass in a buffer, width and height to update as a tiled RGB565 texture.
+* The frame is copied and drawn later by the render thread.
 ****************************************************************************/
 void GX_Render(int width, int height, u8 * buffer, int pitch)
 {
-	int h, w;
-	long long int *dst = (long long int *) texturemem;
-	long long int *src1 = (long long int *) buffer;
-	long long int *src2 = (long long int *) (buffer + pitch);
-	long long int *src3 = (long long int *) (buffer + (pitch << 1));
-	long long int *src4 = (long long int *) (buffer + (pitch * 3));
-	int rowpitch = (pitch >> 3) * 3;
-	int rowadjust = ( pitch % 8 ) << 2;
-
-	vwidth = width;
-	vheight = height;
+	u8 *dst = presentbuf[presentwrite];
+	bool screenshot = ScreenshotRequested;
+
+	for (int h = 0; h < height; ++h)
+		memcpy(dst + h * width * 2, buffer + h * pitch, width * 2);
+
+	LWP_MutexLock (presentmutex);
+	int slot = presentwrite;
+	presentwidth[slot] = width;
+	presentheight[slot] = height;
+	presentkeep[slot] = screenshot;
+	presentwrite = presentready;
+	presentready = slot;
+	presentpending = true;
+	LWP_CondBroadcast (presentcond);
+	LWP_MutexUnlock (presentmutex);
+
+	if (screenshot)
+	{
+		// the render thread leaves this frame in the EFB
+		WaitPresent();
+		ScreenshotRequested = 0;
+		TakeScreenshot();
+		ConfigRequested = 1;
+	}
+}
 
-	int vwid2 = (vwidth >> 2);
-	char *ra = NULL;
-	
+/****************************************************************************
+* DrawFrame
+*
+* Converts a frame to the tiled RGB565 texture and draws it, called on the
+* render thread. A kept frame stays in the EFB for TakeScreenshot().
+****************************************************************************/
+static void DrawFrame(u8 * buffer, int width, int height, bool keep)
+{
 	// Ensure previous vb has complete
 	while ((LWP_ThreadIsSuspended (vbthread) == 0) || (copynow == GX_TRUE))
 		usleep (50);
 
-	whichfb ^= 1;
-
 	if(updateScaling)
 		UpdateScaling();
 
@@ -606,33 +718,7 @@ void GX_Render(int width, int height, u8 * buffer, int pitch)
 	GX_SetTevOp(GX_TEVSTAGE0, GX_DECAL);
 	GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
 
-	for (h = 0; h < vheight; h += 4)
-	{
-		for (w = 0; w < vwid2; ++w)
-		{
-			*dst++ = *src1++;
-			*dst++ = *src2++;
-			*dst++ = *src3++;
-			*dst++ = *src4++;
-		}
-
-		src1 += rowpitch;
-		src2 += rowpitch;
-		src3 += rowpitch;
-		src4 += rowpitch;
-
-		if ( rowadjust )
-		{
-			ra = (char *)src1;
-			src1 = (long long int *)(ra + rowadjust);
-			ra = (char *)src2;
-			src2 = (long long int *)(ra + rowadjust);
-			ra = (char *)src3;
-			src3 = (long long int *)(ra + rowadjust);
-			ra = (char *)src4;
-			src4 = (long long int *)(ra + rowadjust);
-		}
-	}
+	ConvertFrame(FB_RGB565_TILED, texturemem, buffer, width, height, width * 2);
 
 	// load texture into GX
 	DCFlushRange(texturemem, texturesize);
@@ -648,19 +734,16 @@ void GX_Render(int width, int height, u8 * buffer, int pitch)
 	#endif
 	GX_DrawDone();
 
-	if(ScreenshotRequested)
-	{
-		ScreenshotRequested = 0;
-		TakeScreenshot();
-		ConfigRequested = 1;
-	}
+	if(keep)
+		return;
 
 	// EFB is ready to be copied into XFB
+	whichfb ^= 1;
 	VIDEO_SetNextFramebuffer(xfb[whichfb]);
 	VIDEO_Flush();
 	copynow = GX_TRUE;
 
-	// Return to caller, don't waste time waiting for vb
+	// Don't waste time waiting for vb
 	LWP_ResumeThread (vbthread);
 }
 
@@ -693,6 +776,9 @@ ResetVideo_Menu ()
 	Mtx44 p;
 	f32 yscale;
 	u32 xfbHeight;
+
+	WaitPresent(); // the render thread may still be drawing
+
 	GXRModeObj * rmode = FindVideoMode();
 
 	SetupVideoMode(rmode); // reconfigure VI